@@ -0,0 +1,18 @@
+#version 330 core
+in vec3 Normal;
+in vec3 ViewDir;
+flat in float Fade;
+
+out vec4 FragColor;
+
+uniform vec3 echoColor;
+uniform float echoOpacity;
+
+void main()
+{
+    // ghostly: mostly the silhouette, faint where the surface faces the viewer
+    float facing = abs(dot(normalize(Normal), normalize(ViewDir)));
+    float rim = pow(1.0 - facing, 2.0);
+    float alpha = echoOpacity * Fade * (0.15 + 0.85 * rim);
+    FragColor = vec4(echoColor * alpha, alpha); // premultiplied
+}
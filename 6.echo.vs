@@ -0,0 +1,27 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+
+const int MAX_ECHOES = 16;
+
+out vec3 Normal;
+out vec3 ViewDir;
+flat out float Fade;
+
+uniform mat4 echoModel[MAX_ECHOES]; // per ring slot: the shape's transform when it was captured
+uniform float echoFade[MAX_ECHOES]; // per ring slot: 1 for the newest echo, towards 0 for the oldest
+uniform int slotVertices;           // gl_VertexID includes the base vertex, so this finds the slot
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 viewPos;
+
+void main()
+{
+    int slot = gl_VertexID / slotVertices;
+    mat4 model = echoModel[slot];
+    vec3 position = vec3(model * vec4(aPos, 1.0));
+    Normal = mat3(transpose(inverse(model))) * aNormal;
+    ViewDir = viewPos - position;
+    Fade = echoFade[slot];
+    gl_Position = projection * view * vec4(position, 1.0);
+}
@@ -0,0 +1,64 @@
+#version 330 core
+layout (location = 0) in vec2 aSurface;     // (u, v) angles of the parameter grid
+layout (location = 1) in vec2 aTexCoords;
+layout (location = 3) in vec3 aBasePos;     // per instance
+layout (location = 4) in float aHeight;     // per instance
+layout (location = 5) in float aAngle;      // per instance
+layout (location = 6) in float aN1;         // per instance
+layout (location = 7) in float aN2;         // per instance
+layout (location = 8) in float aMorph;      // per instance, 0 .. 1 proximity response
+
+out vec3 FragPos;
+out vec3 Normal;
+out vec2 TexCoords;
+
+uniform mat4 arrayModel;   // places the whole array in the world
+uniform float elementScale;
+uniform vec2 reactiveExponents; // (n1, n2) approached as aMorph goes to 1
+uniform mat4 view;
+uniform mat4 projection;
+#ifdef STEREO_EYE
+uniform mat4 eyeViewProjection[2]; // stereo variant, see stereo_target.h
+#endif
+
+// signed power, same as powe() in generateSuperellipsoid
+float powe(float base, float e)
+{
+    return (base < 0.0 ? -1.0 : 1.0) * pow(abs(base), e);
+}
+
+void main()
+{
+    float cu = cos(aSurface.x), su = sin(aSurface.x);
+    float cv = cos(aSurface.y), sv = sin(aSurface.y);
+
+    float n1 = mix(aN1, reactiveExponents.x, aMorph);
+    float n2 = mix(aN2, reactiveExponents.y, aMorph);
+
+    // superellipsoid with a = b = c = 1, z up as on the CPU path
+    vec3 pos = vec3(powe(cu, n1) * powe(cv, n2),
+                    powe(cu, n1) * powe(sv, n2),
+                    powe(su, n1));
+    // approximate normal, x / a^2 etc. with unit axes
+    vec3 n = normalize(pos);
+
+    // spin around the world up axis, then scale and lift
+    float c = cos(aAngle), s = sin(aAngle);
+    mat3 spin = mat3(c, 0.0, -s,
+                     0.0, 1.0, 0.0,
+                     s, 0.0, c);
+    vec3 local = spin * (pos * elementScale) + aBasePos + vec3(0.0, aHeight, 0.0);
+
+    FragPos = vec3(arrayModel * vec4(local, 1.0));
+    Normal = mat3(transpose(inverse(arrayModel))) * (spin * n);
+    TexCoords = aTexCoords;
+
+#ifdef STEREO_EYE
+    gl_Position = eyeViewProjection[STEREO_EYE] * vec4(FragPos, 1.0);
+#ifdef STEREO_INSTANCED
+    gl_Layer = STEREO_EYE;
+#endif
+#else
+    gl_Position = projection * view * vec4(FragPos, 1.0);
+#endif
+}
@@ -0,0 +1,7 @@
+#version 450
+layout (location = 0) out vec4 FragColor;
+
+void main()
+{
+    FragColor = vec4(1.0); // set all 4 vector values to 1.0
+}
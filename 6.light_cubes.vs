@@ -0,0 +1,21 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 3) in mat4 aModel; // per instance, see instance_batches.h
+
+uniform mat4 view;
+uniform mat4 projection;
+#ifdef STEREO_EYE
+uniform mat4 eyeViewProjection[2]; // stereo variant, see stereo_target.h
+#endif
+
+void main()
+{
+#ifdef STEREO_EYE
+    gl_Position = eyeViewProjection[STEREO_EYE] * aModel * vec4(aPos, 1.0);
+#ifdef STEREO_INSTANCED
+    gl_Layer = STEREO_EYE;
+#endif
+#else
+    gl_Position = projection * view * aModel * vec4(aPos, 1.0);
+#endif
+}
\ No newline at end of file
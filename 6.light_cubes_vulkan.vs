@@ -0,0 +1,14 @@
+#version 450
+// the Vulkan variant of 6.light_cubes.vs, see vulkan_renderer.h
+layout (location = 0) in vec3 aPos;
+layout (location = 3) in mat4 aModel; // per instance, see instance_batches.h
+
+// the start of the block in 6.multiple_lights_vulkan.vs
+layout (std140, set = 0, binding = 0) uniform Lighting {
+    mat4 projectionView;
+};
+
+void main()
+{
+    gl_Position = projectionView * aModel * vec4(aPos, 1.0);
+}
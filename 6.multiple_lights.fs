@@ -44,9 +44,18 @@ struct SpotLight {
 
 #define NR_POINT_LIGHTS 4
 
+#ifdef RAY_MARCHED
+// ray-marched variant, see superellipsoid_raymarch.h: the surface point comes from the march in
+// 6.superellipsoid_raymarch.fs instead of the rasterizer
+vec3 FragPos;
+vec3 Normal;
+vec2 TexCoords;
+void rayMarch(out vec3 fragPos, out vec3 normal, out vec2 texCoords);
+#else
 in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
+#endif
 
 uniform vec3 viewPos;
 uniform DirLight dirLight;
@@ -61,6 +70,9 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 
 void main()
 {    
+#ifdef RAY_MARCHED
+    rayMarch(FragPos, Normal, TexCoords);
+#endif
     // properties
     vec3 norm = normalize(Normal);
     vec3 viewDir = normalize(viewPos - FragPos);
@@ -2,20 +2,31 @@
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
+layout (location = 3) in mat4 aModel;        // per instance, locations 3 - 6
+layout (location = 7) in mat3 aNormalMatrix; // per instance, locations 7 - 9; see instance_batches.h
 
 out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
 
-uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
+#ifdef STEREO_EYE
+uniform mat4 eyeViewProjection[2]; // stereo variant, see stereo_target.h
+#endif
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;  
+    FragPos = vec3(aModel * vec4(aPos, 1.0));
+    Normal = aNormalMatrix * aNormal;
     TexCoords = aTexCoords;
     
+#ifdef STEREO_EYE
+    gl_Position = eyeViewProjection[STEREO_EYE] * vec4(FragPos, 1.0);
+#ifdef STEREO_INSTANCED
+    gl_Layer = STEREO_EYE;
+#endif
+#else
     gl_Position = projection * view * vec4(FragPos, 1.0);
+#endif
 }
\ No newline at end of file
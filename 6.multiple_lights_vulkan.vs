@@ -0,0 +1,21 @@
+#version 450
+// the Vulkan variant of 6.multiple_lights.vs, see vulkan_renderer.h
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 3) in mat4 aModel;        // per instance, locations 3 - 6
+layout (location = 7) in mat3 aNormalMatrix; // per instance, locations 7 - 9; see instance_batches.h
+
+layout (location = 0) out vec3 FragPos;
+layout (location = 1) out vec3 Normal;
+
+// the start of the block in 6.multiple_lights_vulkan.fs
+layout (std140, set = 0, binding = 0) uniform Lighting {
+    mat4 projectionView; // with Vulkan's clip depth
+};
+
+void main()
+{
+    FragPos = vec3(aModel * vec4(aPos, 1.0));
+    Normal = aNormalMatrix * aNormal;
+    gl_Position = projectionView * vec4(FragPos, 1.0);
+}
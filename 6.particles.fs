@@ -0,0 +1,17 @@
+#version 330 core
+in float life;
+out vec4 FragColor;
+
+uniform float brightness;   // per sprite, summed additively
+
+void main()
+{
+    // round sprite, soft towards the rim, cooling and fading with age
+    vec2 d = gl_PointCoord * 2.0 - 1.0;
+    float r2 = dot(d, d);
+    if (r2 > 1.0)
+        discard;
+    float fade = brightness * (1.0 - r2) * (1.0 - life);
+    vec3 color = mix(vec3(1.0, 0.85, 0.45), vec3(0.85, 0.25, 0.1), life);
+    FragColor = vec4(color * fade, fade);
+}
@@ -0,0 +1,19 @@
+#version 330 core
+layout (location = 0) in vec3 aPosition;
+layout (location = 1) in float aAge;        // seconds; negative until the first birth
+
+out float life;             // 0 at birth, 1 at death
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform float lifetime;
+uniform float pointScale;   // sprite diameter in pixels at unit distance
+
+void main()
+{
+    vec4 eye = view * vec4(aPosition, 1.0);
+    life = clamp(aAge / lifetime, 0.0, 1.0);
+    // unborn particles are pushed outside the clip volume
+    gl_Position = aAge < 0.0 ? vec4(0.0, 0.0, 2.0, 1.0) : projection * eye;
+    gl_PointSize = clamp(pointScale * (1.0 - 0.5 * life) / max(-eye.z, 0.05), 1.0, 32.0);
+}
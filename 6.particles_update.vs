@@ -0,0 +1,72 @@
+#version 330 core
+layout (location = 0) in vec3 aPosition;
+layout (location = 1) in float aAge;        // seconds; negative until the first birth
+layout (location = 2) in vec4 aVelocity;
+
+// captured by transform feedback, interleaved in the same layout as the input
+out vec3 position;
+out float age;
+out vec4 velocity;
+
+// per triangle, 7 texels: 3 positions, 3 normals, (alias probability, alias index)
+uniform samplerBuffer emitter;
+uniform int triangleCount;
+uniform mat4 model;
+uniform mat3 normalMatrix;
+uniform float dt;
+uniform float lifetime;
+uniform float speed;
+uniform float spread;
+uniform float damping;      // velocity kept this step
+uniform vec3 gravity;
+uniform uint seed;          // changes every step
+
+// lowbias32, the same hash SurfaceParticles uses on the CPU
+uint hash(uint x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+float random(inout uint h)
+{
+    h = hash(h);
+    return float(h >> 8) * (1.0 / 16777216.0);
+}
+
+void main()
+{
+    vec3 v = aVelocity.xyz * damping + gravity * dt;
+    vec3 p = aPosition + v * dt;
+    float aged = aAge + dt;
+    // reborn whenever the age crosses a multiple of the lifetime (including 0, the first birth)
+    float cycles = floor(aged / lifetime);
+    if (floor(aAge / lifetime) < cycles)
+    {
+        aged -= cycles * lifetime;
+        uint h = uint(gl_VertexID) * 0x9E3779B9u ^ seed;
+        float column = random(h) * float(triangleCount);
+        int t = min(int(column), triangleCount - 1);
+        vec4 alias = texelFetch(emitter, t * 7 + 6);
+        if (column - float(t) >= alias.x)
+            t = int(alias.y);
+        float s = sqrt(random(h)), r = random(h);
+        vec3 b = vec3(1.0 - s, s * (1.0 - r), s * r);
+        int first = t * 7;
+        p = b.x * texelFetch(emitter, first).xyz + b.y * texelFetch(emitter, first + 1).xyz + b.z * texelFetch(emitter, first + 2).xyz;
+        vec3 n = b.x * texelFetch(emitter, first + 3).xyz + b.y * texelFetch(emitter, first + 4).xyz + b.z * texelFetch(emitter, first + 5).xyz;
+        p = vec3(model * vec4(p, 1.0));
+        n = normalMatrix * n;
+        n = dot(n, n) > 0.0 ? normalize(n) : vec3(0.0, 1.0, 0.0);
+        float launch = speed * (0.7 + 0.6 * random(h));
+        vec3 jitter = vec3(random(h), random(h), random(h)) * 2.0 - 1.0;
+        v = n * launch + jitter * (spread * speed);
+    }
+    position = p;
+    age = aged;
+    velocity = vec4(v, 0.0);
+}
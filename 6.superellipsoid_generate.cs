@@ -0,0 +1,74 @@
+#version 430 core
+// one invocation per vertex of generateSuperellipsoid's grid (x) and per shape (y)
+layout (local_size_x = 64) in;
+
+struct Shape
+{
+    vec4 radiiN1;  // a, b, c, n1
+    vec4 n2;       // n2, unused
+};
+
+layout (std430, binding = 0) readonly buffer Shapes
+{
+    Shape shapes[];
+};
+
+// interleaved like Vertex: position, normal, texture coordinates
+layout (std430, binding = 1) writeonly buffer Vertices
+{
+    float vertices[];
+};
+
+uniform int stacks;
+uniform int slices;
+uniform uint firstVertex; // where shape 0 starts in vertices; shape k follows at k * grid vertices
+uniform int shapeCount;
+
+const float PI = 3.14159265358979323846;
+
+// sign(base) * |base|^e; pow() is undefined for negative bases
+float signedPow(float base, float e)
+{
+    return sign(base) * pow(abs(base), e);
+}
+
+void main()
+{
+    uint gridVertices = uint((stacks + 1) * (slices + 1));
+    uint vertex = gl_GlobalInvocationID.x;
+    int shape = int(gl_GlobalInvocationID.y);
+    if (vertex >= gridVertices || shape >= shapeCount)
+        return;
+    int i = int(vertex) / (slices + 1), j = int(vertex) % (slices + 1);
+    vec2 grid = vec2(float(j) / float(slices), float(i) / float(stacks));
+
+    vec3 radii = shapes[shape].radiiN1.xyz;
+    float n1 = shapes[shape].radiiN1.w, n2 = shapes[shape].n2.x;
+    float u = -PI / 2.0 + grid.y * PI;
+    float v = -PI + grid.x * 2.0 * PI;
+    float cu = cos(u), su = sin(u);
+    float cv = cos(v), sv = sin(v);
+
+    vec3 p = radii * vec3(signedPow(cu, n1) * signedPow(cv, n2),
+                          signedPow(cu, n1) * signedPow(sv, n2),
+                          signedPow(su, n1));
+    // the analytic normal, the cross product of the surface tangents up to scale; where that
+    // degenerates (the poles, or exponents of 2 meeting a zero) the CPU path's approximation stands in
+    vec3 n = vec3(signedPow(cu, 2.0 - n1) * signedPow(cv, 2.0 - n2),
+                  signedPow(cu, 2.0 - n1) * signedPow(sv, 2.0 - n2),
+                  signedPow(su, 2.0 - n1)) / radii;
+    float length2 = dot(n, n);
+    if (!(length2 > 1e-20) || isinf(length2))
+        n = p / (radii * radii);
+    n = normalize(n);
+
+    uint first = (firstVertex + uint(shape) * gridVertices + vertex) * 8u;
+    vertices[first + 0u] = p.x;
+    vertices[first + 1u] = p.y;
+    vertices[first + 2u] = p.z;
+    vertices[first + 3u] = n.x;
+    vertices[first + 4u] = n.y;
+    vertices[first + 5u] = n.z;
+    vertices[first + 6u] = grid.x;
+    vertices[first + 7u] = grid.y;
+}
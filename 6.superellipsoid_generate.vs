@@ -0,0 +1,35 @@
+#version 330 core
+// one vertex of generateSuperellipsoid's grid: (j / slices, i / stacks), which is also its texture coordinate
+layout (location = 0) in vec2 aGrid;
+
+// captured by transform feedback, interleaved in the layout of Vertex (position, normal, texture coordinates)
+out vec3 position;
+out vec3 normal;
+out vec2 texCoords;
+
+uniform vec3 radii;     // a, b, c
+uniform vec2 exponents; // n1, n2
+
+const float PI = 3.14159265358979323846;
+
+// sign(base) * |base|^e; pow() is undefined for negative bases
+float signedPow(float base, float e)
+{
+    return sign(base) * pow(abs(base), e);
+}
+
+void main()
+{
+    float u = -PI / 2.0 + aGrid.y * PI;
+    float v = -PI + aGrid.x * 2.0 * PI;
+    float cu = cos(u), su = sin(u);
+    float cv = cos(v), sv = sin(v);
+
+    vec3 p = radii * vec3(signedPow(cu, exponents.x) * signedPow(cv, exponents.y),
+                          signedPow(cu, exponents.x) * signedPow(sv, exponents.y),
+                          signedPow(su, exponents.x));
+    position = p;
+    // the same approximate normal as the CPU path
+    normal = normalize(p / (radii * radii));
+    texCoords = aGrid;
+}
@@ -0,0 +1,103 @@
+#version 330 core
+// The surface for 6.multiple_lights.fs built with RAY_MARCHED: each fragment of the proxy box
+// marches its view ray through the box in object space to the superellipsoid, whose inside-outside
+// function is
+//     F(p) = (|x/a|^(2/n2) + |y/b|^(2/n2))^(n2/n1) + |z/c|^(2/n1),  F = 1 on the surface,
+// and hands the hit point, analytic normal and texture coordinates to the lighting.
+in vec3 objectPos;
+flat in vec3 objectCamera;
+flat in mat4 model;
+flat in mat3 normalMatrix;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 radii;     // a, b, c
+uniform vec2 exponents; // n1, n2
+uniform float stepScale; // the shape's smallest support distance; see superellipsoid_raymarch.h
+uniform int maxSteps;
+
+const float PI = 3.14159265358979323846;
+
+float signedPow(float base, float e)
+{
+    return sign(base) * pow(abs(base), e);
+}
+
+// F^(n1 / 2): homogeneous of degree 1, so it grows linearly along every ray from the centre and,
+// with gradient at most 1 / stepScale, (gauge - 1) * stepScale never overshoots the surface
+float gauge(vec3 p)
+{
+    vec3 q = abs(p / radii);
+    float n1 = exponents.x, n2 = exponents.y;
+    float f = pow(pow(q.x, 2.0 / n2) + pow(q.y, 2.0 / n2), n2 / n1) + pow(q.z, 2.0 / n1);
+    return pow(f, n1 / 2.0);
+}
+
+// discards rays that miss and writes gl_FragDepth for the hit
+void rayMarch(out vec3 fragPos, out vec3 normal, out vec2 texCoords)
+{
+    vec3 origin = objectCamera;
+    vec3 dir = normalize(objectPos - objectCamera);
+
+    // the part of the ray inside the box, from the camera if it is inside
+    vec3 t0 = (-radii - origin) / dir, t1 = (radii - origin) / dir;
+    vec3 tLow = min(t0, t1), tHigh = max(t0, t1);
+    float tNear = max(max(max(tLow.x, tLow.y), tLow.z), 0.0);
+    float tFar = min(min(tHigh.x, tHigh.y), tHigh.z);
+    if (tNear >= tFar)
+        discard;
+
+    // steps of the bound, but never shorter than would cross the box in maxSteps: thinner
+    // features than that can be stepped over where the bound is weak (exponents above 2)
+    float minStep = (tFar - tNear) / float(maxSteps);
+    float t = tNear, outside = tNear;
+    bool hit = false;
+    for (int i = 0; i < maxSteps && t <= tFar; i++)
+    {
+        float g = gauge(origin + dir * t);
+        if (g <= 1.0)
+        {
+            hit = true;
+            break;
+        }
+        outside = t;
+        t += max((g - 1.0) * stepScale, minStep);
+    }
+    if (!hit)
+        discard;
+    // the crossing lies between the last point outside and the first inside
+    for (int i = 0; i < 8; i++)
+    {
+        float mid = 0.5 * (outside + t);
+        if (gauge(origin + dir * mid) <= 1.0)
+            t = mid;
+        else
+            outside = mid;
+    }
+    vec3 p = origin + dir * t;
+
+    // the gradient of F up to the factor 2 / n1; where it degenerates (the axes, exponents above
+    // 2 meeting a zero) the mesh path's approximation stands in
+    vec3 q = p / radii;
+    float n1 = exponents.x, n2 = exponents.y;
+    float xy = pow(abs(q.x), 2.0 / n2) + pow(abs(q.y), 2.0 / n2);
+    float xyScale = pow(xy, n2 / n1 - 1.0);
+    vec3 n = vec3(xyScale * signedPow(q.x, 2.0 / n2 - 1.0),
+                  xyScale * signedPow(q.y, 2.0 / n2 - 1.0),
+                  signedPow(q.z, 2.0 / n1 - 1.0)) / radii;
+    float length2 = dot(n, n);
+    if (!(length2 > 1e-20) || isinf(length2))
+        n = p / (radii * radii);
+
+    // the (u, v) of the parametrisation the mesh is generated from
+    float u = atan(signedPow(q.z, 1.0 / n1), pow(xy, n2 / (2.0 * n1)));
+    float v = atan(signedPow(q.y, 1.0 / n2), signedPow(q.x, 1.0 / n2));
+    texCoords = vec2((v + PI) / (2.0 * PI), (u + PI / 2.0) / PI);
+
+    fragPos = vec3(model * vec4(p, 1.0));
+    normal = normalMatrix * normalize(n);
+    vec4 clip = projection * view * vec4(fragPos, 1.0);
+    if (clip.z < -clip.w)
+        discard; // in front of the near plane
+    gl_FragDepth = 0.5 * clip.z / clip.w + 0.5;
+}
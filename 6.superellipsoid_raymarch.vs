@@ -0,0 +1,26 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;          // proxy box corner, -1 or 1 on each axis
+layout (location = 3) in mat4 aModel;        // per instance, locations 3 - 6
+layout (location = 7) in mat3 aNormalMatrix; // per instance, locations 7 - 9; see instance_batches.h
+
+// the box |p| <= radii around the shape in object space, and what the ray march needs to get there
+out vec3 objectPos;
+flat out vec3 objectCamera;
+flat out mat4 model;
+flat out mat3 normalMatrix;
+
+uniform mat4 view;
+uniform mat4 projection;
+uniform vec3 viewPos;
+uniform vec3 radii;
+
+void main()
+{
+    // a little larger than the shape, so rays grazing a box-like shape still enter the proxy
+    objectPos = aPos * radii * 1.001;
+    // the normal matrix is the inverse transpose of the model's linear part
+    objectCamera = transpose(aNormalMatrix) * (viewPos - vec3(aModel[3]));
+    model = aModel;
+    normalMatrix = aNormalMatrix;
+    gl_Position = projection * view * aModel * vec4(objectPos, 1.0);
+}
@@ -0,0 +1,16 @@
+#version 400 core
+// a corner of the coarse patch grid: (j / slices, i / stacks), as in generateSuperellipsoid
+layout (location = 0) in vec2 aGrid;
+layout (location = 3) in mat4 aModel;        // per instance, locations 3 - 6
+layout (location = 7) in mat3 aNormalMatrix; // per instance, locations 7 - 9; see instance_batches.h
+
+out vec2 vGrid;
+out mat4 vModel;
+out mat3 vNormalMatrix;
+
+void main()
+{
+    vGrid = aGrid;
+    vModel = aModel;
+    vNormalMatrix = aNormalMatrix;
+}
@@ -0,0 +1,311 @@
+#ifndef ANIMATION_CURVES_H
+#define ANIMATION_CURVES_H
+
+#include <glm/glm.hpp>
+
+#include "simd.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+// Keyframed animation channels (shape parameters, transform components, light properties)
+// evaluated in bulk once per frame.
+//
+// Every segment between two keys is compiled to the same form regardless of its interpolation:
+// a cubic x(s) mapping the segment parameter s in [0, 1] to normalised time, and a cubic value(s).
+// Hermite, linear and step segments have x(s) = s; Bezier segments carry their handles' time
+// coordinates in x(s), which is inverted with a few Newton steps. Evaluation then is branch-free
+// and runs four channels per SIMD operation, with the segment coefficients gathered from SoA arrays.
+//
+// Each channel remembers the segment it was last evaluated in. Playback forwards or backwards by
+// at most one segment per frame stays O(1); any other seek (scrubbing) is a binary search.
+class AnimationCurves
+{
+public:
+    enum Interpolation { STEP, LINEAR, HERMITE, BEZIER };
+
+    // interpolation applies to the segment leaving the key. Hermite slopes are in value per
+    // second; Bezier handles are (time, value) offsets from the key, the in-handle pointing back
+    struct Key
+    {
+        float time = 0.0f;
+        float value = 0.0f;
+        Interpolation interpolation = LINEAR;
+        float inSlope = 0.0f, outSlope = 0.0f;
+        glm::vec2 inHandle = glm::vec2(0.0f), outHandle = glm::vec2(0.0f);
+    };
+
+    // looping channels repeat their first-to-last key span; others hold the end values
+    int addChannel(const std::string& name, bool loop = false)
+    {
+        channels.push_back(Channel());
+        channels.back().name = name;
+        channels.back().loop = loop;
+        compiled = false;
+        return (int)channels.size() - 1;
+    }
+
+    int channelIndex(const std::string& name) const
+    {
+        for (size_t i = 0; i < channels.size(); i++)
+            if (channels[i].name == name)
+                return (int)i;
+        return -1;
+    }
+
+    size_t channelCount() const { return channels.size(); }
+    const std::string& channelName(int channel) const { return channels[channel].name; }
+    bool channelLoops(int channel) const { return channels[channel].loop; }
+    // sorted by time
+    const std::vector<Key>& keys(int channel) const { return channels[channel].keys; }
+
+    // replaces a channel's keys and looping, e.g. with ones loaded from a scene file
+    void setKeys(int channel, const Key* keys, size_t count, bool loop)
+    {
+        channels[channel].loop = loop;
+        channels[channel].keys.clear();
+        for (size_t k = 0; k < count; k++)
+            addKey(channel, keys[k]);
+        compiled = false;
+    }
+
+    // keys may be added in any order; a key at an existing time replaces it
+    void addKey(int channel, const Key& key)
+    {
+        std::vector<Key>& keys = channels[channel].keys;
+        auto at = std::lower_bound(keys.begin(), keys.end(), key.time, [](const Key& k, float time) { return k.time < time; });
+        if (at != keys.end() && at->time == key.time)
+            *at = key;
+        else
+            keys.insert(at, key);
+        compiled = false;
+    }
+
+    void addLinearKey(int channel, float time, float value) { addKey(channel, makeKey(time, value, LINEAR)); }
+    void addStepKey(int channel, float time, float value) { addKey(channel, makeKey(time, value, STEP)); }
+
+    void addHermiteKey(int channel, float time, float value, float inSlope, float outSlope)
+    {
+        Key key = makeKey(time, value, HERMITE);
+        key.inSlope = inSlope;
+        key.outSlope = outSlope;
+        addKey(channel, key);
+    }
+
+    void addBezierKey(int channel, float time, float value, const glm::vec2& inHandle, const glm::vec2& outHandle)
+    {
+        Key key = makeKey(time, value, BEZIER);
+        key.inHandle = inHandle;
+        key.outHandle = outHandle;
+        addKey(channel, key);
+    }
+
+    // evaluates every channel at time t into values()
+    void evaluate(float t, ThreadPool& pool)
+    {
+        if (!compiled)
+            compile();
+        size_t blocks = (channels.size() + 3) / 4;
+        pool.parallelFor(blocks, 256, [&](size_t begin, size_t end) {
+            for (size_t block = begin; block < end; block++)
+                evaluateBlock(block * 4, t);
+        });
+    }
+
+    float value(int channel) const { return results[channel]; }
+    const float* values() const { return results.data(); }
+
+private:
+    struct Channel
+    {
+        std::string name;
+        bool loop = false;
+        std::vector<Key> keys;
+    };
+
+    std::vector<Channel> channels;
+    bool compiled = false;
+
+    // per channel: segments [firstSegment, firstSegment + segmentCount) and the cached one
+    std::vector<unsigned int> firstSegment, segmentCount, cachedSegment;
+    std::vector<float> startTime, span; // first key time and first-to-last key span
+    std::vector<float> results;
+
+    // per segment, SoA: start time and 1 / duration, x(s) = ((xA s + xB) s + xC) s,
+    // value(s) = ((vA s + vB) s + vC) s + vD
+    std::vector<float> segmentStart, segmentInvDuration;
+    std::vector<float> xA, xB, xC, vA, vB, vC, vD;
+
+    static Key makeKey(float time, float value, Interpolation interpolation)
+    {
+        Key key;
+        key.time = time;
+        key.value = value;
+        key.interpolation = interpolation;
+        return key;
+    }
+
+    void compile()
+    {
+        size_t n = channels.size();
+        firstSegment.assign(n, 0);
+        segmentCount.assign(n, 0);
+        cachedSegment.assign(n, 0);
+        startTime.assign(n, 0.0f);
+        span.assign(n, 0.0f);
+        results.assign((n + 3) & ~(size_t)3, 0.0f);
+        segmentStart.clear();
+        segmentInvDuration.clear();
+        for (std::vector<float>* c : { &xA, &xB, &xC, &vA, &vB, &vC, &vD })
+            c->clear();
+
+        for (size_t ch = 0; ch < n; ch++)
+        {
+            const std::vector<Key>& keys = channels[ch].keys;
+            firstSegment[ch] = (unsigned int)segmentStart.size();
+            if (keys.empty())
+            {
+                // a constant zero segment keeps evaluation uniform
+                pushSegment(0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f);
+                segmentCount[ch] = 1;
+                continue;
+            }
+            startTime[ch] = keys.front().time;
+            span[ch] = keys.back().time - keys.front().time;
+            if (keys.size() == 1)
+            {
+                pushSegment(keys[0].time, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, keys[0].value);
+                segmentCount[ch] = 1;
+                continue;
+            }
+            for (size_t k = 0; k + 1 < keys.size(); k++)
+                compileSegment(keys[k], keys[k + 1]);
+            segmentCount[ch] = (unsigned int)keys.size() - 1;
+        }
+        compiled = true;
+    }
+
+    void pushSegment(float start, float invDuration, float a, float b, float c, float va, float vb, float vc, float vd)
+    {
+        segmentStart.push_back(start);
+        segmentInvDuration.push_back(invDuration);
+        xA.push_back(a);
+        xB.push_back(b);
+        xC.push_back(c);
+        vA.push_back(va);
+        vB.push_back(vb);
+        vC.push_back(vc);
+        vD.push_back(vd);
+    }
+
+    void compileSegment(const Key& k0, const Key& k1)
+    {
+        float duration = k1.time - k0.time;
+        float v0 = k0.value, v1 = k1.value;
+        switch (k0.interpolation)
+        {
+        case STEP:
+            pushSegment(k0.time, 1.0f / duration, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, v0);
+            break;
+        case LINEAR:
+            pushSegment(k0.time, 1.0f / duration, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, v1 - v0, v0);
+            break;
+        case HERMITE:
+        {
+            // cubic Hermite basis with the tangents scaled to the unit parameter
+            float m0 = k0.outSlope * duration, m1 = k1.inSlope * duration;
+            pushSegment(k0.time, 1.0f / duration, 0.0f, 0.0f, 1.0f,
+                2.0f * v0 + m0 - 2.0f * v1 + m1, -3.0f * v0 - 2.0f * m0 + 3.0f * v1 - m1, m0, v0);
+            break;
+        }
+        case BEZIER:
+        {
+            // handle times are clamped into the segment so x(s) stays monotonic
+            float x1 = std::min(std::max(k0.outHandle.x / duration, 0.0f), 1.0f);
+            float x2 = std::min(std::max(1.0f + k1.inHandle.x / duration, 0.0f), 1.0f);
+            float p1 = v0 + k0.outHandle.y, p2 = v1 + k1.inHandle.y;
+            // Bernstein to power basis: (-c0 + 3c1 - 3c2 + c3, 3c0 - 6c1 + 3c2, -3c0 + 3c1, c0)
+            pushSegment(k0.time, 1.0f / duration,
+                3.0f * x1 - 3.0f * x2 + 1.0f, -6.0f * x1 + 3.0f * x2, 3.0f * x1,
+                -v0 + 3.0f * p1 - 3.0f * p2 + v1, 3.0f * v0 - 6.0f * p1 + 3.0f * p2, -3.0f * v0 + 3.0f * p1, v0);
+            break;
+        }
+        }
+    }
+
+    // segment of channel ch containing local time t (already wrapped or clamped to the key span)
+    unsigned int findSegment(size_t ch, float t)
+    {
+        unsigned int first = firstSegment[ch], count = segmentCount[ch];
+        unsigned int cached = cachedSegment[ch];
+        auto contains = [&](unsigned int s) {
+            return (s == 0 || segmentStart[first + s] <= t) && (s + 1 == count || t < segmentStart[first + s + 1]);
+        };
+        unsigned int s;
+        if (contains(cached))
+            s = cached;
+        else if (cached + 1 < count && contains(cached + 1))
+            s = cached + 1;
+        else if (cached > 0 && contains(cached - 1))
+            s = cached - 1;
+        else
+        {
+            // scrubbing: last segment starting at or before t
+            const float* starts = segmentStart.data() + first;
+            s = (unsigned int)(std::upper_bound(starts + 1, starts + count, t) - starts) - 1;
+        }
+        cachedSegment[ch] = s;
+        return first + s;
+    }
+
+    void evaluateBlock(size_t firstChannel, float t)
+    {
+        using simd::float4;
+        float lanes[8][4];
+        for (int lane = 0; lane < 4; lane++)
+        {
+            size_t ch = std::min(firstChannel + lane, channels.size() - 1);
+            float local = t;
+            if (span[ch] > 0.0f)
+            {
+                if (channels[ch].loop)
+                {
+                    float cycles = (t - startTime[ch]) / span[ch];
+                    local = startTime[ch] + (cycles - std::floor(cycles)) * span[ch];
+                }
+                else
+                    local = std::min(std::max(t, startTime[ch]), startTime[ch] + span[ch]);
+            }
+            unsigned int s = findSegment(ch, local);
+            lanes[0][lane] = std::min(std::max((local - segmentStart[s]) * segmentInvDuration[s], 0.0f), 1.0f);
+            lanes[1][lane] = xA[s];
+            lanes[2][lane] = xB[s];
+            lanes[3][lane] = xC[s];
+            lanes[4][lane] = vA[s];
+            lanes[5][lane] = vB[s];
+            lanes[6][lane] = vC[s];
+            lanes[7][lane] = vD[s];
+        }
+        float4 u = float4::load(lanes[0]);
+        float4 a = float4::load(lanes[1]), b = float4::load(lanes[2]), c = float4::load(lanes[3]);
+
+        // solve x(s) = u; exact after the first step when x is linear
+        float4 s = u;
+        for (int i = 0; i < NEWTON_STEPS; i++)
+        {
+            float4 x = simd::madd(simd::madd(a, s, b), s, c) * s;
+            float4 slope = simd::madd(simd::madd(a * float4(3.0f), s, b * float4(2.0f)), s, c);
+            s = simd::clamp(s - (x - u) / simd::max(slope, float4(1e-4f)), float4(0.0f), float4(1.0f));
+        }
+
+        float4 value = simd::madd(simd::madd(simd::madd(float4::load(lanes[4]), s, float4::load(lanes[5])), s, float4::load(lanes[6])), s, float4::load(lanes[7]));
+        value.store(&results[firstChannel]);
+    }
+
+    static constexpr int NEWTON_STEPS = 5;
+};
+
+#endif
@@ -0,0 +1,380 @@
+#ifndef AUDIO_ANALYSIS_H
+#define AUDIO_ANALYSIS_H
+
+#include "simd.h"
+#include "spsc_queue.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Band energies of a soundtrack for audio-reactive animation.
+//
+// load() decodes a WAV file (8/16/24/32-bit PCM or 32-bit float, any channel count, mixed to mono).
+// A worker thread then walks the track in hops of HOP samples: Hann window, FFT_SIZE-point FFT and
+// power summed into BANDS log-spaced bands, all on simd::float4. Each result is stamped with the
+// time of its window centre on the simulation clock and published through an SpscQueue, staying at
+// most LOOKAHEAD seconds ahead of the last time the render thread asked for. The render thread's
+// sample(t) only pops what is due and interpolates; it never waits for the worker, and if the
+// worker falls behind the last values are held. The track loops, so the clock may run forever.
+class AudioAnalysis
+{
+public:
+    static constexpr int BANDS = 8;
+    static constexpr int FFT_SIZE = 2048;
+    static constexpr int HOP = 512;
+    static constexpr double LOOKAHEAD = 0.25;
+
+    // 0 .. 1 per band (-60 .. 0 dB relative to a full-scale sine), attack/release smoothed
+    struct Frame
+    {
+        double time = 0.0;
+        float bands[BANDS] = {};
+        float level = 0.0f; // whole-window loudness on the same scale
+    };
+
+    ~AudioAnalysis() { stop(); }
+
+    bool load(const std::string& path)
+    {
+        stop();
+        samples.clear();
+        errorMessage.clear();
+        if (!readWav(path))
+            return false;
+        buildTables();
+        return true;
+    }
+
+    const std::string& error() const { return errorMessage; }
+    double duration() const { return sampleRate > 0 ? (double)samples.size() / sampleRate : 0.0; }
+    int rate() const { return sampleRate; }
+    // lower edge of band b in Hz; band b spans [bandFrequency(b), bandFrequency(b + 1))
+    float bandFrequency(int b) const { return bandEdgeHz[b]; }
+
+    // begins analysis with track time 0 at simulation time startTime
+    void start(double startTime)
+    {
+        stop();
+        if (samples.empty())
+            return;
+        origin = startTime;
+        playhead.store(startTime, std::memory_order_relaxed);
+        current = next = Frame();
+        current.time = next.time = startTime;
+        haveNext = false;
+        running = true;
+        worker = std::thread([this] { analyseLoop(); });
+    }
+
+    void stop()
+    {
+        running = false;
+        if (worker.joinable())
+            worker.join();
+        // a fresh ring for the next start()
+        Frame discard;
+        while (queue.pop(discard))
+        {
+        }
+    }
+
+    bool playing() const { return worker.joinable(); }
+
+    // render thread: band values at simulation time t, interpolated between analysis frames
+    Frame sample(double t)
+    {
+        playhead.store(t, std::memory_order_relaxed);
+        for (;;)
+        {
+            if (!haveNext)
+                haveNext = queue.pop(next);
+            if (!haveNext || next.time > t)
+                break;
+            current = next;
+            haveNext = false;
+        }
+        if (!haveNext || next.time <= current.time)
+            return current;
+        Frame result;
+        result.time = t;
+        float f = (float)std::min(std::max((t - current.time) / (next.time - current.time), 0.0), 1.0);
+        for (int b = 0; b < BANDS; b++)
+            result.bands[b] = current.bands[b] + (next.bands[b] - current.bands[b]) * f;
+        result.level = current.level + (next.level - current.level) * f;
+        return result;
+    }
+
+private:
+    std::vector<float> samples; // mono
+    int sampleRate = 0;
+    std::string errorMessage;
+
+    // FFT tables: bit reversal, Hann window and per stage twiddles (stage with half size h stores
+    // its h factors at [h, 2h))
+    std::vector<unsigned int> bitReverse;
+    std::vector<float> window, twiddleRe, twiddleIm;
+    int bandFirstBin[BANDS + 1] = {};
+    float bandEdgeHz[BANDS + 1] = {};
+
+    std::thread worker;
+    std::atomic<bool> running{ false };
+    std::atomic<double> playhead{ 0.0 };
+    double origin = 0.0;
+    SpscQueue<Frame, 256> queue;
+
+    // render thread side
+    Frame current, next;
+    bool haveNext = false;
+
+    static constexpr float FLOOR_DB = -60.0f;
+    // per hop (~12 ms at 44.1 kHz): rises quickly, falls slowly
+    static constexpr float ATTACK = 0.6f, RELEASE = 0.12f;
+
+    void analyseLoop()
+    {
+        std::vector<float> re(FFT_SIZE), im(FFT_SIZE), power(FFT_SIZE / 2);
+        Frame smoothed;
+        double hopSeconds = (double)HOP / sampleRate;
+        size_t frameIndex = 0;
+        size_t framesPerLoop = std::max<size_t>(1, samples.size() / HOP);
+        while (running)
+        {
+            double frameTime = origin + frameIndex * hopSeconds;
+            if (frameTime > playhead.load(std::memory_order_relaxed) + LOOKAHEAD)
+            {
+                // far enough ahead; the render thread catches up in a few milliseconds
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+                continue;
+            }
+            Frame frame;
+            frame.time = frameTime;
+            analyse((long)(frameIndex % framesPerLoop) * HOP, re.data(), im.data(), power.data(), frame);
+            for (int b = 0; b < BANDS; b++)
+            {
+                float& s = smoothed.bands[b];
+                s += (frame.bands[b] - s) * (frame.bands[b] > s ? ATTACK : RELEASE);
+                frame.bands[b] = s;
+            }
+            smoothed.level += (frame.level - smoothed.level) * (frame.level > smoothed.level ? ATTACK : RELEASE);
+            frame.level = smoothed.level;
+            while (running && !queue.push(frame))
+                std::this_thread::sleep_for(std::chrono::milliseconds(2));
+            frameIndex++;
+        }
+    }
+
+    // analyses the window centred on sample `centre` (wrapping around the looping track)
+    void analyse(long centre, float* re, float* im, float* power, Frame& frame) const
+    {
+        using simd::float4;
+        long n = (long)samples.size();
+        long first = centre - FFT_SIZE / 2;
+        for (int i = 0; i < FFT_SIZE; i++)
+        {
+            long s = (first + i) % n;
+            re[bitReverse[i]] = samples[s < 0 ? s + n : s];
+        }
+        // window in bit-reversed order, then the first two stages as one radix-4 pass
+        float energy = 0.0f;
+        float4 energy4(0.0f);
+        for (int i = 0; i < FFT_SIZE; i += 4)
+        {
+            float4 x = float4::load(re + i) * float4::load(&window[i]);
+            energy4 += x * x;
+            x.store(re + i);
+        }
+        energy = energy4[0] + energy4[1] + energy4[2] + energy4[3];
+        for (int i = 0; i < FFT_SIZE; i += 4)
+        {
+            float a = re[i], b = re[i + 1], c = re[i + 2], d = re[i + 3];
+            // inputs are real, so the first stage needs no imaginary parts
+            re[i] = a + b + c + d;
+            im[i] = 0.0f;
+            re[i + 1] = a - b;
+            im[i + 1] = -(c - d);
+            re[i + 2] = a + b - (c + d);
+            im[i + 2] = 0.0f;
+            re[i + 3] = a - b;
+            im[i + 3] = c - d;
+        }
+        // remaining stages, four butterflies per SIMD operation
+        for (int half = 4; half < FFT_SIZE; half *= 2)
+        {
+            const float* wr = &twiddleRe[half];
+            const float* wi = &twiddleIm[half];
+            for (int start = 0; start < FFT_SIZE; start += 2 * half)
+            {
+                float* ar = re + start;
+                float* ai = im + start;
+                float* br = ar + half;
+                float* bi = ai + half;
+                for (int k = 0; k < half; k += 4)
+                {
+                    float4 xr = float4::load(br + k), xi = float4::load(bi + k);
+                    float4 cr = float4::load(wr + k), ci = float4::load(wi + k);
+                    float4 tr = xr * cr - xi * ci;
+                    float4 ti = xr * ci + xi * cr;
+                    float4 yr = float4::load(ar + k), yi = float4::load(ai + k);
+                    (yr + tr).store(ar + k);
+                    (yi + ti).store(ai + k);
+                    (yr - tr).store(br + k);
+                    (yi - ti).store(bi + k);
+                }
+            }
+        }
+        for (int k = 0; k < FFT_SIZE / 2; k += 4)
+        {
+            float4 r = float4::load(re + k), i = float4::load(im + k);
+            (r * r + i * i).store(power + k);
+        }
+
+        // a full-scale sine puts (FFT_SIZE / 4)^2 into its bin through the Hann window
+        const float reference = 1.0f / ((FFT_SIZE / 4.0f) * (FFT_SIZE / 4.0f));
+        for (int b = 0; b < BANDS; b++)
+        {
+            int k = bandFirstBin[b], end = bandFirstBin[b + 1];
+            float4 sum4(0.0f);
+            for (; k + 4 <= end; k += 4)
+                sum4 += float4::load(power + k);
+            float sum = sum4[0] + sum4[1] + sum4[2] + sum4[3];
+            for (; k < end; k++)
+                sum += power[k];
+            frame.bands[b] = toUnit(sum * reference);
+        }
+        // mean square of the windowed signal against that of a full-scale sine (3/16 with Hann)
+        frame.level = toUnit(energy / (FFT_SIZE * 3.0f / 16.0f));
+    }
+
+    static float toUnit(float powerRatio)
+    {
+        float db = 10.0f * std::log10(powerRatio + 1e-12f);
+        return std::min(std::max((db - FLOOR_DB) / -FLOOR_DB, 0.0f), 1.0f);
+    }
+
+    void buildTables()
+    {
+        const double pi = 3.14159265358979323846;
+        int bits = 0;
+        while ((1 << bits) < FFT_SIZE)
+            bits++;
+        bitReverse.resize(FFT_SIZE);
+        for (int i = 0; i < FFT_SIZE; i++)
+        {
+            unsigned int r = 0;
+            for (int b = 0; b < bits; b++)
+                r |= ((i >> b) & 1u) << (bits - 1 - b);
+            bitReverse[i] = r;
+        }
+        // stored permuted, since the window is applied after the bit-reversed load
+        window.resize(FFT_SIZE);
+        for (int i = 0; i < FFT_SIZE; i++)
+            window[bitReverse[i]] = (float)(0.5 - 0.5 * std::cos(2.0 * pi * i / FFT_SIZE));
+        twiddleRe.assign(FFT_SIZE, 0.0f);
+        twiddleIm.assign(FFT_SIZE, 0.0f);
+        for (int half = 1; half < FFT_SIZE; half *= 2)
+            for (int k = 0; k < half; k++)
+            {
+                twiddleRe[half + k] = (float)std::cos(-pi * k / half);
+                twiddleIm[half + k] = (float)std::sin(-pi * k / half);
+            }
+
+        // log-spaced bands from 40 Hz to 16 kHz (or Nyquist), at least one bin each
+        double low = 40.0, high = std::min(16000.0, sampleRate / 2.0);
+        double binHz = (double)sampleRate / FFT_SIZE;
+        for (int b = 0; b <= BANDS; b++)
+        {
+            double hz = low * std::pow(high / low, (double)b / BANDS);
+            bandFirstBin[b] = std::min((int)std::lround(hz / binHz), FFT_SIZE / 2);
+            if (b > 0)
+                bandFirstBin[b] = std::max(bandFirstBin[b], bandFirstBin[b - 1] + 1);
+            bandEdgeHz[b] = (float)(bandFirstBin[b] * binHz);
+        }
+    }
+
+    bool fail(const std::string& message)
+    {
+        errorMessage = message;
+        return false;
+    }
+
+    bool readWav(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            return fail("cannot open " + path);
+        std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        auto u16 = [&](size_t at) { return (unsigned int)bytes[at] | (unsigned int)bytes[at + 1] << 8; };
+        auto u32 = [&](size_t at) { return u16(at) | u16(at + 2) << 16; };
+        if (bytes.size() < 12 || std::memcmp(&bytes[0], "RIFF", 4) != 0 || std::memcmp(&bytes[8], "WAVE", 4) != 0)
+            return fail(path + " is not a WAV file");
+
+        unsigned int format = 0, channels = 0, bitsPerSample = 0;
+        size_t dataAt = 0, dataSize = 0;
+        for (size_t at = 12; at + 8 <= bytes.size();)
+        {
+            size_t size = u32(at + 4);
+            if (std::memcmp(&bytes[at], "fmt ", 4) == 0 && size >= 16 && at + 8 + size <= bytes.size())
+            {
+                format = u16(at + 8);
+                channels = u16(at + 10);
+                sampleRate = (int)u32(at + 12);
+                bitsPerSample = u16(at + 22);
+                // WAVE_FORMAT_EXTENSIBLE keeps the real format in its sub-format GUID
+                if (format == 0xFFFE && size >= 26)
+                    format = u16(at + 32);
+            }
+            else if (std::memcmp(&bytes[at], "data", 4) == 0)
+            {
+                dataAt = at + 8;
+                dataSize = std::min(size, bytes.size() - dataAt);
+            }
+            at += 8 + size + (size & 1);
+        }
+        bool pcm = format == 1 && (bitsPerSample == 8 || bitsPerSample == 16 || bitsPerSample == 24 || bitsPerSample == 32);
+        bool ieee = format == 3 && bitsPerSample == 32;
+        if (!dataAt || channels == 0 || sampleRate <= 0 || (!pcm && !ieee))
+            return fail(path + ": unsupported WAV format (PCM 8/16/24/32-bit or float 32-bit only)");
+
+        size_t bytesPerSample = bitsPerSample / 8;
+        size_t frames = dataSize / (bytesPerSample * channels);
+        if (frames < (size_t)FFT_SIZE)
+            return fail(path + " is shorter than one analysis window");
+        samples.resize(frames);
+        const unsigned char* p = &bytes[dataAt];
+        for (size_t f = 0; f < frames; f++)
+        {
+            float sum = 0.0f;
+            for (unsigned int c = 0; c < channels; c++, p += bytesPerSample)
+            {
+                if (ieee)
+                {
+                    float v;
+                    std::memcpy(&v, p, 4);
+                    sum += v;
+                }
+                else if (bitsPerSample == 8)
+                    sum += (p[0] - 128) / 128.0f;
+                else
+                {
+                    // little-endian signed integer, sign-extended from its top byte
+                    int32_t v = (int32_t)((uint32_t)p[bytesPerSample - 1] << 24);
+                    for (size_t k = 1; k < bytesPerSample; k++)
+                        v |= (int32_t)((uint32_t)p[bytesPerSample - 1 - k] << (24 - 8 * k));
+                    sum += v / 2147483648.0f;
+                }
+            }
+            samples[f] = sum / channels;
+        }
+        return true;
+    }
+};
+
+#endif
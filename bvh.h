@@ -0,0 +1,371 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <glm/glm.hpp>
+
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <limits>
+#include <mutex>
+#include <vector>
+
+// Bounding volume hierarchy over axis-aligned boxes, used for ray picking.
+//
+// Built top-down with a binned surface area heuristic (16 bins along the widest axis) over copies of the boxes that are partitioned
+// in place, so every pass streams through memory; the bounds and bin counts of large nodes are
+// gathered over the thread pool. Nodes are 32 bytes and stored depth-first with the two children of a node
+// next to each other, so a traversal step touches one cache line. When boxes move but keep their
+// identity (swinging objects), refit() recomputes the bounds bottom-up in linear time and keeps
+// the topology; build() again once the set of boxes changes.
+class BoundingVolumeHierarchy
+{
+public:
+    static constexpr int NO_HIT = -1;
+
+    void build(const glm::vec3* boxMin, const glm::vec3* boxMax, size_t count, ThreadPool& pool)
+    {
+        primitiveCount = count;
+        nodes.clear();
+        // the split passes stream over copies of the boxes kept in partition order
+        references.resize(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            references[i].lower = boxMin[i];
+            references[i].index = (unsigned int)i;
+            references[i].upper = boxMax[i];
+        }
+        order.resize(count);
+        if (count == 0)
+            return;
+
+        nodes.reserve(2 * count);
+        nodes.push_back(Node());
+        nodes[0].first = 0;
+        nodes[0].count = (unsigned int)count;
+        std::vector<unsigned int> stack(1, 0);
+        while (!stack.empty())
+        {
+            unsigned int index = stack.back();
+            stack.pop_back();
+            unsigned int first = nodes[index].first, n = nodes[index].count;
+
+            unsigned int mid;
+            if (!split(nodes[index], first, n, mid, pool))
+                continue;
+
+            // children go next to each other; the node becomes interior
+            unsigned int left = (unsigned int)nodes.size();
+            nodes.push_back(Node());
+            nodes.push_back(Node());
+            nodes[left].first = first;
+            nodes[left].count = mid - first;
+            nodes[left + 1].first = mid;
+            nodes[left + 1].count = first + n - mid;
+            nodes[index].first = left;
+            nodes[index].count = 0;
+            stack.push_back(left + 1);
+            stack.push_back(left);
+        }
+        for (size_t k = 0; k < count; k++)
+            order[k] = references[k].index;
+        references.clear();
+    }
+
+    // recomputes all bounds for moved boxes; children always follow their parent in the array
+    void refit(const glm::vec3* boxMin, const glm::vec3* boxMax)
+    {
+        for (size_t k = nodes.size(); k-- > 0;)
+        {
+            Node& node = nodes[k];
+            if (node.count > 0)
+            {
+                setBounds(node, boxMin, boxMax, node.first, node.count);
+                continue;
+            }
+            const Node& a = nodes[node.first];
+            const Node& b = nodes[node.first + 1];
+            for (int axis = 0; axis < 3; axis++)
+            {
+                node.lower[axis] = std::min(a.lower[axis], b.lower[axis]);
+                node.upper[axis] = std::max(a.upper[axis], b.upper[axis]);
+            }
+        }
+    }
+
+    size_t size() const { return primitiveCount; }
+    size_t nodeCount() const { return nodes.size(); }
+
+    // closest hit along origin + t * direction for t in [0, tMax]. hit(primitive, tMax) runs the exact
+    // test for a primitive whose box the ray reaches and returns its ray parameter or a negative
+    // value on a miss. Returns the primitive hit first and its parameter in tMax, or NO_HIT.
+    template <typename HitFn>
+    int raycast(const glm::vec3& origin, const glm::vec3& direction, float& tMax, HitFn hit) const
+    {
+        if (nodes.empty())
+            return NO_HIT;
+        glm::vec3 invDirection;
+        for (int axis = 0; axis < 3; axis++)
+            invDirection[axis] = direction[axis] != 0.0f ? 1.0f / direction[axis] : std::numeric_limits<float>::infinity();
+
+        int closest = NO_HIT;
+        // binned SAH does not bound the depth (clustered boxes split lopsidedly), so subtrees that
+        // do not fit the fixed stack spill into a growable one
+        unsigned int stack[64];
+        int top = 0;
+        std::vector<unsigned int> spilled;
+        if (enter(nodes[0], origin, invDirection, tMax) == MISS)
+            return NO_HIT;
+        unsigned int index = 0;
+        for (;;)
+        {
+            const Node& node = nodes[index];
+            if (node.count > 0)
+            {
+                for (unsigned int k = node.first; k < node.first + node.count; k++)
+                {
+                    float t = hit((size_t)order[k], tMax);
+                    if (t >= 0.0f && t <= tMax)
+                    {
+                        tMax = t;
+                        closest = (int)order[k];
+                    }
+                }
+            }
+            else
+            {
+                // visit the nearer child first, keep the other for later
+                float tNear = enter(nodes[node.first], origin, invDirection, tMax);
+                float tFar = enter(nodes[node.first + 1], origin, invDirection, tMax);
+                unsigned int nearChild = node.first, farChild = node.first + 1;
+                if (tFar < tNear)
+                {
+                    std::swap(tNear, tFar);
+                    std::swap(nearChild, farChild);
+                }
+                if (tNear != MISS)
+                {
+                    if (tFar != MISS)
+                    {
+                        if (top < 64)
+                            stack[top++] = farChild;
+                        else
+                            spilled.push_back(farChild);
+                    }
+                    index = nearChild;
+                    continue;
+                }
+            }
+
+            // pop, skipping subtrees that start beyond the closest hit so far
+            for (;;)
+            {
+                if (!spilled.empty())
+                {
+                    index = spilled.back();
+                    spilled.pop_back();
+                }
+                else if (top == 0)
+                    return closest;
+                else
+                    index = stack[--top];
+                if (enter(nodes[index], origin, invDirection, tMax) != MISS)
+                    break;
+            }
+        }
+    }
+
+private:
+    static constexpr unsigned int MAX_LEAF_SIZE = 4;
+    static constexpr int BIN_COUNT = 16;
+    // nodes with at least this many boxes gather their bounds and bins over the thread pool
+    static constexpr unsigned int PARALLEL_SIZE = 65536;
+    static constexpr float MISS = std::numeric_limits<float>::infinity();
+
+    // interior nodes: count == 0 and the children are first and first + 1;
+    // leaves: primitives order[first, first + count)
+    struct Node
+    {
+        glm::vec3 lower;
+        unsigned int first;
+        glm::vec3 upper;
+        unsigned int count;
+    };
+
+    struct Bin
+    {
+        glm::vec3 lower = glm::vec3(std::numeric_limits<float>::max());
+        glm::vec3 upper = glm::vec3(-std::numeric_limits<float>::max());
+        unsigned int count = 0;
+
+        void grow(const glm::vec3& boxMin, const glm::vec3& boxMax)
+        {
+            lower = glm::min(lower, boxMin);
+            upper = glm::max(upper, boxMax);
+        }
+    };
+
+    // a box during the build, 32 bytes
+    struct Reference
+    {
+        glm::vec3 lower;
+        unsigned int index;
+        glm::vec3 upper;
+        float padding;
+
+        glm::vec3 centroid() const { return (lower + upper) * 0.5f; }
+    };
+
+    std::vector<Node> nodes;
+    std::vector<unsigned int> order;
+    std::vector<Reference> references;
+    size_t primitiveCount = 0;
+
+    void setBounds(Node& node, const glm::vec3* boxMin, const glm::vec3* boxMax, unsigned int first, unsigned int n) const
+    {
+        glm::vec3 lower(std::numeric_limits<float>::max()), upper(-std::numeric_limits<float>::max());
+        for (unsigned int k = first; k < first + n; k++)
+        {
+            lower = glm::min(lower, boxMin[order[k]]);
+            upper = glm::max(upper, boxMax[order[k]]);
+        }
+        node.lower = lower;
+        node.upper = upper;
+    }
+
+    static float halfArea(const glm::vec3& lower, const glm::vec3& upper)
+    {
+        glm::vec3 e = glm::max(upper - lower, glm::vec3(0.0f));
+        return e.x * e.y + e.y * e.z + e.z * e.x;
+    }
+
+    // entry distance of the ray into the node's box, or MISS
+    static float enter(const Node& node, const glm::vec3& origin, const glm::vec3& invDirection, float tMax)
+    {
+        float tEnter = 0.0f, tExit = tMax;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float t0 = (node.lower[axis] - origin[axis]) * invDirection[axis];
+            float t1 = (node.upper[axis] - origin[axis]) * invDirection[axis];
+            // 0 * inf for rays inside a slab they are parallel to
+            if (t0 != t0 || t1 != t1)
+            {
+                if (origin[axis] < node.lower[axis] || origin[axis] > node.upper[axis])
+                    return MISS;
+                continue;
+            }
+            tEnter = std::max(tEnter, std::min(t0, t1));
+            tExit = std::min(tExit, std::max(t0, t1));
+        }
+        return tEnter <= tExit ? tEnter : MISS;
+    }
+
+    // sets the node's bounds and partitions references[first, first + n) at the cheapest of the
+    // binned SAH planes along the widest centroid axis; false if the node stays a leaf
+    bool split(Node& node, unsigned int first, unsigned int n, unsigned int& mid, ThreadPool& pool)
+    {
+        Bin box, centroidBox;
+        auto bound = [&](unsigned int begin, unsigned int end, Bin& outBox, Bin& outCentroids) {
+            for (unsigned int k = begin; k < end; k++)
+            {
+                outBox.grow(references[k].lower, references[k].upper);
+                glm::vec3 c = references[k].centroid();
+                outCentroids.grow(c, c);
+            }
+        };
+        std::mutex mergeMutex;
+        if (n < PARALLEL_SIZE)
+            bound(first, first + n, box, centroidBox);
+        else
+            pool.parallelFor(n, PARALLEL_SIZE / 4, [&](size_t begin, size_t end) {
+                Bin localBox, localCentroids;
+                bound(first + (unsigned int)begin, first + (unsigned int)end, localBox, localCentroids);
+                std::lock_guard<std::mutex> lock(mergeMutex);
+                box.grow(localBox.lower, localBox.upper);
+                centroidBox.grow(localCentroids.lower, localCentroids.upper);
+            });
+        node.lower = box.lower;
+        node.upper = box.upper;
+        if (n <= MAX_LEAF_SIZE)
+            return false;
+
+        // bin along the axis with the widest spread of centroids
+        glm::vec3 spread = centroidBox.upper - centroidBox.lower;
+        int axis = spread.x >= spread.y && spread.x >= spread.z ? 0 : (spread.y >= spread.z ? 1 : 2);
+        float lower = centroidBox.lower[axis];
+        float scale = spread[axis] > 0.0f ? BIN_COUNT / spread[axis] : 0.0f;
+        auto binOf = [&](const Reference& r) {
+            return std::min(BIN_COUNT - 1, (int)(((r.lower[axis] + r.upper[axis]) * 0.5f - lower) * scale));
+        };
+
+        Bin bins[BIN_COUNT];
+        auto binRange = [&](unsigned int begin, unsigned int end, Bin (&out)[BIN_COUNT]) {
+            for (unsigned int k = begin; k < end; k++)
+            {
+                Bin& bin = out[binOf(references[k])];
+                bin.grow(references[k].lower, references[k].upper);
+                bin.count++;
+            }
+        };
+        if (n < PARALLEL_SIZE)
+            binRange(first, first + n, bins);
+        else
+        {
+            // large nodes near the root: gather per chunk and merge
+            pool.parallelFor(n, PARALLEL_SIZE / 4, [&](size_t begin, size_t end) {
+                Bin local[BIN_COUNT];
+                binRange(first + (unsigned int)begin, first + (unsigned int)end, local);
+                std::lock_guard<std::mutex> lock(mergeMutex);
+                for (int b = 0; b < BIN_COUNT; b++)
+                {
+                    bins[b].grow(local[b].lower, local[b].upper);
+                    bins[b].count += local[b].count;
+                }
+            });
+        }
+
+        // sweep from the right to get the cost of every plane's right side, then from the left
+        float bestCost = std::numeric_limits<float>::max();
+        int bestPlane = 0;
+        float rightArea[BIN_COUNT];
+        unsigned int rightCount[BIN_COUNT];
+        Bin right;
+        for (int b = BIN_COUNT - 1; b > 0; b--)
+        {
+            right.grow(bins[b].lower, bins[b].upper);
+            right.count += bins[b].count;
+            rightArea[b] = halfArea(right.lower, right.upper);
+            rightCount[b] = right.count;
+        }
+        Bin left;
+        for (int b = 0; b < BIN_COUNT - 1 && scale > 0.0f; b++)
+        {
+            left.grow(bins[b].lower, bins[b].upper);
+            left.count += bins[b].count;
+            if (left.count == 0 || rightCount[b + 1] == 0)
+                continue;
+            float cost = halfArea(left.lower, left.upper) * left.count + rightArea[b + 1] * rightCount[b + 1];
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestPlane = b + 1;
+            }
+        }
+        if (bestPlane == 0)
+        {
+            // all centroids coincide: split in the middle so leaves stay small
+            mid = first + n / 2;
+            return true;
+        }
+        // a leaf costs one exact test per primitive over the node's whole area
+        if (n <= 2 * MAX_LEAF_SIZE && bestCost >= halfArea(box.lower, box.upper) * n)
+            return false;
+
+        Reference* begin = references.data() + first;
+        Reference* split = std::partition(begin, begin + n, [&](const Reference& r) { return binOf(r) < bestPlane; });
+        mid = (unsigned int)(split - references.data());
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,321 @@
+#ifndef CABLE_PHYSICS_H
+#define CABLE_PHYSICS_H
+
+#include <glm/glm.hpp>
+
+#include "simd.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Position-based dynamics for the cables that hold hanging elements. A cable is a chain of
+// particles whose first particle is kinematic (the anchor); a pendulum is a one-segment cable.
+//
+// Constraints are distance constraints: one per segment for stretch and one between every
+// second particle for bending. They are greedily graph-coloured so no two constraints of a
+// colour share a particle, which lets a whole colour batch be projected in parallel (and four
+// constraints at a time with SIMD) without write conflicts. The solver uses XPBD with small
+// substeps and one projection per substep, so stiffness does not depend on the iteration count.
+class CableSimulation
+{
+public:
+    typedef unsigned int CableId;
+
+    glm::vec3 gravity = glm::vec3(0.0f, -9.81f, 0.0f);
+    float damping = 0.05f;   // fraction of velocity removed per second
+    int substeps = 8;
+
+    // adds a cable from anchor to end with the given number of segments and total mass;
+    // bendCompliance 0 gives a stiff rod, larger values a slacker rope
+    CableId addCable(const glm::vec3& anchor, const glm::vec3& end, int segments, float mass = 1.0f,
+        float stretchCompliance = 0.0f, float bendCompliance = 1e-3f)
+    {
+        segments = std::max(1, segments);
+        Cable cable;
+        cable.first = (unsigned int)px.size();
+        cable.count = (unsigned int)segments + 1;
+        float particleMass = mass / segments;
+        for (int i = 0; i <= segments; i++)
+        {
+            glm::vec3 p = anchor + (end - anchor) * ((float)i / segments);
+            px.push_back(p.x); py.push_back(p.y); pz.push_back(p.z);
+            vx.push_back(0.0f); vy.push_back(0.0f); vz.push_back(0.0f);
+            invMass.push_back(i == 0 ? 0.0f : 1.0f / particleMass);
+        }
+        float segmentLength = glm::length(end - anchor) / segments;
+        for (int i = 0; i < segments; i++)
+            addConstraint(cable.first + i, cable.first + i + 1, segmentLength, stretchCompliance);
+        for (int i = 0; i + 1 < segments; i++)
+            addConstraint(cable.first + i, cable.first + i + 2, 2.0f * segmentLength, bendCompliance);
+        cables.push_back(cable);
+        return (CableId)cables.size() - 1;
+    }
+
+    // room for count more cables of the given segments, so addCable() does not allocate for them
+    void reserve(size_t count, int segments)
+    {
+        segments = std::max(1, segments);
+        size_t particles = px.size() + count * (segments + 1);
+        size_t constraints = addedA.size() + count * (2 * segments - 1);
+        for (std::vector<float>* v : { &px, &py, &pz, &vx, &vy, &vz, &invMass })
+            v->reserve(particles);
+        for (std::vector<unsigned int>* v : { &addedA, &addedB })
+            v->reserve(constraints);
+        addedRest.reserve(constraints);
+        addedCompliance.reserve(constraints);
+        cables.reserve(cables.size() + count);
+    }
+
+    // removes every cable; ids start from 0 again
+    void clear()
+    {
+        for (std::vector<float>* v : { &px, &py, &pz, &ox, &oy, &oz, &vx, &vy, &vz, &invMass, &addedRest, &addedCompliance, &rest, &compliance })
+            v->clear();
+        for (std::vector<unsigned int>* v : { &addedA, &addedB, &ca, &cb })
+            v->clear();
+        cables.clear();
+        batchStart.clear();
+        coloringDirty = false;
+    }
+
+    // moves the kinematic anchor; the chain follows through the constraints
+    void setAnchor(CableId id, const glm::vec3& position)
+    {
+        unsigned int i = cables[id].first;
+        px[i] = position.x; py[i] = position.y; pz[i] = position.z;
+    }
+
+    // adds a velocity change to every free particle of the cable
+    void applyImpulse(CableId id, const glm::vec3& deltaVelocity)
+    {
+        for (unsigned int i = cables[id].first + 1; i < cables[id].first + cables[id].count; i++)
+        {
+            vx[i] += deltaVelocity.x; vy[i] += deltaVelocity.y; vz[i] += deltaVelocity.z;
+        }
+    }
+
+    glm::vec3 cableEnd(CableId id) const
+    {
+        unsigned int i = cables[id].first + cables[id].count - 1;
+        return glm::vec3(px[i], py[i], pz[i]);
+    }
+
+    // direction of the last segment (pointing away from the anchor)
+    glm::vec3 cableEndDirection(CableId id) const
+    {
+        unsigned int i = cables[id].first + cables[id].count - 1;
+        glm::vec3 d(px[i] - px[i - 1], py[i] - py[i - 1], pz[i] - pz[i - 1]);
+        float len = glm::length(d);
+        return len > 1e-6f ? d / len : glm::vec3(0.0f, -1.0f, 0.0f);
+    }
+
+    // moves the last particle of the cable by offset, e.g. to push a hanging object out of a contact
+    void displaceEnd(CableId id, const glm::vec3& offset)
+    {
+        unsigned int i = cables[id].first + cables[id].count - 1;
+        px[i] += offset.x; py[i] += offset.y; pz[i] += offset.z;
+    }
+
+    // velocity of the last particle of the cable
+    glm::vec3 endVelocity(CableId id) const
+    {
+        unsigned int i = cables[id].first + cables[id].count - 1;
+        return glm::vec3(vx[i], vy[i], vz[i]);
+    }
+
+    // adds a velocity change to the last particle only, e.g. a contact impulse on the hanging object
+    void addEndVelocity(CableId id, const glm::vec3& deltaVelocity)
+    {
+        unsigned int i = cables[id].first + cables[id].count - 1;
+        vx[i] += deltaVelocity.x; vy[i] += deltaVelocity.y; vz[i] += deltaVelocity.z;
+    }
+
+    // appends one (start, end) position pair per segment for drawing with GL_LINES
+    void appendSegmentLines(std::vector<float>& out) const
+    {
+        for (const Cable& cable : cables)
+            for (unsigned int i = cable.first; i + 1 < cable.first + cable.count; i++)
+            {
+                out.push_back(px[i]); out.push_back(py[i]); out.push_back(pz[i]);
+                out.push_back(px[i + 1]); out.push_back(py[i + 1]); out.push_back(pz[i + 1]);
+            }
+    }
+
+    size_t particleCount() const { return px.size(); }
+    size_t constraintCount() const { return ca.size(); }
+    size_t colorCount() const { return batchStart.empty() ? 0 : batchStart.size() - 1; }
+    size_t cableCount() const { return cables.size(); }
+
+    void step(float dt, ThreadPool& pool)
+    {
+        if (px.empty() || dt <= 0.0f)
+            return;
+        if (coloringDirty)
+            buildBatches();
+
+        // large frame hitches would explode the chain; cap the simulated time
+        dt = std::min(dt, 1.0f / 30.0f);
+        float h = dt / substeps;
+        float velocityScale = std::max(0.0f, 1.0f - damping * h);
+        size_t n = px.size();
+        ox.resize(n); oy.resize(n); oz.resize(n);
+
+        for (int s = 0; s < substeps; s++)
+        {
+            // predict
+            pool.parallelFor(n, 4096, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++)
+                {
+                    ox[i] = px[i]; oy[i] = py[i]; oz[i] = pz[i];
+                    if (invMass[i] == 0.0f)
+                        continue;
+                    vx[i] = (vx[i] + gravity.x * h) * velocityScale;
+                    vy[i] = (vy[i] + gravity.y * h) * velocityScale;
+                    vz[i] = (vz[i] + gravity.z * h) * velocityScale;
+                    px[i] += vx[i] * h; py[i] += vy[i] * h; pz[i] += vz[i] * h;
+                }
+            });
+
+            // project, one colour batch at a time
+            float invH2 = 1.0f / (h * h);
+            for (size_t b = 0; b + 1 < batchStart.size(); b++)
+            {
+                size_t first = batchStart[b], count = batchStart[b + 1] - first;
+                pool.parallelFor((count + 3) / 4, 1024, [&](size_t begin, size_t end) {
+                    solveBatch(first + begin * 4, std::min(first + end * 4, first + count), invH2);
+                });
+            }
+
+            // derive velocities from the projected positions
+            float invH = 1.0f / h;
+            pool.parallelFor(n, 4096, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++)
+                {
+                    if (invMass[i] == 0.0f)
+                        continue;
+                    vx[i] = (px[i] - ox[i]) * invH;
+                    vy[i] = (py[i] - oy[i]) * invH;
+                    vz[i] = (pz[i] - oz[i]) * invH;
+                }
+            });
+        }
+    }
+
+private:
+    struct Cable
+    {
+        unsigned int first, count;
+    };
+
+    // particles (SoA)
+    std::vector<float> px, py, pz, ox, oy, oz, vx, vy, vz, invMass;
+    std::vector<Cable> cables;
+
+    // constraints as added
+    std::vector<unsigned int> addedA, addedB;
+    std::vector<float> addedRest, addedCompliance;
+
+    // constraints reordered by colour (SoA); batch b is [batchStart[b], batchStart[b + 1])
+    std::vector<unsigned int> ca, cb;
+    std::vector<float> rest, compliance;
+    std::vector<size_t> batchStart;
+    bool coloringDirty = false;
+
+    void addConstraint(unsigned int a, unsigned int b, float restLength, float alpha)
+    {
+        addedA.push_back(a);
+        addedB.push_back(b);
+        addedRest.push_back(restLength);
+        addedCompliance.push_back(alpha);
+        coloringDirty = true;
+    }
+
+    // greedy colouring: each constraint takes the lowest colour not yet used by either particle
+    void buildBatches()
+    {
+        size_t m = addedA.size();
+        std::vector<uint64_t> usedColors(px.size(), 0);
+        std::vector<unsigned char> color(m);
+        std::vector<size_t> colorSize;
+        for (size_t c = 0; c < m; c++)
+        {
+            uint64_t used = usedColors[addedA[c]] | usedColors[addedB[c]];
+            unsigned int k = 0;
+            while (k < 63 && (used & (1ull << k)))
+                k++;
+            color[c] = (unsigned char)k;
+            usedColors[addedA[c]] |= 1ull << k;
+            usedColors[addedB[c]] |= 1ull << k;
+            if (colorSize.size() <= k)
+                colorSize.resize(k + 1, 0);
+            colorSize[k]++;
+        }
+
+        batchStart.assign(colorSize.size() + 1, 0);
+        for (size_t k = 0; k < colorSize.size(); k++)
+            batchStart[k + 1] = batchStart[k] + colorSize[k];
+        std::vector<size_t> fill(batchStart.begin(), batchStart.end() - 1);
+        ca.resize(m); cb.resize(m); rest.resize(m); compliance.resize(m);
+        for (size_t c = 0; c < m; c++)
+        {
+            size_t slot = fill[color[c]]++;
+            ca[slot] = addedA[c];
+            cb[slot] = addedB[c];
+            rest[slot] = addedRest[c];
+            compliance[slot] = addedCompliance[c];
+        }
+        coloringDirty = false;
+    }
+
+    // projects constraints [begin, end) of one colour; particles are gathered four at a time
+    void solveBatch(size_t begin, size_t end, float invH2)
+    {
+        using simd::float4;
+        size_t c = begin;
+        for (; c + 4 <= end; c += 4)
+        {
+            unsigned int a0 = ca[c], a1 = ca[c + 1], a2 = ca[c + 2], a3 = ca[c + 3];
+            unsigned int b0 = cb[c], b1 = cb[c + 1], b2 = cb[c + 2], b3 = cb[c + 3];
+            float4 dx = float4(px[b0], px[b1], px[b2], px[b3]) - float4(px[a0], px[a1], px[a2], px[a3]);
+            float4 dy = float4(py[b0], py[b1], py[b2], py[b3]) - float4(py[a0], py[a1], py[a2], py[a3]);
+            float4 dz = float4(pz[b0], pz[b1], pz[b2], pz[b3]) - float4(pz[a0], pz[a1], pz[a2], pz[a3]);
+            float4 wa(invMass[a0], invMass[a1], invMass[a2], invMass[a3]);
+            float4 wb(invMass[b0], invMass[b1], invMass[b2], invMass[b3]);
+            float4 len = simd::sqrt(dx * dx + dy * dy + dz * dz);
+            float4 alpha = float4::load(&compliance[c]) * invH2;
+            float4 wSum = wa + wb + alpha;
+            // skip degenerate (zero length or both pinned) lanes by zeroing their correction
+            float4 valid = simd::cmpgt(wSum * len, float4(1e-9f));
+            float4 safeLen = simd::max(len, float4(1e-9f));
+            float4 safeW = simd::max(wSum, float4(1e-9f));
+            float4 lambda = simd::select(valid, (len - float4::load(&rest[c])) / (safeW * safeLen), float4(0.0f));
+            float4 cx = dx * lambda, cy = dy * lambda, cz = dz * lambda;
+
+            float lcx[4], lcy[4], lcz[4], lwa[4], lwb[4];
+            cx.store(lcx); cy.store(lcy); cz.store(lcz); wa.store(lwa); wb.store(lwb);
+            const unsigned int as[4] = { a0, a1, a2, a3 }, bs[4] = { b0, b1, b2, b3 };
+            for (int k = 0; k < 4; k++)
+            {
+                px[as[k]] += lwa[k] * lcx[k]; py[as[k]] += lwa[k] * lcy[k]; pz[as[k]] += lwa[k] * lcz[k];
+                px[bs[k]] -= lwb[k] * lcx[k]; py[bs[k]] -= lwb[k] * lcy[k]; pz[bs[k]] -= lwb[k] * lcz[k];
+            }
+        }
+        for (; c < end; c++)
+        {
+            unsigned int a = ca[c], b = cb[c];
+            float dx = px[b] - px[a], dy = py[b] - py[a], dz = pz[b] - pz[a];
+            float len = std::sqrt(dx * dx + dy * dy + dz * dz);
+            float wSum = invMass[a] + invMass[b] + compliance[c] * invH2;
+            if (len < 1e-9f || wSum < 1e-9f)
+                continue;
+            float lambda = (len - rest[c]) / (wSum * len);
+            px[a] += invMass[a] * dx * lambda; py[a] += invMass[a] * dy * lambda; pz[a] += invMass[a] * dz * lambda;
+            px[b] -= invMass[b] * dx * lambda; py[b] -= invMass[b] * dy * lambda; pz[b] -= invMass[b] * dz * lambda;
+        }
+    }
+};
+
+#endif
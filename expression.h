@@ -0,0 +1,722 @@
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+
+#include "simd.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+// Choreography formulas, e.g.
+//
+//     r = sqrt(x*x + z*z)          # locals can be reused by later lines
+//     height = 0.3 * sin(r*2 - t*3)
+//     n1 = 1 + sin(t*1.2 + x*0.3)
+//
+// compiled once into register bytecode and evaluated over whole element arrays. Statements are
+// separated by newlines or ';'; every assigned name is an output and any other identifier is an
+// input, bound before evaluation either to a per-element array or to a single value (like t).
+// Operators: + - * / ^ and unary minus; functions: sin cos abs sqrt floor fract exp min max pow
+// clamp mix; constant: pi. pow of a non-positive base is 0.
+//
+// While parsing, every node is hash-consed (common subexpressions become one node, commutative
+// operands are put in a fixed order first), subtrees over constants are folded and trivial
+// identities (x + 0, x * 1, x ^ 2, ...) are simplified. Code is generated only for nodes an output
+// reaches, products feeding a single sum become multiply-adds, and registers are recycled after
+// their last reader. Instructions that only see uniform values (t * 1.2) are computed once per
+// call. Evaluation runs instruction by instruction over blocks of elements, four per SIMD
+// operation, like MechanismProgram.
+class ExpressionProgram
+{
+public:
+    // elements per block; the registers of one block stay in L1
+    static constexpr int BLOCK = 256;
+
+    static ExpressionProgram compile(const std::string& source)
+    {
+        ExpressionProgram program;
+        Parser parser(source, program);
+        parser.parseProgram();
+        if (program.errorMessage.empty())
+            program.generate();
+        return program;
+    }
+
+    bool valid() const { return errorMessage.empty(); }
+    // "line:column: message" of the first syntax error
+    const std::string& error() const { return errorMessage; }
+
+    size_t instructionCount() const { return instructions.size(); }
+    int registers() const { return registerCount; }
+
+    const std::vector<std::string>& inputNames() const { return inputs; }
+    const std::vector<std::string>& outputNames() const { return outputs; }
+
+    int inputIndex(const std::string& name) const { return indexOf(inputs, name); }
+    int outputIndex(const std::string& name) const { return indexOf(outputs, name); }
+
+    // an input read per element from elements[0, count) of evaluate()
+    void bindArray(int input, const float* elements)
+    {
+        if (input >= 0)
+            bindings[input] = Binding{ elements, 0.0f };
+    }
+
+    // an input with the same value for every element; unbound inputs are 0
+    void setValue(int input, float value)
+    {
+        if (input >= 0)
+            bindings[input] = Binding{ nullptr, value };
+    }
+
+    // evaluates elements [0, count); outputs[k] receives output k and must hold count floats
+    void evaluate(size_t count, ThreadPool& pool, float* const* outputArrays)
+    {
+        if (!valid())
+            return;
+        hoistUniforms();
+        size_t blocks = (count + BLOCK - 1) / BLOCK;
+        pool.parallelFor(blocks, 4, [&](size_t begin, size_t end) {
+            static thread_local std::vector<float> scratch;
+            static thread_local std::vector<const float*> slots;
+            scratch.resize(((size_t)inputs.size() + constants.size() + registerCount) * BLOCK);
+            slots.resize(inputs.size() + constants.size() + registerCount);
+            for (size_t b = begin; b < end; b++)
+                evaluateBlock(b * BLOCK, std::min<size_t>(BLOCK, count - b * BLOCK), scratch.data(), slots.data(), outputArrays);
+        });
+    }
+
+private:
+    enum Op { CONSTANT, INPUT, ADD, SUB, MUL, DIV, NEG, SIN, COS, ABS, SQRT, FLOOR, EXP2, MIN, MAX, POW, MADD };
+
+    struct Node
+    {
+        Op op;
+        int a, b;     // operand nodes, -1 if unused
+        float value;  // CONSTANT
+        int input;    // INPUT
+    };
+
+    // operands are slots: inputs first, then constants, then registers; c is only read by MADD (a * b + c)
+    struct Instruction
+    {
+        Op op;
+        int dst, a, b, c;
+    };
+
+    struct Binding
+    {
+        const float* elements;
+        float value;
+    };
+
+    std::string errorMessage;
+    std::vector<Node> nodes;
+    std::map<std::tuple<int, int, int, unsigned int, int>, int> nodeLookup; // constants keyed by their bits
+    std::vector<std::string> inputs;
+    std::vector<Binding> bindings;
+    std::vector<std::string> outputs;
+    std::vector<int> outputNodes;
+
+    std::vector<Instruction> instructions;
+    std::vector<float> constants;
+    std::vector<int> outputSlots;
+    int registerCount = 0;
+    std::vector<char> hoisted;
+    std::vector<float> hoistedValue;
+
+    static int indexOf(const std::vector<std::string>& names, const std::string& name)
+    {
+        for (size_t i = 0; i < names.size(); i++)
+            if (names[i] == name)
+                return (int)i;
+        return -1;
+    }
+
+    // ---- graph construction with folding and common subexpression elimination ----
+
+    int intern(Op op, int a, int b, float value, int input)
+    {
+        unsigned int bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        auto key = std::make_tuple((int)op, a, b, bits, input);
+        auto found = nodeLookup.find(key);
+        if (found != nodeLookup.end())
+            return found->second;
+        nodes.push_back(Node{ op, a, b, value, input });
+        nodeLookup[key] = (int)nodes.size() - 1;
+        return (int)nodes.size() - 1;
+    }
+
+    int constant(float value) { return intern(CONSTANT, -1, -1, value, -1); }
+
+    int input(const std::string& name)
+    {
+        int index = inputIndex(name);
+        if (index < 0)
+        {
+            index = (int)inputs.size();
+            inputs.push_back(name);
+            bindings.push_back(Binding{ nullptr, 0.0f });
+        }
+        return intern(INPUT, -1, -1, 0.0f, index);
+    }
+
+    bool isConstant(int node, float value) const { return nodes[node].op == CONSTANT && nodes[node].value == value; }
+
+    static float fold(Op op, float a, float b)
+    {
+        switch (op)
+        {
+        case ADD: return a + b;
+        case SUB: return a - b;
+        case MUL: return a * b;
+        case DIV: return a / b;
+        case NEG: return -a;
+        case SIN: return std::sin(a);
+        case COS: return std::cos(a);
+        case ABS: return std::fabs(a);
+        case SQRT: return std::sqrt(a);
+        case FLOOR: return std::floor(a);
+        case EXP2: return std::exp2(a);
+        case MIN: return std::min(a, b);
+        case MAX: return std::max(a, b);
+        case POW: return a > 0.0f ? std::pow(a, b) : 0.0f;
+        default: return 0.0f;
+        }
+    }
+
+    int unary(Op op, int a)
+    {
+        if (nodes[a].op == CONSTANT)
+            return constant(fold(op, nodes[a].value, 0.0f));
+        if (op == NEG && nodes[a].op == NEG)
+            return nodes[a].a;
+        return intern(op, a, -1, 0.0f, -1);
+    }
+
+    int binary(Op op, int a, int b)
+    {
+        if (nodes[a].op == CONSTANT && nodes[b].op == CONSTANT)
+            return constant(fold(op, nodes[a].value, nodes[b].value));
+        switch (op)
+        {
+        case ADD:
+            if (isConstant(a, 0.0f)) return b;
+            if (isConstant(b, 0.0f)) return a;
+            break;
+        case SUB:
+            if (isConstant(b, 0.0f)) return a;
+            if (isConstant(a, 0.0f)) return unary(NEG, b);
+            if (a == b) return constant(0.0f);
+            break;
+        case MUL:
+            if (isConstant(a, 1.0f)) return b;
+            if (isConstant(b, 1.0f)) return a;
+            if (isConstant(a, 0.0f) || isConstant(b, 0.0f)) return constant(0.0f);
+            break;
+        case DIV:
+            if (isConstant(b, 1.0f)) return a;
+            // multiplying by the reciprocal is cheaper and folds with other factors
+            if (nodes[b].op == CONSTANT) return binary(MUL, a, constant(1.0f / nodes[b].value));
+            break;
+        case POW:
+            if (isConstant(b, 1.0f)) return a;
+            if (isConstant(b, 2.0f)) return binary(MUL, a, a);
+            break;
+        case MIN:
+        case MAX:
+            if (a == b) return a;
+            break;
+        default:
+            break;
+        }
+        // commutative operations get a canonical operand order so a*b and b*a are one node
+        if ((op == ADD || op == MUL || op == MIN || op == MAX) && a > b)
+            std::swap(a, b);
+        return intern(op, a, b, 0.0f, -1);
+    }
+
+    // ---- code generation ----
+
+    void generate()
+    {
+        // nodes are created after their operands, so ascending ids are a valid order
+        std::vector<char> reached(nodes.size(), 0);
+        for (int out : outputNodes)
+            reached[out] = 1;
+        for (int n = (int)nodes.size() - 1; n >= 0; n--)
+            if (reached[n])
+            {
+                if (nodes[n].a >= 0) reached[nodes[n].a] = 1;
+                if (nodes[n].b >= 0) reached[nodes[n].b] = 1;
+            }
+
+        // a product read by nothing but one sum is fused into it as a multiply-add
+        std::vector<int> readers(nodes.size(), 0);
+        for (size_t n = 0; n < nodes.size(); n++)
+            if (reached[n])
+            {
+                if (nodes[n].a >= 0) readers[nodes[n].a]++;
+                if (nodes[n].b >= 0 && nodes[n].b != nodes[n].a) readers[nodes[n].b]++;
+            }
+        for (int out : outputNodes)
+            readers[out] += 2;
+        std::vector<char> fused(nodes.size(), 0);
+        std::vector<std::vector<int>> operands(nodes.size());
+        for (size_t n = 0; n < nodes.size(); n++)
+        {
+            const Node& node = nodes[n];
+            if (!reached[n] || node.op == CONSTANT || node.op == INPUT)
+                continue;
+            int product = -1, addend = -1;
+            if (node.op == ADD && node.a != node.b)
+            {
+                if (nodes[node.a].op == MUL && readers[node.a] == 1)
+                    product = node.a, addend = node.b;
+                else if (nodes[node.b].op == MUL && readers[node.b] == 1)
+                    product = node.b, addend = node.a;
+            }
+            if (product >= 0)
+            {
+                fused[product] = 1;
+                operands[n] = { nodes[product].a, nodes[product].b, addend };
+            }
+            else if (node.b >= 0)
+                operands[n] = { node.a, node.b };
+            else
+                operands[n] = { node.a };
+        }
+
+        std::vector<int> constantSlot(nodes.size(), -1);
+        for (size_t n = 0; n < nodes.size(); n++)
+            if (reached[n] && nodes[n].op == CONSTANT)
+            {
+                constantSlot[n] = (int)constants.size();
+                constants.push_back(nodes[n].value);
+            }
+
+        std::vector<int> lastUse(nodes.size(), -1);
+        for (size_t n = 0; n < nodes.size(); n++)
+            if (reached[n] && !fused[n])
+                for (int operand : operands[n])
+                    lastUse[operand] = (int)n;
+        for (int out : outputNodes)
+            lastUse[out] = (int)nodes.size(); // outputs live to the end
+
+        const int firstConstant = (int)inputs.size();
+        const int firstRegister = firstConstant + (int)constants.size();
+        std::vector<int> slot(nodes.size(), -1);
+        std::vector<int> freeRegisters;
+        std::vector<std::vector<int>> expiring(nodes.size());
+        for (size_t n = 0; n < nodes.size(); n++)
+        {
+            if (!reached[n] || fused[n])
+                continue;
+            const Node& node = nodes[n];
+            if (node.op == INPUT)
+            {
+                slot[n] = node.input;
+                continue;
+            }
+            if (node.op == CONSTANT)
+            {
+                slot[n] = firstConstant + constantSlot[n];
+                continue;
+            }
+            const std::vector<int>& src = operands[n];
+            Instruction ins;
+            ins.op = src.size() == 3 ? MADD : node.op;
+            ins.a = slot[src[0]];
+            ins.b = src.size() > 1 ? slot[src[1]] : ins.a;
+            ins.c = src.size() > 2 ? slot[src[2]] : ins.b;
+            // operands dying here can hand their register straight to the result
+            for (int dead : expiring[n])
+                if (slot[dead] >= firstRegister)
+                    freeRegisters.push_back(slot[dead]);
+            if (!freeRegisters.empty())
+            {
+                ins.dst = freeRegisters.back();
+                freeRegisters.pop_back();
+            }
+            else
+                ins.dst = firstRegister + registerCount++;
+            slot[n] = ins.dst;
+            instructions.push_back(ins);
+
+            if (lastUse[n] >= 0 && lastUse[n] < (int)nodes.size())
+                expiring[lastUse[n]].push_back((int)n);
+        }
+        for (int out : outputNodes)
+            outputSlots.push_back(slot[out]);
+        hoisted.assign(instructions.size(), 0);
+        hoistedValue.assign(instructions.size(), 0.0f);
+    }
+
+    // instructions that only read values shared by all elements (constants, inputs given with
+    // setValue and results of such instructions) are computed once here; blocks just broadcast them
+    void hoistUniforms()
+    {
+        std::vector<char> uniform(inputs.size() + constants.size() + registerCount, 0);
+        std::vector<float> value(uniform.size(), 0.0f);
+        for (size_t i = 0; i < inputs.size(); i++)
+        {
+            uniform[i] = bindings[i].elements == nullptr;
+            value[i] = bindings[i].value;
+        }
+        for (size_t k = 0; k < constants.size(); k++)
+        {
+            uniform[inputs.size() + k] = 1;
+            value[inputs.size() + k] = constants[k];
+        }
+        for (size_t i = 0; i < instructions.size(); i++)
+        {
+            const Instruction& ins = instructions[i];
+            hoisted[i] = uniform[ins.a] && uniform[ins.b] && uniform[ins.c];
+            if (hoisted[i])
+                hoistedValue[i] = ins.op == MADD ? value[ins.a] * value[ins.b] + value[ins.c] : fold(ins.op, value[ins.a], value[ins.b]);
+            // registers are reused, so a slot is uniform only while its latest writer was
+            uniform[ins.dst] = hoisted[i];
+            value[ins.dst] = hoistedValue[i];
+        }
+    }
+
+    // ---- evaluation ----
+
+    void evaluateBlock(size_t first, size_t count, float* scratch, const float** slots, float* const* outputArrays) const
+    {
+        using simd::float4;
+        // pad the block to whole vectors; inputs of a partial block are copied so reads stay in bounds
+        size_t lanes = (count + 3) & ~size_t(3);
+        size_t slot = 0;
+        auto area = [&](size_t s) { return scratch + s * BLOCK; };
+        for (const Binding& binding : bindings)
+        {
+            if (binding.elements && count == BLOCK)
+                slots[slot] = binding.elements + first;
+            else
+            {
+                float* dst = area(slot);
+                if (binding.elements)
+                {
+                    std::copy(binding.elements + first, binding.elements + first + count, dst);
+                    std::fill(dst + count, dst + lanes, 0.0f);
+                }
+                else
+                    std::fill(dst, dst + lanes, binding.value);
+                slots[slot] = dst;
+            }
+            slot++;
+        }
+        for (float value : constants)
+        {
+            float* dst = area(slot);
+            std::fill(dst, dst + lanes, value);
+            slots[slot++] = dst;
+        }
+        for (int r = 0; r < registerCount; r++, slot++)
+            slots[slot] = area(slot);
+
+        for (size_t k = 0; k < instructions.size(); k++)
+        {
+            const Instruction& ins = instructions[k];
+            float* dst = const_cast<float*>(slots[ins.dst]);
+            if (hoisted[k])
+            {
+                std::fill(dst, dst + lanes, hoistedValue[k]);
+                continue;
+            }
+            const float* a = slots[ins.a];
+            const float* b = slots[ins.b];
+            const float* c = slots[ins.c];
+            switch (ins.op)
+            {
+#define EXPRESSION_LOOP(expr) for (size_t i = 0; i < lanes; i += 4) { float4 x = float4::load(a + i), y = float4::load(b + i); (void)y; (expr).store(dst + i); } break;
+            case ADD: EXPRESSION_LOOP(x + y)
+            case SUB: EXPRESSION_LOOP(x - y)
+            case MUL: EXPRESSION_LOOP(x * y)
+            case DIV: EXPRESSION_LOOP(x / y)
+            case NEG: EXPRESSION_LOOP(-x)
+            case SIN: EXPRESSION_LOOP(simd::sin(x))
+            case COS: EXPRESSION_LOOP(simd::cos(x))
+            case ABS: EXPRESSION_LOOP(simd::abs(x))
+            case SQRT: EXPRESSION_LOOP(simd::sqrt(x))
+            case FLOOR: EXPRESSION_LOOP(simd::floor(x))
+            case EXP2: EXPRESSION_LOOP(simd::exp2(x))
+            case MIN: EXPRESSION_LOOP(simd::min(x, y))
+            case MAX: EXPRESSION_LOOP(simd::max(x, y))
+            case POW: EXPRESSION_LOOP(simd::pow(x, y))
+            case MADD: EXPRESSION_LOOP(simd::madd(x, y, float4::load(c + i)))
+#undef EXPRESSION_LOOP
+            default:
+                break;
+            }
+        }
+
+        for (size_t o = 0; o < outputSlots.size(); o++)
+            if (outputArrays[o])
+                std::copy(slots[outputSlots[o]], slots[outputSlots[o]] + count, outputArrays[o] + first);
+    }
+
+    // ---- parsing ----
+
+    // recursive descent over the grammar
+    //   program   = statement { (newline | ';') statement }
+    //   statement = [ name '=' sum ]
+    //   sum       = product { ('+' | '-') product }
+    //   product   = unary { ('*' | '/') unary }
+    //   unary     = '-' unary | power
+    //   power     = primary [ '^' unary ]
+    //   primary   = number | name | name '(' sum { ',' sum } ')' | '(' sum ')'
+    class Parser
+    {
+    public:
+        Parser(const std::string& source, ExpressionProgram& program) : text(source), program(program) {}
+
+        void parseProgram()
+        {
+            for (;;)
+            {
+                skipSpace();
+                if (failed() || at >= text.size())
+                    return;
+                if (text[at] == '\n' || text[at] == ';')
+                {
+                    at++;
+                    continue;
+                }
+                std::string name = identifier();
+                if (name.empty())
+                {
+                    fail("expected a name to assign");
+                    return;
+                }
+                if (!accept('='))
+                {
+                    fail("expected '='");
+                    return;
+                }
+                int node = sum();
+                if (failed())
+                    return;
+                skipSpace();
+                if (at < text.size() && text[at] != '\n' && text[at] != ';')
+                {
+                    fail("unexpected character");
+                    return;
+                }
+                locals[name] = node;
+                int out = program.outputIndex(name);
+                if (out < 0)
+                {
+                    program.outputs.push_back(name);
+                    program.outputNodes.push_back(node);
+                }
+                else
+                    program.outputNodes[out] = node;
+            }
+        }
+
+    private:
+        const std::string& text;
+        ExpressionProgram& program;
+        size_t at = 0;
+        std::map<std::string, int> locals;
+
+        bool failed() const { return !program.errorMessage.empty(); }
+
+        int fail(const char* message)
+        {
+            if (failed())
+                return 0;
+            size_t line = 1, column = 1;
+            for (size_t i = 0; i < at && i < text.size(); i++)
+            {
+                column++;
+                if (text[i] == '\n')
+                {
+                    line++;
+                    column = 1;
+                }
+            }
+            program.errorMessage = std::to_string(line) + ":" + std::to_string(column) + ": " + message;
+            return 0;
+        }
+
+        // skips blanks and comments, but not newlines (statement separators)
+        void skipSpace()
+        {
+            while (at < text.size())
+            {
+                if (text[at] == '#')
+                    while (at < text.size() && text[at] != '\n')
+                        at++;
+                else if (text[at] != '\n' && std::isspace((unsigned char)text[at]))
+                    at++;
+                else
+                    break;
+            }
+        }
+
+        bool accept(char c)
+        {
+            skipSpace();
+            if (at < text.size() && text[at] == c)
+            {
+                at++;
+                return true;
+            }
+            return false;
+        }
+
+        std::string identifier()
+        {
+            skipSpace();
+            size_t start = at;
+            if (at < text.size() && (std::isalpha((unsigned char)text[at]) || text[at] == '_'))
+                while (at < text.size() && (std::isalnum((unsigned char)text[at]) || text[at] == '_' || text[at] == '.'))
+                    at++;
+            return text.substr(start, at - start);
+        }
+
+        int sum()
+        {
+            int node = product();
+            for (;;)
+            {
+                if (accept('+'))
+                    node = program.binary(ADD, node, product());
+                else if (accept('-'))
+                    node = program.binary(SUB, node, product());
+                else
+                    return node;
+                if (failed())
+                    return 0;
+            }
+        }
+
+        int product()
+        {
+            int node = unaryMinus();
+            for (;;)
+            {
+                if (accept('*'))
+                    node = program.binary(MUL, node, unaryMinus());
+                else if (accept('/'))
+                    node = program.binary(DIV, node, unaryMinus());
+                else
+                    return node;
+                if (failed())
+                    return 0;
+            }
+        }
+
+        int unaryMinus()
+        {
+            if (accept('-'))
+            {
+                int operand = unaryMinus();
+                return failed() ? 0 : program.unary(NEG, operand);
+            }
+            return power();
+        }
+
+        int power()
+        {
+            int base = primary();
+            if (!failed() && accept('^'))
+            {
+                int exponent = unaryMinus();
+                return failed() ? 0 : program.binary(POW, base, exponent);
+            }
+            return base;
+        }
+
+        int primary()
+        {
+            skipSpace();
+            if (failed() || at >= text.size())
+                return fail("expected an expression");
+            if (accept('('))
+            {
+                int node = sum();
+                if (!failed() && !accept(')'))
+                    return fail("expected ')'");
+                return node;
+            }
+            if (std::isdigit((unsigned char)text[at]) || text[at] == '.')
+            {
+                const char* begin = text.c_str() + at;
+                char* end = nullptr;
+                float value = std::strtof(begin, &end);
+                at += end - begin;
+                return program.constant(value);
+            }
+            std::string name = identifier();
+            if (name.empty())
+                return fail("expected an expression");
+            if (accept('('))
+                return call(name);
+            if (name == "pi")
+                return program.constant(3.14159265358979323846f);
+            auto local = locals.find(name);
+            if (local != locals.end())
+                return local->second;
+            return program.input(name);
+        }
+
+        int call(const std::string& name)
+        {
+            std::vector<int> args;
+            if (!accept(')'))
+            {
+                do
+                {
+                    args.push_back(sum());
+                    if (failed())
+                        return 0;
+                } while (accept(','));
+                if (!accept(')'))
+                    return fail("expected ')' after arguments");
+            }
+
+            struct Function
+            {
+                const char* name;
+                Op op;
+                size_t arity;
+            };
+            static const Function functions[] = {
+                { "sin", SIN, 1 }, { "cos", COS, 1 }, { "abs", ABS, 1 }, { "sqrt", SQRT, 1 },
+                { "floor", FLOOR, 1 }, { "min", MIN, 2 }, { "max", MAX, 2 }, { "pow", POW, 2 }
+            };
+            for (const Function& f : functions)
+                if (name == f.name)
+                {
+                    if (args.size() != f.arity)
+                        return fail("wrong number of arguments");
+                    return f.arity == 1 ? program.unary(f.op, args[0]) : program.binary(f.op, args[0], args[1]);
+                }
+
+            // the rest are built from the primitives, so their parts take part in CSE and folding
+            if (name == "fract" && args.size() == 1)
+                return program.binary(SUB, args[0], program.unary(FLOOR, args[0]));
+            if (name == "exp" && args.size() == 1)
+                return program.unary(EXP2, program.binary(MUL, args[0], program.constant(1.44269504088896340736f)));
+            if (name == "clamp" && args.size() == 3)
+                return program.binary(MIN, program.binary(MAX, args[0], args[1]), args[2]);
+            if (name == "mix" && args.size() == 3)
+                return program.binary(ADD, args[0], program.binary(MUL, program.binary(SUB, args[1], args[0]), args[2]));
+            return fail("unknown function or wrong number of arguments");
+        }
+    };
+};
+
+#endif
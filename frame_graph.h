@@ -0,0 +1,345 @@
+#ifndef FRAME_GRAPH_H
+#define FRAME_GRAPH_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// The frame's render passes declared with the targets each reads and writes, instead of being
+// sequenced by hand. The graph is rebuilt every frame: reset(), addPass() for every pass that could
+// contribute, compile(), execute().
+//
+// compile() walks the passes backwards from the frame's outputs, the final contents of imported
+// resources (the default framebuffer), and culls every pass whose writes nobody reads: a pass that
+// writes a resource without reading it replaces its contents, so an earlier writer of the same
+// resource is dead unless something read it in between. Passes with effects the graph cannot see
+// (buffer updates, readbacks) are marked with sideEffect() and always run.
+//
+// Transient targets, created by a pass and gone at the end of the frame, are textures from a pool
+// the graph owns. Each lives from the first to the last surviving pass that uses it, and a target
+// whose lifetime starts after another's ended takes over that one's texture when their descriptions
+// match, so targets that are never alive together share memory. A pass that takes over a texture
+// finds the previous owner's contents in it and has to clear or overwrite what it reads.
+//
+// Passes run in the order they were declared, which has to respect their dependencies: compile()
+// rejects a read of a transient nothing wrote before, and a pass reading and writing the same
+// transient (a feedback loop GL leaves undefined). GL itself orders render-to-texture before later
+// sampling or blits from the texture, so between passes there are no barriers to issue; stats()
+// counts the read-after-write hand-overs a more explicit API would put them at.
+class FrameGraph
+{
+public:
+    typedef int Resource;
+    static constexpr Resource NONE = -1;
+
+    struct TextureDesc
+    {
+        GLenum target;         // GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY
+        GLenum internalFormat; // sized color or depth format
+        int width;
+        int height;
+        int layers;            // 1 for GL_TEXTURE_2D
+
+        bool operator==(const TextureDesc& other) const
+        {
+            return target == other.target && internalFormat == other.internalFormat
+                && width == other.width && height == other.height && layers == other.layers;
+        }
+
+        size_t bytes() const
+        {
+            return (size_t)width * height * layers * texelBytes(internalFormat);
+        }
+    };
+
+    struct Stats
+    {
+        int passes = 0;           // declared
+        int culled = 0;
+        int barriers = 0;         // read-after-write hand-overs between surviving passes
+        size_t transientBytes = 0; // every surviving transient in a texture of its own
+        size_t allocatedBytes = 0; // the pool textures they were placed in
+
+        bool operator!=(const Stats& other) const
+        {
+            return passes != other.passes || culled != other.culled || barriers != other.barriers
+                || transientBytes != other.transientBytes || allocatedBytes != other.allocatedBytes;
+        }
+    };
+
+    // declares what one pass uses; valid until the next addPass()
+    class PassBuilder
+    {
+    public:
+        // a transient target this pass writes first
+        Resource create(const char* name, const TextureDesc& desc)
+        {
+            Resource resource = (Resource)graph->resources.size();
+            graph->resources.push_back(ResourceNode{ name, desc, true });
+            write(resource);
+            return resource;
+        }
+
+        void read(Resource resource) { graph->passes[pass].reads.push_back(resource); }
+        void write(Resource resource) { graph->passes[pass].writes.push_back(resource); }
+
+        // keeps the pass even if nothing reads what it writes
+        void sideEffect() { graph->passes[pass].sideEffect = true; }
+
+    private:
+        friend class FrameGraph;
+        PassBuilder(FrameGraph* graph, int pass) : graph(graph), pass(pass) {}
+
+        FrameGraph* graph;
+        int pass;
+    };
+
+    // drops last frame's passes and resources; pooled textures are kept for reuse
+    void reset()
+    {
+        passes.clear();
+        resources.clear();
+        compiled = false;
+    }
+
+    // a resource the graph does not own, such as the default framebuffer; its contents after the
+    // last pass that writes it are an output of the frame
+    Resource import(const char* name)
+    {
+        resources.push_back(ResourceNode{ name, TextureDesc{ 0, 0, 0, 0, 0 }, false });
+        return (Resource)resources.size() - 1;
+    }
+
+    // execute runs during execute(), after every earlier surviving pass
+    PassBuilder addPass(const char* name, std::function<void()> execute)
+    {
+        passes.emplace_back();
+        passes.back().name = name;
+        passes.back().execute = std::move(execute);
+        return PassBuilder(this, (int)passes.size() - 1);
+    }
+
+    // culls, checks the order and places transients in pool textures; false (and nothing will
+    // run) if a pass reads what no earlier pass wrote
+    bool compile()
+    {
+        stats = Stats();
+        stats.passes = (int)passes.size();
+
+        // backwards from the outputs: a pass survives if a later survivor, or the frame, needs one
+        // of its writes
+        std::vector<bool> needed(resources.size(), false);
+        for (size_t r = 0; r < resources.size(); r++)
+            needed[r] = !resources[r].transient;
+        for (size_t p = passes.size(); p-- > 0;)
+        {
+            PassNode& pass = passes[p];
+            pass.culled = !pass.sideEffect;
+            for (Resource resource : pass.writes)
+                if (needed[resource])
+                    pass.culled = false;
+            if (pass.culled)
+            {
+                stats.culled++;
+                continue;
+            }
+            for (Resource resource : pass.writes)
+                needed[resource] = false;
+            for (Resource resource : pass.reads)
+                needed[resource] = true;
+        }
+
+        // forwards: lifetimes of transients over the surviving passes
+        for (ResourceNode& resource : resources)
+            resource.firstUse = resource.lastUse = -1;
+        std::vector<bool> written(resources.size(), false);
+        for (size_t p = 0; p < passes.size(); p++)
+        {
+            const PassNode& pass = passes[p];
+            if (pass.culled)
+                continue;
+            for (Resource resource : pass.reads)
+            {
+                if (resources[resource].transient && !written[resource])
+                    return fail(pass, resource, "reads a transient no earlier pass wrote");
+                for (Resource other : pass.writes)
+                    if (other == resource && resources[resource].transient)
+                        return fail(pass, resource, "reads and writes the same transient");
+                if (written[resource])
+                    stats.barriers++;
+                use(resource, (int)p);
+            }
+            for (Resource resource : pass.writes)
+            {
+                written[resource] = true;
+                use(resource, (int)p);
+            }
+        }
+
+        // placement: a transient takes the first pooled texture of its description that is free
+        // by the pass where it starts, i.e. whose last user ended before
+        for (PoolEntry& entry : pool)
+            entry.busyUntil = -2;
+        for (size_t p = 0; p < passes.size(); p++)
+        {
+            for (ResourceNode& resource : resources)
+            {
+                if (!resource.transient || resource.firstUse != (int)p)
+                    continue;
+                stats.transientBytes += resource.desc.bytes();
+                resource.texture = 0;
+                for (PoolEntry& entry : pool)
+                {
+                    if (entry.desc == resource.desc && entry.busyUntil < (int)p)
+                    {
+                        if (entry.busyUntil == -2)
+                            stats.allocatedBytes += entry.desc.bytes();
+                        entry.busyUntil = resource.lastUse;
+                        resource.texture = entry.texture;
+                        break;
+                    }
+                }
+                if (!resource.texture)
+                {
+                    pool.push_back(PoolEntry{ resource.desc, createTexture(resource.desc), resource.lastUse });
+                    stats.allocatedBytes += resource.desc.bytes();
+                    resource.texture = pool.back().texture;
+                }
+            }
+        }
+        // textures no transient needed this frame (old sizes after a resize) are released
+        for (size_t i = pool.size(); i-- > 0;)
+        {
+            if (pool[i].busyUntil == -2)
+            {
+                glDeleteTextures(1, &pool[i].texture);
+                pool.erase(pool.begin() + i);
+            }
+        }
+        compiled = true;
+        return true;
+    }
+
+    // runs the surviving passes in declared order
+    void execute()
+    {
+        if (!compiled)
+            return;
+        for (PassNode& pass : passes)
+            if (!pass.culled)
+                pass.execute();
+    }
+
+    // the texture a transient was placed in; valid from compile() until the next reset()
+    unsigned int texture(Resource resource) const { return resources[resource].texture; }
+
+    int passCount() const { return (int)passes.size(); }
+    const std::string& passName(int pass) const { return passes[pass].name; }
+    bool passCulled(int pass) const { return passes[pass].culled; }
+
+    const Stats& frameStats() const { return stats; }
+
+    void destroy()
+    {
+        for (PoolEntry& entry : pool)
+            glDeleteTextures(1, &entry.texture);
+        pool.clear();
+        reset();
+    }
+
+    // bytes per texel of the sized formats render targets use here; others count as 4
+    static size_t texelBytes(GLenum internalFormat)
+    {
+        switch (internalFormat)
+        {
+        case GL_R8:
+            return 1;
+        case GL_RG8:
+        case GL_R16F:
+            return 2;
+        case GL_RGBA16F:
+        case GL_RG32F:
+            return 8;
+        case GL_RGBA32F:
+            return 16;
+        default: // GL_RGBA8, GL_R32F, GL_RG16F, GL_R11F_G11F_B10F and the depth formats
+            return 4;
+        }
+    }
+
+private:
+    struct PassNode
+    {
+        std::string name;
+        std::function<void()> execute;
+        std::vector<Resource> reads, writes;
+        bool sideEffect = false;
+        bool culled = false;
+    };
+
+    struct ResourceNode
+    {
+        std::string name;
+        TextureDesc desc;
+        bool transient;
+        int firstUse = -1, lastUse = -1; // surviving passes
+        unsigned int texture = 0;
+    };
+
+    struct PoolEntry
+    {
+        TextureDesc desc;
+        unsigned int texture;
+        int busyUntil; // last pass of the current user, -2 while unused this frame
+    };
+
+    std::vector<PassNode> passes;
+    std::vector<ResourceNode> resources;
+    std::vector<PoolEntry> pool;
+    Stats stats;
+    bool compiled = false;
+
+    void use(Resource resource, int pass)
+    {
+        ResourceNode& node = resources[resource];
+        if (node.firstUse < 0)
+            node.firstUse = pass;
+        node.lastUse = pass;
+    }
+
+    bool fail(const PassNode& pass, Resource resource, const char* problem)
+    {
+        std::cout << "ERROR::FRAME_GRAPH: pass \"" << pass.name << "\" " << problem << " (\"" << resources[resource].name << "\")" << std::endl;
+        compiled = false;
+        return false;
+    }
+
+    static unsigned int createTexture(const TextureDesc& desc)
+    {
+        bool depth = desc.internalFormat == GL_DEPTH_COMPONENT16 || desc.internalFormat == GL_DEPTH_COMPONENT24
+            || desc.internalFormat == GL_DEPTH_COMPONENT32F || desc.internalFormat == GL_DEPTH24_STENCIL8;
+        GLenum format = desc.internalFormat == GL_DEPTH24_STENCIL8 ? GL_DEPTH_STENCIL : depth ? GL_DEPTH_COMPONENT : GL_RGBA;
+        GLenum type = desc.internalFormat == GL_DEPTH24_STENCIL8 ? GL_UNSIGNED_INT_24_8 : depth ? GL_UNSIGNED_INT : GL_UNSIGNED_BYTE;
+        GLint filter = depth ? GL_NEAREST : GL_LINEAR;
+
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(desc.target, texture);
+        if (desc.target == GL_TEXTURE_2D_ARRAY)
+            glTexImage3D(desc.target, 0, desc.internalFormat, desc.width, desc.height, desc.layers, 0, format, type, nullptr);
+        else
+            glTexImage2D(desc.target, 0, desc.internalFormat, desc.width, desc.height, 0, format, type, nullptr);
+        glTexParameteri(desc.target, GL_TEXTURE_MIN_FILTER, filter);
+        glTexParameteri(desc.target, GL_TEXTURE_MAG_FILTER, filter);
+        glTexParameteri(desc.target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(desc.target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(desc.target, 0);
+        return texture;
+    }
+};
+
+#endif
@@ -0,0 +1,149 @@
+#ifndef INSTANCE_BATCHES_H
+#define INSTANCE_BATCHES_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+// Per-object transforms for one instanced draw of many copies of a mesh, in place of a uniform
+// update and a draw call per object.
+//
+// record() maps the instance buffer once and lets the pool fill it batch by batch: each batch of
+// BATCH_SIZE objects is written by one thread into its own range, so recording scales with the
+// pool and the render thread only pays for the map, the unmap and a single draw. Each record holds
+// the model matrix and its normal matrix, so the vertex shader no longer inverts a matrix per
+// vertex. Shaders read the record as `layout (location = 3) in mat4 aModel` and
+// `layout (location = 7) in mat3 aNormalMatrix` (see 6.multiple_lights.vs).
+class InstanceBatches
+{
+public:
+    // objects written by one task; large enough that scheduling stays cheap next to the writes
+    static constexpr size_t BATCH_SIZE = 256;
+    // first attribute location of the record: model columns at 3 - 6, normal matrix at 7 - 9
+    static constexpr GLuint FIRST_LOCATION = 3;
+    static constexpr size_t RECORD_FLOATS = 16 + 9;
+    static constexpr GLsizei RECORD_BYTES = RECORD_FLOATS * sizeof(float);
+
+    // adds the instance attributes to vao, whose other attributes must stay below FIRST_LOCATION
+    void create(unsigned int vao)
+    {
+        glGenBuffers(1, &vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, RECORD_BYTES, nullptr, GL_STREAM_DRAW);
+        capacity = 1;
+        attach(vao);
+    }
+
+    // adds the same instance attributes to another vao, so draws from either read these records
+    void attach(unsigned int vao)
+    {
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        for (GLuint column = 0; column < 4; column++)
+        {
+            glVertexAttribPointer(FIRST_LOCATION + column, 4, GL_FLOAT, GL_FALSE, RECORD_BYTES, (void*)(column * 4 * sizeof(float)));
+            glEnableVertexAttribArray(FIRST_LOCATION + column);
+            glVertexAttribDivisor(FIRST_LOCATION + column, 1);
+        }
+        for (GLuint column = 0; column < 3; column++)
+        {
+            glVertexAttribPointer(FIRST_LOCATION + 4 + column, 3, GL_FLOAT, GL_FALSE, RECORD_BYTES, (void*)((16 + column * 3) * sizeof(float)));
+            glEnableVertexAttribArray(FIRST_LOCATION + 4 + column);
+            glVertexAttribDivisor(FIRST_LOCATION + 4 + column, 1);
+        }
+        glBindVertexArray(0);
+    }
+
+    // rewrites the records of count objects; modelOf(i) returns the model matrix of object i and is
+    // called from pool threads, so it may only read shared state
+    template <class ModelOf>
+    void record(size_t count, ThreadPool& pool, ModelOf modelOf)
+    {
+        instanceCount = count;
+        if (count == 0)
+            return;
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        if (count > capacity)
+        {
+            // the attribute pointers keep referring to this buffer name, so growing needs no VAO work
+            capacity = std::max(count, capacity * 2);
+            glBufferData(GL_ARRAY_BUFFER, capacity * RECORD_BYTES, nullptr, GL_STREAM_DRAW);
+        }
+        // invalidating orphans last frame's records instead of waiting for the draws that read them
+        float* records = (float*)glMapBufferRange(GL_ARRAY_BUFFER, 0, count * RECORD_BYTES,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (!records)
+        {
+            instanceCount = 0;
+            return;
+        }
+        pool.parallelFor(count, BATCH_SIZE, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                writeRecord(records + i * RECORD_FLOATS, modelOf(i));
+        });
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+
+    // one instanced draw per call; the VAO given to create() must be bound. With repeat > 1 every
+    // record is used by that many consecutive instances (instanced stereo draws each object twice)
+    void drawElements(GLenum mode, GLsizei indexCount, GLint baseVertex, GLuint repeat = 1) const
+    {
+        if (instanceCount == 0)
+            return;
+        if (repeat != 1)
+            setDivisor(repeat);
+        glDrawElementsInstancedBaseVertex(mode, indexCount, GL_UNSIGNED_INT, 0, (GLsizei)(instanceCount * repeat), baseVertex);
+        if (repeat != 1)
+            setDivisor(1);
+    }
+
+    void drawArrays(GLenum mode, GLint first, GLsizei vertexCount, GLuint repeat = 1) const
+    {
+        if (instanceCount == 0)
+            return;
+        if (repeat != 1)
+            setDivisor(repeat);
+        glDrawArraysInstanced(mode, first, vertexCount, (GLsizei)(instanceCount * repeat));
+        if (repeat != 1)
+            setDivisor(1);
+    }
+
+    size_t count() const { return instanceCount; }
+
+    // the record of one object at out: the model matrix and its normal matrix, column-major
+    static void writeRecord(float* out, const glm::mat4& model)
+    {
+        glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+        std::memcpy(out, glm::value_ptr(model), 16 * sizeof(float));
+        for (int column = 0; column < 3; column++)
+            for (int row = 0; row < 3; row++)
+                out[16 + column * 3 + row] = normalMatrix[column][row];
+    }
+
+    void destroy()
+    {
+        glDeleteBuffers(1, &vbo);
+        vbo = 0;
+        instanceCount = capacity = 0;
+    }
+
+private:
+    unsigned int vbo = 0;
+    size_t instanceCount = 0;
+    size_t capacity = 0; // records the buffer can hold
+
+    // (expects the VAO bound)
+    static void setDivisor(GLuint divisor)
+    {
+        for (GLuint location = FIRST_LOCATION; location < FIRST_LOCATION + 7; location++)
+            glVertexAttribDivisor(location, divisor);
+    }
+};
+
+#endif
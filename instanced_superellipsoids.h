@@ -0,0 +1,327 @@
+#ifndef INSTANCED_SUPERELLIPSOIDS_H
+#define INSTANCED_SUPERELLIPSOIDS_H
+
+#include <glad/glad.h>
+
+#include "upload_thread.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// Draws many superellipsoids with a single instanced call. The mesh is only the static (u, v)
+// parameter grid; 6.kinetic_array.vs evaluates the surface per instance, so every instance can
+// carry its own morph exponents without any CPU tessellation.
+//
+// Per-instance data is kept in two buffers:
+//   - base positions (vec3), written when the layout changes
+//   - channels, one tightly packed float array per channel (height offset, spin angle, n1, n2),
+//     rewritten every frame straight from the SoA simulation output
+//   - morph intensity (float), blending each instance towards a reactive shape; updated in ranges
+class InstancedSuperellipsoids
+{
+public:
+    // channel order inside the channel buffer; matches PhaseWaveArray::Channel
+    static constexpr int CHANNEL_COUNT = 4;
+
+    void create(int stacks = 24, int slices = 24)
+    {
+        std::vector<float> surface;
+        std::vector<unsigned int> indices;
+        const float pi = 3.14159265358979323846f;
+        for (int i = 0; i <= stacks; i++)
+        {
+            float u = -pi / 2.0f + (float)i / stacks * pi;
+            for (int j = 0; j <= slices; j++)
+            {
+                float v = -pi + (float)j / slices * 2.0f * pi;
+                surface.push_back(u);
+                surface.push_back(v);
+                surface.push_back((float)j / slices);
+                surface.push_back((float)i / stacks);
+            }
+        }
+        for (int i = 0; i < stacks; i++)
+        {
+            for (int j = 0; j < slices; j++)
+            {
+                int first = i * (slices + 1) + j;
+                int second = first + slices + 1;
+
+                indices.push_back(first);
+                indices.push_back(second);
+                indices.push_back(first + 1);
+
+                indices.push_back(second);
+                indices.push_back(second + 1);
+                indices.push_back(first + 1);
+            }
+        }
+        indexCount = (unsigned int)indices.size();
+
+        glGenVertexArrays(1, &vao);
+        glGenBuffers(1, &surfaceVBO);
+        glGenBuffers(1, &surfaceEBO);
+        glGenBuffers(1, &baseVBO);
+        glGenBuffers(1, &channelVBO);
+        glGenBuffers(1, &intensityVBO);
+
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, surfaceVBO);
+        glBufferData(GL_ARRAY_BUFFER, surface.size() * sizeof(float), surface.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, surfaceEBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+        // surface angles (u, v)
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        // texture coordinates
+        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+        glBindVertexArray(0);
+    }
+
+    // (re)allocates instance storage for exactly count instances with the given rest positions (xyz triples)
+    void setBasePositions(const float* xyz, size_t count)
+    {
+        instanceCount = count;
+
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, baseVBO);
+        glBufferData(GL_ARRAY_BUFFER, count * 3 * sizeof(float), xyz, GL_STATIC_DRAW);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(3);
+        glVertexAttribDivisor(3, 1);
+        capacity = count;
+
+        resetChannels();
+
+        std::vector<float> intensities(count, 0.0f);
+        glBindBuffer(GL_ARRAY_BUFFER, intensityVBO);
+        glBufferData(GL_ARRAY_BUFFER, count * sizeof(float), intensities.data(), GL_DYNAMIC_DRAW);
+        glVertexAttribPointer(8, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)0);
+        glEnableVertexAttribArray(8);
+        glVertexAttribDivisor(8, 1);
+        glBindVertexArray(0);
+    }
+
+    // adds count instances (xyz triples) after the existing ones with a single upload of their
+    // positions. Storage grows geometrically and existing positions and intensities are copied on
+    // the GPU, so appending in batches stays linear. The channel layout depends on count(), so all
+    // channels are reset to neutral
+    void appendBasePositions(const float* xyz, size_t count)
+    {
+        size_t first = instanceCount;
+        instanceCount += count;
+        glBindVertexArray(vao);
+        if (instanceCount > capacity)
+        {
+            capacity = std::max(instanceCount, capacity * 2);
+            baseVBO = growBuffer(baseVBO, first * 3 * sizeof(float), capacity * 3 * sizeof(float), GL_STATIC_DRAW);
+            glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+            glEnableVertexAttribArray(3);
+            glVertexAttribDivisor(3, 1);
+            intensityVBO = growBuffer(intensityVBO, first * sizeof(float), capacity * sizeof(float), GL_DYNAMIC_DRAW);
+            glVertexAttribPointer(8, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)0);
+            glEnableVertexAttribArray(8);
+            glVertexAttribDivisor(8, 1);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, baseVBO);
+        glBufferSubData(GL_ARRAY_BUFFER, first * 3 * sizeof(float), count * 3 * sizeof(float), xyz);
+        // new instances start unmorphed
+        std::vector<float> intensities(count, 0.0f);
+        glBindBuffer(GL_ARRAY_BUFFER, intensityVBO);
+        glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(float), count * sizeof(float), intensities.data());
+        resetChannels();
+        glBindVertexArray(0);
+    }
+
+    // appendBasePositions() done on the upload thread: grown copies of all three instance buffers
+    // are assembled there (GPU copies of the existing data plus the new positions) while the
+    // current buffers keep drawing, and finishUpload() swaps them in once the upload fence has
+    // passed. xyz must stay valid until then and instance data written meanwhile is lost. Returns
+    // false, queueing nothing, while an earlier upload is still pending
+    bool appendBasePositions(const float* xyz, size_t count, UploadThread& uploads)
+    {
+        if (pendingUpload)
+            return false;
+        size_t first = instanceCount, total = instanceCount + count;
+        unsigned int oldBase = baseVBO, oldIntensity = intensityVBO;
+        // names are shared with the upload context; the objects are created there on first bind
+        unsigned int buffers[3];
+        glGenBuffers(3, buffers);
+        unsigned int base = buffers[0], channels = buffers[1], intensity = buffers[2];
+        pendingBase = base;
+        pendingChannels = channels;
+        pendingIntensity = intensity;
+        pendingCount = total;
+        pendingUpload = uploads.submit([=] {
+            glBindBuffer(GL_COPY_READ_BUFFER, oldBase);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, base);
+            glBufferData(GL_COPY_WRITE_BUFFER, total * 3 * sizeof(float), nullptr, GL_STATIC_DRAW);
+            if (first > 0)
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, first * 3 * sizeof(float));
+            glBufferSubData(GL_COPY_WRITE_BUFFER, first * 3 * sizeof(float), count * 3 * sizeof(float), xyz);
+
+            std::vector<float> zeros(count, 0.0f);
+            glBindBuffer(GL_COPY_READ_BUFFER, oldIntensity);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, intensity);
+            glBufferData(GL_COPY_WRITE_BUFFER, total * sizeof(float), nullptr, GL_DYNAMIC_DRAW);
+            if (first > 0)
+                glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, first * sizeof(float));
+            glBufferSubData(GL_COPY_WRITE_BUFFER, first * sizeof(float), count * sizeof(float), zeros.data());
+
+            std::vector<float> neutral = neutralChannels(total);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, channels);
+            glBufferData(GL_COPY_WRITE_BUFFER, neutral.size() * sizeof(float), neutral.data(), GL_STREAM_DRAW);
+        });
+        return true;
+    }
+
+    // render thread, once per frame: adopts a finished upload; true if the instances changed
+    bool finishUpload(UploadThread& uploads)
+    {
+        if (!pendingUpload || !uploads.ready(pendingUpload))
+            return false;
+        pendingUpload = 0;
+        glDeleteBuffers(1, &baseVBO);
+        glDeleteBuffers(1, &channelVBO);
+        glDeleteBuffers(1, &intensityVBO);
+        baseVBO = pendingBase;
+        channelVBO = pendingChannels;
+        intensityVBO = pendingIntensity;
+        instanceCount = capacity = pendingCount;
+        // VAOs are not shared between contexts, so the attributes are pointed at the new buffers here
+        glBindVertexArray(vao);
+        glBindBuffer(GL_ARRAY_BUFFER, baseVBO);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(3);
+        glVertexAttribDivisor(3, 1);
+        glBindBuffer(GL_ARRAY_BUFFER, channelVBO);
+        setChannelAttributes();
+        glBindBuffer(GL_ARRAY_BUFFER, intensityVBO);
+        glVertexAttribPointer(8, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)0);
+        glEnableVertexAttribArray(8);
+        glVertexAttribDivisor(8, 1);
+        glBindVertexArray(0);
+        return true;
+    }
+
+    bool uploadPending() const { return pendingUpload != 0; }
+
+    // maps the channel buffer for a full rewrite; channel k starts at k * count() floats.
+    // the previous contents are orphaned, so the GPU never stalls on last frame's draw
+    float* mapChannels()
+    {
+        if (instanceCount == 0)
+            return nullptr;
+        glBindBuffer(GL_ARRAY_BUFFER, channelVBO);
+        return (float*)glMapBufferRange(GL_ARRAY_BUFFER, 0, instanceCount * CHANNEL_COUNT * sizeof(float),
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    }
+
+    void unmapChannels()
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, channelVBO);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+
+    // overwrites the morph intensities of instances [first, first + count)
+    void writeIntensities(size_t first, const float* values, size_t count)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, intensityVBO);
+        glBufferSubData(GL_ARRAY_BUFFER, first * sizeof(float), count * sizeof(float), values);
+    }
+
+    // with repeat > 1 every instance is drawn that many times in a row (instanced stereo draws two)
+    void draw(GLuint repeat = 1) const
+    {
+        if (instanceCount == 0)
+            return;
+        glBindVertexArray(vao);
+        if (repeat != 1)
+            setDivisor(repeat);
+        glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, 0, (GLsizei)(instanceCount * repeat));
+        if (repeat != 1)
+            setDivisor(1);
+        glBindVertexArray(0);
+    }
+
+    size_t count() const { return instanceCount; }
+
+    void destroy()
+    {
+        glDeleteVertexArrays(1, &vao);
+        glDeleteBuffers(1, &surfaceVBO);
+        glDeleteBuffers(1, &surfaceEBO);
+        glDeleteBuffers(1, &baseVBO);
+        glDeleteBuffers(1, &channelVBO);
+        glDeleteBuffers(1, &intensityVBO);
+        vao = surfaceVBO = surfaceEBO = baseVBO = channelVBO = intensityVBO = 0;
+        instanceCount = capacity = 0;
+    }
+
+private:
+    unsigned int vao = 0, surfaceVBO = 0, surfaceEBO = 0, baseVBO = 0, channelVBO = 0, intensityVBO = 0;
+    unsigned int indexCount = 0;
+    size_t instanceCount = 0;
+    size_t capacity = 0; // instances the base and intensity buffers can hold
+    // buffers being filled on the upload thread, and the instance count they hold
+    UploadThread::Ticket pendingUpload = 0;
+    unsigned int pendingBase = 0, pendingChannels = 0, pendingIntensity = 0;
+    size_t pendingCount = 0;
+
+    // channels start neutral: no offset, no spin, spheres
+    static std::vector<float> neutralChannels(size_t count)
+    {
+        std::vector<float> channels(count * CHANNEL_COUNT, 0.0f);
+        std::fill(channels.begin() + 2 * count, channels.end(), 1.0f);
+        return channels;
+    }
+
+    // (expects the VAO bound)
+    void resetChannels()
+    {
+        std::vector<float> channels = neutralChannels(instanceCount);
+        glBindBuffer(GL_ARRAY_BUFFER, channelVBO);
+        glBufferData(GL_ARRAY_BUFFER, channels.size() * sizeof(float), channels.data(), GL_STREAM_DRAW);
+        setChannelAttributes();
+    }
+
+    // channel k starts at k * count() floats (expects the VAO and the channel buffer bound)
+    void setChannelAttributes()
+    {
+        for (int k = 0; k < CHANNEL_COUNT; k++)
+        {
+            glVertexAttribPointer(4 + k, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)(k * instanceCount * sizeof(float)));
+            glEnableVertexAttribArray(4 + k);
+            glVertexAttribDivisor(4 + k, 1);
+        }
+    }
+
+    // per-instance attributes: base position, channels, morph intensity (expects the VAO bound)
+    static void setDivisor(GLuint divisor)
+    {
+        for (GLuint location = 3; location <= 8; location++)
+            glVertexAttribDivisor(location, divisor);
+    }
+
+    // replaces buffer with a larger one holding its first keepBytes, copied on the GPU;
+    // leaves the new buffer bound to GL_ARRAY_BUFFER
+    static unsigned int growBuffer(unsigned int buffer, size_t keepBytes, size_t newBytes, GLenum usage)
+    {
+        unsigned int grown;
+        glGenBuffers(1, &grown);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+        glBufferData(GL_COPY_WRITE_BUFFER, newBytes, nullptr, usage);
+        if (keepBytes > 0)
+        {
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, keepBytes);
+        }
+        glDeleteBuffers(1, &buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, grown);
+        return grown;
+    }
+};
+
+#endif
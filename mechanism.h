@@ -0,0 +1,378 @@
+#ifndef MECHANISM_H
+#define MECHANISM_H
+
+#include "simd.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+// Kinematic drive trains (motors, gears, cranks, four-bar linkages, cams) that drive sculpture
+// parameters. A MechanismGraph is described once as a graph of parts; compile() turns it into a
+// MechanismProgram: parts that do not reach an output are dropped, the rest are ordered so every
+// part runs after its inputs, and each signal gets a register that is reused once it is dead.
+// The program is then evaluated for many identical mechanisms at once (one per driven element),
+// register by register over blocks of instances, four instances per SIMD operation.
+class MechanismGraph
+{
+public:
+    // one output of a part
+    struct Signal
+    {
+        int node = -1;
+        int slot = 0;
+    };
+
+    // shaft angle omega * t + phase; each instance can add its own phase offset (see MechanismProgram)
+    Signal motor(float omega, float phase = 0.0f)
+    {
+        int motorIndex = motorCount++;
+        return addNode(MOTOR, {}, { omega, phase, (float)motorIndex }, 1);
+    }
+
+    // meshing gear pair: driven angle = -driverTeeth / drivenTeeth * driver (same sign for an internal gear)
+    Signal gear(Signal driver, int driverTeeth, int drivenTeeth, bool internal = false)
+    {
+        float ratio = (float)driverTeeth / (float)drivenTeeth;
+        return addNode(SCALE_OFFSET, { driver }, { internal ? ratio : -ratio, 0.0f }, 1);
+    }
+
+    // crank pin position (radius * cos, radius * sin) of a shaft angle
+    void crank(Signal angle, float radius, Signal* x, Signal* y)
+    {
+        Signal pin = addNode(CRANK, { angle }, { radius }, 2);
+        if (x)
+            *x = pin;
+        if (y)
+            *y = Signal{ pin.node, 1 };
+    }
+
+    // four-bar linkage driven at the crank: returns the rocker angle (slot 0) measured from the
+    // ground link; slot 1 of the same node is the coupler angle. open or crossed assembly.
+    Signal fourBar(Signal crankAngle, float crankLength, float couplerLength, float rockerLength, float groundLength, bool crossed = false)
+    {
+        return addNode(FOUR_BAR, { crankAngle }, { crankLength, couplerLength, rockerLength, groundLength, crossed ? -1.0f : 1.0f }, 2);
+    }
+
+    Signal couplerAngle(Signal fourBarRocker) const { return Signal{ fourBarRocker.node, 1 }; }
+
+    // follower lift of a disc cam with a cycloidal rise over riseFraction of a turn and a cycloidal return
+    Signal cam(Signal angle, float lift, float riseFraction = 0.5f)
+    {
+        riseFraction = std::min(std::max(riseFraction, 0.01f), 0.99f);
+        return addNode(CAM, { angle }, { lift, riseFraction }, 1);
+    }
+
+    Signal sine(Signal angle) { return addNode(SINE, { angle }, {}, 1); }
+    Signal cosine(Signal angle) { return addNode(COSINE, { angle }, {}, 1); }
+    Signal add(Signal a, Signal b) { return addNode(ADD, { a, b }, {}, 1); }
+    Signal multiply(Signal a, Signal b) { return addNode(MULTIPLY, { a, b }, {}, 1); }
+    Signal scaleOffset(Signal in, float scale, float offset) { return addNode(SCALE_OFFSET, { in }, { scale, offset }, 1); }
+
+    // linear remap of [inMin, inMax] onto [outMin, outMax]
+    Signal mapRange(Signal in, float inMin, float inMax, float outMin, float outMax)
+    {
+        float scale = (outMax - outMin) / (inMax - inMin);
+        return scaleOffset(in, scale, outMin - inMin * scale);
+    }
+
+    // exposes a signal under a name, read back with MechanismProgram::outputIndex()
+    void output(Signal signal, const std::string& name)
+    {
+        outputs.push_back(NamedOutput{ signal, name });
+    }
+
+private:
+    friend class MechanismProgram;
+
+    enum Op { MOTOR, SCALE_OFFSET, CRANK, FOUR_BAR, CAM, SINE, COSINE, ADD, MULTIPLY };
+
+    struct Node
+    {
+        Op op;
+        std::vector<Signal> inputs;
+        std::vector<float> params;
+        int slots;
+    };
+    struct NamedOutput
+    {
+        Signal signal;
+        std::string name;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<NamedOutput> outputs;
+    int motorCount = 0;
+
+    Signal addNode(Op op, std::vector<Signal> inputs, std::vector<float> params, int slots)
+    {
+        nodes.push_back(Node{ op, std::move(inputs), std::move(params), slots });
+        return Signal{ (int)nodes.size() - 1, 0 };
+    }
+};
+
+class MechanismProgram
+{
+public:
+    // instances evaluated per block; registers for one block stay in L1
+    static constexpr int BLOCK = 256;
+
+    static MechanismProgram compile(const MechanismGraph& graph)
+    {
+        MechanismProgram program;
+        const std::vector<MechanismGraph::Node>& nodes = graph.nodes;
+
+        // depth-first post-order from the outputs: dependencies first, unreachable parts dropped
+        std::vector<int> state(nodes.size(), 0); // 0 unvisited, 1 on stack, 2 emitted
+        std::vector<int> order;
+        std::vector<std::pair<int, size_t>> stack;
+        for (const auto& out : graph.outputs)
+        {
+            if (state[out.signal.node])
+                continue;
+            stack.push_back({ out.signal.node, 0 });
+            state[out.signal.node] = 1;
+            while (!stack.empty())
+            {
+                int node = stack.back().first;
+                size_t& next = stack.back().second;
+                if (next < nodes[node].inputs.size())
+                {
+                    int dep = nodes[node].inputs[next++].node;
+                    if (state[dep] == 0)
+                    {
+                        state[dep] = 1;
+                        stack.push_back({ dep, 0 });
+                    }
+                    continue;
+                }
+                state[node] = 2;
+                order.push_back(node);
+                stack.pop_back();
+            }
+        }
+
+        // last instruction that reads each node, so its registers can be recycled afterwards
+        std::vector<int> lastUse(nodes.size(), -1);
+        for (size_t i = 0; i < order.size(); i++)
+            for (const auto& in : nodes[order[i]].inputs)
+                lastUse[in.node] = std::max(lastUse[in.node], (int)i);
+        for (const auto& out : graph.outputs)
+            lastUse[out.signal.node] = (int)order.size(); // outputs live to the end
+
+        std::vector<int> freeRegisters;
+        std::vector<int> firstRegister(nodes.size(), -1);
+        std::vector<std::vector<int>> expiring(order.size() + 1);
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            int node = order[i];
+            const MechanismGraph::Node& n = nodes[node];
+            Instruction ins;
+            ins.op = n.op;
+            for (size_t k = 0; k < n.inputs.size() && k < 2; k++)
+                ins.src[k] = firstRegister[n.inputs[k].node] + n.inputs[k].slot;
+            for (size_t k = 0; k < n.params.size() && k < 5; k++)
+                ins.param[k] = n.params[k];
+
+            // a node's slots need consecutive registers, so only single-slot results reuse freed ones
+            if (n.slots == 1 && !freeRegisters.empty())
+            {
+                ins.dst = freeRegisters.back();
+                freeRegisters.pop_back();
+            }
+            else
+            {
+                ins.dst = program.registerCount;
+                program.registerCount += n.slots;
+            }
+            firstRegister[node] = ins.dst;
+            program.instructions.push_back(ins);
+
+            // registers whose last reader was this instruction become free for the next one
+            if (lastUse[node] >= 0 && lastUse[node] < (int)order.size())
+                expiring[lastUse[node]].push_back(node);
+            for (int dead : expiring[i])
+                if (nodes[dead].slots == 1)
+                    freeRegisters.push_back(firstRegister[dead]);
+        }
+
+        for (const auto& out : graph.outputs)
+        {
+            program.outputNames.push_back(out.name);
+            program.outputRegisters.push_back(firstRegister[out.signal.node] + out.signal.slot);
+        }
+        program.motorPhases.resize(graph.motorCount);
+        return program;
+    }
+
+    size_t instructionCount() const { return instructions.size(); }
+    int registers() const { return registerCount; }
+
+    void setInstanceCount(size_t count)
+    {
+        instanceCount = count;
+        for (auto& phases : motorPhases)
+            phases.resize(count, 0.0f);
+        outputValues.assign(outputRegisters.size() * count, 0.0f);
+    }
+    size_t instances() const { return instanceCount; }
+
+    // per-instance phase offsets (radians) added to the given motor, in creation order
+    std::vector<float>& motorPhase(int motorIndex) { return motorPhases[motorIndex]; }
+
+    // index of a named output, -1 if the graph has no such output
+    int outputIndex(const std::string& name) const
+    {
+        for (size_t i = 0; i < outputNames.size(); i++)
+            if (outputNames[i] == name)
+                return (int)i;
+        return -1;
+    }
+
+    // values of one output for every instance, valid after evaluate()
+    const float* output(int index) const { return &outputValues[(size_t)index * instanceCount]; }
+
+    void evaluate(float t, ThreadPool& pool)
+    {
+        size_t blocks = (instanceCount + BLOCK - 1) / BLOCK;
+        pool.parallelFor(blocks, 4, [&](size_t begin, size_t end) {
+            static thread_local std::vector<float> scratch;
+            scratch.resize((size_t)registerCount * BLOCK);
+            for (size_t b = begin; b < end; b++)
+                evaluateBlock(t, b * BLOCK, std::min<size_t>(BLOCK, instanceCount - b * BLOCK), scratch.data());
+        });
+    }
+
+private:
+    struct Instruction
+    {
+        MechanismGraph::Op op;
+        int dst = 0;
+        int src[2] = { 0, 0 };
+        float param[5] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+    };
+
+    std::vector<Instruction> instructions;
+    int registerCount = 0;
+    std::vector<std::string> outputNames;
+    std::vector<int> outputRegisters;
+    std::vector<std::vector<float>> motorPhases;
+    std::vector<float> outputValues;
+    size_t instanceCount = 0;
+
+    void evaluateBlock(float t, size_t first, size_t count, float* regs)
+    {
+        using simd::float4;
+        // pad the block to whole vectors; the padding lanes compute garbage that is never read
+        size_t lanes = (count + 3) & ~size_t(3);
+        auto reg = [&](int r) { return regs + (size_t)r * BLOCK; };
+
+        for (const Instruction& ins : instructions)
+        {
+            float* dst = reg(ins.dst);
+            const float* a = reg(ins.src[0]);
+            const float* b = reg(ins.src[1]);
+            switch (ins.op)
+            {
+            case MechanismGraph::MOTOR:
+            {
+                const std::vector<float>& phase = motorPhases[(int)ins.param[2]];
+                float base = ins.param[0] * t + ins.param[1];
+                for (size_t i = 0; i < count; i++)
+                    dst[i] = base + phase[first + i];
+                break;
+            }
+            case MechanismGraph::SCALE_OFFSET:
+                for (size_t i = 0; i < lanes; i += 4)
+                    simd::madd(float4::load(a + i), float4(ins.param[0]), float4(ins.param[1])).store(dst + i);
+                break;
+            case MechanismGraph::CRANK:
+            {
+                float* dstY = reg(ins.dst + 1);
+                for (size_t i = 0; i < lanes; i += 4)
+                {
+                    float4 angle = float4::load(a + i);
+                    (simd::cos(angle) * ins.param[0]).store(dst + i);
+                    (simd::sin(angle) * ins.param[0]).store(dstY + i);
+                }
+                break;
+            }
+            case MechanismGraph::FOUR_BAR:
+                fourBar(ins, a, dst, reg(ins.dst + 1), lanes);
+                break;
+            case MechanismGraph::CAM:
+                cam(ins, a, dst, lanes);
+                break;
+            case MechanismGraph::SINE:
+                for (size_t i = 0; i < lanes; i += 4)
+                    simd::sin(float4::load(a + i)).store(dst + i);
+                break;
+            case MechanismGraph::COSINE:
+                for (size_t i = 0; i < lanes; i += 4)
+                    simd::cos(float4::load(a + i)).store(dst + i);
+                break;
+            case MechanismGraph::ADD:
+                for (size_t i = 0; i < lanes; i += 4)
+                    (float4::load(a + i) + float4::load(b + i)).store(dst + i);
+                break;
+            case MechanismGraph::MULTIPLY:
+                for (size_t i = 0; i < lanes; i += 4)
+                    (float4::load(a + i) * float4::load(b + i)).store(dst + i);
+                break;
+            }
+            // keep the padding lanes of a partial block finite
+            for (size_t i = count; i < lanes; i++)
+                dst[i] = 0.0f;
+        }
+
+        for (size_t o = 0; o < outputRegisters.size(); o++)
+            std::copy(reg(outputRegisters[o]), reg(outputRegisters[o]) + count, &outputValues[o * instanceCount + first]);
+    }
+
+    // closed-form position analysis (Freudenstein): with crank a at angle t2, coupler b, rocker c
+    // and ground d, the rocker angle satisfies A cos t4 + B sin t4 = C, so
+    // t4 = atan2(B, A) +- acos(C / sqrt(A^2 + B^2)), the sign picking the open or crossed assembly
+    static void fourBar(const Instruction& ins, const float* crankAngle, float* rocker, float* coupler, size_t lanes)
+    {
+        using simd::float4;
+        const float a = ins.param[0], b = ins.param[1], c = ins.param[2], d = ins.param[3];
+        const float4 branch(ins.param[4]);
+        for (size_t i = 0; i < lanes; i += 4)
+        {
+            float4 t2 = float4::load(crankAngle + i);
+            float4 c2 = simd::cos(t2), s2 = simd::sin(t2);
+            // crank pin relative to the rocker pivot at (d, 0)
+            float4 px = c2 * a - float4(d), py = s2 * a;
+            // rocker tip lies on both circles: |q| = c around the pivot, |q - p| = b around the pin
+            float4 A = px * (2.0f * c), B = py * (2.0f * c);
+            float4 C = px * px + py * py + float4(c * c - b * b);
+            // A cos t4 + B sin t4 = C; positions the linkage cannot reach are clamped to the toggle pose
+            float4 disc = simd::sqrt(simd::max(A * A + B * B - C * C, float4(0.0f)));
+            float4 t4 = simd::atan2(B, A) + simd::atan2(disc * branch, C);
+            t4.store(rocker + i);
+            // coupler direction from the crank pin to the rocker tip
+            float4 qx = simd::cos(t4) * c + float4(d), qy = simd::sin(t4) * c;
+            simd::atan2(qy - py, qx - c2 * a).store(coupler + i);
+        }
+    }
+
+    // cycloidal rise over [0, rise) of a turn, cycloidal return over the rest
+    static void cam(const Instruction& ins, const float* angle, float* lift, size_t lanes)
+    {
+        using simd::float4;
+        const float4 L(ins.param[0]), rise(ins.param[1]), invTwoPi(0.15915494309189533577f), twoPi(6.28318530717958647692f);
+        for (size_t i = 0; i < lanes; i += 4)
+        {
+            float4 turns = float4::load(angle + i) * invTwoPi;
+            float4 p = turns - simd::floor(turns);
+            float4 rising = simd::cmplt(p, rise);
+            float4 q = simd::select(rising, p / rise, (p - rise) / (float4(1.0f) - rise));
+            float4 cycloid = q - simd::sin(q * twoPi) * invTwoPi;
+            (simd::select(rising, cycloid, float4(1.0f) - cycloid) * L).store(lift + i);
+        }
+    }
+};
+
+#endif
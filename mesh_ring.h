@@ -0,0 +1,108 @@
+#ifndef MESH_RING_H
+#define MESH_RING_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// The last few generated meshes of one shape, kept on the GPU as slots of a single vertex buffer.
+//
+// The newest slot is live: write() puts this frame's vertices there, setModel() its transform, and
+// the shape is drawn from it with glDrawElementsBaseVertex(liveBaseVertex()). commit() keeps the
+// live slot as an echo and moves the live slot on, over the oldest echo, so snapshots are never
+// copied or regenerated and memory stays at slots() meshes. drawEchoes() draws every echo, oldest first, in one
+// glMultiDrawElementsBaseVertex; the vertex shader (6.echo.vs) recovers the slot of each vertex
+// from gl_VertexID (which includes the base vertex) to pick that snapshot's transform and fade.
+class MeshRing
+{
+public:
+    // upper bound on slots; matches MAX_ECHOES in 6.echo.vs
+    static constexpr int MAX_SLOTS = 16;
+
+    void create(size_t vertexCount, size_t vertexSize, int slots)
+    {
+        slotVertices = vertexCount;
+        slotBytes = vertexCount * vertexSize;
+        slotCount = std::min(std::max(slots, 2), MAX_SLOTS);
+        live = 0;
+        echoes = 0;
+        glGenBuffers(1, &vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, slotBytes * slotCount, nullptr, GL_DYNAMIC_DRAW);
+    }
+
+    // the vertex buffer holding every slot; attribute pointers start at offset 0
+    unsigned int buffer() const { return vbo; }
+    int slots() const { return slotCount; }
+    int echoCount() const { return echoes; }
+
+    // replaces the live snapshot (slotVertices vertices)
+    void write(const void* vertices)
+    {
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferSubData(GL_ARRAY_BUFFER, live * slotBytes, slotBytes, vertices);
+    }
+
+    // the transform the live snapshot's echo will be drawn with
+    void setModel(const glm::mat4& model) { models[live] = model; }
+
+    // the live snapshot becomes the newest echo; the next write() reuses the oldest slot
+    void commit()
+    {
+        live = (live + 1) % slotCount;
+        echoes = std::min(echoes + 1, slotCount - 1);
+    }
+
+    // forgets all echoes (the live snapshot stays)
+    void clear() { echoes = 0; }
+
+    GLint liveBaseVertex() const { return (GLint)(live * slotVertices); }
+
+    // byte offset of the live snapshot in buffer(), for writers that fill it on the GPU
+    GLintptr liveByteOffset() const { return (GLintptr)(live * slotBytes); }
+
+    // draws the echoes with program, which must be bound and declare echoModel[], echoFade[] and
+    // slotVertices as 6.echo.vs does; the VAO reading buffer() and the index buffer must be bound
+    void drawEchoes(unsigned int program, GLsizei indexCount) const
+    {
+        if (echoes == 0)
+            return;
+        // newest echo at fade 1, fading linearly so the slot about to be reused is nearly gone
+        float fades[MAX_SLOTS] = {};
+        std::vector<GLsizei> counts(echoes, indexCount);
+        std::vector<const void*> offsets(echoes, nullptr);
+        std::vector<GLint> baseVertices(echoes);
+        for (int k = 0; k < echoes; k++)
+        {
+            int age = echoes - k; // oldest first, so nearer echoes blend over older ones
+            int slot = (live - age + slotCount) % slotCount;
+            fades[slot] = 1.0f - (float)(age - 1) / slotCount;
+            baseVertices[k] = (GLint)(slot * slotVertices);
+        }
+        glUniformMatrix4fv(glGetUniformLocation(program, "echoModel"), slotCount, GL_FALSE, glm::value_ptr(models[0]));
+        glUniform1fv(glGetUniformLocation(program, "echoFade"), slotCount, fades);
+        glUniform1i(glGetUniformLocation(program, "slotVertices"), (GLint)slotVertices);
+        glMultiDrawElementsBaseVertex(GL_TRIANGLES, counts.data(), GL_UNSIGNED_INT, offsets.data(), echoes, baseVertices.data());
+    }
+
+    void destroy()
+    {
+        glDeleteBuffers(1, &vbo);
+        vbo = 0;
+        echoes = 0;
+    }
+
+private:
+    unsigned int vbo = 0;
+    size_t slotVertices = 0, slotBytes = 0;
+    int slotCount = 0;
+    int live = 0;   // slot written by write()
+    int echoes = 0; // committed slots behind the live one, at most slotCount - 1
+    glm::mat4 models[MAX_SLOTS];
+};
+
+#endif
@@ -10,105 +10,238 @@
 #include <learnopengl/shader_m.h>
 #include <learnopengl/camera.h>
 
+#include "thread_pool.h"
+#include "scene_graph.h"
+#include "phase_wave_array.h"
+#include "instanced_superellipsoids.h"
+#include "cable_physics.h"
+#include "mechanism.h"
+#include "superellipsoid_collision.h"
+#include "bvh.h"
+#include "proximity_morph.h"
+#include "animation_curves.h"
+#include "expression.h"
+#include "spawn_patterns.h"
+#include "osc.h"
+#include "audio_analysis.h"
+#include "surface_particles.h"
+#include "mesh_ring.h"
+#include "upload_thread.h"
+#include "instance_batches.h"
+#include "view_frustum.h"
+#include "stereo_target.h"
+#include "frame_graph.h"
+#include "superellipsoid_feedback.h"
+#include "superellipsoid_compute.h"
+#include "superellipsoid_tessellation.h"
+#include "superellipsoid_raymarch.h"
+#include "scene_file.h"
+#include "sculpture.h"
+
 #include <iostream>
+#include <fstream>
+#include <sstream>
 #include <vector>
 #include <cmath>
+#include <memory>
+#include <thread>
 
 #define M_PI 3.14159265358979323846
 
+struct WindowState;
+
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
-void processInput(GLFWwindow* window);
+void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
+void processInput(GLFWwindow* window, WindowState& state, float deltaTime);
+bool keyPressed(GLFWwindow* window, WindowState& state, int key);
 unsigned int loadTexture(const char* path);
+unsigned int loadTextureAsync(const char* path, UploadThread& uploads, UploadThread::Ticket& ticket);
+AnimationCurves buildShowCurves();
+ExpressionProgram loadChoreography(const char* path);
+size_t generatePattern(int pattern, const Camera& camera, std::vector<glm::vec3>& positions, ThreadPool& pool);
+void spawnSuperellipsoid(SculptureScene& scene, const glm::vec3& position, const glm::vec3& push);
+void applyControl(const OscMessage& message, WindowState& state);
+void reportControlLatency(WindowState& state, float now);
+void soundtrackDrive(const AudioAnalysis::Frame& frame, float& bass, float& mid, float& high);
+void reportParticleTimings(WindowState& state, float now, const SurfaceParticles& particles);
+void reportFrameGraph(const FrameGraph& graph, std::string& reported);
+glm::vec3 pickingRayDirection(GLFWwindow* window, const Camera& camera, const glm::mat4& projection, const glm::mat4& view, const glm::vec4& rect);
+int runBatch(int sculptures, int frames, const char* backend, int objects);
+void placeBatchSculpture(SculptureScene& scene, float angle, int objects);
+int checkFrameGraph();
+int verifyGeneration();
+int checkVulkan();
+glm::vec4 viewRect(int view, int count);
 
 // settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 
-// camera
-Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
-float lastX = SCR_WIDTH / 2.0f;
-float lastY = SCR_HEIGHT / 2.0f;
-bool firstMouse = true;
-
-// timing
-float deltaTime = 0.0f;
-float lastFrame = 0.0f;
-
-// lighting
-glm::vec3 lightPos(1.2f, 1.0f, 2.0f);
-
-// GLOBAL VARIABLES FOR SPAWNING (NEW)
-std::vector<glm::vec3> spawnedSuperellipsoids;
-bool e_pressed_last_frame = false;
-
-struct Vertex {
-    glm::vec3 Position;
-    glm::vec3 Normal;
-    glm::vec2 TexCoords;
+// kinetic array (grid of wave-driven shapes below the sculpture)
+const int KINETIC_ARRAY_WIDTH = 100;
+const int KINETIC_ARRAY_DEPTH = 100;
+// optional formulas overriding the waves, re-read with R
+const char* CHOREOGRAPHY_PATH = "kinetic_array.expr";
+
+// installation views (V cycles 1, 2 and 4): view 0 is the camera above, the others are fixed
+// cameras around the sculpture sharing one framebuffer. Everything except culling and draw
+// submission happens once per frame, whatever the view count
+const int MAX_VIEWS = 4;
+// single-pass stereo (O): the visitor's view for both eyes, side by side; cables, the selection,
+// echoes and particles are left out of it
+const float EYE_SEPARATION = 0.065f;
+
+// the sculpture itself (camera, lights, shape, spawned objects on their cables) is a SculptureScene
+// owned by main() and moved by a SculptureSimulation, see sculpture.h; what is left belongs to the
+// interactive window, in its WindowState below. E spawns an object in front of the camera
+
+// headless batch (--batch <sculptures> [frames] [backend] [objects]): independent sculptures with
+// objects swinging around them each, simulated and rendered offscreen, each on its own thread with
+// its own pool (and GL context), timed on 1, 2, 4 .. threads. The renderer is picked by name through
+// createSculptureBackend(): "gl", or "vulkan" where the Vulkan headers were found
+const int BATCH_WIDTH = 640;
+const int BATCH_HEIGHT = 360;
+
+// left click selects the spawned object under the cursor (the screen centre while the cursor is captured)
+
+// keys 1-4 lay out a whole field of small shapes at once (grid, spiral, Poisson disk, curve), 0 clears
+// them. Pattern instances are drawn instanced and take no part in cables, collisions or picking
+
+// external show control: OSC over UDP on localhost (osc_send.cpp is a test sender). Values set
+// from outside replace the animated ones until /release
+//   /morph n1 n2, /morph/n1 v, /morph/n2 v      sculpture exponents
+//   /light/<0-3>/intensity v, /light/<0-3>/position x y z
+//   /spawn x y z, /pattern <0-4>, /release, /ping <send time, int64 ns>
+const unsigned short OSC_PORT = 9000;
+// /spawn only fills slots reserved up front, as messages are applied without allocating; E and a
+// scene load may still add objects past them
+const size_t CONTROL_SPAWN_SLOTS = 4096;
+struct ShowControl
+{
+    bool n1Set = false, n2Set = false;
+    float n1 = 1.0f, n2 = 1.0f;
+    bool intensitySet[4] = { false, false, false, false };
+    bool positionSet[4] = { false, false, false, false };
+    float intensity[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    glm::vec3 position[4];
+
+    // latency of the messages applied since the last report, in nanoseconds
+    int64_t arrivalSum = 0, arrivalMax = 0, pingSum = 0, pingMax = 0;
+    int arrivalCount = 0, pingCount = 0;
+    int spawnsRefused = 0; // /spawn with every reserved slot taken
+    float lastReport = 0.0f;
 };
 
-void generateSuperellipsoid(
-    std::vector<Vertex>& vertices,
-    std::vector<unsigned int>& indices,
-    float a, float b, float c,
-    float n1, float n2,
-    int stacks = 64, int slices = 64)
+// audio-reactive mode (M): band energies of the soundtrack, analysed ahead of time on a worker
+// thread, drive the sculpture's exponents, the lights and its scale in place of the drive trains.
+// There is no playback device; the track is followed on the simulation clock from the moment M is
+// pressed. Show control still wins over the soundtrack
+const char* SOUNDTRACK_PATH = "soundtrack.wav";
+
+// particles shed by the sculpture's surface; P cycles off -> CPU (SIMD) -> GPU (transform feedback)
+const size_t PARTICLE_COUNT = 1 << 20;
+
+// echo trails (T): the sculpture's recent shapes as fading ghosts, one kept every ECHO_INTERVAL
+// seconds, straight from the ring of generated meshes the sculpture itself is drawn from
+const int ECHO_SLOTS = 12;
+const float ECHO_INTERVAL = 0.1f;
+
+// superellipsoid generation (G cycles the available paths): on the CPU and uploaded, or on the
+// GPU straight into the mesh ring by transform feedback or, with GL 4.3, a compute shader;
+// render-thread time per frame is averaged per path and printed when it changes
+const char* const GENERATION_PATH_NAMES[SculptureRenderer::GENERATIONS] = { "CPU", "GPU, transform feedback", "GPU, compute shader" };
+
+// tessellated detail (L, GL 4.0): the sculpture and spawned objects as patches subdivided on the
+// GPU for each view, instead of the fixed mesh; the stereo pass keeps the mesh. The generated
+// triangle count is printed every two seconds
+
+// ray-marched surfaces (I): the sculpture and spawned objects as implicit surfaces marched per
+// fragment inside their boxes, exact at any distance; the stereo pass keeps the mesh. B times the
+// fill cost of the meshed, tessellated and ray-marched shapes at several resolutions
+const char* const SHAPE_SURFACE_NAMES[SculptureRenderer::SURFACES] = { "mesh", "tessellated", "ray-marched" };
+
+// scenes: F5 saves the layout (camera, shape, lights, spawned objects, pattern instances, show
+// curves) to SCENE_PATH, memory-mapped on load. F6 exports it as editable JSON to SCENE_JSON_PATH,
+// which is far slower (about a second for a million pattern instances) and so only done on request.
+// F9 loads the scene, from the JSON when that was exported or edited after the last save
+const char* SCENE_PATH = "installation.scene";
+const char* SCENE_JSON_PATH = "installation.scene.json";
+
+// the interactive window's own state: what the visitor's keys and mouse set (the modes above and
+// the requests the render loop takes up on its next frame), the workers and listeners feeding the
+// loop, and what the periodic reports have accumulated. main() owns it; the GLFW callbacks reach it
+// through the window's user pointer
+struct WindowState
 {
-    vertices.clear();
-    indices.clear();
-
-    auto sgn = [](float x) { return (x < 0) ? -1.0f : 1.0f; };
-    auto powe = [&](float base, float exp) {
-        return sgn(base) * std::pow(std::abs(base), exp);
-        };
-
-    for (int i = 0; i <= stacks; i++) {
-        float u = -M_PI / 2.0f + (float)i / stacks * M_PI;
-        for (int j = 0; j <= slices; j++) {
-            float v = -M_PI + (float)j / slices * 2.0f * M_PI;
-
-            float cu = cos(u), su = sin(u);
-            float cv = cos(v), sv = sin(v);
-
-            float x = a * powe(cu, n1) * powe(cv, n2);
-            float y = b * powe(cu, n1) * powe(sv, n2);
-            float z = c * powe(su, n1);
-
-            glm::vec3 pos(x, y, z);
-
-            // approximate normal
-            glm::vec3 n = glm::normalize(glm::vec3(
-                x / (a * a), y / (b * b), z / (c * c)
-            ));
-
-            glm::vec2 tex(
-                (float)j / slices,
-                (float)i / stacks
-            );
-
-            vertices.push_back({ pos, n, tex });
-        }
-    }
-
-    for (int i = 0; i < stacks; i++) {
-        for (int j = 0; j < slices; j++) {
-            int first = i * (slices + 1) + j;
-            int second = first + slices + 1;
-
-            indices.push_back(first);
-            indices.push_back(second);
-            indices.push_back(first + 1);
+    SculptureScene* scene = nullptr;
+
+    // worker pool of the window's per-frame loops; the simulation runs its loops on it too
+    ThreadPool threadPool;
+    // picking, over collision bodies 1.., i.e. primitive i is spawned object i
+    BoundingVolumeHierarchy pickingTree;
+    OscListener oscListener;
+    ShowControl showControl;
+    AudioAnalysis soundtrack;
+    // the fixed views' cameras
+    Camera installationCameras[MAX_VIEWS - 1] = {
+        Camera(glm::vec3(3.5f, 0.5f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), 180.0f, -8.0f),  // side
+        Camera(glm::vec3(0.0f, 0.5f, -3.5f), glm::vec3(0.0f, 1.0f, 0.0f), 90.0f, -8.0f),  // back
+        Camera(glm::vec3(0.0f, 4.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, -89.0f) // above
+    };
 
-            indices.push_back(second);
-            indices.push_back(second + 1);
-            indices.push_back(first + 1);
-        }
-    }
-}
+    // mouse look of the visitor's camera
+    float lastX = SCR_WIDTH / 2.0f;
+    float lastY = SCR_HEIGHT / 2.0f;
+    bool firstMouse = true;
+    // keys down at the last processInput(), so that a key acts once per press
+    bool keysDown[GLFW_KEY_LAST + 1] = {};
+
+    // modes
+    bool showKineticArray = false;
+    int viewCount = 1;
+    bool stereo = false;
+    bool audioReactive = false;
+    int particleMode = 0; // 0 off, otherwise 1 + SurfaceParticles::Backend
+    bool showEchoes = false;
+    int generationPath = SculptureRenderer::GENERATE_CPU;
+    bool tessellatedDetail = false;
+    bool rayMarchedSurfaces = false;
+    int selectedObject = -1;
+
+    // which modes this context and this run can offer
+    bool generationPathAvailable[SculptureRenderer::GENERATIONS] = { true, false, false };
+    bool tessellationAvailable = false;
+    bool rayMarchAvailable = false;
+    bool soundtrackLoaded = false;
+
+    // requests
+    bool reloadChoreography = true;
+    bool pickRequested = false;
+    int patternRequest = -1;
+    bool particleModeChanged = false;
+    bool fillBenchmarkRequested = false;
+    bool sceneSaveRequested = false;
+    bool sceneExportRequested = false;
+    bool sceneLoadRequested = false;
+
+    // reports: frame time averaged per view layout, the frame graph's last passes and memory,
+    // particle update time, render-thread generation time per path, tessellation statistics
+    int reportedViewCount = 1;
+    float viewFrameSum = 0.0f;
+    int viewFrameCount = 0;
+    std::string reportedFrameGraph;
+    double particleUpdateSum = 0.0;
+    int particleUpdateCount = 0;
+    float particleLastReport = 0.0f;
+    int reportedGenerationPath = SculptureRenderer::GENERATE_CPU;
+    double generationSum = 0.0;
+    int generationCount = 0;
+    float tessellationLastReport = 0.0f;
+};
 
-int main()
+int main(int argc, char** argv)
 {
     // glfw: initialize and configure
     // ------------------------------
@@ -121,6 +254,16 @@ int main()
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
+    if (argc >= 3 && std::strcmp(argv[1], "--batch") == 0)
+        return runBatch(std::max(std::atoi(argv[2]), 1), argc >= 4 ? std::max(std::atoi(argv[3]), 1) : 120, argc >= 5 ? argv[4] : "gl",
+            argc >= 6 ? std::max(std::atoi(argv[5]), 0) : 3);
+    if (argc >= 2 && std::strcmp(argv[1], "--check-frame-graph") == 0)
+        return checkFrameGraph();
+    if (argc >= 2 && std::strcmp(argv[1], "--verify-generation") == 0)
+        return verifyGeneration();
+    if (argc >= 2 && std::strcmp(argv[1], "--check-vulkan") == 0)
+        return checkVulkan();
+
     // glfw window creation
     // --------------------
     GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Superellipsoid Morphing", NULL, NULL);
@@ -131,9 +274,21 @@ int main()
         return -1;
     }
     glfwMakeContextCurrent(window);
+
+    // the window's state (its workers, listeners, modes, requests and reports), the sculpture in
+    // the window and what moves it, on the window's pool; the callbacks reach them, and the
+    // visitor's camera, through the window
+    WindowState state;
+    SculptureScene installation;
+    installation.reserveSpawned(CONTROL_SPAWN_SLOTS);
+    SculptureSimulation simulation(state.threadPool);
+    Camera& camera = installation.camera;
+    state.scene = &installation;
+    glfwSetWindowUserPointer(window, &state);
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetScrollCallback(window, scroll_callback);
+    glfwSetMouseButtonCallback(window, mouse_button_callback);
 
     // tell GLFW to capture our mouse
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
@@ -146,80 +301,30 @@ int main()
         return -1;
     }
 
+    // large buffer and texture uploads go through a second context on its own thread
+    UploadThread uploadThread;
+    if (!uploadThread.start(window))
+        std::cout << "No shared upload context; uploads stay on the render thread" << std::endl;
+
     // configure global opengl state
     // -----------------------------
     glEnable(GL_DEPTH_TEST);
 
-    // build and compile our shader zprogram
-    // ------------------------------------
-    Shader lightingShader("6.multiple_lights.vs", "6.multiple_lights.fs");
-    Shader lightCubeShader("6.light_cube.vs", "6.light_cube.fs");
-
-    // ====================================================================
-    // 1. SUPER ELLIPSOID MESH SETUP (REPLACES CUBE VERTEX DATA)
-    // ====================================================================
-
-    // Mesh storage
-    std::vector<Vertex> superellipsoidVertices;
-    std::vector<unsigned int> superellipsoidIndices;
-
-    // Generate initial shape (sphere: a=b=c=1, n1=n2=1)
-    generateSuperellipsoid(superellipsoidVertices, superellipsoidIndices, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f);
-
-    unsigned int superellipsoidVAO, VBO, EBO;
-    glGenVertexArrays(1, &superellipsoidVAO);
-    glGenBuffers(1, &VBO);
-    glGenBuffers(1, &EBO);
-
-    glBindVertexArray(superellipsoidVAO);
-
-    // Vertex Buffer Object (VBO)
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    // Use GL_DYNAMIC_DRAW since the geometry will change every frame (for morphing)
-    glBufferData(GL_ARRAY_BUFFER, superellipsoidVertices.size() * sizeof(Vertex), superellipsoidVertices.data(), GL_DYNAMIC_DRAW);
-
-    // Element Buffer Object (EBO)
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, superellipsoidIndices.size() * sizeof(unsigned int), superellipsoidIndices.data(), GL_DYNAMIC_DRAW);
-
-    // Vertex Attributes
-    // Position
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-    glEnableVertexAttribArray(0);
-    // Normal
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-    glEnableVertexAttribArray(1);
-    // TexCoords
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-    glEnableVertexAttribArray(2);
-
-    // Unbind VAO
-    glBindVertexArray(0);
-
-    // ====================================================================
-    // 2. LIGHT CUBE SETUP 
-    // ====================================================================
-    float lightCubeVertices[] = { /* same cube data as your original 'vertices' array, but only positions (3 floats) needed for the light cube shader */
-             -0.5f, -0.5f, -0.5f,  0.5f, -0.5f, -0.5f,  0.5f,  0.5f, -0.5f,  0.5f,  0.5f, -0.5f, -0.5f,  0.5f, -0.5f, -0.5f, -0.5f, -0.5f,
-             -0.5f, -0.5f,  0.5f,  0.5f, -0.5f,  0.5f,  0.5f,  0.5f,  0.5f,  0.5f,  0.5f,  0.5f, -0.5f,  0.5f,  0.5f, -0.5f, -0.5f,  0.5f,
-             -0.5f,  0.5f,  0.5f, -0.5f,  0.5f, -0.5f, -0.5f, -0.5f, -0.5f, -0.5f, -0.5f, -0.5f, -0.5f, -0.5f,  0.5f, -0.5f,  0.5f,  0.5f,
-              0.5f,  0.5f,  0.5f,  0.5f,  0.5f, -0.5f,  0.5f, -0.5f, -0.5f,  0.5f, -0.5f, -0.5f,  0.5f, -0.5f,  0.5f,  0.5f,  0.5f,  0.5f,
-             -0.5f, -0.5f, -0.5f,  0.5f, -0.5f, -0.5f,  0.5f, -0.5f,  0.5f,  0.5f, -0.5f,  0.5f, -0.5f, -0.5f,  0.5f, -0.5f, -0.5f, -0.5f,
-             -0.5f,  0.5f, -0.5f,  0.5f,  0.5f, -0.5f,  0.5f,  0.5f,  0.5f,  0.5f,  0.5f,  0.5f, -0.5f,  0.5f,  0.5f, -0.5f,  0.5f, -0.5f
-    };
-
-    unsigned int lightCubeVAO, lightCubeVBO;
-    glGenVertexArrays(1, &lightCubeVAO);
-    glGenBuffers(1, &lightCubeVBO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, lightCubeVBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(lightCubeVertices), lightCubeVertices, GL_STATIC_DRAW);
-
-    glBindVertexArray(lightCubeVAO);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
+    // the sculpture's passes: its mesh in a ring keeping the last ECHO_SLOTS shapes, the GPU
+    // generators and surfaces the context supports, the lamps and the cables. Every view of the
+    // window is drawn through it; the best generation path is the default
+    SculptureRenderer sculptureRenderer;
+    sculptureRenderer.createPasses(64, 64, ECHO_SLOTS, true);
+    for (int path = 0; path < SculptureRenderer::GENERATIONS; path++)
+    {
+        state.generationPathAvailable[path] = sculptureRenderer.generationAvailable(path);
+        if (state.generationPathAvailable[path])
+            state.generationPath = state.reportedGenerationPath = path;
+    }
+    state.tessellationAvailable = sculptureRenderer.surfaceAvailable(SculptureRenderer::SURFACE_TESSELLATED);
+    state.rayMarchAvailable = sculptureRenderer.surfaceAvailable(SculptureRenderer::SURFACE_RAY_MARCHED);
 
-    // positions of the point lights
+    // rest positions of the point lights; the show lifts and pulses them into installation's lights
     glm::vec3 pointLightPositions[] = {
         glm::vec3(0.7f,  0.2f,  2.0f),
         glm::vec3(2.3f, -3.3f, -4.0f),
@@ -227,18 +332,139 @@ int main()
         glm::vec3(0.0f,  0.0f, -3.0f)
     };
     // ====================================================================
+    // 4. KINETIC ARRAY SETUP
+    // ====================================================================
+    Shader arrayShader("6.kinetic_array.vs", "6.multiple_lights.fs");
+
+    PhaseWaveArray kineticArray(KINETIC_ARRAY_WIDTH, KINETIC_ARRAY_DEPTH, 0.35f);
+    // a slow swell along x crossed by a faster ripple from the centre
+    kineticArray.addPlanarWave(PhaseWaveArray::HEIGHT, 0.4f, 0.6f, 0.2f, 1.5f);
+    kineticArray.addRadialWave(PhaseWaveArray::HEIGHT, 0.25f, 1.2f, 3.0f);
+    kineticArray.addPlanarWave(PhaseWaveArray::ROTATION, 1.5f, 0.15f, 0.35f, 0.7f);
+    // same 0.2 .. 2.0 exponent range as the central sculpture, travelling in crossed directions
+    kineticArray.setChannelRange(PhaseWaveArray::MORPH_N1, 1.1f, 0.2f, 2.0f);
+    kineticArray.addPlanarWave(PhaseWaveArray::MORPH_N1, 0.9f, 0.3f, 0.0f, 1.2f);
+    kineticArray.setChannelRange(PhaseWaveArray::MORPH_N2, 1.1f, 0.2f, 2.0f);
+    kineticArray.addPlanarWave(PhaseWaveArray::MORPH_N2, 0.9f, 0.0f, 0.3f, 0.8f, 1.0f);
+
+    InstancedSuperellipsoids arrayInstances;
+    arrayInstances.create(16, 16);
+    std::vector<float> arrayBasePositions(kineticArray.size() * 3);
+    for (size_t i = 0; i < kineticArray.size(); i++)
+    {
+        arrayBasePositions[i * 3 + 0] = kineticArray.elementX(i);
+        arrayBasePositions[i * 3 + 1] = 0.0f;
+        arrayBasePositions[i * 3 + 2] = kineticArray.elementZ(i);
+    }
+    arrayInstances.setBasePositions(arrayBasePositions.data(), kineticArray.size());
+    const glm::vec3 arrayOrigin(0.0f, -3.0f, 0.0f);
+
+    // elements near the camera morph into spiky stars; they only bob vertically, so proximity is
+    // measured in the array's floor plane against their rest positions
+    ProximityMorph arrayProximity;
+    arrayProximity.radius = 1.5f;
+    std::vector<glm::vec3> arrayRestPositions(kineticArray.size());
+    for (size_t i = 0; i < kineticArray.size(); i++)
+        arrayRestPositions[i] = glm::vec3(kineticArray.elementX(i), 0.0f, kineticArray.elementZ(i));
+    arrayProximity.setPositions(arrayRestPositions.data(), arrayRestPositions.size());
+
+    // procedurally spawned fields share the array shader; low-poly, as there can be millions
+    InstancedSuperellipsoids patternInstances;
+    patternInstances.create(8, 8);
+    std::vector<glm::vec3> patternPositions;
+    // the loaded scene stays mapped: an upload of its pattern instances may still be reading it
+    SceneFile sceneFile;
+
+    Shader particleShader("6.particles.vs", "6.particles.fs");
+    SurfaceParticles surfaceParticles;
+    bool gpuParticles = surfaceParticles.create(PARTICLE_COUNT, "6.particles_update.vs");
+
+    float lastEchoTime = 0.0f;
+
+    // stereo variants of the lit, array and lamp passes, with the same uniforms as the mono ones;
+    // the renderer builds its own
+    StereoTarget stereoTarget;
+    Shader stereoArrayShader = arrayShader;
+    bool stereoAvailable = false;
+    if (stereoTarget.detect() != StereoTarget::UNAVAILABLE)
+    {
+        stereoArrayShader.ID = stereoTarget.buildProgram("6.kinetic_array.vs", "6.multiple_lights.fs");
+        stereoAvailable = sculptureRenderer.createStereo(stereoTarget) && stereoArrayShader.ID;
+    }
+
+    // sequences the render passes and owns their transient targets
+    FrameGraph frameGraph;
+
+    // choreography formulas see each element's grid position as x and z, and the time as t
+    ExpressionProgram choreography;
+    std::vector<float> arrayX(kineticArray.size()), arrayZ(kineticArray.size());
+    for (size_t i = 0; i < kineticArray.size(); i++)
+    {
+        arrayX[i] = kineticArray.elementX(i);
+        arrayZ[i] = kineticArray.elementZ(i);
+    }
+    const char* const choreographyChannels[PhaseWaveArray::CHANNEL_COUNT] = { "height", "rotation", "n1", "n2" };
+    // ====================================================================
 
     // load textures
-    unsigned int diffuseMap = loadTexture(FileSystem::getPath("resources/textures/Solid_yellow.png").c_str());
+    // decoded and uploaded on the upload thread; waited for just before its first use
+    UploadThread::Ticket diffuseMapTicket = 0;
+    unsigned int diffuseMap = loadTextureAsync(FileSystem::getPath("resources/textures/Solid_yellow.png").c_str(), uploadThread, diffuseMapTicket);
     //unsigned int specularMap = loadTexture(FileSystem::getPath("resources/textures/wood.png").c_str());
 
-    // shader configuration
-    lightingShader.use();
-    lightingShader.setInt("material.diffuse", 0);
-    lightingShader.setInt("material.specular", 1);
-
     printf("Press E to summon superellipsoid \n");
+    printf("Press K to toggle the kinetic array \n");
+    printf("Press 1-4 to spawn a grid, spiral, Poisson disk or curve pattern, 0 to clear them \n");
+    if (state.oscListener.start(OSC_PORT))
+        printf("Listening for OSC show control on 127.0.0.1:%d \n", OSC_PORT);
+    else
+        printf("OSC show control unavailable: port %d is taken \n", OSC_PORT);
+    printf("Press R to reload the kinetic array choreography (%s) \n", CHOREOGRAPHY_PATH);
+    printf("Press T to toggle echo trails \n");
+    printf("Press P to cycle surface particles: off, CPU, GPU%s \n", gpuParticles ? "" : " (unavailable)");
+    printf("Press V to cycle 1, 2 or 4 views \n");
+    printf("Press G to cycle superellipsoid generation: CPU, GPU transform feedback%s, GPU compute shader%s \n",
+        state.generationPathAvailable[SculptureRenderer::GENERATE_FEEDBACK] ? "" : " (unavailable)",
+        state.generationPathAvailable[SculptureRenderer::GENERATE_COMPUTE] ? "" : " (needs GL 4.3)");
+    if (state.tessellationAvailable)
+        printf("Press L to toggle GPU-tessellated adaptive detail \n");
+    else
+        printf("Tessellated detail unavailable: needs GL 4.0 \n");
+    if (state.rayMarchAvailable)
+        printf("Press I to toggle ray-marched implicit surfaces, B to benchmark their fill cost \n");
+    printf("Press F5 to save the scene to %s, F6 to export it as JSON to %s, F9 to load it \n", SCENE_PATH, SCENE_JSON_PATH);
+    printf("Run with --batch <sculptures> [frames] [backend] [objects] to render independent sculptures headless on parallel threads \n");
+    printf("Run with --check-frame-graph to check culling and aliasing on a deferred-style frame \n");
+    printf("Run with --verify-generation to compare the GPU superellipsoid generators with the CPU one \n");
+    printf("Run with --check-vulkan to compare the Vulkan renderer's image with the GL one \n");
+    if (stereoAvailable)
+        printf("Press O to toggle side-by-side stereo (%s) \n",
+            stereoTarget.path() == StereoTarget::MULTIVIEW ? "multiview" : "instanced, layered");
+    else
+        printf("Stereo unavailable: needs GL_OVR_multiview or a vertex shader layer extension \n");
+    state.soundtrackLoaded = state.soundtrack.load(SOUNDTRACK_PATH);
+    if (state.soundtrackLoaded)
+        printf("Press M to toggle audio-reactive morphing (%s, %.1f s) \n", SOUNDTRACK_PATH, state.soundtrack.duration());
+    else
+        printf("Audio-reactive morphing unavailable: %s \n", state.soundtrack.error().c_str());
+
+    // keyframed show: sculpture breathing, light pulses and lifts, reactive shape of the array
+    AnimationCurves showCurves = buildShowCurves();
+    const int sculptureScale = showCurves.channelIndex("sculpture.scale");
+    const int reactiveN1 = showCurves.channelIndex("array.reactiveN1");
+    const int reactiveN2 = showCurves.channelIndex("array.reactiveN2");
+    int lightIntensity[4], lightLift[4];
+    for (int i = 0; i < 4; i++)
+    {
+        lightIntensity[i] = showCurves.channelIndex("light" + std::to_string(i) + ".intensity");
+        lightLift[i] = showCurves.channelIndex("light" + std::to_string(i) + ".lift");
+    }
+    // the lights as the show moves them this frame, lit from the scene
+    glm::vec3* animatedLightPositions = installation.lightPositions;
+    float* animatedLightIntensities = installation.lightIntensities;
 
+    // timing
+    float lastFrame = 0.0f;
 
     // render loop
     // -----------
@@ -246,126 +472,598 @@ int main()
     {
         // per-frame time logic
         float currentFrame = static_cast<float>(glfwGetTime());
-        deltaTime = currentFrame - lastFrame;
+        float deltaTime = currentFrame - lastFrame;
         lastFrame = currentFrame;
 
         // input
-        processInput(window);
+        processInput(window, state, deltaTime);
+
+        // apply everything show control sent since the last frame
+        OscMessage controlMessage;
+        while (state.oscListener.poll(controlMessage))
+            applyControl(controlMessage, state);
+        reportControlLatency(state, currentFrame);
 
         // render
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         // ====================================================================
         // 3. MORPHING LOGIC AND BUFFER UPDATE
         // ====================================================================
 
-        // Calculate morph parameters for superellipsoid
+        // Calculate morph parameters for superellipsoid from its drive train
         float t = glfwGetTime();
-        float n1 = 0.2f + 1.8f * (std::sin(t * 1.2f) * 0.5f + 0.5f); // 0.2 to 2.0
-        float n2 = 0.2f + 1.8f * (std::cos(t * 0.8f) * 0.5f + 0.5f); // 0.2 to 2.0
+        simulation.drive(installation, t);
+        float n1 = installation.n1; // 0.2 to 2.0
+        float n2 = installation.n2; // 0.2 to 2.0
+        float bass = 0.0f, mid = 0.0f, high = 0.0f, loudness = 0.0f;
+        if (state.audioReactive != state.soundtrack.playing())
+        {
+            if (state.audioReactive)
+                state.soundtrack.start(t);
+            else
+                state.soundtrack.stop();
+        }
+        if (state.audioReactive)
+        {
+            AudioAnalysis::Frame frame = state.soundtrack.sample(t);
+            soundtrackDrive(frame, bass, mid, high);
+            loudness = frame.level;
+            // kicks round the shape off, mids pinch it towards a star
+            n1 = 2.0f - 1.8f * bass;
+            n2 = 2.0f - 1.8f * mid;
+        }
+        if (state.showControl.n1Set)
+            n1 = state.showControl.n1;
+        if (state.showControl.n2Set)
+            n2 = state.showControl.n2;
 
-        // Regenerate and update geometry buffers (Note: All superellipsoids use this shape)
-        generateSuperellipsoid(superellipsoidVertices, superellipsoidIndices, 1.0f, 1.0f, 1.0f, n1, n2);
+        showCurves.evaluate(t, state.threadPool);
+        for (int i = 0; i < 4; i++)
+        {
+            animatedLightPositions[i] = pointLightPositions[i] + glm::vec3(0.0f, showCurves.value(lightLift[i]), 0.0f);
+            // loaded curves may go anywhere; Hermite keys can also overshoot
+            animatedLightIntensities[i] = std::max(showCurves.value(lightIntensity[i]), 0.0f);
+            if (state.audioReactive)
+            {
+                // two lights follow the lows, two the highs
+                float band = i < 2 ? bass : high;
+                animatedLightIntensities[i] = 0.15f + 1.1f * band * band;
+            }
+            if (state.showControl.positionSet[i])
+                animatedLightPositions[i] = state.showControl.position[i];
+            if (state.showControl.intensitySet[i])
+                animatedLightIntensities[i] = state.showControl.intensity[i];
+        }
 
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, superellipsoidVertices.size() * sizeof(Vertex), superellipsoidVertices.data());
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0, superellipsoidIndices.size() * sizeof(unsigned int), superellipsoidIndices.data());
+        // Regenerate and update geometry buffers (Note: All superellipsoids use this shape).
+        // On the GPU the shape goes straight into the live ring slot; a CPU copy is only made while
+        // the particles need it as their emitter
+        installation.n1 = n1;
+        installation.n2 = n2;
+        if (state.generationPath != state.reportedGenerationPath)
+        {
+            std::cout << "Superellipsoid generation: " << GENERATION_PATH_NAMES[state.generationPath] << " ("
+                      << GENERATION_PATH_NAMES[state.reportedGenerationPath] << " averaged " << state.generationSum / std::max(state.generationCount, 1)
+                      << " ms per frame on the render thread)" << std::endl;
+            state.reportedGenerationPath = state.generationPath;
+            state.generationSum = 0.0;
+            state.generationCount = 0;
+        }
+        double generationStart = glfwGetTime();
+        sculptureRenderer.generate(installation, state.generationPath, state.particleMode > 0);
+        state.generationSum += (glfwGetTime() - generationStart) * 1000.0;
+        state.generationCount++;
 
         // ====================================================================
 
-        // Lighting setup
-        lightingShader.use();
-        lightingShader.setVec3("viewPos", camera.Position);
-        lightingShader.setFloat("material.shininess", 32.0f);
-
-        // NEW: Set explicit material colors for a vibrant blue with bright blue reflections
-        lightingShader.setVec3("material.ambient", 0.05f, 0.1f, 0.3f);   // Darker blue base
-        lightingShader.setVec3("material.diffuse", 0.2f, 0.5f, 0.8f);    // Main body bright blue
-        lightingShader.setVec3("material.specular", 0.7f, 0.9f, 1.0f);  // Bright blue/cyan reflections (light reflexes)
-
-        // Set all light uniforms here...
-        // directional light
-        lightingShader.setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
-        lightingShader.setVec3("dirLight.ambient", 0.05f, 0.05f, 0.05f);
-        lightingShader.setVec3("dirLight.diffuse", 0.4f, 0.4f, 0.4f);
-        lightingShader.setVec3("dirLight.specular", 0.5f, 0.5f, 0.5f);
-        // point lights
-        for (unsigned int i = 0; i < 4; i++)
+        // cables, the hierarchy and contacts, with this frame's exponents and breathing
+        float scale = showCurves.value(sculptureScale);
+        if (state.audioReactive)
+            scale = 0.85f + 0.4f * loudness;
+        installation.sculptureScale = scale;
+        simulation.step(installation, t, deltaTime);
+        const SuperellipsoidCollision& collisionWorld = simulation.collisions();
+
+        // particles are born on this frame's surface, so the emitter follows the morph
+        if (state.particleModeChanged)
+        {
+            state.particleModeChanged = false;
+            if (state.particleMode == 1 + SurfaceParticles::GPU && !surfaceParticles.gpuAvailable())
+                state.particleMode = 0;
+            if (state.particleMode > 0)
+                surfaceParticles.setBackend((SurfaceParticles::Backend)(state.particleMode - 1));
+            else
+                surfaceParticles.release();
+            state.particleUpdateSum = 0.0;
+            state.particleUpdateCount = 0;
+        }
+        if (state.particleMode > 0)
+        {
+            const std::vector<Vertex>& emitterVertices = sculptureRenderer.meshVertices();
+            const std::vector<unsigned int>& emitterIndices = sculptureRenderer.meshIndices();
+            surfaceParticles.setEmitter(&emitterVertices[0].Position.x, &emitterVertices[0].Normal.x,
+                sizeof(Vertex) / sizeof(float), emitterIndices.data(), emitterIndices.size());
+            surfaceParticles.update(deltaTime, installation.bodyMatrix(0), state.threadPool);
+            reportParticleTimings(state, currentFrame, surfaceParticles);
+        }
+
+        // the picking hierarchy follows the collision boxes: rebuilt when objects are added, refitted as they swing
+        const glm::vec3* pickLower = collisionWorld.lowerCorners().data() + 1;
+        const glm::vec3* pickUpper = collisionWorld.upperCorners().data() + 1;
+        if (state.pickingTree.size() != installation.spawnedCount())
+            state.pickingTree.build(pickLower, pickUpper, installation.spawnedCount(), state.threadPool);
+        else
+            state.pickingTree.refit(pickLower, pickUpper);
+
+        // views of this frame: their rectangles split the framebuffer, view 0 follows the visitor
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        state.viewFrameSum += deltaTime;
+        state.viewFrameCount++;
+        if (state.viewCount != state.reportedViewCount)
         {
-            std::string name = "pointLights[" + std::to_string(i) + "]";
-            lightingShader.setVec3(name + ".position", pointLightPositions[i]);
-            lightingShader.setVec3(name + ".ambient", 0.05f, 0.05f, 0.05f);
-            lightingShader.setVec3(name + ".diffuse", 0.8f, 0.8f, 0.8f);
-            lightingShader.setVec3(name + ".specular", 1.0f, 1.0f, 1.0f);
-            lightingShader.setFloat(name + ".constant", 1.0f);
-            lightingShader.setFloat(name + ".linear", 0.09f);
-            lightingShader.setFloat(name + ".quadratic", 0.032f);
+            std::cout << "Views: " << state.viewCount << " (" << state.reportedViewCount << " view(s) averaged "
+                      << state.viewFrameSum / state.viewFrameCount * 1000.0f << " ms per frame)" << std::endl;
+            state.reportedViewCount = state.viewCount;
+            state.viewFrameSum = 0.0f;
+            state.viewFrameCount = 0;
+        }
+
+        // view/projection transformations of the visitor's view, for picking; in stereo each eye
+        // gets half the width
+        bool stereoFrame = state.stereo && stereoAvailable;
+        glm::vec4 mainRect = stereoFrame ? glm::vec4(0.0f, 0.0f, 0.5f, 1.0f) : viewRect(0, state.viewCount);
+        glm::mat4 visitorProjection = glm::perspective(glm::radians(camera.Zoom),
+            (mainRect.z * framebufferWidth) / std::max(mainRect.w * framebufferHeight, 1.0f), 0.1f, 100.0f);
+        glm::mat4 visitorView = camera.GetViewMatrix();
+
+        if (uploadThread.running() && patternInstances.finishUpload(uploadThread))
+            std::cout << "Pattern upload finished: " << patternInstances.count() << " instances, "
+                      << uploadThread.lastJobMilliseconds() << " ms on the upload thread" << std::endl;
+        // a new pattern waits for the previous upload, which still reads patternPositions
+        if (state.patternRequest >= 0 && !patternInstances.uploadPending())
+        {
+            if (state.patternRequest == 0)
+            {
+                patternPositions.clear();
+                patternInstances.setBasePositions(nullptr, 0);
+            }
+            else
+            {
+                // generate in parallel, then one upload of just the new positions
+                double start = glfwGetTime();
+                size_t first = patternPositions.size();
+                size_t added = generatePattern(state.patternRequest, camera, patternPositions, state.threadPool);
+                double generated = glfwGetTime();
+                if (added > 0 && uploadThread.running())
+                    patternInstances.appendBasePositions(glm::value_ptr(patternPositions[first]), added, uploadThread);
+                else if (added > 0)
+                    patternInstances.appendBasePositions(glm::value_ptr(patternPositions[first]), added);
+                std::cout << "Spawned " << added << " pattern instances (" << patternPositions.size() << " total): generated in "
+                          << (generated - start) * 1000.0 << " ms, render thread spent " << (glfwGetTime() - generated) * 1000.0
+                          << " ms on the upload" << std::endl;
+            }
+            state.patternRequest = -1;
+        }
+
+        // scenes: the layout written as it is now, or replaced by the saved one. A load waits for a
+        // pattern upload, which may still read the previous scene's mapping
+        if (state.sceneSaveRequested || state.sceneExportRequested)
+        {
+            SceneFile::Contents scene;
+            scene.camera = { { camera.Position.x, camera.Position.y, camera.Position.z }, camera.Yaw, camera.Pitch, camera.Zoom };
+            scene.shape = { n1, n2, (state.showControl.n1Set ? 1u : 0u) | (state.showControl.n2Set ? 2u : 0u) };
+            for (int i = 0; i < 4; i++)
+            {
+                glm::vec3 position = state.showControl.positionSet[i] ? state.showControl.position[i] : pointLightPositions[i];
+                scene.lights.push_back({ { position.x, position.y, position.z }, animatedLightIntensities[i],
+                    (state.showControl.positionSet[i] ? 1u : 0u) | (state.showControl.intensitySet[i] ? 2u : 0u) });
+            }
+            // spawned objects are kept where they were hung, below their anchors
+            std::vector<glm::vec3> hangPositions;
+            for (const glm::vec3& anchor : installation.spawnedAnchors)
+                hangPositions.push_back(anchor - glm::vec3(0.0f, SculptureScene::CABLE_LENGTH + 0.5f, 0.0f));
+            scene.spawned = hangPositions.empty() ? nullptr : glm::value_ptr(hangPositions[0]);
+            scene.spawnedCount = hangPositions.size();
+            scene.instances = patternPositions.empty() ? nullptr : glm::value_ptr(patternPositions[0]);
+            scene.instanceCount = patternPositions.size();
+            for (size_t c = 0; c < showCurves.channelCount(); c++)
+                scene.channels.push_back({ showCurves.channelName((int)c), showCurves.channelLoops((int)c), showCurves.keys((int)c) });
+            if (state.sceneSaveRequested)
+            {
+                double start = glfwGetTime();
+                if (SceneFile::save(SCENE_PATH, scene))
+                    std::cout << "Scene saved to " << SCENE_PATH << ": " << scene.spawnedCount << " spawned, " << scene.instanceCount
+                              << " instances, " << scene.channels.size() << " channels in " << (glfwGetTime() - start) * 1000.0 << " ms" << std::endl;
+                else
+                    std::cout << "Scene not saved: cannot write " << SCENE_PATH << std::endl;
+            }
+            if (state.sceneExportRequested)
+            {
+                double start = glfwGetTime();
+                if (SceneFile::exportJson(SCENE_JSON_PATH, scene))
+                    std::cout << "Scene exported to " << SCENE_JSON_PATH << " in " << (glfwGetTime() - start) * 1000.0 << " ms" << std::endl;
+                else
+                    std::cout << "Scene not exported: cannot write " << SCENE_JSON_PATH << std::endl;
+            }
+            state.sceneSaveRequested = state.sceneExportRequested = false;
+        }
+        if (state.sceneLoadRequested && !patternInstances.uploadPending())
+        {
+            state.sceneLoadRequested = false;
+            double start = glfwGetTime();
+            // a JSON copy exported or edited since the last save becomes the scene, so the next
+            // load maps it again
+            bool edited = SceneFile::isNewer(SCENE_JSON_PATH, SCENE_PATH);
+            std::string error;
+            if (edited)
+            {
+                SceneFile::Contents imported;
+                if (!SceneFile::importJson(SCENE_JSON_PATH, imported, error))
+                    error = std::string(SCENE_JSON_PATH) + ": " + error;
+                else if (!SceneFile::save(SCENE_PATH, imported))
+                    error = std::string("cannot write ") + SCENE_PATH;
+            }
+            double imported = glfwGetTime();
+            if (error.empty() && !sceneFile.open(SCENE_PATH))
+                error = std::string(SCENE_PATH) + ": " + sceneFile.error();
+            double mapped = glfwGetTime();
+            if (!error.empty())
+                std::cout << "Scene not loaded: " << error << std::endl;
+            else
+            {
+                const SceneFile::Contents& scene = sceneFile.contents();
+                camera.Position = glm::vec3(scene.camera.position[0], scene.camera.position[1], scene.camera.position[2]);
+                camera.Yaw = scene.camera.yaw;
+                camera.Pitch = scene.camera.pitch;
+                camera.Zoom = scene.camera.zoom;
+                camera.ProcessMouseMovement(0.0f, 0.0f); // recomputes the camera's axes
+                // the file may have been edited by hand: SceneFile has rejected NaN and infinities,
+                // and these are the same limits as show control, as an exponent of 0 turns the
+                // surfaces' 2 / n into infinities
+                state.showControl.n1Set = (scene.shape.held & 1) != 0;
+                state.showControl.n2Set = (scene.shape.held & 2) != 0;
+                state.showControl.n1 = glm::clamp(scene.shape.n1, 0.05f, 4.0f);
+                state.showControl.n2 = glm::clamp(scene.shape.n2, 0.05f, 4.0f);
+                for (size_t i = 0; i < scene.lights.size() && i < 4; i++)
+                {
+                    const SceneFile::Light& light = scene.lights[i];
+                    glm::vec3 position(light.position[0], light.position[1], light.position[2]);
+                    state.showControl.positionSet[i] = (light.held & 1) != 0;
+                    state.showControl.intensitySet[i] = (light.held & 2) != 0;
+                    if (state.showControl.positionSet[i])
+                        state.showControl.position[i] = position;
+                    else
+                        pointLightPositions[i] = position;
+                    state.showControl.intensity[i] = std::max(light.intensity, 0.0f);
+                }
+                for (const SceneFile::Channel& channel : scene.channels)
+                {
+                    int c = showCurves.channelIndex(channel.name);
+                    if (c < 0)
+                        c = showCurves.addChannel(channel.name, channel.loop);
+                    showCurves.setKeys(c, channel.keys.data(), channel.keys.size(), channel.loop);
+                }
+
+                // the spawned objects are hung again from new cables
+                installation.clearSpawned();
+                installation.reserveSpawned(scene.spawnedCount + CONTROL_SPAWN_SLOTS);
+                state.selectedObject = -1;
+                for (size_t i = 0; i < scene.spawnedCount; i++)
+                    installation.spawn(glm::make_vec3(scene.spawned + i * 3), glm::vec3(0.0f));
+
+                // the pattern instances go to the GPU from the mapped pages; the CPU copy is what
+                // later patterns are appended to
+                double applied = glfwGetTime();
+                const glm::vec3* instances = (const glm::vec3*)scene.instances;
+                patternPositions.assign(instances, instances + scene.instanceCount);
+                double copied = glfwGetTime();
+                if (scene.instanceCount > 0 && uploadThread.running())
+                {
+                    patternInstances.setBasePositions(nullptr, 0);
+                    patternInstances.appendBasePositions(scene.instances, scene.instanceCount, uploadThread);
+                }
+                else
+                    patternInstances.setBasePositions(scene.instances, scene.instanceCount);
+                std::cout << "Scene loaded from " << (edited ? SCENE_JSON_PATH : SCENE_PATH) << ": " << scene.spawnedCount << " spawned, "
+                          << scene.instanceCount << " instances, " << scene.channels.size() << " channels in "
+                          << (glfwGetTime() - start) * 1000.0 << " ms (";
+                if (edited)
+                    std::cout << "JSON import " << (imported - start) * 1000.0 << " ms, ";
+                std::cout << "mapping " << sceneFile.fileBytes() / 1024 << " KB " << (mapped - imported) * 1000.0 << " ms, CPU copy of the instances "
+                          << (copied - applied) * 1000.0 << " ms, upload " << (glfwGetTime() - copied) * 1000.0 << " ms)" << std::endl;
+            }
+        }
+
+        if (state.pickRequested)
+        {
+            state.pickRequested = false;
+            glm::vec3 direction = pickingRayDirection(window, camera, visitorProjection, visitorView, mainRect);
+            float distance = 100.0f;
+            state.selectedObject = state.pickingTree.raycast(camera.Position, direction, distance, [&](size_t i, float) {
+                return collisionWorld.intersectRay(i + 1, camera.Position, direction);
+            });
+            if (state.selectedObject != BoundingVolumeHierarchy::NO_HIT)
+                std::cout << "Selected superellipsoid " << state.selectedObject << " at distance " << distance << std::endl;
         }
-        // spotLight
-        lightingShader.setVec3("spotLight.position", camera.Position);
-        lightingShader.setVec3("spotLight.direction", camera.Front);
-        lightingShader.setVec3("spotLight.ambient", 0.0f, 0.0f, 0.0f);
-        lightingShader.setVec3("spotLight.diffuse", 1.0f, 1.0f, 1.0f);
-        lightingShader.setVec3("spotLight.specular", 1.0f, 1.0f, 1.0f);
-        lightingShader.setFloat("spotLight.constant", 1.0f);
-        lightingShader.setFloat("spotLight.linear", 0.09f);
-        lightingShader.setFloat("spotLight.quadratic", 0.032f);
-        lightingShader.setFloat("spotLight.cutOff", glm::cos(glm::radians(12.5f)));
-        lightingShader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(15.0f)));
-
-
-        // view/projection transformations
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        glm::mat4 view = camera.GetViewMatrix();
-        lightingShader.setMat4("projection", projection);
-        lightingShader.setMat4("view", view);
 
         // bind textures
+        if (diffuseMapTicket)
+        {
+            uploadThread.wait(diffuseMapTicket);
+            diffuseMapTicket = 0;
+        }
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, diffuseMap);
         glActiveTexture(GL_TEXTURE1);
         //glBindTexture(GL_TEXTURE_2D, specularMap);
 
-        // --- RENDER ALL SUPER ELLIPSOIDS ---
-        glBindVertexArray(superellipsoidVAO);
-
-        // 1. RENDER THE MORPHING SUPER ELLIPSOID (at world origin)
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::rotate(model, t * 0.5f, glm::vec3(0.0f, 1.0f, 0.0f));
-        lightingShader.setMat4("model", model);
-        glDrawElements(GL_TRIANGLES, superellipsoidIndices.size(), GL_UNSIGNED_INT, 0);
+        // ====================================================================
+        // per-frame work shared by every view: instance data, lights, cables
+        // ====================================================================
 
-        // 2. RENDER ALL SPAWNED SUPER ELLIPSOIDS (using the same *morphing* shape)
-        for (const auto& position : spawnedSuperellipsoids)
+        // RENDER THE KINETIC ARRAY (one instanced draw, waves evaluated straight into the instance buffer)
+        if (state.reloadChoreography)
+        {
+            choreography = loadChoreography(CHOREOGRAPHY_PATH);
+            state.reloadChoreography = false;
+        }
+        if (state.showKineticArray)
         {
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, position);
-            // Add a small rotation and scale to the spawned objects
-            model = glm::rotate(model, (float)glfwGetTime() * 0.2f, glm::vec3(0.0f, 1.0f, 0.0f));
-            model = glm::scale(model, glm::vec3(0.5f)); // Make the spawned objects smaller
-            lightingShader.setMat4("model", model);
-            glDrawElements(GL_TRIANGLES, superellipsoidIndices.size(), GL_UNSIGNED_INT, 0);
+            float* channels = arrayInstances.mapChannels();
+            if (channels)
+            {
+                float* const channelOut[PhaseWaveArray::CHANNEL_COUNT] = {
+                    channels,
+                    channels + kineticArray.size(),
+                    channels + kineticArray.size() * 2,
+                    channels + kineticArray.size() * 3
+                };
+                // outputs named after a channel replace its waves, so the waves skip that channel;
+                // other outputs are just locals
+                float* waveOut[PhaseWaveArray::CHANNEL_COUNT];
+                std::vector<float*> outputs(choreography.outputNames().size(), nullptr);
+                for (int ch = 0; ch < PhaseWaveArray::CHANNEL_COUNT; ch++)
+                {
+                    int output = choreography.outputIndex(choreographyChannels[ch]);
+                    if (output >= 0)
+                        outputs[output] = channelOut[ch];
+                    waveOut[ch] = output >= 0 ? nullptr : channelOut[ch];
+                }
+                kineticArray.evaluate(t, state.threadPool, waveOut);
+                if (!outputs.empty())
+                {
+                    choreography.bindArray(choreography.inputIndex("x"), arrayX.data());
+                    choreography.bindArray(choreography.inputIndex("z"), arrayZ.data());
+                    choreography.setValue(choreography.inputIndex("t"), t);
+                    choreography.setValue(choreography.inputIndex("bass"), bass);
+                    choreography.setValue(choreography.inputIndex("mid"), mid);
+                    choreography.setValue(choreography.inputIndex("high"), high);
+                    choreography.setValue(choreography.inputIndex("level"), loudness);
+                    choreography.evaluate(kineticArray.size(), state.threadPool, outputs.data());
+                }
+                arrayInstances.unmapChannels();
+            }
+
+            // ease the elements around the camera and upload only the intensities that changed
+            glm::vec3 visitor = camera.Position - arrayOrigin;
+            visitor.y = 0.0f;
+            for (const ProximityMorph::Run& run : arrayProximity.update(visitor, deltaTime))
+                arrayInstances.writeIntensities(run.first, arrayProximity.intensities() + run.first, run.count);
         }
 
+        // the sculpture's echo transform, lamps and cables
+        sculptureRenderer.record(installation, state.threadPool);
+
+        // ====================================================================
+        // passes: every pass that could reach the screen is declared and the frame graph runs
+        // the ones that do
         // ====================================================================
+        // a view is drawn by the sculpture's renderer, culled by the collision boxes, with the
+        // kinetic array and the patterns after the shapes, and the particles over everything. A
+        // stereo pass (with eyeViewProjection) is submitted once for both eyes and leaves out
+        // cables, the selection, echoes and particles
+        SculptureRenderer::ViewOptions viewOptions;
+        viewOptions.surface = state.rayMarchedSurfaces ? SculptureRenderer::SURFACE_RAY_MARCHED
+            : state.tessellatedDetail ? SculptureRenderer::SURFACE_TESSELLATED : SculptureRenderer::SURFACE_MESH;
+        viewOptions.culling = &collisionWorld;
+        viewOptions.selected = state.selectedObject;
+        viewOptions.echoes = state.showEchoes;
+        viewOptions.fields = [&](const SculptureRenderer::View& view) {
+            bool stereoPass = view.eyeViewProjection != nullptr;
+            Shader& instancedShader = stereoPass ? stereoArrayShader : arrayShader;
+            GLuint repeat = stereoPass ? stereoTarget.instanceRepeat() : 1;
+
+            // 3. THE KINETIC ARRAY
+            if (state.showKineticArray)
+            {
+                instancedShader.use();
+                instancedShader.setMat4("projection", view.projection);
+                instancedShader.setMat4("view", view.view);
+                instancedShader.setVec3("viewPos", view.camera->Position);
+                if (stereoPass)
+                    StereoTarget::setEyeUniforms(instancedShader.ID, view.eyeViewProjection);
+                instancedShader.setMat4("arrayModel", glm::translate(glm::mat4(1.0f), arrayOrigin));
+                instancedShader.setFloat("elementScale", 0.12f);
+                instancedShader.setVec2("reactiveExponents", glm::clamp(glm::vec2(showCurves.value(reactiveN1), showCurves.value(reactiveN2)), 0.05f, 4.0f));
+                arrayInstances.draw(repeat);
+            }
+
+            // 4. RENDER THE SPAWNED PATTERNS (one instanced draw for all of them)
+            if (patternInstances.count() > 0)
+            {
+                instancedShader.use();
+                instancedShader.setMat4("projection", view.projection);
+                instancedShader.setMat4("view", view.view);
+                instancedShader.setVec3("viewPos", view.camera->Position);
+                if (stereoPass)
+                    StereoTarget::setEyeUniforms(instancedShader.ID, view.eyeViewProjection);
+                instancedShader.setMat4("arrayModel", glm::mat4(1.0f));
+                instancedShader.setFloat("elementScale", 0.04f);
+                instancedShader.setVec2("reactiveExponents", glm::vec2(1.0f));
+                patternInstances.draw(repeat);
+            }
+        };
+        // surface particles last: additive sprites that test against the scene but do not write depth
+        if (state.particleMode > 0)
+            viewOptions.overlays = [&](const SculptureRenderer::View& view) {
+                particleShader.use();
+                particleShader.setMat4("projection", view.projection);
+                particleShader.setMat4("view", view.view);
+                particleShader.setFloat("lifetime", surfaceParticles.lifetime);
+                // 0.015 units across
+                particleShader.setFloat("pointScale", 0.015f * view.height / (2.0f * std::tan(glm::radians(view.camera->Zoom) * 0.5f)));
+                particleShader.setFloat("brightness", 0.06f);
+                glEnable(GL_PROGRAM_POINT_SIZE);
+                glEnable(GL_BLEND);
+                glBlendFunc(GL_ONE, GL_ONE);
+                glDepthMask(GL_FALSE);
+                surfaceParticles.draw();
+                glDepthMask(GL_TRUE);
+                glDisable(GL_BLEND);
+                glDisable(GL_PROGRAM_POINT_SIZE);
+            };
+
+        frameGraph.reset();
+        FrameGraph::Resource screen = frameGraph.import("screen");
+
+        // the installation views, each in its rectangle of the default framebuffer
+        FrameGraph::PassBuilder views = frameGraph.addPass("views", [&] {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            // lighting setup; the spot light stays on the visitor in every view
+            sculptureRenderer.setLighting(installation, viewOptions.surface);
+            arrayShader.use();
+            SculptureRenderer::setLightingUniforms(arrayShader, camera, animatedLightPositions, animatedLightIntensities);
+            for (int v = 0; v < state.viewCount; v++)
+            {
+                Camera& viewCamera = v == 0 ? camera : state.installationCameras[v - 1];
+                glm::vec4 rect = viewRect(v, state.viewCount);
+                int viewWidth = std::max((int)(rect.z * framebufferWidth), 1);
+                int viewHeight = std::max((int)(rect.w * framebufferHeight), 1);
+                glViewport((int)(rect.x * framebufferWidth), (int)(rect.y * framebufferHeight), viewWidth, viewHeight);
+                glm::mat4 projection = v == 0 ? visitorProjection
+                    : glm::perspective(glm::radians(viewCamera.Zoom), (float)viewWidth / (float)viewHeight, 0.1f, 100.0f);
+                SculptureRenderer::View view = { &viewCamera, projection, v == 0 ? visitorView : viewCamera.GetViewMatrix(), viewHeight, nullptr };
+                sculptureRenderer.drawView(installation, view, state.threadPool, viewOptions);
+            }
+            glViewport(0, 0, framebufferWidth, framebufferHeight);
+        });
+        views.write(screen);
+
+        // B: the visitor's shapes drawn into offscreen targets of several sizes in each available
+        // surface, a few times between glFinish calls, and the time per frame printed
+        if (state.fillBenchmarkRequested)
+        {
+            state.fillBenchmarkRequested = false;
+            frameGraph.addPass("fill benchmark", [&] {
+                const int SIZES[][2] = { { 640, 360 }, { 1280, 720 }, { 1920, 1080 }, { 2560, 1440 } };
+                const int REPEATS = 5;
+                for (int surface = 0; surface < SculptureRenderer::SURFACES; surface++)
+                    if (sculptureRenderer.surfaceAvailable(surface))
+                        sculptureRenderer.setLighting(installation, surface);
+                unsigned int fbo, color, depth;
+                glGenFramebuffers(1, &fbo);
+                glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+                for (const int* size : SIZES)
+                {
+                    glGenTextures(1, &color);
+                    glBindTexture(GL_TEXTURE_2D, color);
+                    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size[0], size[1], 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+                    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color, 0);
+                    glGenRenderbuffers(1, &depth);
+                    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+                    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size[0], size[1]);
+                    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+                    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE)
+                    {
+                        glViewport(0, 0, size[0], size[1]);
+                        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)size[0] / (float)size[1], 0.1f, 100.0f);
+                        SculptureRenderer::View view = { &camera, projection, visitorView, size[1], nullptr };
+                        sculptureRenderer.recordShapes(installation, ViewFrustum(projection * visitorView), state.threadPool, &collisionWorld);
+                        std::cout << "Fill benchmark " << size[0] << "x" << size[1] << ", " << sculptureRenderer.drawnShapes() << " object(s):";
+                        for (int surface = 0; surface < SculptureRenderer::SURFACES; surface++)
+                        {
+                            if (!sculptureRenderer.surfaceAvailable(surface))
+                                continue;
+                            // once to warm up, then timed
+                            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                            sculptureRenderer.drawShapes(installation, view, surface);
+                            glFinish();
+                            double start = glfwGetTime();
+                            for (int i = 0; i < REPEATS; i++)
+                            {
+                                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                                sculptureRenderer.drawShapes(installation, view, surface);
+                            }
+                            glFinish();
+                            std::cout << " " << SHAPE_SURFACE_NAMES[surface] << " " << (glfwGetTime() - start) * 1000.0 / REPEATS << " ms";
+                        }
+                        std::cout << std::endl;
+                    }
+                    glDeleteTextures(1, &color);
+                    glDeleteRenderbuffers(1, &depth);
+                }
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                glDeleteFramebuffers(1, &fbo);
+                glViewport(0, 0, framebufferWidth, framebufferHeight);
+            }).sideEffect();
+        }
+
+        // stereo: both eyes into the layers of two transient array targets, then side by side on
+        // the screen. The eyes pass is declared whenever stereo can run and is culled unless the
+        // present pass reads its color; present replaces the whole screen, which culls the views
+        int eyeWidth = std::max(framebufferWidth / 2, 1), eyeHeight = std::max(framebufferHeight, 1);
+        FrameGraph::Resource eyeColor = FrameGraph::NONE, eyeDepth = FrameGraph::NONE;
+        if (stereoAvailable)
+        {
+            FrameGraph::PassBuilder eyes = frameGraph.addPass("stereo eyes", [&] {
+                if (!stereoTarget.attach(frameGraph.texture(eyeColor), frameGraph.texture(eyeDepth), eyeWidth, eyeHeight))
+                {
+                    stereoAvailable = false;
+                    return;
+                }
+                stereoTarget.bind();
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                sculptureRenderer.setLighting(installation, SculptureRenderer::SURFACE_MESH, true);
+                stereoArrayShader.use();
+                SculptureRenderer::setLightingUniforms(stereoArrayShader, camera, animatedLightPositions, animatedLightIntensities);
+                glm::mat4 eyeViewProjection[2];
+                StereoTarget::eyeViewProjections(visitorProjection, visitorView, EYE_SEPARATION, eyeViewProjection);
+                SculptureRenderer::View view = { &camera, visitorProjection, visitorView, eyeHeight, eyeViewProjection };
+                sculptureRenderer.drawView(installation, view, state.threadPool, viewOptions);
+            });
+            eyeColor = eyes.create("eye color", FrameGraph::TextureDesc{ GL_TEXTURE_2D_ARRAY, GL_RGBA8, eyeWidth, eyeHeight, 2 });
+            eyeDepth = eyes.create("eye depth", FrameGraph::TextureDesc{ GL_TEXTURE_2D_ARRAY, GL_DEPTH_COMPONENT24, eyeWidth, eyeHeight, 2 });
+        }
+        if (stereoFrame)
+        {
+            FrameGraph::PassBuilder present = frameGraph.addPass("stereo present", [&] {
+                stereoTarget.present(framebufferWidth, framebufferHeight);
+            });
+            present.read(eyeColor);
+            present.write(screen);
+        }
 
-        // also draw the lamp object(s)
-        lightCubeShader.use();
-        lightCubeShader.setMat4("projection", projection);
-        lightCubeShader.setMat4("view", view);
+        if (frameGraph.compile())
+            frameGraph.execute();
+        reportFrameGraph(frameGraph, state.reportedFrameGraph);
+        if (state.tessellatedDetail && currentFrame - state.tessellationLastReport >= 2.0f)
+        {
+            std::cout << "Tessellated detail: " << sculptureRenderer.tessellatedTriangles() << " triangles for "
+                      << sculptureRenderer.drawnShapes() << " object(s) in one view (the fixed mesh has "
+                      << sculptureRenderer.meshIndices().size() / 3 << " each)" << std::endl;
+            state.tessellationLastReport = currentFrame;
+        }
 
-        // we now draw as many light bulbs as we have point lights.
-        glBindVertexArray(lightCubeVAO);
-        for (unsigned int i = 0; i < 4; i++)
+        if (state.showEchoes && currentFrame - lastEchoTime >= ECHO_INTERVAL)
         {
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, pointLightPositions[i]);
-            model = glm::scale(model, glm::vec3(0.2f)); // Make it a smaller cube
-            lightCubeShader.setMat4("model", model);
-            glDrawArrays(GL_TRIANGLES, 0, 36); // The light cube has 36 vertices (12 triangles)
+            // this frame's shape becomes an echo; the next one is generated into the oldest slot
+            sculptureRenderer.keepEcho();
+            lastEchoTime = currentFrame;
         }
+        else if (!state.showEchoes)
+            sculptureRenderer.clearEchoes();
 
 
         // glfw: swap buffers and poll IO events
@@ -374,20 +1072,470 @@ int main()
     }
 
     // de-allocate all resources
-    glDeleteVertexArrays(1, &superellipsoidVAO);
-    glDeleteVertexArrays(1, &lightCubeVAO);
-    glDeleteBuffers(1, &VBO);
-    glDeleteBuffers(1, &EBO);
-    glDeleteBuffers(1, &lightCubeVBO);
+    sculptureRenderer.destroy();
+    stereoTarget.destroy();
+    frameGraph.destroy();
+    arrayInstances.destroy();
+    patternInstances.destroy();
+    surfaceParticles.destroy();
+    uploadThread.stop();
+
+    glfwTerminate();
+    return 0;
+}
+
+// headless batch: independent sculptures, each with its own scene, simulation, pool, renderer
+// and, for GL, hidden context, run for `frames` frames with the sculptures split over 1, 2, 4 ..
+// threads. Prints the throughput of every split and the time render() takes, which is what the
+// backends differ in, and writes each sculpture's last frame to batch_<i>.ppm
+// ---------------------------------------------------------------------------------------------
+int runBatch(int sculptures, int frames, const char* backend, int objects)
+{
+    struct Sculpture
+    {
+        GLFWwindow* context = nullptr;
+        std::unique_ptr<ThreadPool> pool;
+        SculptureScene scene;
+        std::unique_ptr<SculptureSimulation> simulation;
+        std::unique_ptr<SculptureBackend> renderer;
+        double renderSeconds = 0.0;
+    };
+    const float FRAME_TIME = 1.0f / 60.0f;
+
+    // contexts are created on this thread, which owns GLFW, and share nothing; the GL entry points
+    // are loaded once, as every context comes from the same driver
+    std::vector<std::unique_ptr<Sculpture>> batch;
+    std::unique_ptr<SculptureBackend> probe = createSculptureBackend(backend);
+    if (!probe)
+    {
+        std::cout << "No renderer backend \"" << backend << "\" in this build (available: " << SCULPTURE_BACKENDS << ")" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    bool glContexts = probe->needsGLContext();
+    unsigned int hardwareThreads = std::thread::hardware_concurrency();
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    for (int i = 0; i < sculptures; i++)
+    {
+        batch.emplace_back(new Sculpture());
+        Sculpture& sculpture = *batch.back();
+        if (glContexts)
+        {
+            sculpture.context = glfwCreateWindow(1, 1, "sculpture", NULL, NULL);
+            if (sculpture.context == NULL)
+            {
+                std::cout << "Failed to create a context for sculpture " << i << std::endl;
+                glfwTerminate();
+                return -1;
+            }
+            glfwMakeContextCurrent(sculpture.context);
+            if (i == 0 && !gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+            {
+                std::cout << "Failed to initialize GLAD" << std::endl;
+                return -1;
+            }
+        }
+        sculpture.renderer = createSculptureBackend(backend);
+        if (!sculpture.renderer->create(BATCH_WIDTH, BATCH_HEIGHT))
+        {
+            std::cout << "Failed to create the offscreen target of sculpture " << i << std::endl;
+            return -1;
+        }
+        // the hardware threads beyond one per sculpture record the instance batches
+        sculpture.pool.reset(new ThreadPool(std::max(1u, hardwareThreads / sculptures)));
+        sculpture.simulation.reset(new SculptureSimulation(*sculpture.pool));
+
+        // each sculpture starts elsewhere in its drive cycle, seen from another side
+        placeBatchSculpture(sculpture.scene, 2.0f * (float)M_PI * i / sculptures, objects);
+        sculpture.simulation->setClock(1.7f * i);
+        glfwMakeContextCurrent(NULL);
+    }
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
 
+    std::cout << "Batch: " << sculptures << " sculpture(s) with " << objects << " object(s), " << frames << " frames each at "
+              << BATCH_WIDTH << "x" << BATCH_HEIGHT << " with the " << batch[0]->renderer->name() << " renderer on "
+              << batch[0]->renderer->deviceName() << ", " << hardwareThreads << " hardware thread(s)" << std::endl;
+    double oneThreadRate = 0.0;
+    for (int threads = 1;; threads = std::min(threads * 2, sculptures))
+    {
+        // thread w runs sculptures w, w + threads, ..., each from first to last frame with its
+        // context current
+        std::vector<std::thread> workers;
+        for (std::unique_ptr<Sculpture>& sculpture : batch)
+            sculpture->renderSeconds = 0.0;
+        double start = glfwGetTime();
+        for (int w = 0; w < threads; w++)
+            workers.emplace_back([&, w] {
+                for (int i = w; i < sculptures; i += threads)
+                {
+                    Sculpture& sculpture = *batch[i];
+                    if (sculpture.context)
+                        glfwMakeContextCurrent(sculpture.context);
+                    for (int frame = 0; frame < frames; frame++)
+                    {
+                        sculpture.simulation->advance(sculpture.scene, FRAME_TIME);
+                        double renderStart = glfwGetTime();
+                        sculpture.renderer->render(sculpture.scene, *sculpture.pool);
+                        sculpture.renderSeconds += glfwGetTime() - renderStart;
+                    }
+                    if (sculpture.context)
+                        glfwMakeContextCurrent(NULL);
+                }
+            });
+        for (std::thread& worker : workers)
+            worker.join();
+        double seconds = glfwGetTime() - start;
+        double rate = sculptures * frames / seconds;
+        double renderSeconds = 0.0;
+        for (std::unique_ptr<Sculpture>& sculpture : batch)
+            renderSeconds += sculpture->renderSeconds;
+        if (threads == 1)
+            oneThreadRate = rate;
+        std::cout << "Batch on " << threads << " thread(s): " << seconds * 1000.0 << " ms, " << rate << " sculpture frames/s ("
+                  << rate / oneThreadRate << "x one thread), render() " << renderSeconds * 1000.0 / (sculptures * frames) << " ms per frame";
+        // beyond the hardware threads the split only shows contention; scaling needs that many cores
+        if (hardwareThreads > 0 && (unsigned int)threads > hardwareThreads)
+            std::cout << ", more threads than hardware threads: not a measure of scaling";
+        std::cout << std::endl;
+        if (threads == sculptures)
+            break;
+    }
+
+    for (int i = 0; i < sculptures; i++)
+    {
+        Sculpture& sculpture = *batch[i];
+        std::string path = "batch_" + std::to_string(i) + ".ppm";
+        if (!sculpture.renderer->writeImage(path.c_str()))
+            std::cout << "Cannot write " << path << std::endl;
+        if (sculpture.context)
+            glfwMakeContextCurrent(sculpture.context);
+        sculpture.renderer->destroy();
+        if (sculpture.context)
+        {
+            glfwMakeContextCurrent(NULL);
+            glfwDestroyWindow(sculpture.context);
+        }
+    }
     glfwTerminate();
     return 0;
 }
 
+// a batch sculpture seen from angle around it, with objects spawned around it three to a ring,
+// the rings spaced to keep the objects apart, each object pushed along its ring
+// ---------------------------------------------------------------------------------------------
+void placeBatchSculpture(SculptureScene& scene, float angle, int objects)
+{
+    Camera& camera = scene.camera;
+    camera.Position = glm::vec3(4.0f * std::sin(angle), 0.5f, 4.0f * std::cos(angle));
+    camera.Yaw = -90.0f - glm::degrees(angle);
+    camera.Pitch = -7.0f;
+    camera.ProcessMouseMovement(0.0f, 0.0f); // recomputes the camera's axes
+    scene.reserveSpawned(objects);
+    for (int k = 0; k < objects; k++)
+    {
+        float around = angle + 2.1f * k;
+        float radius = 1.8f * std::sqrt(1.0f + (float)(k / 3));
+        scene.spawn(glm::vec3(radius * std::cos(around), -0.3f, radius * std::sin(around)),
+            glm::vec3(0.6f * std::sin(around), 0.0f, -0.6f * std::cos(around)));
+    }
+}
+
+// --check-frame-graph: the app's own frames have too few transients to alias, so the graph is
+// checked on a deferred-style 1920x1080 frame instead (depth prepass, shadows, G-buffer, lighting,
+// bloom, tonemap, HUD), declared twice: with a capture pass that nothing reads, which is culled,
+// then with the capture marked as a readback. A debug view nobody presents is culled in both.
+// Prints the frame graph report of each and returns nonzero if culling or aliasing is off
+// ---------------------------------------------------------------------------------------------
+int checkFrameGraph()
+{
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* context = glfwCreateWindow(1, 1, "frame graph", NULL, NULL);
+    if (context == NULL)
+    {
+        std::cout << "Failed to create a context for the frame graph check" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(context);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return -1;
+    }
+
+    const int W = 1920, H = 1080;
+    typedef FrameGraph::TextureDesc Desc;
+    FrameGraph graph;
+    bool passed = true;
+    std::string reported;
+    for (int frame = 0; frame < 2; frame++)
+    {
+        bool capture = frame == 1;
+        graph.reset();
+        FrameGraph::Resource screen = graph.import("screen");
+        FrameGraph::PassBuilder prepass = graph.addPass("depth prepass", [] {});
+        FrameGraph::Resource depth = prepass.create("depth", Desc{ GL_TEXTURE_2D, GL_DEPTH_COMPONENT24, W, H, 1 });
+        FrameGraph::PassBuilder shadows = graph.addPass("shadows", [] {});
+        FrameGraph::Resource shadowMap = shadows.create("shadow map", Desc{ GL_TEXTURE_2D, GL_DEPTH_COMPONENT24, 2048, 2048, 1 });
+        FrameGraph::PassBuilder gBuffer = graph.addPass("g-buffer", [] {});
+        gBuffer.read(depth);
+        FrameGraph::Resource albedo = gBuffer.create("albedo", Desc{ GL_TEXTURE_2D, GL_RGBA8, W, H, 1 });
+        FrameGraph::Resource normal = gBuffer.create("normal", Desc{ GL_TEXTURE_2D, GL_RGBA16F, W, H, 1 });
+        FrameGraph::Resource material = gBuffer.create("material", Desc{ GL_TEXTURE_2D, GL_RGBA8, W, H, 1 });
+        FrameGraph::PassBuilder lighting = graph.addPass("lighting", [] {});
+        lighting.read(depth);
+        lighting.read(shadowMap);
+        lighting.read(albedo);
+        lighting.read(normal);
+        lighting.read(material);
+        FrameGraph::Resource hdr = lighting.create("hdr", Desc{ GL_TEXTURE_2D, GL_RGBA16F, W, H, 1 });
+        FrameGraph::PassBuilder bright = graph.addPass("bloom bright", [] {});
+        bright.read(hdr);
+        FrameGraph::Resource brightColor = bright.create("bright", Desc{ GL_TEXTURE_2D, GL_RGBA16F, W, H, 1 });
+        FrameGraph::PassBuilder blurX = graph.addPass("bloom blur x", [] {});
+        blurX.read(brightColor);
+        FrameGraph::Resource blurredX = blurX.create("blur x", Desc{ GL_TEXTURE_2D, GL_RGBA16F, W, H, 1 });
+        FrameGraph::PassBuilder blurY = graph.addPass("bloom blur y", [] {});
+        blurY.read(blurredX);
+        FrameGraph::Resource blurredY = blurY.create("blur y", Desc{ GL_TEXTURE_2D, GL_RGBA16F, W, H, 1 });
+        FrameGraph::PassBuilder tonemap = graph.addPass("tonemap", [] {});
+        tonemap.read(hdr);
+        tonemap.read(blurredY);
+        FrameGraph::Resource ldr = tonemap.create("ldr", Desc{ GL_TEXTURE_2D, GL_RGBA8, W, H, 1 });
+        FrameGraph::PassBuilder capturePass = graph.addPass("capture", [] {});
+        capturePass.read(ldr);
+        if (capture)
+            capturePass.sideEffect();
+        FrameGraph::PassBuilder hud = graph.addPass("hud", [] {});
+        hud.read(ldr);
+        hud.write(screen);
+        FrameGraph::PassBuilder debugView = graph.addPass("debug view", [] {});
+        debugView.read(normal);
+        debugView.create("debug", Desc{ GL_TEXTURE_2D, GL_RGBA8, W, H, 1 });
+
+        if (!graph.compile())
+        {
+            passed = false;
+            continue;
+        }
+        reportFrameGraph(graph, reported);
+        const FrameGraph::Stats& stats = graph.frameStats();
+        bool captureCulled = graph.passCulled(graph.passCount() - 3);
+        bool debugCulled = graph.passCulled(graph.passCount() - 1);
+        if (stats.culled != (capture ? 1 : 2) || captureCulled == capture || !debugCulled || stats.allocatedBytes >= stats.transientBytes)
+            passed = false;
+    }
+    std::cout << "Frame graph check " << (passed ? "passed" : "FAILED") << std::endl;
+    graph.destroy();
+    glfwDestroyWindow(context);
+    glfwTerminate();
+    return passed ? 0 : 1;
+}
+
+// --verify-generation: every GPU generation path this context supports evaluates a set of shapes
+// (exponents across the animated range, round and squashed radii; the compute path does them all
+// in one dispatch), which are read back and compared with generateSuperellipsoid on the same grid.
+// Prints the worst position, texture coordinate and normal deviation of each path and returns
+// nonzero if a position or texture coordinate is off. Vertices on the seams, where a sine or
+// cosine of the grid angles is zero, are held to a looser bound: there each side raises its own
+// rounding error of that zero (up to ~1e-6 for a GPU cos) to an exponent as low as 0.2, which moves
+// the point by a few percent of the radius.
+// Normals are reported only, as the compute path uses the surface's true normals where the
+// others approximate them
+// ---------------------------------------------------------------------------------------------
+int verifyGeneration()
+{
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* context = glfwCreateWindow(1, 1, "generation", NULL, NULL);
+    if (context == NULL)
+    {
+        std::cout << "Failed to create a context for the generation check" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(context);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return -1;
+    }
+
+    const int STACKS = 64, SLICES = 64;
+    const float EXPONENTS[] = { 0.2f, 0.5f, 1.0f, 1.5f, 2.0f };
+    const glm::vec3 RADII[] = { glm::vec3(1.0f), glm::vec3(0.5f, 1.0f, 2.0f) };
+    // positions within 1e-4 of the radius, about what single-precision pow() gives on both sides
+    const float TOLERANCE = 1e-4f, SEAM_TOLERANCE = 0.1f;
+    std::vector<SuperellipsoidCompute::Shape> shapes;
+    for (const glm::vec3& radii : RADII)
+        for (float n1 : EXPONENTS)
+            for (float n2 : EXPONENTS)
+                shapes.push_back(SuperellipsoidCompute::Shape{ radii, n1, n2 });
+
+    SuperellipsoidFeedback feedback;
+    SuperellipsoidCompute compute;
+    bool available[SculptureRenderer::GENERATIONS] = { false,
+        feedback.create(STACKS, SLICES, "6.superellipsoid_generate.vs"), compute.create(STACKS, SLICES, "6.superellipsoid_generate.cs") };
+    std::vector<Vertex> reference;
+    std::vector<unsigned int> indices;
+    generateSuperellipsoid(reference, indices, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, STACKS, SLICES);
+    const size_t shapeVertices = reference.size();
+
+    bool passed = true;
+    for (int path = SculptureRenderer::GENERATE_FEEDBACK; path < SculptureRenderer::GENERATIONS; path++)
+    {
+        if (!available[path])
+        {
+            std::cout << GENERATION_PATH_NAMES[path] << ": unavailable in this context, not checked" << std::endl;
+            continue;
+        }
+        unsigned int buffer;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferData(GL_ARRAY_BUFFER, shapes.size() * shapeVertices * sizeof(Vertex), nullptr, GL_STATIC_READ);
+        if (path == SculptureRenderer::GENERATE_COMPUTE)
+            compute.generate(buffer, 0, shapes.data(), shapes.size());
+        else
+            for (size_t k = 0; k < shapes.size(); k++)
+                feedback.generate(buffer, (GLintptr)(k * shapeVertices * sizeof(Vertex)), shapes[k].n1, shapes[k].n2, shapes[k].radii);
+        std::vector<Vertex> generated(shapes.size() * shapeVertices);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glGetBufferSubData(GL_ARRAY_BUFFER, 0, generated.size() * sizeof(Vertex), generated.data());
+        glDeleteBuffers(1, &buffer);
+
+        float worstPosition = 0.0f, worstSeamPosition = 0.0f, worstTexCoords = 0.0f, worstNormal = 0.0f;
+        size_t worstShape = 0;
+        for (size_t k = 0; k < shapes.size(); k++)
+        {
+            const SuperellipsoidCompute::Shape& shape = shapes[k];
+            generateSuperellipsoid(reference, indices, shape.radii.x, shape.radii.y, shape.radii.z, shape.n1, shape.n2, STACKS, SLICES);
+            float radius = std::max(shape.radii.x, std::max(shape.radii.y, shape.radii.z));
+            for (size_t v = 0; v < shapeVertices; v++)
+            {
+                const Vertex& gpu = generated[k * shapeVertices + v];
+                const Vertex& cpu = reference[v];
+                float position = glm::length(gpu.Position - cpu.Position) / radius;
+                int stack = (int)(v / (SLICES + 1)), slice = (int)(v % (SLICES + 1));
+                if (stack % (STACKS / 2) == 0 || slice % (SLICES / 4) == 0)
+                    worstSeamPosition = std::max(worstSeamPosition, position);
+                else if (position > worstPosition)
+                {
+                    worstPosition = position;
+                    worstShape = k;
+                }
+                worstTexCoords = std::max(worstTexCoords, glm::length(gpu.TexCoords - cpu.TexCoords));
+                float cosine = glm::dot(glm::normalize(gpu.Normal), glm::normalize(cpu.Normal));
+                worstNormal = std::max(worstNormal, glm::degrees(std::acos(glm::clamp(cosine, -1.0f, 1.0f))));
+            }
+        }
+        bool pathPassed = worstPosition <= TOLERANCE && worstSeamPosition <= SEAM_TOLERANCE && worstTexCoords <= TOLERANCE;
+        passed = passed && pathPassed;
+        const SuperellipsoidCompute::Shape& worst = shapes[worstShape];
+        std::cout << GENERATION_PATH_NAMES[path] << ": " << shapes.size() << " shapes of " << shapeVertices << " vertices, worst position "
+                  << worstPosition << " of the radius (n1 " << worst.n1 << ", n2 " << worst.n2 << "), on the seams "
+                  << worstSeamPosition << ", texture coordinates "
+                  << worstTexCoords << ", normals " << worstNormal << " degrees; " << (pathPassed ? "matches" : "DOES NOT MATCH")
+                  << " the CPU reference" << std::endl;
+    }
+    feedback.destroy();
+    compute.destroy();
+    glfwDestroyWindow(context);
+    glfwTerminate();
+    return passed ? 0 : 1;
+}
+
+// --check-vulkan: one batch sculpture with enough objects for several instance batches, driven
+// for a second, is rendered by the GL and the Vulkan backends from the same scene, the Vulkan
+// batches recorded on four threads however many cores there are. Prints the Vulkan device, and
+// whether it is a CPU implementation, and how far the images are apart; writes both to
+// check_vulkan_<backend>.ppm and returns nonzero if they differ by more than rasterisation does.
+// On a machine without a GPU, point VK_ICD_FILENAMES at lavapipe's lvp_icd.*.json to check there
+// ---------------------------------------------------------------------------------------------
+int checkVulkan()
+{
+#ifndef SCULPTURE_VULKAN
+    std::cout << "No Vulkan backend in this build: the Vulkan headers were not found" << std::endl;
+    glfwTerminate();
+    return -1;
+#else
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* context = glfwCreateWindow(1, 1, "vulkan check", NULL, NULL);
+    if (context == NULL)
+    {
+        std::cout << "Failed to create a context for the Vulkan check" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(context);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return -1;
+    }
+
+    // 600 objects and the sculpture make three instance batches; the lamps and cables are a fourth
+    const int OBJECTS = 600, FRAMES = 60;
+    // pixels whose channels are all within 8 of each other match; edges, where the two
+    // rasterisers may pick different triangles or line pixels, may make up 2% of the image
+    const int CHANNEL_TOLERANCE = 8;
+    const double MISMATCH_TOLERANCE = 0.02;
+    ThreadPool pool(4);
+    SculptureScene scene;
+    SculptureSimulation simulation(pool);
+    placeBatchSculpture(scene, 0.0f, OBJECTS);
+    for (int frame = 0; frame < FRAMES; frame++)
+        simulation.advance(scene, 1.0f / 60.0f);
+
+    SculptureRenderer gl;
+    VulkanSculptureRenderer vulkan;
+    if (!gl.create(BATCH_WIDTH, BATCH_HEIGHT) || !vulkan.create(BATCH_WIDTH, BATCH_HEIGHT))
+    {
+        std::cout << "Failed to create the renderers for the Vulkan check" << std::endl;
+        vulkan.destroy();
+        glfwTerminate();
+        return -1;
+    }
+    std::cout << "Vulkan device: " << vulkan.deviceName() << (vulkan.cpuDevice() ? ", a CPU implementation" : ", a GPU")
+              << "; GL renderer: " << gl.deviceName() << std::endl;
+    gl.render(scene, pool);
+    vulkan.render(scene, pool);
+    const std::vector<unsigned char>& a = gl.image();
+    const std::vector<unsigned char>& b = vulkan.image();
+    size_t pixels = (size_t)BATCH_WIDTH * BATCH_HEIGHT, mismatched = 0;
+    double differenceSum = 0.0;
+    for (size_t i = 0; i < pixels; i++)
+    {
+        int worst = 0;
+        for (int channel = 0; channel < 3; channel++)
+        {
+            int difference = std::abs((int)a[i * 3 + channel] - (int)b[i * 3 + channel]);
+            worst = std::max(worst, difference);
+            differenceSum += difference;
+        }
+        if (worst > CHANNEL_TOLERANCE)
+            mismatched++;
+    }
+    double mismatchedShare = (double)mismatched / pixels;
+    bool passed = mismatchedShare <= MISMATCH_TOLERANCE;
+    std::cout << OBJECTS << " objects in " << BATCH_WIDTH << "x" << BATCH_HEIGHT << ": " << mismatched << " pixels ("
+              << mismatchedShare * 100.0 << "%) differ by more than " << CHANNEL_TOLERANCE << ", mean channel difference "
+              << differenceSum / (pixels * 3) << std::endl;
+    if (!gl.writeImage("check_vulkan_gl.ppm") || !vulkan.writeImage("check_vulkan_vulkan.ppm"))
+        std::cout << "Cannot write the check's images" << std::endl;
+    std::cout << "Vulkan check " << (passed ? "passed" : "FAILED") << std::endl;
+    vulkan.destroy();
+    gl.destroy();
+    glfwDestroyWindow(context);
+    glfwTerminate();
+    return passed ? 0 : 1;
+#endif
+}
+
 // process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
 // ---------------------------------------------------------------------------------------------------------
-void processInput(GLFWwindow* window)
+void processInput(GLFWwindow* window, WindowState& state, float deltaTime)
 {
+    SculptureScene& scene = *state.scene;
+    Camera& camera = scene.camera;
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
@@ -401,18 +1549,342 @@ void processInput(GLFWwindow* window)
         camera.ProcessKeyboard(RIGHT, deltaTime);
 
     // NEW: Spawn logic for 'E' key
-    bool e_is_pressed = glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS;
+    if (keyPressed(window, state, GLFW_KEY_E))
+    {
+        // Add the current camera position, pushed forward by 2.0f units, with a push away from the camera
+        spawnSuperellipsoid(scene, camera.Position + camera.Front * 2.0f, camera.Front * 2.0f);
+    }
 
-    if (e_is_pressed && !e_pressed_last_frame)
+    if (keyPressed(window, state, GLFW_KEY_K))
+        state.showKineticArray = !state.showKineticArray;
+    if (keyPressed(window, state, GLFW_KEY_R))
+        state.reloadChoreography = true;
+    for (int pattern = 0; pattern <= 4; pattern++)
+        if (keyPressed(window, state, GLFW_KEY_0 + pattern))
+            state.patternRequest = pattern;
+    if (keyPressed(window, state, GLFW_KEY_M) && state.soundtrackLoaded)
+        state.audioReactive = !state.audioReactive;
+    if (keyPressed(window, state, GLFW_KEY_T))
+        state.showEchoes = !state.showEchoes;
+    if (keyPressed(window, state, GLFW_KEY_V))
+        state.viewCount = state.viewCount == 1 ? 2 : state.viewCount == 2 ? MAX_VIEWS : 1;
+    if (keyPressed(window, state, GLFW_KEY_O))
+        state.stereo = !state.stereo;
+    if (keyPressed(window, state, GLFW_KEY_P))
     {
-        // Add the current camera position, pushed forward by 2.0f units
-        glm::vec3 spawn_pos = camera.Position + camera.Front * 2.0f;
-        spawnedSuperellipsoids.push_back(spawn_pos);
-        // Note: You must have <iostream> included for this to work
-        std::cout << "Superellipsoid spawned at: (" << spawn_pos.x << ", " << spawn_pos.y << ", " << spawn_pos.z << ")" << std::endl;
+        state.particleMode = (state.particleMode + 1) % 3;
+        state.particleModeChanged = true;
     }
+    if (keyPressed(window, state, GLFW_KEY_G))
+    {
+        do
+            state.generationPath = (state.generationPath + 1) % SculptureRenderer::GENERATIONS;
+        while (!state.generationPathAvailable[state.generationPath]);
+    }
+    if (keyPressed(window, state, GLFW_KEY_L) && state.tessellationAvailable)
+        state.tessellatedDetail = !state.tessellatedDetail;
+    if (keyPressed(window, state, GLFW_KEY_I) && state.rayMarchAvailable)
+        state.rayMarchedSurfaces = !state.rayMarchedSurfaces;
+    if (keyPressed(window, state, GLFW_KEY_B) && state.rayMarchAvailable)
+        state.fillBenchmarkRequested = true;
+    if (keyPressed(window, state, GLFW_KEY_F5))
+        state.sceneSaveRequested = true;
+    if (keyPressed(window, state, GLFW_KEY_F6))
+        state.sceneExportRequested = true;
+    if (keyPressed(window, state, GLFW_KEY_F9))
+        state.sceneLoadRequested = true;
+}
+
+// whether key went down since the last call for it: held keys act once per press
+// ---------------------------------------------------------------------------------------------
+bool keyPressed(GLFWwindow* window, WindowState& state, int key)
+{
+    bool down = glfwGetKey(window, key) == GLFW_PRESS;
+    bool pressed = down && !state.keysDown[key];
+    state.keysDown[key] = down;
+    return pressed;
+}
+
+// prints the mean particle update time every two seconds, to compare the backends
+// ---------------------------------------------------------------------------------------------
+void reportParticleTimings(WindowState& state, float now, const SurfaceParticles& particles)
+{
+    state.particleUpdateSum += particles.updateMilliseconds();
+    state.particleUpdateCount++;
+    if (now - state.particleLastReport < 2.0f)
+        return;
+    std::cout << "Particles (" << (particles.backend() == SurfaceParticles::CPU ? "CPU, SIMD" : "GPU, transform feedback")
+              << "): " << particles.count() << ", update " << state.particleUpdateSum / state.particleUpdateCount << " ms" << std::endl;
+    state.particleUpdateSum = 0.0;
+    state.particleUpdateCount = 0;
+    state.particleLastReport = now;
+}
+
+// prints which passes the frame graph ran and the memory aliasing saved, whenever that differs
+// from the reported line
+// ---------------------------------------------------------------------------------------------
+void reportFrameGraph(const FrameGraph& graph, std::string& reported)
+{
+    const FrameGraph::Stats& stats = graph.frameStats();
+    std::ostringstream line;
+    line << "Frame graph:";
+    for (int pass = 0; pass < graph.passCount(); pass++)
+        line << (pass == 0 ? " " : ", ") << graph.passName(pass) << (graph.passCulled(pass) ? " (culled)" : "");
+    line << "; " << stats.barriers << " read-after-write hand-over(s); transient targets "
+         << stats.transientBytes / 1048576.0 << " MB in " << stats.allocatedBytes / 1048576.0 << " MB of textures, "
+         << (stats.transientBytes - stats.allocatedBytes) / 1048576.0 << " MB saved by aliasing";
+    if (line.str() == reported)
+        return;
+    reported = line.str();
+    std::cout << reported << std::endl;
+}
 
-    e_pressed_last_frame = e_is_pressed;
+// folds the soundtrack's bands into three 0..1 drives: lows (40-180 Hz), mids (180-1700 Hz) and highs
+// ---------------------------------------------------------------------------------------------
+void soundtrackDrive(const AudioAnalysis::Frame& frame, float& bass, float& mid, float& high)
+{
+    static_assert(AudioAnalysis::BANDS == 8, "band grouping assumes eight bands");
+    bass = std::max(frame.bands[0], frame.bands[1]);
+    mid = (frame.bands[2] + frame.bands[3] + frame.bands[4]) / 3.0f;
+    high = (frame.bands[5] + frame.bands[6] + frame.bands[7]) / 3.0f;
+}
+
+// adds a spawned object at spawn_pos, hanging from its own cable
+// ---------------------------------------------------------------------------------------------
+void spawnSuperellipsoid(SculptureScene& scene, const glm::vec3& spawn_pos, const glm::vec3& push)
+{
+    scene.spawn(spawn_pos, push);
+    // Note: You must have <iostream> included for this to work
+    std::cout << "Superellipsoid spawned at: (" << spawn_pos.x << ", " << spawn_pos.y << ", " << spawn_pos.z << ")" << std::endl;
+}
+
+// applies one show-control message; runs on the render thread at the start of a frame
+// ---------------------------------------------------------------------------------------------
+void applyControl(const OscMessage& message, WindowState& state)
+{
+    ShowControl& showControl = state.showControl;
+    int64_t now = OscMessage::steadyNanoseconds();
+    int64_t waited = now - message.receivedAt;
+    showControl.arrivalSum += waited;
+    showControl.arrivalMax = std::max(showControl.arrivalMax, waited);
+    showControl.arrivalCount++;
+
+    const char* address = message.address;
+    if (message.is("/morph"))
+    {
+        showControl.n1Set = showControl.n2Set = true;
+        showControl.n1 = glm::clamp(message.number(0), 0.05f, 4.0f);
+        showControl.n2 = glm::clamp(message.number(1), 0.05f, 4.0f);
+    }
+    else if (message.is("/morph/n1"))
+    {
+        showControl.n1Set = true;
+        showControl.n1 = glm::clamp(message.number(0), 0.05f, 4.0f);
+    }
+    else if (message.is("/morph/n2"))
+    {
+        showControl.n2Set = true;
+        showControl.n2 = glm::clamp(message.number(0), 0.05f, 4.0f);
+    }
+    else if (std::strncmp(address, "/light/", 7) == 0 && address[7] >= '0' && address[7] <= '3' && address[8] == '/')
+    {
+        int light = address[7] - '0';
+        if (std::strcmp(address + 9, "intensity") == 0)
+        {
+            showControl.intensitySet[light] = true;
+            showControl.intensity[light] = std::max(message.number(0), 0.0f);
+        }
+        else if (std::strcmp(address + 9, "position") == 0)
+        {
+            showControl.positionSet[light] = true;
+            showControl.position[light] = glm::vec3(message.number(0), message.number(1), message.number(2));
+        }
+    }
+    else if (message.is("/spawn"))
+    {
+        // into a reserved slot, without the E key's message per object
+        SculptureScene& scene = *state.scene;
+        if (scene.spawnedCount() < scene.spawnCapacity())
+            scene.spawn(glm::vec3(message.number(0), message.number(1), message.number(2)), glm::vec3(0.0f));
+        else
+            showControl.spawnsRefused++;
+    }
+    else if (message.is("/pattern"))
+    {
+        int64_t pattern = message.integer(0);
+        if (pattern >= 0 && pattern <= 4)
+            state.patternRequest = (int)pattern;
+    }
+    else if (message.is("/release"))
+    {
+        showControl.n1Set = showControl.n2Set = false;
+        for (int i = 0; i < 4; i++)
+            showControl.intensitySet[i] = showControl.positionSet[i] = false;
+    }
+    else if (message.is("/ping"))
+    {
+        // the sender's stamp is on the same monotonic clock: send -> applied, end to end
+        int64_t endToEnd = now - message.integer(0);
+        showControl.pingSum += endToEnd;
+        showControl.pingMax = std::max(showControl.pingMax, endToEnd);
+        showControl.pingCount++;
+    }
+}
+
+// prints the control latency every few seconds while messages are coming in
+// ---------------------------------------------------------------------------------------------
+void reportControlLatency(WindowState& state, float now)
+{
+    ShowControl& showControl = state.showControl;
+    if (now - showControl.lastReport < 2.0f)
+        return;
+    showControl.lastReport = now;
+    if (showControl.arrivalCount > 0)
+    {
+        std::cout << "OSC: " << showControl.arrivalCount << " messages, arrival -> applied "
+                  << showControl.arrivalSum / showControl.arrivalCount / 1e6 << " ms avg, " << showControl.arrivalMax / 1e6 << " ms max";
+        if (showControl.pingCount > 0)
+            std::cout << "; sent -> applied " << showControl.pingSum / showControl.pingCount / 1e6 << " ms avg, "
+                      << showControl.pingMax / 1e6 << " ms max";
+        if (state.oscListener.dropped() > 0)
+            std::cout << "; " << state.oscListener.dropped() << " dropped";
+        if (showControl.spawnsRefused > 0)
+            std::cout << "; " << showControl.spawnsRefused << " spawns refused, no free slot";
+        std::cout << std::endl;
+    }
+    showControl.arrivalSum = showControl.arrivalMax = showControl.pingSum = showControl.pingMax = 0;
+    showControl.arrivalCount = showControl.pingCount = showControl.spawnsRefused = 0;
+}
+
+// appends the positions of pattern 1-4, laid out in front of the camera, and returns how many
+// ---------------------------------------------------------------------------------------------
+size_t generatePattern(int pattern, const Camera& camera, std::vector<glm::vec3>& positions, ThreadPool& pool)
+{
+    // patterns lie in a horizontal plane a little below eye level, centred ahead of the camera
+    glm::vec3 forward = glm::normalize(glm::vec3(camera.Front.x, 0.0f, camera.Front.z) + glm::vec3(0.0f, 0.0f, 1e-6f));
+    glm::vec3 center = camera.Position + forward * 8.0f - glm::vec3(0.0f, 1.0f, 0.0f);
+    switch (pattern)
+    {
+    case 1: // 200 x 200 floor of shapes
+        return SpawnPatterns::grid(positions, center - glm::vec3(10.0f, 0.0f, 10.0f), glm::ivec3(200, 1, 200), glm::vec3(0.1f), pool);
+    case 2: // rising sunflower spiral
+        return SpawnPatterns::spiral(positions, center, 50000, 0.045f, 0.00002f, pool);
+    case 3: // blue-noise scatter
+        return SpawnPatterns::poissonDisk(positions, center - glm::vec3(10.0f, 0.0f, 10.0f), glm::vec2(20.0f), 0.12f,
+            (unsigned int)positions.size(), pool);
+    case 4:
+    {
+        // a closed loop weaving up and down around the point ahead
+        std::vector<glm::vec3> loop;
+        for (int i = 0; i < 8; i++)
+        {
+            float a = i * 2.0f * (float)M_PI / 8.0f;
+            loop.push_back(center + glm::vec3(5.0f * std::cos(a), (i % 2) ? 1.5f : -0.5f, 5.0f * std::sin(a)));
+        }
+        return SpawnPatterns::alongCurve(positions, loop, true, 2000, pool);
+    }
+    default:
+        return 0;
+    }
+}
+
+// reads and compiles the kinetic array choreography; a missing file or a syntax error leaves the
+// waves alone (an empty program), errors are printed so the file can be fixed and reloaded
+// ---------------------------------------------------------------------------------------------
+ExpressionProgram loadChoreography(const char* path)
+{
+    std::ifstream file(path);
+    if (!file)
+    {
+        std::cout << "No choreography at " << path << ", the kinetic array follows its waves" << std::endl;
+        return ExpressionProgram::compile("");
+    }
+    std::stringstream source;
+    source << file.rdbuf();
+    ExpressionProgram program = ExpressionProgram::compile(source.str());
+    if (!program.valid())
+    {
+        std::cout << path << ":" << program.error() << std::endl;
+        return ExpressionProgram::compile("");
+    }
+    std::cout << "Choreography " << path << ": " << program.instructionCount() << " instructions, "
+              << program.registers() << " registers" << std::endl;
+    return program;
+}
+
+// keyframed show curves, all looping: the sculpture breathes (Bezier ease in / out), each point
+// light pulses and bobs on its own period, and the reactive shape of the kinetic array alternates
+// between spiky stars and rounded cubes
+// ---------------------------------------------------------------------------------------------
+AnimationCurves buildShowCurves()
+{
+    AnimationCurves curves;
+
+    int scale = curves.addChannel("sculpture.scale", true);
+    curves.addBezierKey(scale, 0.0f, 1.0f, glm::vec2(0.0f), glm::vec2(1.2f, 0.0f));
+    curves.addBezierKey(scale, 2.0f, 1.15f, glm::vec2(-0.4f, 0.0f), glm::vec2(0.4f, 0.0f));
+    curves.addBezierKey(scale, 4.0f, 1.0f, glm::vec2(-1.2f, 0.0f), glm::vec2(0.0f));
+
+    for (int i = 0; i < 4; i++)
+    {
+        // quick attack, slow decay
+        float period = 2.5f + 0.7f * i;
+        int intensity = curves.addChannel("light" + std::to_string(i) + ".intensity", true);
+        curves.addBezierKey(intensity, 0.0f, 0.4f, glm::vec2(0.0f), glm::vec2(0.1f, 0.3f));
+        curves.addBezierKey(intensity, 0.25f * period, 1.2f, glm::vec2(-0.05f, 0.0f), glm::vec2(0.3f * period, 0.0f));
+        curves.addBezierKey(intensity, period, 0.4f, glm::vec2(-0.2f * period, 0.0f), glm::vec2(0.0f));
+
+        int lift = curves.addChannel("light" + std::to_string(i) + ".lift", true);
+        curves.addHermiteKey(lift, 0.0f, 0.0f, 0.3f, 0.3f);
+        curves.addHermiteKey(lift, period, 0.4f, -0.3f, -0.3f);
+        curves.addHermiteKey(lift, 2.0f * period, 0.0f, 0.3f, 0.3f);
+    }
+
+    int n1 = curves.addChannel("array.reactiveN1", true);
+    int n2 = curves.addChannel("array.reactiveN2", true);
+    curves.addHermiteKey(n1, 0.0f, 3.0f, 0.0f, 0.0f);
+    curves.addHermiteKey(n1, 3.0f, 3.0f, 0.0f, 0.0f);
+    curves.addHermiteKey(n1, 5.0f, 0.3f, 0.0f, 0.0f);
+    curves.addHermiteKey(n1, 8.0f, 0.3f, 0.0f, 0.0f);
+    curves.addHermiteKey(n1, 10.0f, 3.0f, 0.0f, 0.0f);
+    curves.addStepKey(n2, 0.0f, 3.0f);
+    curves.addStepKey(n2, 4.0f, 0.3f);
+    curves.addStepKey(n2, 9.0f, 3.0f);
+    curves.addStepKey(n2, 10.0f, 3.0f);
+
+    return curves;
+}
+
+// world-space direction of the ray through the cursor; a captured cursor picks through the screen centre.
+// rect is the part of the window the camera's view covers, as from viewRect()
+// ---------------------------------------------------------------------------------------------
+glm::vec3 pickingRayDirection(GLFWwindow* window, const Camera& camera, const glm::mat4& projection, const glm::mat4& view, const glm::vec4& rect)
+{
+    if (glfwGetInputMode(window, GLFW_CURSOR) == GLFW_CURSOR_DISABLED)
+        return camera.Front;
+
+    double xpos, ypos;
+    glfwGetCursorPos(window, &xpos, &ypos);
+    int width, height;
+    glfwGetWindowSize(window, &width, &height);
+    // window coordinates run down from the top, rect up from the bottom
+    float x = ((float)xpos / width - rect.x) / rect.z;
+    float y = (1.0f - (float)ypos / height - rect.y) / rect.w;
+    glm::vec4 ndc(2.0f * x - 1.0f, 2.0f * y - 1.0f, 1.0f, 1.0f);
+    glm::vec4 farPoint = glm::inverse(projection * view) * ndc;
+    return glm::normalize(glm::vec3(farPoint) / farPoint.w - camera.Position);
+}
+
+// the part of the framebuffer showing view `view` of `count` (1, 2 or 4), as (x, y, width, height)
+// fractions from the bottom left; view 0 is on the left, or top left with four views
+// ---------------------------------------------------------------------------------------------
+glm::vec4 viewRect(int view, int count)
+{
+    if (count == 1)
+        return glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+    if (count == 2)
+        return glm::vec4(0.5f * view, 0.0f, 0.5f, 1.0f);
+    return glm::vec4(0.5f * (view % 2), view < 2 ? 0.5f : 0.0f, 0.5f, 0.5f);
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -431,27 +1903,71 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
     float xpos = static_cast<float>(xposIn);
     float ypos = static_cast<float>(yposIn);
 
-    if (firstMouse)
+    WindowState& state = *static_cast<WindowState*>(glfwGetWindowUserPointer(window));
+    if (state.firstMouse)
     {
-        lastX = xpos;
-        lastY = ypos;
-        firstMouse = false;
+        state.lastX = xpos;
+        state.lastY = ypos;
+        state.firstMouse = false;
     }
 
-    float xoffset = xpos - lastX;
-    float yoffset = lastY - ypos; // reversed since y-coordinates go from bottom to top
+    float xoffset = xpos - state.lastX;
+    float yoffset = state.lastY - ypos; // reversed since y-coordinates go from bottom to top
 
-    lastX = xpos;
-    lastY = ypos;
+    state.lastX = xpos;
+    state.lastY = ypos;
 
-    camera.ProcessMouseMovement(xoffset, yoffset);
+    state.scene->camera.ProcessMouseMovement(xoffset, yoffset);
 }
 
 // glfw: whenever the mouse scroll wheel scrolls, this callback is called
 // ----------------------------------------------------------------------
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
-    camera.ProcessMouseScroll(static_cast<float>(yoffset));
+    static_cast<WindowState*>(glfwGetWindowUserPointer(window))->scene->camera.ProcessMouseScroll(static_cast<float>(yoffset));
+}
+
+// glfw: whenever a mouse button is pressed, this callback is called; picking runs in the render loop
+// ----------------------------------------------------------------------
+void mouse_button_callback(GLFWwindow* window, int button, int action, int /*mods*/)
+{
+    if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS)
+        static_cast<WindowState*>(glfwGetWindowUserPointer(window))->pickRequested = true;
+}
+
+// loadTexture() with decoding and upload on the upload thread; the texture may only be used once
+// ticket is ready (or waited for). Falls back to loadTexture() without an upload thread
+// ---------------------------------------------------------------------------------------------
+unsigned int loadTextureAsync(const char* path, UploadThread& uploads, UploadThread::Ticket& ticket)
+{
+    if (!uploads.running())
+    {
+        ticket = 0;
+        return loadTexture(path);
+    }
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    std::string file = path;
+    ticket = uploads.submit([textureID, file] {
+        int width, height, nrComponents;
+        unsigned char* data = stbi_load(file.c_str(), &width, &height, &nrComponents, 0);
+        if (!data)
+        {
+            std::cout << "Texture failed to load at path: " << file << std::endl;
+            return;
+        }
+        GLenum format = nrComponents == 1 ? GL_RED : nrComponents == 3 ? GL_RGB : GL_RGBA;
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        stbi_image_free(data);
+    });
+    return textureID;
 }
 
 // utility function for loading a 2D texture from file
@@ -0,0 +1,374 @@
+#ifndef OSC_H
+#define OSC_H
+
+#include "spsc_queue.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef SOCKET OscSocket;
+#define OSC_INVALID_SOCKET INVALID_SOCKET
+inline int oscClose(OscSocket s) { return closesocket(s); }
+inline int oscPoll(WSAPOLLFD* fds, ULONG count, int timeout) { return WSAPoll(fds, count, timeout); }
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+typedef int OscSocket;
+#define OSC_INVALID_SOCKET -1
+inline int oscClose(OscSocket s) { return ::close(s); }
+inline int oscPoll(pollfd* fds, nfds_t count, int timeout) { return ::poll(fds, count, timeout); }
+#endif
+
+// Open Sound Control (1.0) over UDP: the subset show-control software sends, i.e. messages and
+// bundles with int32 (i), float32 (f), int64 (h), time tag (t), double (d), string/symbol (s, S,
+// skipped) and argument-less T/F/N/I tags. Messages are decoded into fixed-size OscMessage values
+// so they can travel through a lock-free ring without allocating.
+struct OscMessage
+{
+    static constexpr int MAX_ADDRESS = 64;
+    static constexpr int MAX_ARGUMENTS = 8;
+
+    char address[MAX_ADDRESS];
+    char types[MAX_ARGUMENTS + 1]; // type tag of each decoded argument
+    int argumentCount;
+    union Argument
+    {
+        float f;
+        int32_t i;
+        int64_t h;
+        double d;
+    } arguments[MAX_ARGUMENTS];
+    int64_t receivedAt; // steadyNanoseconds() when the datagram arrived
+
+    bool is(const char* pattern) const { return std::strcmp(address, pattern) == 0; }
+
+    // argument k as a float whatever its numeric type; 0 if missing
+    float number(int k) const
+    {
+        if (k >= argumentCount)
+            return 0.0f;
+        switch (types[k])
+        {
+        case 'f': return arguments[k].f;
+        case 'i': return (float)arguments[k].i;
+        case 'h': case 't': return (float)arguments[k].h;
+        case 'd': return (float)arguments[k].d;
+        case 'T': return 1.0f;
+        default: return 0.0f;
+        }
+    }
+
+    int64_t integer(int k) const
+    {
+        if (k >= argumentCount)
+            return 0;
+        switch (types[k])
+        {
+        case 'h': case 't': return arguments[k].h;
+        case 'i': return arguments[k].i;
+        case 'f': return (int64_t)arguments[k].f;
+        case 'd': return (int64_t)arguments[k].d;
+        case 'T': return 1;
+        default: return 0;
+        }
+    }
+
+    // monotonic clock shared by every process on the machine (CLOCK_MONOTONIC / QPC), so a sender
+    // on the same host can stamp messages and the receiver can measure end-to-end latency
+    static int64_t steadyNanoseconds()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // calls emit(const OscMessage&) for each message in the packet, unwrapping bundles; returns
+    // false if the packet was malformed (messages decoded before the error are still emitted)
+    template <typename Emit>
+    static bool decode(const char* data, size_t size, int64_t receivedAt, Emit emit, int depth = 0)
+    {
+        if (size >= 8 && std::memcmp(data, "#bundle", 8) == 0)
+        {
+            // "#bundle", 8-byte time tag (ignored: everything is applied on arrival), sized elements
+            if (depth > 4 || size < 16)
+                return false;
+            size_t at = 16;
+            while (at + 4 <= size)
+            {
+                uint32_t elementSize = readUint32(data + at);
+                at += 4;
+                if (elementSize > size - at || !decode(data + at, elementSize, receivedAt, emit, depth + 1))
+                    return false;
+                at += elementSize;
+            }
+            return at == size;
+        }
+
+        OscMessage message;
+        message.receivedAt = receivedAt;
+        message.argumentCount = 0;
+        size_t at = 0;
+        if (!readString(data, size, at, message.address, MAX_ADDRESS) || message.address[0] != '/')
+            return false;
+        char tags[32];
+        if (at == size)
+            tags[0] = 0; // very old senders omit the type tag string
+        else if (!readString(data, size, at, tags, sizeof(tags)) || tags[0] != ',')
+            return false;
+        for (const char* tag = tags[0] ? tags + 1 : tags; *tag; tag++)
+        {
+            OscMessage::Argument argument;
+            switch (*tag)
+            {
+            case 'i':
+            case 'f':
+                if (at + 4 > size)
+                    return false;
+                argument.i = (int32_t)readUint32(data + at); // float bits land in the same word
+                at += 4;
+                break;
+            case 'h':
+            case 't':
+            case 'd':
+                if (at + 8 > size)
+                    return false;
+                argument.h = (int64_t)(((uint64_t)readUint32(data + at) << 32) | readUint32(data + at + 4));
+                at += 8;
+                break;
+            case 's':
+            case 'S':
+            {
+                char skipped[256];
+                if (!readString(data, size, at, skipped, sizeof(skipped)))
+                    return false;
+                continue;
+            }
+            case 'T':
+            case 'F':
+            case 'N':
+            case 'I':
+                argument.h = 0;
+                break;
+            default:
+                return false; // blobs, arrays and others have no use here
+            }
+            if (message.argumentCount < MAX_ARGUMENTS)
+            {
+                message.types[message.argumentCount] = *tag;
+                message.arguments[message.argumentCount++] = argument;
+            }
+        }
+        message.types[message.argumentCount] = 0;
+        emit(message);
+        return true;
+    }
+
+    static uint32_t readUint32(const char* p)
+    {
+        const unsigned char* u = (const unsigned char*)p;
+        return (uint32_t)u[0] << 24 | (uint32_t)u[1] << 16 | (uint32_t)u[2] << 8 | (uint32_t)u[3];
+    }
+
+private:
+    // null-terminated string padded to a multiple of four bytes
+    static bool readString(const char* data, size_t size, size_t& at, char* out, size_t capacity)
+    {
+        size_t length = 0;
+        while (at + length < size && data[at + length])
+            length++;
+        if (at + length >= size || length >= capacity)
+            return false;
+        std::memcpy(out, data + at, length + 1);
+        at += (length + 4) & ~(size_t)3;
+        return at <= size;
+    }
+};
+
+// builds one OSC message for sending (tests, tools); fixed buffer, excess arguments are dropped
+class OscWriter
+{
+public:
+    explicit OscWriter(const char* address)
+    {
+        writeString(address);
+        typesAt = size;
+        writeString(",");
+    }
+
+    OscWriter& add(float value)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &value, 4);
+        if (addTag('f'))
+            writeUint32(bits);
+        return *this;
+    }
+
+    OscWriter& add(int32_t value)
+    {
+        if (addTag('i'))
+            writeUint32((uint32_t)value);
+        return *this;
+    }
+
+    OscWriter& add(int64_t value)
+    {
+        if (addTag('h'))
+        {
+            writeUint32((uint32_t)((uint64_t)value >> 32));
+            writeUint32((uint32_t)value);
+        }
+        return *this;
+    }
+
+    const char* data() const { return buffer; }
+    size_t length() const { return size; }
+
+private:
+    static constexpr size_t CAPACITY = 512;
+    char buffer[CAPACITY] = {};
+    size_t size = 0, typesAt = 0;
+    int argumentCount = 0;
+
+    void writeString(const char* s)
+    {
+        size_t length = std::strlen(s);
+        size_t padded = (length + 4) & ~(size_t)3;
+        if (size + padded > CAPACITY)
+            return;
+        std::memcpy(buffer + size, s, length);
+        std::memset(buffer + size + length, 0, padded - length);
+        size += padded;
+    }
+
+    void writeUint32(uint32_t v)
+    {
+        buffer[size++] = (char)(v >> 24);
+        buffer[size++] = (char)(v >> 16);
+        buffer[size++] = (char)(v >> 8);
+        buffer[size++] = (char)v;
+    }
+
+    // appends the tag to the type string, moving the arguments written so far when the string
+    // grows into a new four-byte word
+    bool addTag(char tag)
+    {
+        if (argumentCount >= OscMessage::MAX_ARGUMENTS || size + 16 > CAPACITY)
+            return false;
+        size_t tagLength = 1 + argumentCount; // ',' and the tags so far
+        size_t oldPadded = (tagLength + 4) & ~(size_t)3, newPadded = (tagLength + 5) & ~(size_t)3;
+        if (newPadded != oldPadded)
+        {
+            size_t argumentsAt = typesAt + oldPadded;
+            std::memmove(buffer + argumentsAt + 4, buffer + argumentsAt, size - argumentsAt);
+            std::memset(buffer + argumentsAt, 0, 4);
+            size += 4;
+        }
+        buffer[typesAt + tagLength] = tag;
+        argumentCount++;
+        return true;
+    }
+};
+
+// Receives OSC datagrams on a background thread and hands the decoded messages to the render
+// thread through a lock-free ring. The render thread drains it once per frame with poll(); when
+// it falls behind by more than QUEUE_SIZE messages the newest are dropped and counted.
+class OscListener
+{
+public:
+    static constexpr size_t QUEUE_SIZE = 1024;
+
+    ~OscListener() { stop(); }
+
+    // binds host:port (localhost by default, so nothing outside the machine can drive the show)
+    bool start(unsigned short port, const char* host = "127.0.0.1")
+    {
+        stop();
+#ifdef _WIN32
+        WSADATA wsa;
+        if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0)
+            return false;
+#endif
+        socketHandle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (socketHandle == OSC_INVALID_SOCKET)
+            return false;
+        sockaddr_in address;
+        std::memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        if (inet_pton(AF_INET, host, &address.sin_addr) != 1 || bind(socketHandle, (sockaddr*)&address, sizeof(address)) != 0)
+        {
+            oscClose(socketHandle);
+            socketHandle = OSC_INVALID_SOCKET;
+            return false;
+        }
+        running = true;
+        thread = std::thread([this] { receiveLoop(); });
+        return true;
+    }
+
+    void stop()
+    {
+        running = false;
+        if (thread.joinable())
+            thread.join();
+        if (socketHandle != OSC_INVALID_SOCKET)
+            oscClose(socketHandle);
+        socketHandle = OSC_INVALID_SOCKET;
+    }
+
+    bool listening() const { return socketHandle != OSC_INVALID_SOCKET; }
+
+    // render thread: next pending message, false once the ring is empty
+    bool poll(OscMessage& message) { return queue.pop(message); }
+
+    size_t received() const { return receivedCount.load(std::memory_order_relaxed); }
+    size_t dropped() const { return droppedCount.load(std::memory_order_relaxed); }
+    size_t malformed() const { return malformedCount.load(std::memory_order_relaxed); }
+
+private:
+    OscSocket socketHandle = OSC_INVALID_SOCKET;
+    std::thread thread;
+    std::atomic<bool> running{ false };
+    std::atomic<size_t> receivedCount{ 0 }, droppedCount{ 0 }, malformedCount{ 0 };
+    SpscQueue<OscMessage, QUEUE_SIZE> queue;
+
+    // how often the thread wakes up without traffic to notice stop()
+    static constexpr int STOP_CHECK_MS = 50;
+
+    void receiveLoop()
+    {
+        char datagram[65536];
+        pollfd waiting;
+        waiting.fd = socketHandle;
+        waiting.events = POLLIN;
+        while (running)
+        {
+            // block until a datagram arrives; the timeout only serves stop()
+            waiting.revents = 0;
+            if (oscPoll(&waiting, 1, STOP_CHECK_MS) <= 0)
+                continue;
+            int length = (int)recv(socketHandle, datagram, sizeof(datagram), 0);
+            if (length <= 0)
+                continue;
+            int64_t now = OscMessage::steadyNanoseconds();
+            bool valid = OscMessage::decode(datagram, (size_t)length, now, [this](const OscMessage& message) {
+                receivedCount.fetch_add(1, std::memory_order_relaxed);
+                if (!queue.push(message))
+                    droppedCount.fetch_add(1, std::memory_order_relaxed);
+            });
+            if (!valid)
+                malformedCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,106 @@
+// Test sender for the OSC control of the kinetic sculpture (osc.h, port 9000 on localhost).
+//
+//   osc_send [-p port] /address [arguments...]   one message; 3 is sent as int32, 3.0 as float
+//   osc_send [-p port] --ping count rate         count /ping messages stamped with the send time,
+//                                                rate per second; the sculpture prints the latency
+//   osc_send [-p port] --demo seconds            morph sweep, light pulses, a few spawns and pings
+//
+// Build next to the sculpture, e.g.  g++ -std=c++17 -O2 osc_send.cpp -o osc_send -pthread
+#include "osc.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+static OscSocket sender = OSC_INVALID_SOCKET;
+static sockaddr_in target;
+
+static void send(const OscWriter& message)
+{
+    sendto(sender, message.data(), (int)message.length(), 0, (const sockaddr*)&target, sizeof(target));
+}
+
+static void sendPing()
+{
+    send(OscWriter("/ping").add((int64_t)OscMessage::steadyNanoseconds()));
+}
+
+static void sleepSeconds(double seconds)
+{
+    std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+}
+
+int main(int argc, char** argv)
+{
+    unsigned short port = 9000;
+    int first = 1;
+    if (argc > 2 && std::strcmp(argv[1], "-p") == 0)
+    {
+        port = (unsigned short)std::atoi(argv[2]);
+        first = 3;
+    }
+    if (first >= argc)
+    {
+        std::printf("usage: osc_send [-p port] /address [args...] | --ping count rate | --demo seconds\n");
+        return 1;
+    }
+
+#ifdef _WIN32
+    WSADATA wsa;
+    WSAStartup(MAKEWORD(2, 2), &wsa);
+#endif
+    sender = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    std::memset(&target, 0, sizeof(target));
+    target.sin_family = AF_INET;
+    target.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &target.sin_addr);
+
+    std::string command = argv[first];
+    if (command == "--ping")
+    {
+        int count = first + 1 < argc ? std::atoi(argv[first + 1]) : 100;
+        double rate = first + 2 < argc ? std::atof(argv[first + 2]) : 100.0;
+        for (int i = 0; i < count; i++)
+        {
+            sendPing();
+            sleepSeconds(1.0 / rate);
+        }
+        std::printf("sent %d pings to port %d\n", count, port);
+    }
+    else if (command == "--demo")
+    {
+        double seconds = first + 1 < argc ? std::atof(argv[first + 1]) : 10.0;
+        const double rate = 120.0;
+        int frames = (int)(seconds * rate);
+        for (int i = 0; i < frames; i++)
+        {
+            float t = (float)(i / rate);
+            send(OscWriter("/morph").add(1.1f + 0.9f * std::sin(t * 2.0f)).add(1.1f + 0.9f * std::cos(t * 1.3f)));
+            std::string light = "/light/" + std::to_string(i % 4) + "/intensity";
+            send(OscWriter(light.c_str()).add(0.5f + 0.5f * std::sin(t * 4.0f + (i % 4))));
+            if (i % (int)rate == 0)
+                send(OscWriter("/spawn").add(3.0f * std::cos(t)).add(1.0f).add(3.0f * std::sin(t) - 2.0f));
+            sendPing();
+            sleepSeconds(1.0 / rate);
+        }
+        send(OscWriter("/release"));
+        std::printf("demo of %.1f s sent to port %d\n", seconds, port);
+    }
+    else
+    {
+        OscWriter message(argv[first]);
+        for (int i = first + 1; i < argc; i++)
+        {
+            if (std::strpbrk(argv[i], ".eE"))
+                message.add((float)std::atof(argv[i]));
+            else
+                message.add((int32_t)std::atoi(argv[i]));
+        }
+        send(message);
+    }
+    oscClose(sender);
+    return 0;
+}
@@ -0,0 +1,262 @@
+#ifndef PHASE_WAVE_ARRAY_H
+#define PHASE_WAVE_ARRAY_H
+
+#include "simd.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Kinematic engine for large grids of suspended shapes (e.g. 1000 x 1000). Every element gets a
+// height offset, a spin angle and the two morph exponents, each driven by a sum of phase waves
+// over the element's grid coordinates:
+//
+//     value(x, z, t) = clamp(base + sum_k A_k * sin(kx_k * x + kz_k * z - w_k * t + phase_k))
+//
+// Planar waves are separable, sin(a(x) + b(z)) = sin a cos b + cos a sin b, so a frame only needs
+// one sin/cos per column and per row and each element costs a couple of multiply-adds per wave.
+// Radial waves (ripples around a centre) are not separable and go through the SIMD sine instead.
+// Outputs are written channel by channel (SoA), matching the instance buffer layout on the GPU.
+class PhaseWaveArray
+{
+public:
+    enum Channel { HEIGHT, ROTATION, MORPH_N1, MORPH_N2, CHANNEL_COUNT };
+
+    // waves of each kind per channel; further waves are ignored
+    static constexpr int MAX_WAVES = 8;
+
+    PhaseWaveArray(int width, int depth, float spacing)
+        : width(width), depth(depth), spacing(spacing)
+    {
+        columnX.resize(width);
+        for (int c = 0; c < width; c++)
+            columnX[c] = (c - (width - 1) * 0.5f) * spacing;
+        rowZ.resize(depth);
+        for (int r = 0; r < depth; r++)
+            rowZ[r] = (r - (depth - 1) * 0.5f) * spacing;
+
+        // neutral defaults: flat, still, spheres
+        channels[MORPH_N1].base = channels[MORPH_N2].base = 1.0f;
+        channels[MORPH_N1].minValue = channels[MORPH_N2].minValue = 0.2f;
+        channels[MORPH_N1].maxValue = channels[MORPH_N2].maxValue = 2.0f;
+    }
+
+    int gridWidth() const { return width; }
+    int gridDepth() const { return depth; }
+    size_t size() const { return (size_t)width * depth; }
+    float elementSpacing() const { return spacing; }
+
+    // rest position of element (row, column) in the array's local frame, y = 0
+    float elementX(size_t index) const { return columnX[index % width]; }
+    float elementZ(size_t index) const { return rowZ[index / width]; }
+
+    void setChannelRange(Channel channel, float base, float minValue, float maxValue)
+    {
+        channels[channel].base = base;
+        channels[channel].minValue = minValue;
+        channels[channel].maxValue = maxValue;
+    }
+
+    void clearWaves(Channel channel)
+    {
+        channels[channel].planar.clear();
+        channels[channel].radial.clear();
+        rowTablesBuilt = false;
+        radialCacheValid = false;
+    }
+
+    // travelling plane wave with wave vector (kx, kz) in radians per world unit
+    void addPlanarWave(Channel channel, float amplitude, float kx, float kz, float omega, float phase = 0.0f)
+    {
+        if (channels[channel].planar.size() >= MAX_WAVES)
+            return;
+        channels[channel].planar.push_back(PlanarWave{ amplitude, kx, kz, omega, phase });
+        rowTablesBuilt = false;
+    }
+
+    // circular ripple around (centerX, centerZ) with wave number k
+    void addRadialWave(Channel channel, float amplitude, float k, float omega, float centerX = 0.0f, float centerZ = 0.0f, float phase = 0.0f)
+    {
+        if (channels[channel].radial.size() >= MAX_WAVES)
+            return;
+        channels[channel].radial.push_back(RadialWave{ amplitude, k, omega, phase, centerX, centerZ });
+        radialCacheValid = false;
+    }
+
+    // evaluates the channels at time t; out[channel] must hold size() floats, or be null to skip
+    // a channel whose values come from elsewhere
+    void evaluate(float t, ThreadPool& pool, float* const out[CHANNEL_COUNT])
+    {
+        prepareFrame(t);
+
+        // rows are independent; keep chunks large enough to amortise dispatch on small grids
+        size_t rowsPerChunk = std::max<size_t>(1, 16384 / std::max(1, width));
+        pool.parallelFor(depth, rowsPerChunk, [&](size_t rowBegin, size_t rowEnd) {
+            for (size_t r = rowBegin; r < rowEnd; r++)
+                for (int ch = 0; ch < CHANNEL_COUNT; ch++)
+                    if (out[ch])
+                        evaluateRow(ch, (int)r, out[ch] + r * width);
+        });
+    }
+
+private:
+    struct PlanarWave
+    {
+        float amplitude, kx, kz, omega, phase;
+    };
+    struct RadialWave
+    {
+        float amplitude, k, omega, phase, centerX, centerZ;
+    };
+    struct WaveChannel
+    {
+        float base = 0.0f;
+        float minValue = -1e30f;
+        float maxValue = 1e30f;
+        std::vector<PlanarWave> planar;
+        std::vector<RadialWave> radial;
+    };
+
+    int width, depth;
+    float spacing;
+    std::vector<float> columnX, rowZ;
+    WaveChannel channels[CHANNEL_COUNT];
+
+    // per-frame tables for the separable planar waves, laid out [wave][column] / [wave][row]
+    std::vector<float> columnSin, columnCos, rowSin, rowCos;
+    std::vector<int> planarOffset; // first planar wave of each channel in the tables
+    float frameTime = -1.0f;
+    bool rowTablesBuilt = false;
+
+    // distance of every element from each radial wave centre, [wave][element]; static
+    std::vector<float> radialDistance;
+    std::vector<int> radialOffset;
+    bool radialCacheValid = false;
+
+    void prepareFrame(float t)
+    {
+        planarOffset.assign(CHANNEL_COUNT + 1, 0);
+        for (int ch = 0; ch < CHANNEL_COUNT; ch++)
+            planarOffset[ch + 1] = planarOffset[ch] + (int)channels[ch].planar.size();
+        int planarCount = planarOffset[CHANNEL_COUNT];
+
+        // column terms carry the time dependency and the amplitude: A * sin/cos(kx * x - w * t + phase)
+        columnSin.resize((size_t)planarCount * width);
+        columnCos.resize((size_t)planarCount * width);
+        for (int ch = 0; ch < CHANNEL_COUNT; ch++)
+            for (size_t w = 0; w < channels[ch].planar.size(); w++)
+            {
+                const PlanarWave& wave = channels[ch].planar[w];
+                float* s = &columnSin[(planarOffset[ch] + w) * width];
+                float* c = &columnCos[(planarOffset[ch] + w) * width];
+                for (int col = 0; col < width; col++)
+                {
+                    float a = wave.kx * columnX[col] - wave.omega * t + wave.phase;
+                    s[col] = wave.amplitude * std::sin(a);
+                    c[col] = wave.amplitude * std::cos(a);
+                }
+            }
+
+        // row terms do not depend on time; rebuild only when the wave set changes
+        if (!rowTablesBuilt)
+        {
+            rowSin.resize((size_t)planarCount * depth);
+            rowCos.resize((size_t)planarCount * depth);
+            for (int ch = 0; ch < CHANNEL_COUNT; ch++)
+                for (size_t w = 0; w < channels[ch].planar.size(); w++)
+                {
+                    const PlanarWave& wave = channels[ch].planar[w];
+                    for (int row = 0; row < depth; row++)
+                    {
+                        rowSin[(planarOffset[ch] + w) * depth + row] = std::sin(wave.kz * rowZ[row]);
+                        rowCos[(planarOffset[ch] + w) * depth + row] = std::cos(wave.kz * rowZ[row]);
+                    }
+                }
+            rowTablesBuilt = true;
+        }
+
+        if (!radialCacheValid)
+        {
+            radialOffset.assign(CHANNEL_COUNT + 1, 0);
+            for (int ch = 0; ch < CHANNEL_COUNT; ch++)
+                radialOffset[ch + 1] = radialOffset[ch] + (int)channels[ch].radial.size();
+            radialDistance.resize((size_t)radialOffset[CHANNEL_COUNT] * size());
+            for (int ch = 0; ch < CHANNEL_COUNT; ch++)
+                for (size_t w = 0; w < channels[ch].radial.size(); w++)
+                {
+                    const RadialWave& wave = channels[ch].radial[w];
+                    float* d = &radialDistance[(radialOffset[ch] + w) * size()];
+                    for (size_t i = 0; i < size(); i++)
+                    {
+                        float dx = elementX(i) - wave.centerX, dz = elementZ(i) - wave.centerZ;
+                        d[i] = std::sqrt(dx * dx + dz * dz);
+                    }
+                }
+            radialCacheValid = true;
+        }
+        frameTime = t;
+    }
+
+    void evaluateRow(int ch, int row, float* out) const
+    {
+        using simd::float4;
+        const WaveChannel& channel = channels[ch];
+        const int planarCount = (int)channel.planar.size();
+        const int radialCount = (int)channel.radial.size();
+
+        // gather the per-row wave constants once, then stream each element through all waves
+        // while it sits in a register
+        const float* sA[MAX_WAVES];
+        const float* cA[MAX_WAVES];
+        float sB[MAX_WAVES], cB[MAX_WAVES];
+        for (int w = 0; w < planarCount && w < MAX_WAVES; w++)
+        {
+            size_t wave = planarOffset[ch] + w;
+            sA[w] = &columnSin[wave * width];
+            cA[w] = &columnCos[wave * width];
+            sB[w] = rowSin[wave * depth + row];
+            cB[w] = rowCos[wave * depth + row];
+        }
+        const float* d[MAX_WAVES];
+        float k[MAX_WAVES], shift[MAX_WAVES], amp[MAX_WAVES];
+        for (int w = 0; w < radialCount && w < MAX_WAVES; w++)
+        {
+            const RadialWave& wave = channel.radial[w];
+            d[w] = &radialDistance[(radialOffset[ch] + w) * size() + (size_t)row * width];
+            k[w] = wave.k;
+            shift[w] = wave.phase - wave.omega * frameTime;
+            amp[w] = wave.amplitude;
+        }
+        const int planarUsed = std::min(planarCount, (int)MAX_WAVES);
+        const int radialUsed = std::min(radialCount, (int)MAX_WAVES);
+
+        const float4 base(channel.base), lo(channel.minValue), hi(channel.maxValue);
+        int simdEnd = width & ~3;
+        for (int c = 0; c < simdEnd; c += 4)
+        {
+            // planar: A sin(a + b) = (A sin a) cos b + (A cos a) sin b
+            float4 acc = base;
+            for (int w = 0; w < planarUsed; w++)
+            {
+                acc = simd::madd(float4::load(sA[w] + c), float4(cB[w]), acc);
+                acc = simd::madd(float4::load(cA[w] + c), float4(sB[w]), acc);
+            }
+            // radial: A sin(k r + shift)
+            for (int w = 0; w < radialUsed; w++)
+                acc = simd::madd(float4(amp[w]), simd::sin(simd::madd(float4::load(d[w] + c), float4(k[w]), float4(shift[w]))), acc);
+            simd::clamp(acc, lo, hi).store(out + c);
+        }
+        for (int c = simdEnd; c < width; c++)
+        {
+            float acc = channel.base;
+            for (int w = 0; w < planarUsed; w++)
+                acc += sA[w][c] * cB[w] + cA[w][c] * sB[w];
+            for (int w = 0; w < radialUsed; w++)
+                acc += amp[w] * std::sin(d[w][c] * k[w] + shift[w]);
+            out[c] = std::min(std::max(acc, channel.minValue), channel.maxValue);
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef PROXIMITY_MORPH_H
+#define PROXIMITY_MORPH_H
+
+#include <glm/glm.hpp>
+
+#include "spatial_hash.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Per-instance morph intensity that rises as a visitor comes close and fades after they leave.
+//
+// Instances are kept in a SpatialHash; every frame one radius query around the visitor sets the
+// targets, and only the "active" instances (inside the radius or still fading out) are eased
+// towards them. Frame cost therefore depends on how many instances are near the visitor, not on
+// how many there are. The instances whose value changed are reported as runs of consecutive
+// indices so the renderer can upload just those ranges of the attribute buffer.
+class ProximityMorph
+{
+public:
+    // consecutive instances [first, first + count) whose intensity changed this frame
+    struct Run
+    {
+        size_t first, count;
+    };
+
+    float radius = 2.0f;
+    // 1 / seconds; intensity closes ~63% of the gap to its target per 1 / response seconds
+    float response = 4.0f;
+
+    void setPositions(const glm::vec3* positions, size_t count)
+    {
+        hash.reset(radius, count);
+        for (size_t i = 0; i < count; i++)
+            hash.insert(positions[i]);
+        values.assign(count, 0.0f);
+        activeSlot.assign(count, NOT_ACTIVE);
+        active.clear();
+        runs.clear();
+    }
+
+    void setPosition(size_t i, const glm::vec3& position) { hash.update((unsigned int)i, position); }
+
+    size_t size() const { return values.size(); }
+    const float* intensities() const { return values.data(); }
+    size_t activeCount() const { return active.size(); }
+
+    // eases the instances around visitor and returns the changed ranges of intensities()
+    const std::vector<Run>& update(const glm::vec3& visitor, float deltaTime)
+    {
+        for (Active& a : active)
+            a.target = 0.0f;
+        hash.query(visitor, radius, [&](unsigned int i, float distanceSquared) {
+            if (activeSlot[i] == NOT_ACTIVE)
+            {
+                activeSlot[i] = (unsigned int)active.size();
+                active.push_back(Active{ i, 0.0f });
+            }
+            // smooth falloff, 1 at the visitor and 0 with zero slope at the radius
+            float f = 1.0f - distanceSquared / (radius * radius);
+            active[activeSlot[i]].target = f * f;
+        });
+
+        changed.clear();
+        float blend = 1.0f - std::exp(-response * deltaTime);
+        for (size_t k = 0; k < active.size();)
+        {
+            unsigned int i = active[k].instance;
+            float& value = values[i];
+            value += (active[k].target - value) * blend;
+            changed.push_back(i);
+            if (active[k].target == 0.0f && value < 1e-3f)
+            {
+                // faded out; swap-remove keeps the active list dense
+                value = 0.0f;
+                activeSlot[i] = NOT_ACTIVE;
+                Active last = active.back();
+                active.pop_back();
+                if (k < active.size())
+                {
+                    active[k] = last;
+                    activeSlot[last.instance] = (unsigned int)k;
+                }
+                continue;
+            }
+            k++;
+        }
+
+        // merge nearby indices so a grid row near the visitor becomes one upload
+        std::sort(changed.begin(), changed.end());
+        runs.clear();
+        for (unsigned int i : changed)
+        {
+            if (!runs.empty() && i <= runs.back().first + runs.back().count + RUN_GAP)
+                runs.back().count = i + 1 - runs.back().first;
+            else
+                runs.push_back(Run{ i, 1 });
+        }
+        return runs;
+    }
+
+private:
+    static constexpr unsigned int NOT_ACTIVE = 0xFFFFFFFFu;
+    // unchanged instances worth re-uploading to avoid splitting a run
+    static constexpr unsigned int RUN_GAP = 8;
+
+    struct Active
+    {
+        unsigned int instance;
+        float target;
+    };
+
+    SpatialHash hash;
+    std::vector<float> values;
+    std::vector<unsigned int> activeSlot; // index into active, or NOT_ACTIVE
+    std::vector<Active> active;
+    std::vector<unsigned int> changed;
+    std::vector<Run> runs;
+};
+
+#endif
@@ -0,0 +1,863 @@
+#ifndef SCENE_FILE_H
+#define SCENE_FILE_H
+
+#include "animation_curves.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// An installation layout on disk: camera, sculpture shape, lights, spawned objects, pattern
+// instances and the show's animation channels.
+//
+// The binary file is laid out to be used where it lies. A fixed header and a table of sections,
+// each an array of fixed-size records in the writer's byte order starting at a multiple of
+// ALIGNMENT bytes, are followed by the arrays themselves. open() maps the file read-only and checks the header and the
+// table, and the instance arrays are then read straight from the mapped pages, e.g. uploaded with
+// glBufferData from contents().instances, without parsing or copying; only the few channel names
+// and keys are turned into objects. The file must stay open while anything still reads from it.
+//
+//   header   "SUPERSCN", version, byte order tag 0x01020304, section count, file size
+//   table    per section: type, record size, offset, record count
+//   sections CAMERA, SHAPE, LIGHTS, SPAWNED (xyz), INSTANCES (xyz), CHANNELS, KEYS, NAMES (bytes)
+//
+// Readers reject files of a newer version or another byte order, skip section types they do not
+// know and accept records larger than theirs (fields appended by a newer minor revision). Both
+// readers reject NaN and infinities anywhere in the contents: clamping would pass them through and
+// a NaN key time would break the channels' ordering. save()
+// writes next to the target and renames, so a file that is mapped keeps its contents.
+//
+// exportJson() and importJson() carry the same contents as JSON for editing by hand or by script.
+class SceneFile
+{
+public:
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t ALIGNMENT = 64;
+
+    struct Camera
+    {
+        float position[3];
+        float yaw, pitch, zoom;
+    };
+
+    // held: the exponents replace the drive train's (bit 0 n1, bit 1 n2), as /morph does
+    struct Shape
+    {
+        float n1, n2;
+        uint32_t held;
+    };
+
+    // held: bit 0 the position, bit 1 the intensity replace the animated ones, as /light does
+    struct Light
+    {
+        float position[3];
+        float intensity;
+        uint32_t held;
+    };
+
+    struct Channel
+    {
+        std::string name;
+        bool loop = false;
+        std::vector<AnimationCurves::Key> keys;
+    };
+
+    // spawned and instances are xyz triples: in the mapped file after open(), in ownedSpawned and
+    // ownedInstances after importJson(), or wherever the caller points them before saving
+    struct Contents
+    {
+        Camera camera = {};
+        Shape shape = {};
+        std::vector<Light> lights;
+        const float* spawned = nullptr;
+        size_t spawnedCount = 0;
+        const float* instances = nullptr;
+        size_t instanceCount = 0;
+        std::vector<Channel> channels;
+        std::vector<float> ownedSpawned, ownedInstances;
+    };
+
+    SceneFile() {}
+    SceneFile(const SceneFile&) = delete;
+    SceneFile& operator=(const SceneFile&) = delete;
+    ~SceneFile() { close(); }
+
+    // maps path and validates it; false (with error()) if it is not a scene this reader understands
+    bool open(const char* path)
+    {
+        close();
+        errorMessage.clear();
+        if (!map(path))
+            return false;
+        if (!readContents())
+        {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    bool isOpen() const { return base != nullptr; }
+    const Contents& contents() const { return scene; }
+    size_t fileBytes() const { return mappedBytes; }
+    const std::string& error() const { return errorMessage; }
+
+    void close()
+    {
+        if (base)
+        {
+#ifdef _WIN32
+            UnmapViewOfFile(base);
+#else
+            munmap((void*)base, mappedBytes);
+#endif
+        }
+        base = nullptr;
+        mappedBytes = 0;
+        scene = Contents();
+    }
+
+    static bool save(const char* path, const Contents& scene)
+    {
+        Section sections[SECTION_TYPES];
+        size_t sectionCount = 0;
+        std::vector<ChannelRecord> channelRecords;
+        std::vector<KeyRecord> keyRecords;
+        std::string names;
+        for (const Channel& channel : scene.channels)
+        {
+            ChannelRecord record = { (uint32_t)names.size(), (uint32_t)channel.name.size(), (uint32_t)keyRecords.size(),
+                (uint32_t)channel.keys.size(), channel.loop ? 1u : 0u };
+            channelRecords.push_back(record);
+            names += channel.name;
+            for (const AnimationCurves::Key& key : channel.keys)
+            {
+                KeyRecord k = { key.time, key.value, (uint32_t)key.interpolation, key.inSlope, key.outSlope,
+                    { key.inHandle.x, key.inHandle.y }, { key.outHandle.x, key.outHandle.y } };
+                keyRecords.push_back(k);
+            }
+        }
+
+        // every section's data, in file order
+        struct Pending
+        {
+            uint32_t type;
+            uint32_t recordBytes;
+            const void* data;
+            size_t count;
+        } pending[] = {
+            { CAMERA, sizeof(Camera), &scene.camera, 1 },
+            { SHAPE, sizeof(Shape), &scene.shape, 1 },
+            { LIGHTS, sizeof(Light), scene.lights.data(), scene.lights.size() },
+            { SPAWNED, 3 * sizeof(float), scene.spawned, scene.spawnedCount },
+            { INSTANCES, 3 * sizeof(float), scene.instances, scene.instanceCount },
+            { CHANNELS, sizeof(ChannelRecord), channelRecords.data(), channelRecords.size() },
+            { KEYS, sizeof(KeyRecord), keyRecords.data(), keyRecords.size() },
+            { NAMES, 1, names.data(), names.size() },
+        };
+        size_t offset = align(sizeof(Header) + sizeof(pending) / sizeof(pending[0]) * sizeof(Section));
+        for (const Pending& p : pending)
+        {
+            sections[sectionCount++] = Section{ p.type, p.recordBytes, (uint64_t)offset, (uint64_t)p.count };
+            offset = align(offset + p.count * p.recordBytes);
+        }
+        Header header;
+        std::memcpy(header.magic, MAGIC, sizeof(header.magic));
+        header.version = VERSION;
+        header.byteOrder = BYTE_ORDER_TAG;
+        header.sectionCount = (uint32_t)sectionCount;
+        header.reserved = 0;
+        header.fileBytes = offset;
+
+        std::string temporary = std::string(path) + ".tmp";
+        FILE* file = std::fopen(temporary.c_str(), "wb");
+        if (!file)
+            return false;
+        bool written = std::fwrite(&header, sizeof(header), 1, file) == 1
+            && std::fwrite(sections, sizeof(Section), sectionCount, file) == sectionCount;
+        size_t position = sizeof(header) + sectionCount * sizeof(Section);
+        for (size_t s = 0; s < sectionCount && written; s++)
+        {
+            written = pad(file, position, (size_t)sections[s].offset);
+            size_t bytes = (size_t)(sections[s].count * sections[s].recordBytes);
+            if (written && bytes > 0)
+                written = std::fwrite(pending[s].data, 1, bytes, file) == bytes;
+            position += bytes;
+        }
+        written = written && pad(file, position, (size_t)header.fileBytes);
+        written = std::fclose(file) == 0 && written;
+        if (!written)
+        {
+            std::remove(temporary.c_str());
+            return false;
+        }
+#ifdef _WIN32
+        return MoveFileExA(temporary.c_str(), path, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+        return std::rename(temporary.c_str(), path) == 0;
+#endif
+    }
+
+    // true if path exists and was modified after than, or than does not exist (one-second resolution)
+    static bool isNewer(const char* path, const char* than)
+    {
+        struct stat a, b;
+        if (stat(path, &a) != 0)
+            return false;
+        return stat(than, &b) != 0 || a.st_mtime > b.st_mtime;
+    }
+
+    static bool exportJson(const char* path, const Contents& scene)
+    {
+        FILE* file = std::fopen(path, "w");
+        if (!file)
+            return false;
+        const Camera& camera = scene.camera;
+        std::fprintf(file, "{\n  \"format\": \"superellipsoid scene\",\n  \"version\": %u,\n", VERSION);
+        std::fprintf(file, "  \"camera\": { \"position\": [%.9g, %.9g, %.9g], \"yaw\": %.9g, \"pitch\": %.9g, \"zoom\": %.9g },\n",
+            camera.position[0], camera.position[1], camera.position[2], camera.yaw, camera.pitch, camera.zoom);
+        std::fprintf(file, "  \"shape\": { \"n1\": %.9g, \"n2\": %.9g, \"heldN1\": %s, \"heldN2\": %s },\n",
+            scene.shape.n1, scene.shape.n2, (scene.shape.held & 1) ? "true" : "false", (scene.shape.held & 2) ? "true" : "false");
+        std::fprintf(file, "  \"lights\": [");
+        for (size_t i = 0; i < scene.lights.size(); i++)
+        {
+            const Light& light = scene.lights[i];
+            std::fprintf(file, "%s\n    { \"position\": [%.9g, %.9g, %.9g], \"intensity\": %.9g, \"heldPosition\": %s, \"heldIntensity\": %s }",
+                i == 0 ? "" : ",", light.position[0], light.position[1], light.position[2], light.intensity,
+                (light.held & 1) ? "true" : "false", (light.held & 2) ? "true" : "false");
+        }
+        std::fprintf(file, "\n  ],\n");
+        writePoints(file, "spawned", scene.spawned, scene.spawnedCount);
+        writePoints(file, "instances", scene.instances, scene.instanceCount);
+        std::fprintf(file, "  \"channels\": [");
+        for (size_t c = 0; c < scene.channels.size(); c++)
+        {
+            const Channel& channel = scene.channels[c];
+            std::fprintf(file, "%s\n    { \"name\": ", c == 0 ? "" : ",");
+            writeString(file, channel.name);
+            std::fprintf(file, ", \"loop\": %s, \"keys\": [", channel.loop ? "true" : "false");
+            for (size_t k = 0; k < channel.keys.size(); k++)
+            {
+                const AnimationCurves::Key& key = channel.keys[k];
+                std::fprintf(file, "%s\n      { \"time\": %.9g, \"value\": %.9g, \"interpolation\": \"%s\"", k == 0 ? "" : ",",
+                    key.time, key.value, INTERPOLATION_NAMES[key.interpolation]);
+                if (key.interpolation == AnimationCurves::HERMITE)
+                    std::fprintf(file, ", \"inSlope\": %.9g, \"outSlope\": %.9g", key.inSlope, key.outSlope);
+                if (key.interpolation == AnimationCurves::BEZIER)
+                    std::fprintf(file, ", \"inHandle\": [%.9g, %.9g], \"outHandle\": [%.9g, %.9g]",
+                        key.inHandle.x, key.inHandle.y, key.outHandle.x, key.outHandle.y);
+                std::fprintf(file, " }");
+            }
+            std::fprintf(file, "%s]%s", channel.keys.empty() ? "" : "\n    ", " }");
+        }
+        std::fprintf(file, "\n  ]\n}\n");
+        return std::fclose(file) == 0;
+    }
+
+    // reads what exportJson() writes; members may come in any order and unknown ones are skipped.
+    // false, with error, at the first thing that is not valid JSON of that shape
+    static bool importJson(const char* path, Contents& scene, std::string& error)
+    {
+        FILE* file = std::fopen(path, "rb");
+        if (!file)
+        {
+            error = std::string("cannot open ") + path;
+            return false;
+        }
+        std::string text;
+        char buffer[65536];
+        size_t got;
+        while ((got = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+            text.append(buffer, got);
+        std::fclose(file);
+
+        scene = Contents();
+        JsonReader json(text);
+        bool ok = json.object([&](const std::string& member) {
+            if (member == "camera")
+                return json.object([&](const std::string& field) {
+                    if (field == "position")
+                        return json.numbers(scene.camera.position, 3);
+                    if (field == "yaw")
+                        return json.number(scene.camera.yaw);
+                    if (field == "pitch")
+                        return json.number(scene.camera.pitch);
+                    if (field == "zoom")
+                        return json.number(scene.camera.zoom);
+                    return json.skip();
+                });
+            if (member == "shape")
+                return json.object([&](const std::string& field) {
+                    if (field == "n1")
+                        return json.number(scene.shape.n1);
+                    if (field == "n2")
+                        return json.number(scene.shape.n2);
+                    if (field == "heldN1")
+                        return json.flag(scene.shape.held, 1);
+                    if (field == "heldN2")
+                        return json.flag(scene.shape.held, 2);
+                    return json.skip();
+                });
+            if (member == "lights")
+                return json.array([&] {
+                    scene.lights.push_back(Light());
+                    Light& light = scene.lights.back();
+                    return json.object([&](const std::string& field) {
+                        if (field == "position")
+                            return json.numbers(light.position, 3);
+                        if (field == "intensity")
+                            return json.number(light.intensity);
+                        if (field == "heldPosition")
+                            return json.flag(light.held, 1);
+                        if (field == "heldIntensity")
+                            return json.flag(light.held, 2);
+                        return json.skip();
+                    });
+                });
+            if (member == "spawned" || member == "instances")
+            {
+                std::vector<float>& points = member == "spawned" ? scene.ownedSpawned : scene.ownedInstances;
+                return json.array([&] {
+                    points.resize(points.size() + 3);
+                    return json.numbers(&points[points.size() - 3], 3);
+                });
+            }
+            if (member == "channels")
+                return json.array([&] {
+                    scene.channels.push_back(Channel());
+                    Channel& channel = scene.channels.back();
+                    return json.object([&](const std::string& field) {
+                        if (field == "name")
+                            return json.string(channel.name);
+                        if (field == "loop")
+                            return json.boolean(channel.loop);
+                        if (field == "keys")
+                            return json.array([&] {
+                                channel.keys.push_back(AnimationCurves::Key());
+                                return readKey(json, channel.keys.back());
+                            });
+                        return json.skip();
+                    });
+                });
+            if (member == "version")
+            {
+                float version = 0.0f;
+                if (!json.number(version))
+                    return false;
+                if (version > VERSION)
+                    return json.fail("written by a newer version");
+                return true;
+            }
+            return json.skip();
+        });
+        if (ok)
+            ok = json.end();
+        if (!ok)
+        {
+            error = json.error();
+            scene = Contents();
+            return false;
+        }
+        scene.spawned = scene.ownedSpawned.data();
+        scene.spawnedCount = scene.ownedSpawned.size() / 3;
+        scene.instances = scene.ownedInstances.data();
+        scene.instanceCount = scene.ownedInstances.size() / 3;
+        return true;
+    }
+
+private:
+    enum SectionType : uint32_t { CAMERA = 1, SHAPE, LIGHTS, SPAWNED, INSTANCES, CHANNELS, KEYS, NAMES, SECTION_TYPES_END };
+    static constexpr size_t SECTION_TYPES = SECTION_TYPES_END - 1;
+    static constexpr uint32_t BYTE_ORDER_TAG = 0x01020304;
+    static constexpr const char* MAGIC = "SUPERSCN";
+
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t byteOrder;
+        uint32_t sectionCount;
+        uint32_t reserved;
+        uint64_t fileBytes;
+    };
+
+    struct Section
+    {
+        uint32_t type;
+        uint32_t recordBytes;
+        uint64_t offset;
+        uint64_t count;
+    };
+
+    struct ChannelRecord
+    {
+        uint32_t nameOffset, nameBytes; // into NAMES
+        uint32_t firstKey, keyCount;    // into KEYS
+        uint32_t loop;
+    };
+
+    struct KeyRecord
+    {
+        float time, value;
+        uint32_t interpolation; // AnimationCurves::Interpolation
+        float inSlope, outSlope;
+        float inHandle[2], outHandle[2];
+    };
+
+    static constexpr const char* INTERPOLATION_NAMES[4] = { "step", "linear", "hermite", "bezier" };
+
+    const unsigned char* base = nullptr;
+    size_t mappedBytes = 0;
+    Contents scene;
+    std::string errorMessage;
+
+    static size_t align(size_t offset) { return (offset + ALIGNMENT - 1) & ~(ALIGNMENT - 1); }
+
+    static bool pad(FILE* file, size_t& position, size_t to)
+    {
+        static const char zeros[ALIGNMENT] = {};
+        size_t bytes = to - position;
+        position = to;
+        return bytes == 0 || std::fwrite(zeros, 1, bytes, file) == bytes;
+    }
+
+    bool map(const char* path)
+    {
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return fail(std::string("cannot open ") + path);
+        LARGE_INTEGER size;
+        GetFileSizeEx(file, &size);
+        HANDLE mapping = size.QuadPart > 0 ? CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+        CloseHandle(file);
+        if (!mapping)
+            return fail(std::string("cannot map ") + path);
+        base = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mapping);
+        if (!base)
+            return fail(std::string("cannot map ") + path);
+        mappedBytes = (size_t)size.QuadPart;
+#else
+        int file = ::open(path, O_RDONLY);
+        if (file < 0)
+            return fail(std::string("cannot open ") + path);
+        struct stat info;
+        if (fstat(file, &info) != 0 || info.st_size <= 0)
+        {
+            ::close(file);
+            return fail(std::string("cannot map ") + path);
+        }
+        void* pages = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        ::close(file);
+        if (pages == MAP_FAILED)
+            return fail(std::string("cannot map ") + path);
+        base = (const unsigned char*)pages;
+        mappedBytes = (size_t)info.st_size;
+#endif
+        return true;
+    }
+
+    bool fail(const std::string& message)
+    {
+        errorMessage = message;
+        return false;
+    }
+
+    // the section of a type, checked against the file; nullptr if absent
+    const Section* find(uint32_t type, size_t recordBytes, bool exactRecord)
+    {
+        const Header* header = (const Header*)base;
+        const Section* table = (const Section*)(base + sizeof(Header));
+        for (uint32_t s = 0; s < header->sectionCount; s++)
+            if (table[s].type == type)
+            {
+                const Section& section = table[s];
+                bool sized = exactRecord ? section.recordBytes == recordBytes : section.recordBytes >= recordBytes;
+                if (!sized || section.offset % 4 != 0 || section.offset > mappedBytes
+                    || (section.recordBytes > 0 && section.count > (mappedBytes - section.offset) / section.recordBytes))
+                {
+                    fail("section " + std::to_string(type) + " does not fit the file");
+                    return nullptr;
+                }
+                return &section;
+            }
+        return nullptr;
+    }
+
+    bool readContents()
+    {
+        if (mappedBytes < sizeof(Header))
+            return fail("too short for a scene");
+        const Header* header = (const Header*)base;
+        if (std::memcmp(header->magic, MAGIC, sizeof(header->magic)) != 0)
+            return fail("not a scene file");
+        if (header->byteOrder != BYTE_ORDER_TAG)
+            return fail("written with another byte order");
+        if (header->version > VERSION)
+            return fail("written by a newer version (" + std::to_string(header->version) + ")");
+        if (header->fileBytes != mappedBytes || header->sectionCount > (mappedBytes - sizeof(Header)) / sizeof(Section))
+            return fail("truncated");
+
+        // the fixed records are copied out; a newer, larger record keeps its known prefix
+        const Section* section;
+        if ((section = find(CAMERA, sizeof(Camera), false)) && section->count > 0)
+            std::memcpy(&scene.camera, base + section->offset, sizeof(Camera));
+        if ((section = find(SHAPE, sizeof(Shape), false)) && section->count > 0)
+            std::memcpy(&scene.shape, base + section->offset, sizeof(Shape));
+        if ((section = find(LIGHTS, sizeof(Light), false)))
+        {
+            scene.lights.resize((size_t)section->count);
+            for (size_t i = 0; i < scene.lights.size(); i++)
+                std::memcpy(&scene.lights[i], base + section->offset + i * section->recordBytes, sizeof(Light));
+        }
+        // the instance arrays stay in the mapping
+        if ((section = find(SPAWNED, 3 * sizeof(float), true)))
+        {
+            scene.spawned = (const float*)(base + section->offset);
+            scene.spawnedCount = (size_t)section->count;
+        }
+        if ((section = find(INSTANCES, 3 * sizeof(float), true)))
+        {
+            scene.instances = (const float*)(base + section->offset);
+            scene.instanceCount = (size_t)section->count;
+        }
+        const Camera& camera = scene.camera;
+        if (!allFinite(camera.position, 3) || !std::isfinite(camera.yaw) || !std::isfinite(camera.pitch) || !std::isfinite(camera.zoom))
+            return fail("camera is not finite");
+        if (!std::isfinite(scene.shape.n1) || !std::isfinite(scene.shape.n2))
+            return fail("shape is not finite");
+        for (size_t i = 0; i < scene.lights.size(); i++)
+            if (!allFinite(scene.lights[i].position, 3) || !std::isfinite(scene.lights[i].intensity))
+                return fail("light " + std::to_string(i) + " is not finite");
+        if (!allFinite(scene.spawned, scene.spawnedCount * 3))
+            return fail("spawned positions are not finite");
+        if (!allFinite(scene.instances, scene.instanceCount * 3))
+            return fail("instance positions are not finite");
+        const Section* channels = find(CHANNELS, sizeof(ChannelRecord), false);
+        const Section* keys = find(KEYS, sizeof(KeyRecord), false);
+        const Section* names = find(NAMES, 1, true);
+        if (!errorMessage.empty())
+            return false;
+        for (size_t c = 0; channels && c < channels->count; c++)
+        {
+            ChannelRecord record;
+            std::memcpy(&record, base + channels->offset + c * channels->recordBytes, sizeof(record));
+            if (!keys || !names || (uint64_t)record.firstKey + record.keyCount > keys->count
+                || (uint64_t)record.nameOffset + record.nameBytes > names->count)
+                return fail("channel " + std::to_string(c) + " refers outside its sections");
+            Channel channel;
+            channel.name.assign((const char*)base + names->offset + record.nameOffset, record.nameBytes);
+            channel.loop = record.loop != 0;
+            for (uint32_t k = 0; k < record.keyCount; k++)
+            {
+                KeyRecord r;
+                std::memcpy(&r, base + keys->offset + (size_t)(record.firstKey + k) * keys->recordBytes, sizeof(r));
+                if (!std::isfinite(r.time) || !std::isfinite(r.value) || !std::isfinite(r.inSlope) || !std::isfinite(r.outSlope)
+                    || !allFinite(r.inHandle, 2) || !allFinite(r.outHandle, 2))
+                    return fail("channel " + std::to_string(c) + " key " + std::to_string(k) + " is not finite");
+                AnimationCurves::Key key;
+                key.time = r.time;
+                key.value = r.value;
+                key.interpolation = r.interpolation <= AnimationCurves::BEZIER ? (AnimationCurves::Interpolation)r.interpolation : AnimationCurves::LINEAR;
+                key.inSlope = r.inSlope;
+                key.outSlope = r.outSlope;
+                key.inHandle = glm::vec2(r.inHandle[0], r.inHandle[1]);
+                key.outHandle = glm::vec2(r.outHandle[0], r.outHandle[1]);
+                channel.keys.push_back(key);
+            }
+            scene.channels.push_back(channel);
+        }
+        return true;
+    }
+
+    static bool allFinite(const float* values, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+            if (!std::isfinite(values[i]))
+                return false;
+        return true;
+    }
+
+    static void writePoints(FILE* file, const char* name, const float* xyz, size_t count)
+    {
+        std::fprintf(file, "  \"%s\": [", name);
+        for (size_t i = 0; i < count; i++)
+            std::fprintf(file, "%s[%.9g, %.9g, %.9g]", i == 0 ? "\n    " : ",\n    ", xyz[i * 3], xyz[i * 3 + 1], xyz[i * 3 + 2]);
+        std::fprintf(file, "%s],\n", count > 0 ? "\n  " : "");
+    }
+
+    static void writeString(FILE* file, const std::string& text)
+    {
+        std::fputc('"', file);
+        for (char c : text)
+        {
+            if (c == '"' || c == '\\')
+                std::fprintf(file, "\\%c", c);
+            else if ((unsigned char)c < 0x20)
+                std::fprintf(file, "\\u%04x", (unsigned int)(unsigned char)c);
+            else
+                std::fputc(c, file);
+        }
+        std::fputc('"', file);
+    }
+
+    // a pull parser for the parts of JSON scenes use: the caller says what it expects next
+    class JsonReader
+    {
+    public:
+        explicit JsonReader(const std::string& text) : at(text.c_str()), start(text.c_str()), finish(text.c_str() + text.size()) {}
+
+        // calls member(name) with the reader on each member's value
+        template <typename Fn>
+        bool object(Fn member)
+        {
+            if (!expect('{'))
+                return false;
+            if (peek('}'))
+                return expect('}');
+            do
+            {
+                std::string name;
+                if (!string(name) || !expect(':') || !member(name))
+                    return false;
+            } while (accept(','));
+            return expect('}');
+        }
+
+        // calls element() with the reader on each element
+        template <typename Fn>
+        bool array(Fn element)
+        {
+            if (!expect('['))
+                return false;
+            if (peek(']'))
+                return expect(']');
+            do
+            {
+                if (!element())
+                    return false;
+            } while (accept(','));
+            return expect(']');
+        }
+
+        bool number(float& value)
+        {
+            skipSpace();
+            char* end;
+            double parsed = std::strtod(at, &end);
+            if (end == at)
+                return fail("number expected");
+            at = end;
+            value = (float)parsed;
+            // strtod takes "nan" and "inf", and a large double becomes an infinite float
+            return std::isfinite(value) || fail("finite number expected");
+        }
+
+        bool numbers(float* values, int count)
+        {
+            int read = 0;
+            bool ok = array([&] {
+                if (read == count)
+                    return fail("too many numbers");
+                return number(values[read++]);
+            });
+            return ok && (read == count || fail("too few numbers"));
+        }
+
+        bool boolean(bool& value)
+        {
+            skipSpace();
+            if (finish - at >= 4 && std::strncmp(at, "true", 4) == 0)
+            {
+                at += 4;
+                value = true;
+                return true;
+            }
+            if (finish - at >= 5 && std::strncmp(at, "false", 5) == 0)
+            {
+                at += 5;
+                value = false;
+                return true;
+            }
+            return fail("true or false expected");
+        }
+
+        bool flag(uint32_t& flags, uint32_t bit)
+        {
+            bool value = false;
+            if (!boolean(value))
+                return false;
+            flags = value ? (flags | bit) : (flags & ~bit);
+            return true;
+        }
+
+        bool string(std::string& value)
+        {
+            if (!expect('"'))
+                return false;
+            value.clear();
+            while (at < finish && *at != '"')
+            {
+                char c = *at++;
+                if (c == '\\' && at < finish)
+                {
+                    char e = *at++;
+                    if (e == 'n')
+                        c = '\n';
+                    else if (e == 't')
+                        c = '\t';
+                    else if (e == 'u' && finish - at >= 4)
+                    {
+                        // names are ASCII; other code points become '?'
+                        unsigned int code = (unsigned int)std::strtoul(std::string(at, 4).c_str(), nullptr, 16);
+                        at += 4;
+                        c = code < 0x80 ? (char)code : '?';
+                    }
+                    else
+                        c = e;
+                }
+                value += c;
+            }
+            return expect('"');
+        }
+
+        // any value
+        bool skip()
+        {
+            skipSpace();
+            if (at >= finish)
+                return fail("value expected");
+            if (*at == '{')
+                return object([&](const std::string&) { return skip(); });
+            if (*at == '[')
+                return array([&] { return skip(); });
+            if (*at == '"')
+            {
+                std::string ignored;
+                return string(ignored);
+            }
+            if (*at == 't' || *at == 'f')
+            {
+                bool ignored = false;
+                return boolean(ignored);
+            }
+            if (finish - at >= 4 && std::strncmp(at, "null", 4) == 0)
+            {
+                at += 4;
+                return true;
+            }
+            float ignored;
+            return number(ignored);
+        }
+
+        bool end()
+        {
+            skipSpace();
+            return at == finish || fail("text after the scene");
+        }
+
+        bool fail(const char* problem)
+        {
+            if (message.empty())
+            {
+                int line = 1;
+                for (const char* c = start; c < at && c < finish; c++)
+                    line += *c == '\n';
+                message = std::string(problem) + " on line " + std::to_string(line);
+            }
+            return false;
+        }
+
+        const std::string& error() const { return message; }
+
+    private:
+        const char* at;
+        const char* start;
+        const char* finish;
+        std::string message;
+
+        void skipSpace()
+        {
+            while (at < finish && (*at == ' ' || *at == '\n' || *at == '\r' || *at == '\t'))
+                at++;
+        }
+
+        bool peek(char c)
+        {
+            skipSpace();
+            return at < finish && *at == c;
+        }
+
+        bool accept(char c)
+        {
+            if (!peek(c))
+                return false;
+            at++;
+            return true;
+        }
+
+        bool expect(char c)
+        {
+            if (accept(c))
+                return true;
+            char problem[] = "'?' expected";
+            problem[1] = c;
+            return fail(problem);
+        }
+    };
+
+    static bool readKey(JsonReader& json, AnimationCurves::Key& key)
+    {
+        return json.object([&](const std::string& field) {
+            if (field == "time")
+                return json.number(key.time);
+            if (field == "value")
+                return json.number(key.value);
+            if (field == "inSlope")
+                return json.number(key.inSlope);
+            if (field == "outSlope")
+                return json.number(key.outSlope);
+            if (field == "inHandle" || field == "outHandle")
+            {
+                float handle[2];
+                if (!json.numbers(handle, 2))
+                    return false;
+                (field == "inHandle" ? key.inHandle : key.outHandle) = glm::vec2(handle[0], handle[1]);
+                return true;
+            }
+            if (field == "interpolation")
+            {
+                std::string name;
+                if (!json.string(name))
+                    return false;
+                for (int i = 0; i < 4; i++)
+                    if (name == INTERPOLATION_NAMES[i])
+                    {
+                        key.interpolation = (AnimationCurves::Interpolation)i;
+                        return true;
+                    }
+                return json.fail("unknown interpolation");
+            }
+            return json.skip();
+        });
+    }
+};
+
+#endif
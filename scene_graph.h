@@ -0,0 +1,265 @@
+#ifndef SCENE_GRAPH_H
+#define SCENE_GRAPH_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <vector>
+
+// Transform hierarchy for the sculpture (arms carrying sub-arms carrying shapes).
+// Nodes live in flat arrays kept in depth-first pre-order, so every subtree is the contiguous
+// range [i, subtreeEnd[i]) and a parent always precedes its children. Setting a local transform
+// only flags the node; update() recomputes world matrices of the flagged subtrees and nothing
+// else, spreading independent subtrees over the thread pool.
+class SceneGraph
+{
+public:
+    typedef unsigned int NodeId;
+    static constexpr NodeId INVALID_NODE = ~0u;
+
+    // adds a node with an identity local transform; parent must be a live node or INVALID_NODE
+    NodeId createNode(NodeId parent = INVALID_NODE)
+    {
+        NodeId id;
+        if (!freeIds.empty())
+        {
+            id = freeIds.back();
+            freeIds.pop_back();
+        }
+        else
+        {
+            id = (NodeId)nodes.size();
+            nodes.push_back(NodeInfo());
+        }
+        nodes[id] = NodeInfo();
+        nodes[id].parent = parent;
+        nodes[id].alive = true;
+        liveCount++;
+        structureChanged = true;
+        return id;
+    }
+
+    // room for count nodes, so createNode() does not allocate until there are more
+    void reserve(size_t count)
+    {
+        nodes.reserve(count);
+        freeIds.reserve(count);
+    }
+
+    // removes the node together with its whole subtree
+    void destroyNode(NodeId id)
+    {
+        if (id >= nodes.size() || !nodes[id].alive)
+            return;
+        std::vector<NodeId> stack(1, id);
+        // children are only known through the flat order, so make sure it is current
+        rebuildOrder();
+        while (!stack.empty())
+        {
+            NodeId node = stack.back();
+            stack.pop_back();
+            unsigned int index = nodes[node].index;
+            for (unsigned int i = index + 1; i < subtreeEnd[index]; i++)
+                if (parentIndex[i] == index)
+                    stack.push_back(indexToNode[i]);
+            nodes[node].alive = false;
+            freeIds.push_back(node);
+            liveCount--;
+        }
+        structureChanged = true;
+    }
+
+    void setTranslation(NodeId id, const glm::vec3& translation)
+    {
+        nodes[id].translation = translation;
+        markDirty(id);
+    }
+
+    // rotation of angle radians around axis, applied before translation and after scale
+    void setRotation(NodeId id, float angle, const glm::vec3& axis)
+    {
+        nodes[id].angle = angle;
+        nodes[id].axis = axis;
+        markDirty(id);
+    }
+
+    void setScale(NodeId id, const glm::vec3& scale)
+    {
+        nodes[id].scale = scale;
+        markDirty(id);
+    }
+
+    const glm::vec3& translation(NodeId id) const { return nodes[id].translation; }
+    NodeId parent(NodeId id) const { return nodes[id].parent; }
+    bool isAlive(NodeId id) const { return id < nodes.size() && nodes[id].alive; }
+    size_t nodeCount() const { return liveCount; }
+
+    // world matrix as of the last update()
+    const glm::mat4& worldMatrix(NodeId id) const { return world[nodes[id].index]; }
+
+    // number of world matrices recomputed by the last update()
+    size_t lastUpdatedCount() const { return updatedCount; }
+
+    // recomputes world matrices for every dirty subtree; cost is proportional to the nodes that moved
+    void update(ThreadPool& pool)
+    {
+        if (structureChanged)
+            rebuildOrder();
+
+        // turn dirty nodes into disjoint subtree ranges: after sorting by pre-order index any
+        // node that falls inside the previous kept range is already covered by its ancestor
+        ranges.clear();
+        std::sort(dirtyIndices.begin(), dirtyIndices.end());
+        unsigned int coveredEnd = 0;
+        for (unsigned int index : dirtyIndices)
+        {
+            dirtyFlags[index] = 0;
+            if (index < coveredEnd)
+                continue;
+            ranges.push_back(Range{ index, subtreeEnd[index] });
+            coveredEnd = subtreeEnd[index];
+        }
+        dirtyIndices.clear();
+
+        updatedCount = 0;
+        for (const Range& range : ranges)
+            updatedCount += range.end - range.begin;
+
+        // the parent of a range root lies outside every dirty range, so its world matrix is final
+        // and the ranges can be processed in any order on any thread
+        pool.parallelFor(ranges.size(), 1, [this](size_t begin, size_t end) {
+            for (size_t r = begin; r < end; r++)
+                for (unsigned int i = ranges[r].begin; i < ranges[r].end; i++)
+                {
+                    glm::mat4 local = localMatrix(nodes[indexToNode[i]]);
+                    world[i] = parentIndex[i] == INVALID_NODE ? local : world[parentIndex[i]] * local;
+                }
+        });
+    }
+
+private:
+    struct NodeInfo
+    {
+        NodeId parent = INVALID_NODE;
+        unsigned int index = 0; // position in the pre-order arrays
+        bool alive = false;
+        glm::vec3 translation = glm::vec3(0.0f);
+        glm::vec3 axis = glm::vec3(0.0f, 1.0f, 0.0f);
+        float angle = 0.0f;
+        glm::vec3 scale = glm::vec3(1.0f);
+    };
+
+    struct Range
+    {
+        unsigned int begin, end;
+    };
+
+    // indexed by NodeId
+    std::vector<NodeInfo> nodes;
+    std::vector<NodeId> freeIds;
+    size_t liveCount = 0;
+
+    // indexed by pre-order position
+    std::vector<NodeId> indexToNode;
+    std::vector<unsigned int> parentIndex;
+    std::vector<unsigned int> subtreeEnd;
+    std::vector<glm::mat4> world;
+    std::vector<unsigned char> dirtyFlags;
+
+    std::vector<unsigned int> dirtyIndices;
+    std::vector<Range> ranges;
+    size_t updatedCount = 0;
+    bool structureChanged = false;
+
+    static glm::mat4 localMatrix(const NodeInfo& node)
+    {
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), node.translation);
+        if (node.angle != 0.0f)
+            model = glm::rotate(model, node.angle, node.axis);
+        return glm::scale(model, node.scale);
+    }
+
+    void markDirty(NodeId id)
+    {
+        // nodes created since the last update are re-ordered (and fully recomputed) anyway
+        if (structureChanged)
+            return;
+        unsigned int index = nodes[id].index;
+        if (!dirtyFlags[index])
+        {
+            dirtyFlags[index] = 1;
+            dirtyIndices.push_back(index);
+        }
+    }
+
+    // lays the live nodes out in depth-first pre-order and marks everything dirty
+    void rebuildOrder()
+    {
+        if (!structureChanged)
+            return;
+
+        // children lists in creation order via a counting sort on the parent id
+        std::vector<unsigned int> childStart(nodes.size() + 2, 0);
+        for (NodeId id = 0; id < nodes.size(); id++)
+            if (nodes[id].alive)
+            {
+                NodeId p = nodes[id].parent;
+                bool rootNode = p == INVALID_NODE || !nodes[p].alive;
+                childStart[(rootNode ? nodes.size() : p) + 1]++;
+            }
+        for (size_t i = 1; i < childStart.size(); i++)
+            childStart[i] += childStart[i - 1];
+        std::vector<NodeId> children(liveCount);
+        std::vector<unsigned int> fill(childStart.begin(), childStart.end() - 1);
+        for (NodeId id = 0; id < nodes.size(); id++)
+            if (nodes[id].alive)
+            {
+                NodeId p = nodes[id].parent;
+                bool rootNode = p == INVALID_NODE || !nodes[p].alive;
+                children[fill[rootNode ? nodes.size() : p]++] = id;
+            }
+
+        indexToNode.clear();
+        parentIndex.clear();
+        subtreeEnd.assign(liveCount, 0);
+        std::vector<NodeId> stack;
+        for (unsigned int c = childStart[nodes.size() + 1]; c-- > childStart[nodes.size()];)
+            stack.push_back(children[c]);
+        // explicit stack; a node is pushed again as a marker to close its subtree range
+        std::vector<bool> opened(nodes.size(), false);
+        while (!stack.empty())
+        {
+            NodeId id = stack.back();
+            if (opened[id])
+            {
+                stack.pop_back();
+                subtreeEnd[nodes[id].index] = (unsigned int)indexToNode.size();
+                continue;
+            }
+            opened[id] = true;
+            nodes[id].index = (unsigned int)indexToNode.size();
+            NodeId p = nodes[id].parent;
+            parentIndex.push_back(p == INVALID_NODE || !nodes[p].alive ? INVALID_NODE : nodes[p].index);
+            indexToNode.push_back(id);
+            for (unsigned int c = childStart[id + 1]; c-- > childStart[id];)
+                stack.push_back(children[c]);
+        }
+
+        world.assign(liveCount, glm::mat4(1.0f));
+        dirtyFlags.assign(liveCount, 0);
+        dirtyIndices.clear();
+        // every root starts a dirty range covering its whole subtree
+        for (unsigned int i = 0; i < liveCount; i++)
+            if (parentIndex[i] == INVALID_NODE)
+            {
+                dirtyFlags[i] = 1;
+                dirtyIndices.push_back(i);
+            }
+        structureChanged = false;
+    }
+};
+
+#endif
@@ -0,0 +1,938 @@
+#ifndef SCULPTURE_H
+#define SCULPTURE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/shader_m.h>
+#include <learnopengl/camera.h>
+
+#include "thread_pool.h"
+#include "scene_graph.h"
+#include "cable_physics.h"
+#include "mechanism.h"
+#include "superellipsoid_collision.h"
+#include "instance_batches.h"
+#include "mesh_ring.h"
+#include "view_frustum.h"
+#include "stereo_target.h"
+#include "superellipsoid_feedback.h"
+#include "superellipsoid_compute.h"
+#include "superellipsoid_tessellation.h"
+#include "superellipsoid_raymarch.h"
+
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// One sculpture as three objects with explicit ownership, so that a process can host several
+// independent ones and drive each from its own thread:
+//   SculptureScene       what is there: the camera, the lights, the shape's exponents, the transform
+//                        hierarchy and the objects hanging from cables
+//   SculptureSimulation  moves a scene: drive trains, cables and contacts, on the pool it is given
+//   SculptureRenderer    draws a scene's views into the bound target: the interactive window's,
+//                        or an offscreen image it reads back as the GL SculptureBackend; the
+//                        Vulkan one is in vulkan_renderer.h
+// None of them touches global state. A scene and its simulation belong to one thread at a time, a
+// renderer to the GL context that was current when it was created. ThreadPool::parallelFor
+// serialises its callers, so simulations stepped on different threads should not share a pool.
+
+struct Vertex {
+    glm::vec3 Position;
+    glm::vec3 Normal;
+    glm::vec2 TexCoords;
+};
+
+inline void generateSuperellipsoid(
+    std::vector<Vertex>& vertices,
+    std::vector<unsigned int>& indices,
+    float a, float b, float c,
+    float n1, float n2,
+    int stacks = 64, int slices = 64)
+{
+    const double PI = 3.14159265358979323846;
+    vertices.clear();
+    indices.clear();
+
+    auto sgn = [](float x) { return (x < 0) ? -1.0f : 1.0f; };
+    auto powe = [&](float base, float exp) {
+        return sgn(base) * std::pow(std::abs(base), exp);
+        };
+
+    for (int i = 0; i <= stacks; i++) {
+        float u = -PI / 2.0f + (float)i / stacks * PI;
+        for (int j = 0; j <= slices; j++) {
+            float v = -PI + (float)j / slices * 2.0f * PI;
+
+            float cu = cos(u), su = sin(u);
+            float cv = cos(v), sv = sin(v);
+
+            float x = a * powe(cu, n1) * powe(cv, n2);
+            float y = b * powe(cu, n1) * powe(sv, n2);
+            float z = c * powe(su, n1);
+
+            glm::vec3 pos(x, y, z);
+
+            // approximate normal
+            glm::vec3 n = glm::normalize(glm::vec3(
+                x / (a * a), y / (b * b), z / (c * c)
+            ));
+
+            glm::vec2 tex(
+                (float)j / slices,
+                (float)i / stacks
+            );
+
+            vertices.push_back({ pos, n, tex });
+        }
+    }
+
+    for (int i = 0; i < stacks; i++) {
+        for (int j = 0; j < slices; j++) {
+            int first = i * (slices + 1) + j;
+            int second = first + slices + 1;
+
+            indices.push_back(first);
+            indices.push_back(second);
+            indices.push_back(first + 1);
+
+            indices.push_back(second);
+            indices.push_back(second + 1);
+            indices.push_back(first + 1);
+        }
+    }
+}
+
+struct SculptureScene
+{
+    static constexpr int LIGHTS = 4;
+    // spawned objects hang this far below their cable anchors, plus half their size
+    static constexpr float CABLE_LENGTH = 1.5f;
+    static constexpr int CABLE_SEGMENTS = 8;
+
+    Camera camera = Camera(glm::vec3(0.0f, 0.0f, 3.0f));
+    // the point lights as lit this frame
+    glm::vec3 lightPositions[LIGHTS] = {
+        glm::vec3(0.7f,  0.2f,  2.0f),
+        glm::vec3(2.3f, -3.3f, -4.0f),
+        glm::vec3(-4.0f,  2.0f, -12.0f),
+        glm::vec3(0.0f,  0.0f, -3.0f)
+    };
+    float lightIntensities[LIGHTS] = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+    // exponents shared by the sculpture and every spawned object, and the sculpture's scale
+    float n1 = 1.0f, n2 = 1.0f;
+    float sculptureScale = 1.0f;
+
+    // the sculpture and the spawned objects are nodes; spawned objects hang from simulated cables
+    SceneGraph graph;
+    SceneGraph::NodeId sculptureNode;
+    CableSimulation cables;
+    // parallel, one entry per spawned object
+    std::vector<glm::vec3> spawnedPositions;
+    std::vector<SceneGraph::NodeId> spawnedNodes;
+    std::vector<CableSimulation::CableId> spawnedCables;
+    std::vector<glm::vec3> spawnedAnchors; // rest position of each cable anchor
+
+    SculptureScene() { sculptureNode = graph.createNode(); }
+    SculptureScene(const SculptureScene&) = delete;
+    SculptureScene& operator=(const SculptureScene&) = delete;
+
+    size_t spawnedCount() const { return spawnedNodes.size(); }
+    // spawn() does not allocate while spawnedCount() is below this
+    size_t spawnCapacity() const { return reservedSpawns; }
+
+    // makes room for count spawned objects in all, cables and graph nodes included
+    void reserveSpawned(size_t count)
+    {
+        if (count <= reservedSpawns)
+            return;
+        spawnedPositions.reserve(count);
+        spawnedNodes.reserve(count);
+        spawnedCables.reserve(count);
+        spawnedAnchors.reserve(count);
+        graph.reserve(count + 1);
+        cables.reserve(count - std::min(count, cables.cableCount()), CABLE_SEGMENTS);
+        reservedSpawns = count;
+    }
+
+    // collision bodies and instance records number the sculpture 0 and spawned object i as i + 1
+    const glm::mat4& bodyMatrix(size_t body) const
+    {
+        return graph.worldMatrix(body == 0 ? sculptureNode : spawnedNodes[body - 1]);
+    }
+
+    // adds an object at position, hanging from its own cable, with an initial push
+    void spawn(const glm::vec3& position, const glm::vec3& push)
+    {
+        spawnedPositions.push_back(position);
+
+        // spawned objects are smaller than the central sculpture
+        SceneGraph::NodeId node = graph.createNode();
+        graph.setTranslation(node, position);
+        graph.setScale(node, glm::vec3(0.5f));
+        spawnedNodes.push_back(node);
+
+        // hang it from a cable anchored above the spawn point
+        glm::vec3 anchor = position + glm::vec3(0.0f, CABLE_LENGTH + 0.5f, 0.0f);
+        CableSimulation::CableId cable = cables.addCable(anchor, anchor - glm::vec3(0.0f, CABLE_LENGTH, 0.0f), CABLE_SEGMENTS);
+        cables.applyImpulse(cable, push);
+        spawnedCables.push_back(cable);
+        spawnedAnchors.push_back(anchor);
+    }
+
+    void clearSpawned()
+    {
+        for (SceneGraph::NodeId node : spawnedNodes)
+            graph.destroyNode(node);
+        spawnedPositions.clear();
+        spawnedNodes.clear();
+        spawnedCables.clear();
+        spawnedAnchors.clear();
+        cables.clear();
+    }
+
+private:
+    size_t reservedSpawns = 0;
+};
+
+class SculptureSimulation
+{
+public:
+    float contactRestitution = 0.3f;
+
+    // all parallel loops of this simulation run on pool, which must outlive it
+    explicit SculptureSimulation(ThreadPool& pool) : pool(pool)
+    {
+        morphDrive = buildMorphDrive();
+        morphDrive.setInstanceCount(1);
+        morphN1 = morphDrive.outputIndex("n1");
+        morphN2 = morphDrive.outputIndex("n2");
+        anchorDrive = buildAnchorDrive();
+        anchorSway = anchorDrive.outputIndex("sway");
+        anchorLift = anchorDrive.outputIndex("lift");
+    }
+
+    // the morph drive's exponents at time t into the scene; callers may replace them before step()
+    void drive(SculptureScene& scene, float t)
+    {
+        morphDrive.evaluate(t, pool);
+        scene.n1 = morphDrive.output(morphN1)[0]; // 0.2 to 2.0
+        scene.n2 = morphDrive.output(morphN2)[0]; // 0.2 to 2.0
+    }
+
+    // moves the cable anchors to time t, swings the cables by dt, poses the hierarchy and pushes
+    // touching objects apart with the scene's current exponents
+    void step(SculptureScene& scene, float t, float dt)
+    {
+        // cable anchors ride on their own linkages, phase-shifted per object
+        if (anchorDrive.instances() != scene.spawnedAnchors.size())
+        {
+            anchorDrive.setInstanceCount(scene.spawnedAnchors.size());
+            for (size_t i = 0; i < scene.spawnedAnchors.size(); i++)
+                anchorDrive.motorPhase(0)[i] = 0.9f * i;
+        }
+        anchorDrive.evaluate(t, pool);
+        for (size_t i = 0; i < scene.spawnedAnchors.size(); i++)
+        {
+            glm::vec3 offset(anchorDrive.output(anchorSway)[i], anchorDrive.output(anchorLift)[i], 0.0f);
+            scene.cables.setAnchor(scene.spawnedCables[i], scene.spawnedAnchors[i] + offset);
+        }
+
+        // swing the hanging objects; each one sits just below the end of its cable
+        scene.cables.step(dt, pool);
+        for (size_t i = 0; i < scene.spawnedNodes.size(); i++)
+        {
+            glm::vec3 end = scene.cables.cableEnd(scene.spawnedCables[i]);
+            scene.spawnedPositions[i] = end + scene.cables.cableEndDirection(scene.spawnedCables[i]) * 0.5f;
+            scene.graph.setTranslation(scene.spawnedNodes[i], scene.spawnedPositions[i]);
+        }
+
+        // animate the hierarchy; only nodes touched here (and their subtrees) get recomputed
+        scene.graph.setRotation(scene.sculptureNode, t * 0.5f, glm::vec3(0.0f, 1.0f, 0.0f));
+        scene.graph.setScale(scene.sculptureNode, glm::vec3(scene.sculptureScale));
+        for (SceneGraph::NodeId node : scene.spawnedNodes)
+            scene.graph.setRotation(node, t * 0.2f, glm::vec3(0.0f, 1.0f, 0.0f));
+        scene.graph.update(pool);
+
+        // push touching objects apart; the sculpture is fixed, spawned objects move through their cable ends
+        collisionWorld.resize(scene.spawnedNodes.size() + 1);
+        for (size_t body = 0; body <= scene.spawnedNodes.size(); body++)
+            collisionWorld.setBody(body, scene.bodyMatrix(body), scene.n1, scene.n2);
+        for (const SuperellipsoidCollision::Contact& contact : collisionWorld.detect(pool))
+            resolveContact(scene, contact);
+    }
+
+    // drive() and step() on the simulation's own clock, which starts at 0
+    void advance(SculptureScene& scene, float dt)
+    {
+        time += dt;
+        drive(scene, time);
+        step(scene, time, dt);
+    }
+
+    float clock() const { return time; }
+    void setClock(float t) { time = t; }
+
+    // the bodies of the last step(), numbered as SculptureScene::bodyMatrix(), for culling and picking
+    const SuperellipsoidCollision& collisions() const { return collisionWorld; }
+
+    // drive train of the central shape: one motor turns two gear trains through idler gears
+    // (24:16:20 and 16:16:20, so the output shafts turn at 1.2 and 0.8 times motor speed in the
+    // motor's direction); cranks on those shafts give the sin/cos morph curves in 0.2 .. 2.0
+    static MechanismProgram buildMorphDrive()
+    {
+        MechanismGraph graph;
+        MechanismGraph::Signal motor = graph.motor(1.0f);
+
+        MechanismGraph::Signal shaft1 = graph.gear(graph.gear(motor, 24, 16), 16, 20);
+        MechanismGraph::Signal pin1Y;
+        graph.crank(shaft1, 1.0f, nullptr, &pin1Y);
+        graph.output(graph.mapRange(pin1Y, -1.0f, 1.0f, 0.2f, 2.0f), "n1");
+
+        MechanismGraph::Signal shaft2 = graph.gear(graph.gear(motor, 16, 16), 16, 20);
+        MechanismGraph::Signal pin2X;
+        graph.crank(shaft2, 1.0f, &pin2X, nullptr);
+        graph.output(graph.mapRange(pin2X, -1.0f, 1.0f, 0.2f, 2.0f), "n2");
+
+        return MechanismProgram::compile(graph);
+    }
+
+    // drive train of a cable anchor: a four-bar rocker sways the anchor sideways while a cam on the
+    // same motor shaft lifts it; evaluated once per spawned object with a per-object motor phase
+    static MechanismProgram buildAnchorDrive()
+    {
+        MechanismGraph graph;
+        MechanismGraph::Signal motor = graph.motor(0.8f);
+
+        MechanismGraph::Signal rocker = graph.fourBar(motor, 0.25f, 1.0f, 0.7f, 0.9f);
+        graph.output(graph.scaleOffset(graph.cosine(rocker), 0.4f, 0.0f), "sway");
+        graph.output(graph.cam(motor, 0.15f, 0.4f), "lift");
+
+        return MechanismProgram::compile(graph);
+    }
+
+private:
+    ThreadPool& pool;
+    MechanismProgram morphDrive, anchorDrive;
+    int morphN1, morphN2, anchorSway, anchorLift;
+    SuperellipsoidCollision collisionWorld;
+    float time = 0.0f;
+
+    // separates the two bodies of a contact and removes their approaching velocity (with some bounce);
+    // body 0 is the static sculpture, every other body is the end of a cable
+    void resolveContact(SculptureScene& scene, const SuperellipsoidCollision::Contact& contact)
+    {
+        bool aMoves = contact.a != 0;
+        float share = aMoves ? 0.5f : 1.0f;
+        CableSimulation& cables = scene.cables;
+        CableSimulation::CableId cableB = scene.spawnedCables[contact.b - 1];
+
+        glm::vec3 relativeVelocity = cables.endVelocity(cableB);
+        if (aMoves)
+            relativeVelocity -= cables.endVelocity(scene.spawnedCables[contact.a - 1]);
+        float approach = glm::dot(relativeVelocity, contact.normal);
+        glm::vec3 impulse = approach < 0.0f ? contact.normal * (-(1.0f + contactRestitution) * approach * share) : glm::vec3(0.0f);
+
+        cables.displaceEnd(cableB, contact.normal * (contact.depth * share));
+        cables.addEndVelocity(cableB, impulse);
+        if (aMoves)
+        {
+            cables.displaceEnd(scene.spawnedCables[contact.a - 1], -contact.normal * (contact.depth * share));
+            cables.addEndVelocity(scene.spawnedCables[contact.a - 1], -impulse);
+        }
+    }
+};
+
+// What the headless batch asks of a renderer: the sculpture, its lamps and its cables with the
+// lighting model of 6.multiple_lights.fs, drawn into an image of its own. Anything that can do that
+// (another graphics API, a software rasteriser) can stand in for SculptureRenderer behind this
+// interface; createSculptureBackend() knows the implementations built in. A backend belongs to the
+// thread, and for GL the context, it was created on.
+class SculptureBackend
+{
+public:
+    virtual ~SculptureBackend() {}
+
+    virtual const char* name() const = 0;
+    // whether create() and render() need a GL context current on their thread
+    virtual bool needsGLContext() const = 0;
+    // what renders, as the driver names it; empty before create()
+    virtual std::string deviceName() const = 0;
+
+    // builds the passes, the shape's mesh on a stacks x slices grid and a width x height image;
+    // false if the image cannot be rendered to
+    virtual bool create(int width, int height, int stacks = 64, int slices = 64) = 0;
+
+    // draws the sculpture and the spawned objects as the scene's camera sees them, then makes the
+    // image available in image(); the mesh follows the scene's exponents
+    virtual void render(const SculptureScene& scene, ThreadPool& pool) = 0;
+
+    // the last rendered image, RGB rows from the bottom up
+    virtual const std::vector<unsigned char>& image() const = 0;
+    virtual int width() const = 0;
+    virtual int height() const = 0;
+
+    virtual void destroy() = 0;
+
+    // the last rendered image as a binary PPM
+    bool writeImage(const char* path) const
+    {
+        FILE* file = std::fopen(path, "wb");
+        if (!file)
+            return false;
+        const std::vector<unsigned char>& pixels = image();
+        std::fprintf(file, "P6 %d %d 255\n", width(), height());
+        for (int y = height() - 1; y >= 0; y--)
+            std::fwrite(&pixels[(size_t)y * width() * 3], 1, (size_t)width() * 3, file);
+        return std::fclose(file) == 0;
+    }
+};
+
+// The GL passes of a sculpture: the shape's mesh and how it is generated, the shapes, lamps and
+// cables, the selection outline and the echo trails. drawView() draws one view into whatever target
+// is bound, so the interactive window submits its views and stereo layers through it, with its own
+// instanced fields and overlays hooked in, and render() draws the batch's image the same way into a
+// target of its own. The lit passes sample the diffuse map on unit 0: render() binds a solid yellow
+// there, the window its texture.
+class SculptureRenderer : public SculptureBackend
+{
+public:
+    // where each frame's mesh comes from: the CPU, uploaded, or the GPU straight into the live slot
+    // of the mesh ring by transform feedback or, with GL 4.3, a compute shader
+    enum Generation { GENERATE_CPU, GENERATE_FEEDBACK, GENERATE_COMPUTE, GENERATIONS };
+    // how the shapes fill a mono view: the fixed mesh, patches subdivided as finely as the view
+    // needs (GL 4.0), or boxes the implicit surface is ray-marched in
+    enum Surface { SURFACE_MESH, SURFACE_TESSELLATED, SURFACE_RAY_MARCHED, SURFACES };
+
+    // one view drawn into the bound target, with the viewport already set
+    struct View
+    {
+        const Camera* camera;               // seen from; the spot light stays on the scene's camera
+        glm::mat4 projection;
+        glm::mat4 view;
+        int height;                         // in pixels
+        const glm::mat4* eyeViewProjection; // a stereo pass submitted once for both eyes, or null
+    };
+
+    // what a view shows besides the shapes, the lamps and the cables. A stereo pass draws the mesh
+    // and stops after the lamps
+    struct ViewOptions
+    {
+        int surface = SURFACE_MESH;
+        const SuperellipsoidCollision* culling = nullptr; // bodies whose boxes are out of view are skipped
+        int selected = -1;                                 // spawned object outlined in white
+        bool echoes = false;                               // the ring's kept shapes, blended
+        std::function<void(const View&)> fields;           // after the shapes, before the lamps
+        std::function<void(const View&)> overlays;         // last
+    };
+
+    const char* name() const override { return "gl"; }
+    bool needsGLContext() const override { return true; }
+    std::string deviceName() const override
+    {
+        const GLubyte* renderer = glGetString(GL_RENDERER);
+        return renderer ? (const char*)renderer : "";
+    }
+
+    // the passes without the GPU paths, and the image; false if the target is incomplete
+    bool create(int width, int height, int stacks = 64, int slices = 64) override
+    {
+        createPasses(stacks, slices, 1, false);
+        return createTarget(width, height);
+    }
+
+    // builds the passes in the current context: the mesh on a stacks x slices grid in a ring of
+    // echoSlots snapshots, and with gpuPaths the GPU generators and surfaces the context supports
+    void createPasses(int stacks, int slices, int echoSlots, bool gpuPaths)
+    {
+        meshStacks = stacks;
+        meshSlices = slices;
+        lightingShader.reset(new Shader("6.multiple_lights.vs", "6.multiple_lights.fs"));
+        lampShader.reset(new Shader("6.light_cubes.vs", "6.light_cube.fs"));
+        lineShader.reset(new Shader("6.light_cube.vs", "6.light_cube.fs"));
+        echoShader.reset(new Shader("6.echo.vs", "6.echo.fs"));
+        setSamplers(*lightingShader);
+
+        // the shape's mesh: the vertices change every frame, the last echoSlots shapes stay in the
+        // ring and the newest is drawn from liveBaseVertex(); the indices never change
+        generateSuperellipsoid(vertices, indices, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, stacks, slices);
+        glGenVertexArrays(1, &shapeVAO);
+        glGenBuffers(1, &shapeEBO);
+        glBindVertexArray(shapeVAO);
+        ring.create(vertices.size(), sizeof(Vertex), echoSlots);
+        ring.write(vertices.data());
+        glBindBuffer(GL_ARRAY_BUFFER, ring.buffer());
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, shapeEBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+        glEnableVertexAttribArray(2);
+        glBindVertexArray(0);
+        // the sculpture and the spawned objects are drawn as instances of the live shape
+        shapeBatches.create(shapeVAO);
+
+        if (gpuPaths)
+        {
+            generators[GENERATE_FEEDBACK] = feedback.create(stacks, slices, "6.superellipsoid_generate.vs")
+                && feedback.vertexCount() == vertices.size();
+            generators[GENERATE_COMPUTE] = compute.create(stacks, slices, "6.superellipsoid_generate.cs")
+                && compute.vertexCount() == vertices.size();
+            // 8 x 16 patches; the control shader decides how finely each is cut
+            surfaces[SURFACE_TESSELLATED] = tessellation.create(8, 16, "6.superellipsoid_tess.vs", "6.superellipsoid_tess.tcs",
+                "6.superellipsoid_tess.tes", "6.multiple_lights.fs");
+            if (surfaces[SURFACE_TESSELLATED])
+            {
+                shapeBatches.attach(tessellation.vao());
+                tessellatedShader.reset(new Shader(*lightingShader));
+                tessellatedShader->ID = tessellation.programId();
+                setSamplers(*tessellatedShader);
+            }
+            surfaces[SURFACE_RAY_MARCHED] = raymarch.create("6.superellipsoid_raymarch.vs", "6.superellipsoid_raymarch.fs", "6.multiple_lights.fs");
+            if (surfaces[SURFACE_RAY_MARCHED])
+            {
+                shapeBatches.attach(raymarch.vao());
+                rayMarchedShader.reset(new Shader(*lightingShader));
+                rayMarchedShader->ID = raymarch.programId();
+                setSamplers(*rayMarchedShader);
+            }
+        }
+
+        // a unit cube per point light
+        const float cube[] = {
+            -0.5f, -0.5f, -0.5f,  0.5f, -0.5f, -0.5f,  0.5f,  0.5f, -0.5f,  0.5f,  0.5f, -0.5f, -0.5f,  0.5f, -0.5f, -0.5f, -0.5f, -0.5f,
+            -0.5f, -0.5f,  0.5f,  0.5f, -0.5f,  0.5f,  0.5f,  0.5f,  0.5f,  0.5f,  0.5f,  0.5f, -0.5f,  0.5f,  0.5f, -0.5f, -0.5f,  0.5f,
+            -0.5f,  0.5f,  0.5f, -0.5f,  0.5f, -0.5f, -0.5f, -0.5f, -0.5f, -0.5f, -0.5f, -0.5f, -0.5f, -0.5f,  0.5f, -0.5f,  0.5f,  0.5f,
+             0.5f,  0.5f,  0.5f,  0.5f,  0.5f, -0.5f,  0.5f, -0.5f, -0.5f,  0.5f, -0.5f, -0.5f,  0.5f, -0.5f,  0.5f,  0.5f,  0.5f,  0.5f,
+            -0.5f, -0.5f, -0.5f,  0.5f, -0.5f, -0.5f,  0.5f, -0.5f,  0.5f,  0.5f, -0.5f,  0.5f, -0.5f, -0.5f,  0.5f, -0.5f, -0.5f, -0.5f,
+            -0.5f,  0.5f, -0.5f,  0.5f,  0.5f, -0.5f,  0.5f,  0.5f,  0.5f,  0.5f,  0.5f,  0.5f, -0.5f,  0.5f,  0.5f, -0.5f,  0.5f, -0.5f
+        };
+        glGenVertexArrays(1, &lampVAO);
+        glGenBuffers(1, &lampVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, lampVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(cube), cube, GL_STATIC_DRAW);
+        glBindVertexArray(lampVAO);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        lampBatches.create(lampVAO);
+
+        // cable segments, rewritten every frame
+        glGenVertexArrays(1, &cableVAO);
+        glGenBuffers(1, &cableVBO);
+        glBindVertexArray(cableVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, cableVBO);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glBindVertexArray(0);
+
+        // the same solid yellow as Solid_yellow.png; no specular map, as in the interactive view
+        const unsigned char yellow[3] = { 255, 255, 0 };
+        glGenTextures(1, &diffuseMap);
+        glBindTexture(GL_TEXTURE_2D, diffuseMap);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGB, GL_UNSIGNED_BYTE, yellow);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    // the stereo variants of the lit and lamp passes, built for target; false if it cannot
+    bool createStereo(const StereoTarget& target)
+    {
+        stereoTarget = &target;
+        stereoLightingShader.reset(new Shader(*lightingShader));
+        stereoLightingShader->ID = target.buildProgram("6.multiple_lights.vs", "6.multiple_lights.fs");
+        stereoLampShader.reset(new Shader(*lampShader));
+        stereoLampShader->ID = target.buildProgram("6.light_cubes.vs", "6.light_cube.fs");
+        if (!stereoLightingShader->ID || !stereoLampShader->ID)
+            return false;
+        setSamplers(*stereoLightingShader);
+        return true;
+    }
+
+    // the offscreen image render() draws into; false if it is incomplete
+    bool createTarget(int width, int height)
+    {
+        targetWidth = width;
+        targetHeight = height;
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glGenRenderbuffers(1, &color);
+        glBindRenderbuffer(GL_RENDERBUFFER, color);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+        glGenRenderbuffers(1, &depth);
+        glBindRenderbuffer(GL_RENDERBUFFER, depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+        bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        pixels.resize((size_t)width * height * 3);
+        return complete;
+    }
+
+    bool generationAvailable(int path) const { return generators[path]; }
+    bool surfaceAvailable(int surface) const { return surfaces[surface]; }
+
+    // the scene's shape into the ring's live slot along path. The CPU copy, vertices() and
+    // indices(), is only made on the CPU path or when cpuCopy asks for it
+    void generate(const SculptureScene& scene, int path = GENERATE_CPU, bool cpuCopy = false)
+    {
+        if (path == GENERATE_CPU || cpuCopy)
+            generateSuperellipsoid(vertices, indices, 1.0f, 1.0f, 1.0f, scene.n1, scene.n2, meshStacks, meshSlices);
+        if (path == GENERATE_COMPUTE)
+        {
+            SuperellipsoidCompute::Shape shape = { glm::vec3(1.0f), scene.n1, scene.n2 };
+            compute.generate(ring.buffer(), ring.liveBaseVertex(), &shape, 1);
+        }
+        else if (path == GENERATE_FEEDBACK)
+            feedback.generate(ring.buffer(), ring.liveByteOffset(), scene.n1, scene.n2);
+        else
+            ring.write(vertices.data());
+    }
+
+    // per-frame data shared by every view once the scene has been stepped: the live shape's
+    // transform for its echo, the lamps and the cables
+    void record(const SculptureScene& scene, ThreadPool& pool)
+    {
+        ring.setModel(scene.bodyMatrix(0));
+        lampBatches.record(SculptureScene::LIGHTS, pool, [&](size_t i) {
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), scene.lightPositions[i]);
+            return glm::scale(model, glm::vec3(0.2f)); // Make it a smaller cube
+        });
+        if (scene.cables.cableCount() > 0)
+        {
+            cableLineVertices.clear();
+            scene.cables.appendSegmentLines(cableLineVertices);
+            glBindBuffer(GL_ARRAY_BUFFER, cableVBO);
+            glBufferData(GL_ARRAY_BUFFER, cableLineVertices.size() * sizeof(float), cableLineVertices.data(), GL_STREAM_DRAW);
+        }
+    }
+
+    // this frame's shape becomes an echo and the next one is generated into the oldest slot
+    void keepEcho() { ring.commit(); }
+    void clearEchoes() { ring.clear(); }
+
+    // camera, material and light uniforms of the scene in the lit pass and, for a mono view drawn
+    // with another surface, in that surface's pass; with stereoPass in the stereo variant instead
+    void setLighting(const SculptureScene& scene, int surface = SURFACE_MESH, bool stereoPass = false)
+    {
+        Shader& shader = stereoPass ? *stereoLightingShader : *lightingShader;
+        shader.use();
+        setLightingUniforms(shader, scene.camera, scene.lightPositions, scene.lightIntensities);
+        if (!stereoPass && surface != SURFACE_MESH)
+        {
+            surfaceShader(surface).use();
+            setLightingUniforms(surfaceShader(surface), scene.camera, scene.lightPositions, scene.lightIntensities);
+        }
+    }
+
+    // the sculpture (body 0) and the spawned objects (body i + 1) as this frame's instance records;
+    // with culling only those whose collision boxes are in frustum
+    void recordShapes(const SculptureScene& scene, const ViewFrustum& frustum, ThreadPool& pool, const SuperellipsoidCollision* culling = nullptr)
+    {
+        visibleBodies.clear();
+        for (size_t body = 0; body <= scene.spawnedCount(); body++)
+            if (!culling || frustum.intersects(culling->lowerCorners()[body], culling->upperCorners()[body]))
+                visibleBodies.push_back(body);
+        shapeBatches.record(visibleBodies.size(), pool, [&](size_t i) {
+            return scene.bodyMatrix(visibleBodies[i]);
+        });
+    }
+
+    // the recorded shapes in one draw with surface, which a stereo pass ignores for the mesh. The
+    // lighting uniforms must be set
+    void drawShapes(const SculptureScene& scene, const View& view, int surface)
+    {
+        bool stereoPass = view.eyeViewProjection != nullptr;
+        Shader& shader = stereoPass ? *stereoLightingShader : surfaceShader(surface);
+        shader.use();
+        shader.setMat4("projection", view.projection);
+        shader.setMat4("view", view.view);
+        shader.setVec3("viewPos", view.camera->Position);
+        if (stereoPass)
+            StereoTarget::setEyeUniforms(shader.ID, view.eyeViewProjection);
+        if (!stereoPass && surface == SURFACE_TESSELLATED)
+        {
+            glm::vec2 viewportSize(view.height * view.projection[1][1] / view.projection[0][0], view.height);
+            tessellation.draw(scene.n1, scene.n2, viewportSize, (GLsizei)shapeBatches.count());
+        }
+        else if (!stereoPass && surface == SURFACE_RAY_MARCHED)
+            raymarch.draw(scene.n1, scene.n2, (GLsizei)shapeBatches.count());
+        else
+        {
+            glBindVertexArray(shapeVAO);
+            shapeBatches.drawElements(GL_TRIANGLES, (GLsizei)indices.size(), ring.liveBaseVertex(), instanceRepeat(view));
+        }
+    }
+
+    // culling and draw submission of one view: the shapes in view, options.fields, the lamps and,
+    // unless it is a stereo pass, the cables, the selection, the echoes and options.overlays
+    void drawView(const SculptureScene& scene, const View& view, ThreadPool& pool, const ViewOptions& options)
+    {
+        bool stereoPass = view.eyeViewProjection != nullptr;
+        // culls for the centre eye; objects only one eye sees at the edge may be dropped
+        recordShapes(scene, ViewFrustum(view.projection * view.view), pool, options.culling);
+        drawShapes(scene, view, options.surface);
+        if (options.fields)
+            options.fields(view);
+
+        Shader& lamps = stereoPass ? *stereoLampShader : *lampShader;
+        lamps.use();
+        lamps.setMat4("projection", view.projection);
+        lamps.setMat4("view", view.view);
+        if (stereoPass)
+            StereoTarget::setEyeUniforms(lamps.ID, view.eyeViewProjection);
+        glBindVertexArray(lampVAO);
+        lampBatches.drawArrays(GL_TRIANGLES, 0, 36, instanceRepeat(view)); // The light cube has 36 vertices (12 triangles)
+        if (stereoPass)
+            return;
+
+        lineShader->use();
+        lineShader->setMat4("projection", view.projection);
+        lineShader->setMat4("view", view.view);
+        if (scene.cables.cableCount() > 0)
+        {
+            lineShader->setMat4("model", glm::mat4(1.0f));
+            glBindVertexArray(cableVAO);
+            glDrawArrays(GL_LINES, 0, (GLsizei)(cableLineVertices.size() / 3));
+        }
+
+        // a slightly enlarged white wireframe around the selected object
+        if (options.selected >= 0)
+        {
+            lineShader->setMat4("model", glm::scale(scene.bodyMatrix(options.selected + 1), glm::vec3(1.05f)));
+            glBindVertexArray(shapeVAO);
+            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+            glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT, 0, ring.liveBaseVertex());
+            glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+        }
+
+        // every kept snapshot in one multi-draw, oldest first, blended over the scene
+        if (options.echoes && ring.echoCount() > 0)
+        {
+            echoShader->use();
+            echoShader->setMat4("projection", view.projection);
+            echoShader->setMat4("view", view.view);
+            echoShader->setVec3("viewPos", view.camera->Position);
+            echoShader->setVec3("echoColor", glm::vec3(0.55f, 0.75f, 1.0f));
+            echoShader->setFloat("echoOpacity", 0.6f);
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+            glDepthMask(GL_FALSE);
+            glBindVertexArray(shapeVAO);
+            ring.drawEchoes(echoShader->ID, (GLsizei)indices.size());
+            glDepthMask(GL_TRUE);
+            glDisable(GL_BLEND);
+        }
+
+        if (options.overlays)
+            options.overlays(view);
+    }
+
+    void drawView(const SculptureScene& scene, const View& view, ThreadPool& pool)
+    {
+        drawView(scene, view, pool, ViewOptions());
+    }
+
+    // one view of the scene's camera into the offscreen target, read back at the end
+    void render(const SculptureScene& scene, ThreadPool& pool) override
+    {
+        generate(scene);
+        record(scene, pool);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glViewport(0, 0, targetWidth, targetHeight);
+        glEnable(GL_DEPTH_TEST);
+        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, diffuseMap);
+
+        const Camera& camera = scene.camera;
+        setLighting(scene);
+        View view = {
+            &camera,
+            glm::perspective(glm::radians(camera.Zoom), (float)targetWidth / (float)targetHeight, 0.1f, 100.0f),
+            glm::lookAt(camera.Position, camera.Position + camera.Front, camera.Up),
+            targetHeight,
+            nullptr
+        };
+        drawView(scene, view, pool);
+
+        glReadPixels(0, 0, targetWidth, targetHeight, GL_RGB, GL_UNSIGNED_BYTE, pixels.data());
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glBindVertexArray(0);
+    }
+
+    const std::vector<unsigned char>& image() const override { return pixels; }
+    int width() const override { return targetWidth; }
+    int height() const override { return targetHeight; }
+
+    // the CPU copy of the mesh, see generate()
+    const std::vector<Vertex>& meshVertices() const { return vertices; }
+    const std::vector<unsigned int>& meshIndices() const { return indices; }
+    // instances drawn by the last drawShapes() and triangles the last tessellated draw generated
+    size_t drawnShapes() const { return shapeBatches.count(); }
+    GLuint tessellatedTriangles() const { return tessellation.lastTriangleCount(); }
+
+    void destroy() override
+    {
+        ring.destroy();
+        feedback.destroy();
+        compute.destroy();
+        tessellation.destroy();
+        raymarch.destroy();
+        shapeBatches.destroy();
+        lampBatches.destroy();
+        glDeleteVertexArrays(1, &shapeVAO);
+        glDeleteBuffers(1, &shapeEBO);
+        glDeleteVertexArrays(1, &lampVAO);
+        glDeleteBuffers(1, &lampVBO);
+        glDeleteVertexArrays(1, &cableVAO);
+        glDeleteBuffers(1, &cableVBO);
+        glDeleteTextures(1, &diffuseMap);
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteRenderbuffers(1, &color);
+        glDeleteRenderbuffers(1, &depth);
+        // the tessellated and ray-marched programs belong to their passes
+        std::unique_ptr<Shader>* programs[] = { &lightingShader, &lampShader, &lineShader, &echoShader, &stereoLightingShader, &stereoLampShader };
+        for (std::unique_ptr<Shader>* shader : programs)
+        {
+            if (*shader)
+                glDeleteProgram((*shader)->ID);
+            shader->reset();
+        }
+        tessellatedShader.reset();
+        rayMarchedShader.reset();
+        shapeVAO = shapeEBO = lampVAO = lampVBO = cableVAO = cableVBO = diffuseMap = fbo = color = depth = 0;
+    }
+
+    // sets camera, material and light uniforms shared by every pass using 6.multiple_lights.fs;
+    // the spot light is a flashlight held by camera
+    static void setLightingUniforms(const Shader& shader, const Camera& camera, const glm::vec3* pointLightPositions, const float* pointLightIntensities)
+    {
+        shader.setVec3("viewPos", camera.Position);
+        shader.setFloat("material.shininess", 32.0f);
+
+        // NEW: Set explicit material colors for a vibrant blue with bright blue reflections
+        shader.setVec3("material.ambient", 0.05f, 0.1f, 0.3f);   // Darker blue base
+        shader.setVec3("material.diffuse", 0.2f, 0.5f, 0.8f);    // Main body bright blue
+        shader.setVec3("material.specular", 0.7f, 0.9f, 1.0f);  // Bright blue/cyan reflections (light reflexes)
+
+        // Set all light uniforms here...
+        // directional light
+        shader.setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
+        shader.setVec3("dirLight.ambient", 0.05f, 0.05f, 0.05f);
+        shader.setVec3("dirLight.diffuse", 0.4f, 0.4f, 0.4f);
+        shader.setVec3("dirLight.specular", 0.5f, 0.5f, 0.5f);
+        // point lights
+        for (unsigned int i = 0; i < SculptureScene::LIGHTS; i++)
+        {
+            std::string name = "pointLights[" + std::to_string(i) + "]";
+            shader.setVec3(name + ".position", pointLightPositions[i]);
+            shader.setVec3(name + ".ambient", 0.05f, 0.05f, 0.05f);
+            shader.setVec3(name + ".diffuse", glm::vec3(0.8f) * pointLightIntensities[i]);
+            shader.setVec3(name + ".specular", glm::vec3(1.0f) * pointLightIntensities[i]);
+            shader.setFloat(name + ".constant", 1.0f);
+            shader.setFloat(name + ".linear", 0.09f);
+            shader.setFloat(name + ".quadratic", 0.032f);
+        }
+        // spotLight
+        shader.setVec3("spotLight.position", camera.Position);
+        shader.setVec3("spotLight.direction", camera.Front);
+        shader.setVec3("spotLight.ambient", 0.0f, 0.0f, 0.0f);
+        shader.setVec3("spotLight.diffuse", 1.0f, 1.0f, 1.0f);
+        shader.setVec3("spotLight.specular", 1.0f, 1.0f, 1.0f);
+        shader.setFloat("spotLight.constant", 1.0f);
+        shader.setFloat("spotLight.linear", 0.09f);
+        shader.setFloat("spotLight.quadratic", 0.032f);
+        shader.setFloat("spotLight.cutOff", glm::cos(glm::radians(12.5f)));
+        shader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(15.0f)));
+    }
+
+private:
+    // the lit passes sample the diffuse map on unit 0 and a specular map on unit 1
+    static void setSamplers(const Shader& shader)
+    {
+        shader.use();
+        shader.setInt("material.diffuse", 0);
+        shader.setInt("material.specular", 1);
+    }
+
+    Shader& surfaceShader(int surface) const
+    {
+        return surface == SURFACE_TESSELLATED ? *tessellatedShader
+            : surface == SURFACE_RAY_MARCHED ? *rayMarchedShader : *lightingShader;
+    }
+
+    // instanced stereo draws every record twice, once per eye
+    GLuint instanceRepeat(const View& view) const
+    {
+        return view.eyeViewProjection ? stereoTarget->instanceRepeat() : 1;
+    }
+
+    std::unique_ptr<Shader> lightingShader, lampShader, lineShader, echoShader;
+    std::unique_ptr<Shader> tessellatedShader, rayMarchedShader, stereoLightingShader, stereoLampShader;
+    const StereoTarget* stereoTarget = nullptr;
+
+    int meshStacks = 64, meshSlices = 64;
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    MeshRing ring;
+    unsigned int shapeVAO = 0, shapeEBO = 0;
+    SuperellipsoidFeedback feedback;
+    SuperellipsoidCompute compute;
+    SuperellipsoidTessellation tessellation;
+    SuperellipsoidRaymarch raymarch;
+    bool generators[GENERATIONS] = { true, false, false };
+    bool surfaces[SURFACES] = { true, false, false };
+    InstanceBatches shapeBatches;
+    std::vector<size_t> visibleBodies;
+
+    unsigned int lampVAO = 0, lampVBO = 0;
+    InstanceBatches lampBatches;
+    unsigned int cableVAO = 0, cableVBO = 0;
+    std::vector<float> cableLineVertices;
+
+    unsigned int diffuseMap = 0;
+    unsigned int fbo = 0, color = 0, depth = 0;
+    int targetWidth = 0, targetHeight = 0;
+    std::vector<unsigned char> pixels;
+};
+
+// the Vulkan backend is built wherever the Vulkan headers are; it loads the driver at run time
+#if defined(__has_include)
+#if __has_include(<vulkan/vulkan.h>)
+#define SCULPTURE_VULKAN
+#include "vulkan_renderer.h"
+#endif
+#endif
+
+// the backends built into this program, as createSculptureBackend() names them
+#ifdef SCULPTURE_VULKAN
+const char* const SCULPTURE_BACKENDS = "gl, vulkan";
+#else
+const char* const SCULPTURE_BACKENDS = "gl";
+#endif
+
+// the backend called name ("gl" or "vulkan"), or null if it is not built into this program
+inline std::unique_ptr<SculptureBackend> createSculptureBackend(const std::string& name)
+{
+    if (name == "gl")
+        return std::unique_ptr<SculptureBackend>(new SculptureRenderer());
+#ifdef SCULPTURE_VULKAN
+    if (name == "vulkan")
+        return std::unique_ptr<SculptureBackend>(new VulkanSculptureRenderer());
+#endif
+    return nullptr;
+}
+
+#endif
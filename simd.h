@@ -0,0 +1,229 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <cmath>
+
+// Four-wide float vector used by the SoA kernels. Maps to SSE where available and falls back to
+// plain scalar code elsewhere, so the kernels are written once against this interface.
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define SIMD_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace simd
+{
+
+#ifdef SIMD_SSE
+
+struct float4
+{
+    __m128 v;
+    float4() {}
+    float4(__m128 value) : v(value) {}
+    explicit float4(float s) : v(_mm_set1_ps(s)) {}
+    float4(float a, float b, float c, float d) : v(_mm_setr_ps(a, b, c, d)) {}
+
+    static float4 load(const float* p) { return _mm_loadu_ps(p); }
+    void store(float* p) const { _mm_storeu_ps(p, v); }
+    float operator[](int i) const { float lanes[4]; store(lanes); return lanes[i]; }
+};
+
+inline float4 operator+(float4 a, float4 b) { return _mm_add_ps(a.v, b.v); }
+inline float4 operator-(float4 a, float4 b) { return _mm_sub_ps(a.v, b.v); }
+inline float4 operator*(float4 a, float4 b) { return _mm_mul_ps(a.v, b.v); }
+inline float4 operator/(float4 a, float4 b) { return _mm_div_ps(a.v, b.v); }
+inline float4 operator-(float4 a) { return _mm_xor_ps(a.v, _mm_set1_ps(-0.0f)); }
+inline float4 min(float4 a, float4 b) { return _mm_min_ps(a.v, b.v); }
+inline float4 max(float4 a, float4 b) { return _mm_max_ps(a.v, b.v); }
+inline float4 sqrt(float4 a) { return _mm_sqrt_ps(a.v); }
+inline float4 abs(float4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a.v); }
+// lanes are all-ones where the comparison holds
+inline float4 cmplt(float4 a, float4 b) { return _mm_cmplt_ps(a.v, b.v); }
+inline float4 cmpgt(float4 a, float4 b) { return _mm_cmpgt_ps(a.v, b.v); }
+inline float4 select(float4 mask, float4 a, float4 b) { return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)); }
+inline bool any(float4 mask) { return _mm_movemask_ps(mask.v) != 0; }
+// round to nearest integer value
+inline float4 round(float4 a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a.v)); }
+// a with the sign of b
+inline float4 copysign(float4 a, float4 b)
+{
+    __m128 signMask = _mm_set1_ps(-0.0f);
+    return _mm_or_ps(_mm_andnot_ps(signMask, a.v), _mm_and_ps(signMask, b.v));
+}
+// rows to columns: lane i of a, b, c, d becomes row i (SoA to AoS and back)
+inline void transpose(float4& a, float4& b, float4& c, float4& d) { _MM_TRANSPOSE4_PS(a.v, b.v, c.v, d.v); }
+
+#else
+
+struct float4
+{
+    float v[4];
+    float4() {}
+    explicit float4(float s) { v[0] = v[1] = v[2] = v[3] = s; }
+    float4(float a, float b, float c, float d) { v[0] = a; v[1] = b; v[2] = c; v[3] = d; }
+
+    static float4 load(const float* p) { return float4(p[0], p[1], p[2], p[3]); }
+    void store(float* p) const { p[0] = v[0]; p[1] = v[1]; p[2] = v[2]; p[3] = v[3]; }
+    float operator[](int i) const { return v[i]; }
+};
+
+#define SIMD_LANEWISE(expr) float4 r; for (int i = 0; i < 4; i++) r.v[i] = (expr); return r;
+inline float4 operator+(float4 a, float4 b) { SIMD_LANEWISE(a.v[i] + b.v[i]) }
+inline float4 operator-(float4 a, float4 b) { SIMD_LANEWISE(a.v[i] - b.v[i]) }
+inline float4 operator*(float4 a, float4 b) { SIMD_LANEWISE(a.v[i] * b.v[i]) }
+inline float4 operator/(float4 a, float4 b) { SIMD_LANEWISE(a.v[i] / b.v[i]) }
+inline float4 operator-(float4 a) { SIMD_LANEWISE(-a.v[i]) }
+inline float4 min(float4 a, float4 b) { SIMD_LANEWISE(a.v[i] < b.v[i] ? a.v[i] : b.v[i]) }
+inline float4 max(float4 a, float4 b) { SIMD_LANEWISE(a.v[i] > b.v[i] ? a.v[i] : b.v[i]) }
+inline float4 sqrt(float4 a) { SIMD_LANEWISE(std::sqrt(a.v[i])) }
+inline float4 abs(float4 a) { SIMD_LANEWISE(std::fabs(a.v[i])) }
+// masks are stored as 1.0 / 0.0 in the scalar build
+inline float4 cmplt(float4 a, float4 b) { SIMD_LANEWISE(a.v[i] < b.v[i] ? 1.0f : 0.0f) }
+inline float4 cmpgt(float4 a, float4 b) { SIMD_LANEWISE(a.v[i] > b.v[i] ? 1.0f : 0.0f) }
+inline float4 select(float4 mask, float4 a, float4 b) { SIMD_LANEWISE(mask.v[i] != 0.0f ? a.v[i] : b.v[i]) }
+inline bool any(float4 mask) { return mask.v[0] != 0.0f || mask.v[1] != 0.0f || mask.v[2] != 0.0f || mask.v[3] != 0.0f; }
+inline float4 round(float4 a) { SIMD_LANEWISE(std::nearbyint(a.v[i])) }
+inline float4 copysign(float4 a, float4 b) { SIMD_LANEWISE(std::copysign(a.v[i], b.v[i])) }
+inline void transpose(float4& a, float4& b, float4& c, float4& d)
+{
+    float4* rows[4] = { &a, &b, &c, &d };
+    for (int i = 0; i < 4; i++)
+        for (int j = i + 1; j < 4; j++)
+        {
+            float t = rows[i]->v[j];
+            rows[i]->v[j] = rows[j]->v[i];
+            rows[j]->v[i] = t;
+        }
+}
+#undef SIMD_LANEWISE
+
+#endif
+
+inline float4 operator*(float4 a, float s) { return a * float4(s); }
+inline float4 operator+(float4 a, float s) { return a + float4(s); }
+inline float4 operator-(float4 a, float s) { return a - float4(s); }
+inline float4& operator+=(float4& a, float4 b) { a = a + b; return a; }
+inline float4& operator-=(float4& a, float4 b) { a = a - b; return a; }
+inline float4& operator*=(float4& a, float4 b) { a = a * b; return a; }
+// a * b + c
+inline float4 madd(float4 a, float4 b, float4 c) { return a * b + c; }
+inline float4 clamp(float4 a, float4 lo, float4 hi) { return min(max(a, lo), hi); }
+
+#ifdef SIMD_SSE
+
+// base-2 logarithm of positive x, ~4e-6 absolute error; zero maps to -127
+inline float4 log2(float4 x)
+{
+    // x = m * 2^e with m in [1, 2)
+    __m128i bits = _mm_castps_si128(x.v);
+    float4 e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127)));
+    float4 m = _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F800000)));
+    // log2(m) = 2 / ln 2 * atanh(t) with t = (m - 1) / (m + 1) in [0, 1/3]; series to t^9
+    float4 t = (m - float4(1.0f)) / (m + float4(1.0f));
+    float4 t2 = t * t;
+    float4 p(1.0f / 9.0f);
+    p = madd(p, t2, float4(1.0f / 7.0f));
+    p = madd(p, t2, float4(1.0f / 5.0f));
+    p = madd(p, t2, float4(1.0f / 3.0f));
+    p = madd(p, t2, float4(1.0f));
+    return madd(p * t, float4(2.88539008177792681472f), e);
+}
+
+// 2^x, ~1e-6 relative error; x is clamped to the normal float range
+inline float4 exp2(float4 x)
+{
+    x = min(max(x, float4(-126.0f)), float4(127.0f));
+    // 2^x = 2^i * e^(f ln 2) with i = floor(x), f in [0, 1)
+    __m128i rounded = _mm_cvtps_epi32(x.v);
+    __m128i i = _mm_add_epi32(rounded, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(rounded), x.v)));
+    float4 f = (x - float4(_mm_cvtepi32_ps(i))) * float4(0.69314718055994530942f);
+    // Taylor series of e^f to f^7
+    float4 p(1.0f / 5040.0f);
+    p = madd(p, f, float4(1.0f / 720.0f));
+    p = madd(p, f, float4(1.0f / 120.0f));
+    p = madd(p, f, float4(1.0f / 24.0f));
+    p = madd(p, f, float4(1.0f / 6.0f));
+    p = madd(p, f, float4(0.5f));
+    p = madd(p, f, float4(1.0f));
+    p = madd(p, f, float4(1.0f));
+    return p * float4(_mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(i, _mm_set1_epi32(127)), 23)));
+}
+
+#else
+
+inline float4 log2(float4 x)
+{
+    float4 r;
+    for (int i = 0; i < 4; i++)
+        r.v[i] = x.v[i] > 0.0f ? std::log2(x.v[i]) : -127.0f;
+    return r;
+}
+
+inline float4 exp2(float4 x)
+{
+    float4 r;
+    for (int i = 0; i < 4; i++)
+        r.v[i] = std::exp2(x.v[i]);
+    return r;
+}
+
+#endif
+
+// x^y for x >= 0, built on log2 / exp2; exact zero for x = 0 and y > 0
+inline float4 pow(float4 x, float4 y)
+{
+    return select(cmpgt(x, float4(0.0f)), exp2(y * log2(x)), float4(0.0f));
+}
+
+// sine with ~1e-7 absolute error for small arguments; range reduction in float adds roughly
+// 1e-7 * |x| on top (about 1e-4 at |x| = 1000)
+inline float4 sin(float4 x)
+{
+    const float4 twoPi(6.28318530717958647692f), invTwoPi(0.15915494309189533577f);
+    const float4 pi(3.14159265358979323846f), halfPi(1.57079632679489661923f);
+    // reduce to [-pi, pi], then fold into [-pi/2, pi/2] where sin is odd and monotonic
+    x = x - round(x * invTwoPi) * twoPi;
+    float4 folded = copysign(pi, x) - x;
+    x = select(cmpgt(abs(x), halfPi), folded, x);
+    float4 x2 = x * x;
+    // Taylor series to x^11, remainder below 6e-8 on [-pi/2, pi/2]
+    float4 p(-2.5052108385441719e-8f);
+    p = madd(p, x2, float4(2.7557319223985891e-6f));
+    p = madd(p, x2, float4(-1.9841269841269841e-4f));
+    p = madd(p, x2, float4(8.3333333333333333e-3f));
+    p = madd(p, x2, float4(-1.6666666666666667e-1f));
+    return madd(p * x2, x, x);
+}
+
+inline float4 cos(float4 x) { return sin(x + float4(1.57079632679489661923f)); }
+
+inline float4 floor(float4 x)
+{
+    float4 r = round(x);
+    return r - select(cmpgt(r, x), float4(1.0f), float4(0.0f));
+}
+
+// four-quadrant arctangent, ~2e-6 rad absolute error
+inline float4 atan2(float4 y, float4 x)
+{
+    const float4 pi(3.14159265358979323846f), halfPi(1.57079632679489661923f);
+    float4 ax = abs(x), ay = abs(y);
+    // atan on [0, 1] of the smaller over the larger magnitude, then unfold the octant
+    float4 lo = min(ax, ay), hi = max(ax, ay);
+    float4 z = lo / max(hi, float4(1e-30f));
+    float4 z2 = z * z;
+    float4 p(-0.0117212f);
+    p = madd(p, z2, float4(0.05265332f));
+    p = madd(p, z2, float4(-0.11643287f));
+    p = madd(p, z2, float4(0.19354346f));
+    p = madd(p, z2, float4(-0.33262347f));
+    p = madd(p, z2, float4(0.99997726f));
+    float4 a = p * z;
+    a = select(cmpgt(ay, ax), halfPi - a, a);
+    a = select(cmplt(x, float4(0.0f)), pi - a, a);
+    return copysign(a, y);
+}
+
+} // namespace simd
+
+#endif
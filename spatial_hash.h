@@ -0,0 +1,140 @@
+#ifndef SPATIAL_HASH_H
+#define SPATIAL_HASH_H
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <vector>
+
+// Uniform-grid spatial hash over points for radius queries. Cells are hashed into a table that
+// grows with the number of items, so a query only visits the cells overlapping its sphere and
+// costs the same for 1k or 1M items at equal density. Items keep their cell and their slot in the
+// bucket: update() is O(1) and only touches the table when a point crosses into another cell.
+class SpatialHash
+{
+public:
+    explicit SpatialHash(float cellSize = 1.0f) : cellSize(cellSize), invCellSize(1.0f / cellSize)
+    {
+        buckets.resize(64);
+    }
+
+    // drops all items; queries of about the cell size are the cheapest
+    void reset(float newCellSize, size_t expectedCount = 0)
+    {
+        cellSize = newCellSize;
+        invCellSize = 1.0f / newCellSize;
+        items.clear();
+        size_t tableSize = 64;
+        while (tableSize < expectedCount)
+            tableSize *= 2;
+        buckets.assign(tableSize, std::vector<unsigned int>());
+    }
+
+    // adds a point and returns its id; ids are consecutive from 0
+    unsigned int insert(const glm::vec3& position)
+    {
+        unsigned int id = (unsigned int)items.size();
+        items.push_back(Item());
+        items[id].position = position;
+        cellOf(position, items[id].cell);
+        link(id);
+        if (items.size() > buckets.size())
+            rehash(buckets.size() * 2);
+        return id;
+    }
+
+    void update(unsigned int id, const glm::vec3& position)
+    {
+        Item& item = items[id];
+        item.position = position;
+        int cell[3];
+        cellOf(position, cell);
+        if (cell[0] == item.cell[0] && cell[1] == item.cell[1] && cell[2] == item.cell[2])
+            return;
+        unlink(id);
+        item.cell[0] = cell[0];
+        item.cell[1] = cell[1];
+        item.cell[2] = cell[2];
+        link(id);
+    }
+
+    size_t size() const { return items.size(); }
+    const glm::vec3& position(unsigned int id) const { return items[id].position; }
+
+    // calls fn(id, squaredDistance) for every item within radius of center
+    template <typename Fn>
+    void query(const glm::vec3& center, float radius, Fn fn) const
+    {
+        int lower[3], upper[3];
+        cellOf(center - glm::vec3(radius), lower);
+        cellOf(center + glm::vec3(radius), upper);
+        float radiusSquared = radius * radius;
+        for (int z = lower[2]; z <= upper[2]; z++)
+            for (int y = lower[1]; y <= upper[1]; y++)
+                for (int x = lower[0]; x <= upper[0]; x++)
+                    for (unsigned int id : buckets[bucketOf(x, y, z)])
+                    {
+                        const Item& item = items[id];
+                        // other cells can alias into the same bucket
+                        if (item.cell[0] != x || item.cell[1] != y || item.cell[2] != z)
+                            continue;
+                        glm::vec3 d = item.position - center;
+                        float distanceSquared = glm::dot(d, d);
+                        if (distanceSquared <= radiusSquared)
+                            fn(id, distanceSquared);
+                    }
+    }
+
+private:
+    struct Item
+    {
+        glm::vec3 position;
+        int cell[3];
+        unsigned int slot; // index inside its bucket
+    };
+
+    float cellSize, invCellSize;
+    std::vector<Item> items;
+    std::vector<std::vector<unsigned int>> buckets; // power-of-two count
+
+    void cellOf(const glm::vec3& p, int cell[3]) const
+    {
+        cell[0] = (int)std::floor(p.x * invCellSize);
+        cell[1] = (int)std::floor(p.y * invCellSize);
+        cell[2] = (int)std::floor(p.z * invCellSize);
+    }
+
+    size_t bucketOf(int x, int y, int z) const
+    {
+        unsigned int h = (unsigned int)x * 73856093u ^ (unsigned int)y * 19349663u ^ (unsigned int)z * 83492791u;
+        return h & (buckets.size() - 1);
+    }
+
+    void link(unsigned int id)
+    {
+        Item& item = items[id];
+        std::vector<unsigned int>& bucket = buckets[bucketOf(item.cell[0], item.cell[1], item.cell[2])];
+        item.slot = (unsigned int)bucket.size();
+        bucket.push_back(id);
+    }
+
+    // swap-removes the item from its bucket
+    void unlink(unsigned int id)
+    {
+        const Item& item = items[id];
+        std::vector<unsigned int>& bucket = buckets[bucketOf(item.cell[0], item.cell[1], item.cell[2])];
+        unsigned int last = bucket.back();
+        bucket[item.slot] = last;
+        items[last].slot = item.slot;
+        bucket.pop_back();
+    }
+
+    void rehash(size_t tableSize)
+    {
+        buckets.assign(tableSize, std::vector<unsigned int>());
+        for (unsigned int id = 0; id < items.size(); id++)
+            link(id);
+    }
+};
+
+#endif
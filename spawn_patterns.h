@@ -0,0 +1,263 @@
+#ifndef SPAWN_PATTERNS_H
+#define SPAWN_PATTERNS_H
+
+#include <glm/glm.hpp>
+
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Procedural layouts for spawning many objects at once. Every generator appends its positions to
+// out and returns how many it added. Instance i of a layout is a pure function of i (or of its
+// Poisson cell), so the work is split over the thread pool with each thread writing its own slice
+// of the already resized output; nothing is pushed one element at a time.
+class SpawnPatterns
+{
+public:
+    // counts.x * counts.y * counts.z points starting at origin, x varying fastest
+    static size_t grid(std::vector<glm::vec3>& out, const glm::vec3& origin, const glm::ivec3& counts, const glm::vec3& spacing, ThreadPool& pool)
+    {
+        size_t n = (size_t)std::max(counts.x, 0) * std::max(counts.y, 0) * std::max(counts.z, 0);
+        glm::vec3* dst = grow(out, n);
+        pool.parallelFor(n, CHUNK, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+            {
+                size_t x = i % counts.x, y = i / counts.x % counts.y, z = i / ((size_t)counts.x * counts.y);
+                dst[i] = origin + glm::vec3((float)x, (float)y, (float)z) * spacing;
+            }
+        });
+        return n;
+    }
+
+    // sunflower (Vogel) spiral in the xz plane: point i at radius spacing * sqrt(i), turned by the
+    // golden angle, so the disc is filled at even density. rise lifts each point above the last
+    static size_t spiral(std::vector<glm::vec3>& out, const glm::vec3& center, size_t count, float spacing, float rise, ThreadPool& pool)
+    {
+        const float goldenAngle = 2.39996322972865332f;
+        glm::vec3* dst = grow(out, count);
+        pool.parallelFor(count, CHUNK, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+            {
+                float r = spacing * std::sqrt((float)i);
+                // reduce the angle in double so large indices keep their precision
+                float theta = (float)std::fmod((double)i * goldenAngle, 2.0 * 3.14159265358979323846);
+                dst[i] = center + glm::vec3(r * std::cos(theta), rise * (float)i, r * std::sin(theta));
+            }
+        });
+        return count;
+    }
+
+    // blue-noise points in the xz rectangle [corner, corner + size] (y = corner.y), no two closer
+    // than radius. Darts are thrown per cell of a grid with diagonal radius, so a cell holds at most
+    // one point and a candidate only has to be checked against the 5 x 5 cells around it. Cells
+    // three apart cannot see each other, so the grid is swept in 3 x 3 phases whose cells are all
+    // filled in parallel without locks. The result depends only on seed, not on the thread count.
+    static size_t poissonDisk(std::vector<glm::vec3>& out, const glm::vec3& corner, const glm::vec2& size, float radius, unsigned int seed, ThreadPool& pool)
+    {
+        float cellSize = radius / std::sqrt(2.0f);
+        int width = std::max(1, (int)std::ceil(size.x / cellSize));
+        int depth = std::max(1, (int)std::ceil(size.y / cellSize));
+        std::vector<glm::vec2> cells((size_t)width * depth, glm::vec2(EMPTY));
+        float radiusSquared = radius * radius;
+
+        // cells of each phase that can still take a point, and per cell a mask of its 4 x 4
+        // sub-squares not yet inside any neighbour's disk. Darts only go to uncovered sub-squares,
+        // and a cell leaves its list once it is filled or covered, so late rounds stay cheap
+        std::vector<unsigned int> open[9];
+        for (int phase = 0; phase < 9; phase++)
+            for (int cz = phase / 3; cz < depth; cz += 3)
+                for (int cx = phase % 3; cx < width; cx += 3)
+                    open[phase].push_back((unsigned int)(cz * width + cx));
+        std::vector<unsigned short> uncovered((size_t)width * depth, 0xFFFF);
+        // step (round * 9 + phase) at which each cell got its point, -1 while empty; a cell's mask
+        // already accounts for the points placed before its previous visit, nine steps ago
+        std::vector<int> filledAt((size_t)width * depth, -1);
+        const float subSize = cellSize / 4.0f;
+
+        for (int round = 0; round < POISSON_ROUNDS; round++)
+            for (int phase = 0; phase < 9; phase++)
+            {
+                std::vector<unsigned int>& cellsLeft = open[phase];
+                const int step = round * 9 + phase, since = std::max(step - 9, 0);
+                pool.parallelFor(cellsLeft.size(), CHUNK / 8, [&](size_t begin, size_t end) {
+                    for (size_t k = begin; k < end; k++)
+                    {
+                        unsigned int index = cellsLeft[k];
+                        int cx = (int)(index % width), cz = (int)(index / width);
+                        unsigned int mask = uncovered[index];
+                        // pick one of the uncovered sub-squares, then a point inside it
+                        unsigned int h = hash(seed ^ hash(index * 64u + (unsigned int)round));
+                        int sub = 0;
+                        for (int pick = (int)(h % (unsigned int)popCount(mask)); pick >= 0; sub++)
+                            pick -= (mask >> sub) & 1u;
+                        sub--;
+                        glm::vec2 low(cx * cellSize, cz * cellSize);
+                        h = hash(h);
+                        glm::vec2 candidate(low.x + ((sub & 3) + unit(h)) * subSize, low.y + ((sub >> 2) + unit(hash(h))) * subSize);
+
+                        int x0 = std::max(cx - 2, 0), x1 = std::min(cx + 2, width - 1);
+                        int z0 = std::max(cz - 2, 0), z1 = std::min(cz + 2, depth - 1);
+                        // branch-free nearest distance; empty cells sit far away and never conflict
+                        float nearest = radiusSquared;
+                        for (int z = z0; z <= z1; z++)
+                        {
+                            const glm::vec2* row = &cells[(size_t)z * width];
+                            for (int x = x0; x <= x1; x++)
+                            {
+                                float dx = row[x].x - candidate.x, dz = row[x].y - candidate.y;
+                                nearest = std::min(nearest, dx * dx + dz * dz);
+                            }
+                        }
+                        bool free = nearest >= radiusSquared && candidate.x < size.x && candidate.y < size.y;
+                        for (int z = z0; z <= z1 && !free && mask; z++)
+                            for (int x = x0; x <= x1; x++)
+                            {
+                                size_t n = (size_t)z * width + x;
+                                if (filledAt[n] < since)
+                                    continue;
+                                const glm::vec2& p = cells[n];
+                                // a sub-square is covered when its farthest corner is inside the disk;
+                                // that distance splits into a column and a row term
+                                float fx[4], fz[4];
+                                for (int i = 0; i < 4; i++)
+                                {
+                                    float ex = std::max(std::fabs(p.x - low.x - i * subSize), std::fabs(p.x - low.x - (i + 1) * subSize));
+                                    float ez = std::max(std::fabs(p.y - low.y - i * subSize), std::fabs(p.y - low.y - (i + 1) * subSize));
+                                    fx[i] = ex * ex;
+                                    fz[i] = ez * ez;
+                                }
+                                unsigned int covered = 0;
+                                for (int b = 0; b < 16; b++)
+                                    covered |= (unsigned int)(fx[b & 3] + fz[b >> 2] < radiusSquared) << b;
+                                mask &= ~covered;
+                            }
+                        if (free)
+                        {
+                            cells[index] = candidate;
+                            filledAt[index] = step;
+                            mask = 0;
+                        }
+                        uncovered[index] = (unsigned short)mask;
+                    }
+                });
+                cellsLeft.erase(std::remove_if(cellsLeft.begin(), cellsLeft.end(), [&](unsigned int index) { return uncovered[index] == 0; }),
+                    cellsLeft.end());
+            }
+
+        // compact the filled cells: count per row, prefix sum, then every row writes its own range
+        std::vector<size_t> rowStart(depth + 1, 0);
+        pool.parallelFor(depth, 64, [&](size_t begin, size_t end) {
+            for (size_t z = begin; z < end; z++)
+                rowStart[z + 1] = std::count_if(cells.begin() + z * width, cells.begin() + (z + 1) * width,
+                    [](const glm::vec2& c) { return c.x != EMPTY; });
+        });
+        for (int z = 0; z < depth; z++)
+            rowStart[z + 1] += rowStart[z];
+        glm::vec3* dst = grow(out, rowStart[depth]);
+        pool.parallelFor(depth, 64, [&](size_t begin, size_t end) {
+            for (size_t z = begin; z < end; z++)
+            {
+                size_t o = rowStart[z];
+                for (int x = 0; x < width; x++)
+                {
+                    const glm::vec2& c = cells[z * width + x];
+                    if (c.x != EMPTY)
+                        dst[o++] = corner + glm::vec3(c.x, 0.0f, c.y);
+                }
+            }
+        });
+        return rowStart[depth];
+    }
+
+    // count points evenly spaced by arc length along the Catmull-Rom spline through controlPoints
+    // (at least two), from the first to the last control point or around the loop when closed
+    static size_t alongCurve(std::vector<glm::vec3>& out, const std::vector<glm::vec3>& controlPoints, bool closed, size_t count, ThreadPool& pool)
+    {
+        if (controlPoints.size() < 2 || count == 0)
+            return 0;
+        size_t segments = closed ? controlPoints.size() : controlPoints.size() - 1;
+
+        // arc length table: cumulative length at each sample of every segment
+        std::vector<float> length(segments * CURVE_SAMPLES + 1, 0.0f);
+        glm::vec3 previous = curvePoint(controlPoints, closed, 0, 0.0f);
+        for (size_t s = 0; s < segments; s++)
+            for (int k = 1; k <= CURVE_SAMPLES; k++)
+            {
+                glm::vec3 p = curvePoint(controlPoints, closed, s, (float)k / CURVE_SAMPLES);
+                size_t at = s * CURVE_SAMPLES + k;
+                length[at] = length[at - 1] + glm::length(p - previous);
+                previous = p;
+            }
+
+        float total = length.back();
+        // a closed loop must not place its last point on top of the first
+        float step = total / (float)(closed ? count : std::max<size_t>(count - 1, 1));
+        glm::vec3* dst = grow(out, count);
+        pool.parallelFor(count, CHUNK, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+            {
+                float target = std::min(step * (float)i, total);
+                size_t at = std::upper_bound(length.begin() + 1, length.end() - 1, target) - length.begin();
+                float span = length[at] - length[at - 1];
+                float f = span > 0.0f ? (target - length[at - 1]) / span : 0.0f;
+                float u = ((float)((at - 1) % CURVE_SAMPLES) + f) / CURVE_SAMPLES;
+                dst[i] = curvePoint(controlPoints, closed, (at - 1) / CURVE_SAMPLES, u);
+            }
+        });
+        return count;
+    }
+
+private:
+    static constexpr size_t CHUNK = 16384;
+    // dart rounds per cell; later rounds mostly miss, 24 leaves the field close to maximal
+    static constexpr int POISSON_ROUNDS = 24;
+    // linear pieces per spline segment in the arc length table
+    static constexpr int CURVE_SAMPLES = 256;
+    static constexpr float EMPTY = -1e18f; // squared distances stay finite
+
+    static glm::vec3* grow(std::vector<glm::vec3>& out, size_t count)
+    {
+        size_t first = out.size();
+        out.resize(first + count);
+        return out.data() + first;
+    }
+
+    static int popCount(unsigned int m)
+    {
+        int n = 0;
+        for (; m; m &= m - 1)
+            n++;
+        return n;
+    }
+
+    static unsigned int hash(unsigned int x)
+    {
+        x ^= x >> 16;
+        x *= 0x7feb352du;
+        x ^= x >> 15;
+        x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return x;
+    }
+
+    // [0, 1) from the top 24 bits
+    static float unit(unsigned int h) { return (float)(h >> 8) * (1.0f / 16777216.0f); }
+
+    static glm::vec3 curvePoint(const std::vector<glm::vec3>& p, bool closed, size_t segment, float u)
+    {
+        size_t n = p.size();
+        auto at = [&](long i) {
+            if (closed)
+                return p[(size_t)((i % (long)n + (long)n) % (long)n)];
+            return p[(size_t)std::min(std::max(i, 0L), (long)n - 1)];
+        };
+        long s = (long)segment;
+        glm::vec3 p0 = at(s - 1), p1 = at(s), p2 = at(s + 1), p3 = at(s + 2);
+        float u2 = u * u, u3 = u2 * u;
+        return 0.5f * ((2.0f * p1) + (p2 - p0) * u + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * u2 + (3.0f * p1 - p0 - 3.0f * p2 + p3) * u3);
+    }
+};
+
+#endif
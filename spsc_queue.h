@@ -0,0 +1,56 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+// Bounded single-producer single-consumer ring. One thread pushes, one thread pops; neither ever
+// blocks, locks or allocates. Each side owns one index and only reads the other's (acquire) when
+// its cached copy says the ring looks full or empty, so in the steady state the two threads do
+// not bounce a cache line per element.
+template <typename T, size_t CAPACITY>
+class SpscQueue
+{
+    static_assert(CAPACITY >= 2 && (CAPACITY & (CAPACITY - 1)) == 0, "capacity must be a power of two");
+
+public:
+    // producer side; false (and nothing written) when the ring is full
+    bool push(const T& value)
+    {
+        size_t tail = tailIndex.load(std::memory_order_relaxed);
+        if (tail - cachedHead == CAPACITY)
+        {
+            cachedHead = headIndex.load(std::memory_order_acquire);
+            if (tail - cachedHead == CAPACITY)
+                return false;
+        }
+        slots[tail & (CAPACITY - 1)] = value;
+        tailIndex.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer side; false when the ring is empty
+    bool pop(T& value)
+    {
+        size_t head = headIndex.load(std::memory_order_relaxed);
+        if (head == cachedTail)
+        {
+            cachedTail = tailIndex.load(std::memory_order_acquire);
+            if (head == cachedTail)
+                return false;
+        }
+        value = slots[head & (CAPACITY - 1)];
+        headIndex.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    // indices only grow; the producer and consumer halves sit on separate cache lines
+    alignas(64) std::atomic<size_t> tailIndex{ 0 };
+    size_t cachedHead = 0;
+    alignas(64) std::atomic<size_t> headIndex{ 0 };
+    size_t cachedTail = 0;
+    alignas(64) T slots[CAPACITY];
+};
+
+#endif
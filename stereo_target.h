@@ -0,0 +1,239 @@
+#ifndef STEREO_TARGET_H
+#define STEREO_TARGET_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// Single-pass stereo: both eyes are rendered by one submission into the two layers of an array
+// render target, then presented side by side.
+//
+// With GL_OVR_multiview the target's layers are attached as two views and the driver runs each
+// draw once per view; the vertex shader picks its eye from gl_ViewID_OVR. Without it, instanced
+// stereo is used: every instanced draw is issued with twice the instances (per-instance
+// attributes advance every second instance, see repeat in InstanceBatches::drawElements), even
+// instances go to the left eye and odd ones to the right, and the vertex shader routes each to its
+// layer through gl_Layer, which GL 3.3 allows there only with GL_ARB_shader_viewport_layer_array
+// or GL_AMD_vertex_shader_layer. Either way geometry, instance data and uniforms are sent once.
+//
+// Vertex shaders opt in with an #ifdef STEREO_EYE path (see 6.multiple_lights.vs): buildProgram()
+// defines STEREO_EYE, the eye index (0 left, 1 right), after the #version line and the shader then
+// transforms with eyeViewProjection[STEREO_EYE], and under STEREO_INSTANCED also writes gl_Layer.
+class StereoTarget
+{
+public:
+    enum Path
+    {
+        UNAVAILABLE,
+        MULTIVIEW,
+        INSTANCED
+    };
+
+    // picks the path the current context supports; call after the GL functions are loaded
+    Path detect()
+    {
+        framebufferTextureMultiview = nullptr;
+        if (glfwExtensionSupported("GL_OVR_multiview"))
+            framebufferTextureMultiview = (FramebufferTextureMultiviewProc)glfwGetProcAddress("glFramebufferTextureMultiviewOVR");
+        if (framebufferTextureMultiview)
+        {
+            mode = MULTIVIEW;
+            prelude = "#extension GL_OVR_multiview : require\n"
+                      "layout (num_views = 2) in;\n"
+                      "#define STEREO_EYE int(gl_ViewID_OVR)\n";
+        }
+        else if (glfwExtensionSupported("GL_ARB_shader_viewport_layer_array") || glfwExtensionSupported("GL_AMD_vertex_shader_layer"))
+        {
+            mode = INSTANCED;
+            prelude = glfwExtensionSupported("GL_ARB_shader_viewport_layer_array")
+                ? "#extension GL_ARB_shader_viewport_layer_array : require\n"
+                : "#extension GL_AMD_vertex_shader_layer : require\n";
+            prelude += "#define STEREO_EYE (gl_InstanceID & 1)\n"
+                       "#define STEREO_INSTANCED\n";
+        }
+        else
+            mode = UNAVAILABLE;
+        return mode;
+    }
+
+    Path path() const { return mode; }
+
+    // instances to draw per object: 2 on the instanced path, where each object is drawn once per eye
+    GLuint instanceRepeat() const { return mode == INSTANCED ? 2 : 1; }
+
+    // links the stereo variant of a vertex / fragment program pair; 0 if it fails to build
+    unsigned int buildProgram(const char* vertexPath, const char* fragmentPath) const
+    {
+        std::string vertexCode = readFile(vertexPath), fragmentCode = readFile(fragmentPath);
+        if (mode == UNAVAILABLE || vertexCode.empty() || fragmentCode.empty())
+            return 0;
+        // the #extension directives have to come before anything but the #version line
+        size_t versionEnd = vertexCode.find('\n', vertexCode.find("#version"));
+        if (versionEnd == std::string::npos)
+            return 0;
+        vertexCode.insert(versionEnd + 1, prelude);
+
+        unsigned int vertex = compile(GL_VERTEX_SHADER, vertexCode, vertexPath);
+        unsigned int fragment = compile(GL_FRAGMENT_SHADER, fragmentCode, fragmentPath);
+        unsigned int program = 0;
+        if (vertex && fragment)
+        {
+            program = glCreateProgram();
+            glAttachShader(program, vertex);
+            glAttachShader(program, fragment);
+            glLinkProgram(program);
+            int success;
+            glGetProgramiv(program, GL_LINK_STATUS, &success);
+            if (!success)
+            {
+                char log[1024];
+                glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+                std::cout << "ERROR::STEREO::PROGRAM_LINKING_ERROR: " << vertexPath << "\n" << log << std::endl;
+                glDeleteProgram(program);
+                program = 0;
+            }
+        }
+        glDeleteShader(vertex);
+        glDeleteShader(fragment);
+        return program;
+    }
+
+    // renders into colorLayers and depthLayers, two-layer GL_TEXTURE_2D_ARRAY color and depth
+    // textures of eyeWidth x eyeHeight the caller owns (the frame graph's transients); the
+    // framebuffer is only re-attached when they change
+    bool attach(unsigned int color, unsigned int depth, int eyeWidth, int eyeHeight)
+    {
+        if (mode == UNAVAILABLE)
+            return false;
+        if (color == colorLayers && depth == depthLayers && fbo)
+            return complete;
+        if (!fbo)
+        {
+            glGenFramebuffers(1, &fbo);
+            glGenFramebuffers(1, &readFbo);
+        }
+        colorLayers = color;
+        depthLayers = depth;
+        width = eyeWidth;
+        height = eyeHeight;
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        if (mode == MULTIVIEW)
+        {
+            framebufferTextureMultiview(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, colorLayers, 0, 0, 2);
+            framebufferTextureMultiview(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthLayers, 0, 0, 2);
+        }
+        else
+        {
+            // layered attachments: gl_Layer selects the eye
+            glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, colorLayers, 0);
+            glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, depthLayers, 0);
+        }
+        complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (!complete)
+            std::cout << "ERROR::STEREO::FRAMEBUFFER_INCOMPLETE" << std::endl;
+        return complete;
+    }
+
+    // makes both eyes the render target; clear afterwards clears both
+    void bind() const
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glViewport(0, 0, width, height);
+    }
+
+    // copies the left eye into the left half of the default framebuffer and the right eye into
+    // the right half, the side-by-side format 3D displays take; leaves the default framebuffer bound
+    void present(int framebufferWidth, int framebufferHeight) const
+    {
+        if (!complete)
+            return;
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, readFbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        int half = framebufferWidth / 2;
+        for (int eye = 0; eye < 2; eye++)
+        {
+            glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, colorLayers, 0, eye);
+            glBlitFramebuffer(0, 0, width, height, eye * half, 0, eye * half + half, framebufferHeight, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, framebufferWidth, framebufferHeight);
+    }
+
+    // view-projections of two parallel eyes separation apart along the view's x axis
+    static void eyeViewProjections(const glm::mat4& projection, const glm::mat4& view, float separation, glm::mat4 out[2])
+    {
+        for (int eye = 0; eye < 2; eye++)
+        {
+            float offset = (eye == 0 ? 0.5f : -0.5f) * separation; // the left eye sees the world shifted right
+            out[eye] = projection * glm::translate(glm::mat4(1.0f), glm::vec3(offset, 0.0f, 0.0f)) * view;
+        }
+    }
+
+    // (expects program in use)
+    static void setEyeUniforms(unsigned int program, const glm::mat4 eyeViewProjection[2])
+    {
+        glUniformMatrix4fv(glGetUniformLocation(program, "eyeViewProjection"), 2, GL_FALSE, glm::value_ptr(eyeViewProjection[0]));
+    }
+
+    // the attached textures stay with their owner
+    void destroy()
+    {
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteFramebuffers(1, &readFbo);
+        fbo = readFbo = colorLayers = depthLayers = 0;
+        width = height = 0;
+        complete = false;
+    }
+
+private:
+    typedef void (APIENTRY* FramebufferTextureMultiviewProc)(GLenum target, GLenum attachment, GLuint texture, GLint level, GLint baseViewIndex, GLsizei numViews);
+
+    Path mode = UNAVAILABLE;
+    std::string prelude;
+    FramebufferTextureMultiviewProc framebufferTextureMultiview = nullptr;
+    unsigned int fbo = 0, readFbo = 0, colorLayers = 0, depthLayers = 0;
+    int width = 0, height = 0;
+    bool complete = false;
+
+    static std::string readFile(const char* path)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR::STEREO::SHADER_NOT_FOUND: " << path << std::endl;
+            return std::string();
+        }
+        std::stringstream source;
+        source << file.rdbuf();
+        return source.str();
+    }
+
+    static unsigned int compile(GLenum type, const std::string& code, const char* path)
+    {
+        const char* text = code.c_str();
+        unsigned int shader = glCreateShader(type);
+        glShaderSource(shader, 1, &text, nullptr);
+        glCompileShader(shader);
+        int success;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            char log[1024];
+            glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+            std::cout << "ERROR::STEREO::SHADER_COMPILATION_ERROR: " << path << "\n" << log << std::endl;
+            glDeleteShader(shader);
+            return 0;
+        }
+        return shader;
+    }
+};
+
+#endif
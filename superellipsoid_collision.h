@@ -0,0 +1,524 @@
+#ifndef SUPERELLIPSOID_COLLISION_H
+#define SUPERELLIPSOID_COLLISION_H
+
+#include <glm/glm.hpp>
+
+#include "simd.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// Contact generation between superellipsoids placed by arbitrary affine transforms (the world
+// matrices of the scene graph, scale included).
+//
+// Broadphase: spatial hash. Cells are twice the largest box extent, so every box covers at most
+// 2 x 2 x 2 cells (1.5 per axis on average) and is entered into each of them; two boxes can only
+// overlap if they share a cell, and a pair is reported only from the cell holding the lower corner
+// of the overlap, so it is found once. The hash wraps cell coordinates into a table of about four cells per body; far
+// away bodies that alias into a cell are rejected by the box test. Entries are counting-sorted by
+// cell every call and the cells are then walked in memory order, split over the thread pool.
+//
+// Narrow phase: Minkowski portal refinement on exact support mappings. The unit superellipsoid
+// with exponents (n1, n2) is the unit ball of the nested norm
+//     ((|x|^p + |y|^p)^(q/p) + |z|^q)^(1/q),   p = 2 / n2, q = 2 / n1,
+// i.e. the inside-outside function used by the mesh generator. Its support point in a direction
+// is the gradient of the dual norm, which has the same nested form with the conjugate exponents,
+// so no tessellation or iteration is involved. Convexity needs n1, n2 <= 2; exponents are clamped
+// to [0.1, 1.9] for the collision shape.
+class SuperellipsoidCollision
+{
+public:
+    struct Contact
+    {
+        unsigned int a, b;   // body indices, a < b
+        glm::vec3 normal;    // unit, pointing from a towards b
+        float depth;         // distance b has to move along normal to separate
+        glm::vec3 point;     // midway between the deepest points of the two bodies
+    };
+
+    // portal refinement stops once the support plane moves less than this
+    float tolerance = 1e-4f;
+
+    void resize(size_t count)
+    {
+        bodies.resize(count);
+        boxMin.resize(count);
+        boxMax.resize(count);
+    }
+
+    size_t size() const { return bodies.size(); }
+
+    // shape i is the unit superellipsoid mapped by transform (linear part and translation). The
+    // exponents are clamped to [0.1, 1.9], so a body drawn outside that range (the sculpture reaches
+    // 2.0, the array's reactive shape 3.0) collides and is picked as the nearest convex shape: a
+    // slightly rounder cube or, past 2, a filled-in star
+    void setBody(size_t i, const glm::mat4& transform, float n1, float n2)
+    {
+        Body& body = bodies[i];
+        body.basis = glm::mat3(transform);
+        body.center = glm::vec3(transform[3]);
+        body.n1 = std::min(std::max(n1, 0.1f), 1.9f);
+        body.n2 = std::min(std::max(n2, 0.1f), 1.9f);
+        // conjugate exponents of p = 2 / n2 and q = 2 / n1, used by the support mapping
+        body.ps = 2.0f / (2.0f - body.n2);
+        body.qs = 2.0f / (2.0f - body.n1);
+        // the unit shape lies in [-1, 1]^3 for any exponents
+        glm::vec3 extent = glm::abs(body.basis[0]) + glm::abs(body.basis[1]) + glm::abs(body.basis[2]);
+        boxMin[i] = body.center - extent;
+        boxMax[i] = body.center + extent;
+    }
+
+    // inside-outside test against the collision shape of body i, i.e. with the clamped exponents
+    bool contains(size_t i, const glm::vec3& point) const
+    {
+        const Body& body = bodies[i];
+        glm::vec3 p = glm::inverse(body.basis) * (point - body.center);
+        float xy = std::pow(std::fabs(p.x), 2.0f / body.n2) + std::pow(std::fabs(p.y), 2.0f / body.n2);
+        return std::pow(xy, body.n2 / body.n1) + std::pow(std::fabs(p.z), 2.0f / body.n1) <= 1.0f;
+    }
+
+    // first point where origin + t * direction enters body i, as the ray parameter t >= 0, or -1 on
+    // a miss; 0 when the origin is inside. The shape is clipped to its [-1, 1]^3 box in local space,
+    // and since the inside-outside function is convex along the ray, a golden-section search finds
+    // a point inside (or proves there is none) and bisection then narrows down the entry.
+    float intersectRay(size_t i, const glm::vec3& origin, const glm::vec3& direction) const
+    {
+        const Body& body = bodies[i];
+        glm::mat3 inverse = glm::inverse(body.basis);
+        glm::vec3 o = inverse * (origin - body.center), d = inverse * direction;
+
+        float t0 = 0.0f, t1 = std::numeric_limits<float>::max();
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (d[axis] == 0.0f)
+            {
+                if (std::fabs(o[axis]) > 1.0f)
+                    return -1.0f;
+                continue;
+            }
+            float a = (-1.0f - o[axis]) / d[axis], b = (1.0f - o[axis]) / d[axis];
+            t0 = std::max(t0, std::min(a, b));
+            t1 = std::min(t1, std::max(a, b));
+        }
+        if (t0 > t1)
+            return -1.0f;
+
+        float p = 2.0f / body.n2, q = 2.0f / body.n1;
+        auto outside = [&](float t) {
+            glm::vec3 x = glm::abs(o + t * d);
+            return std::pow(std::pow(x.x, p) + std::pow(x.y, p), q / p) + std::pow(x.z, q) - 1.0f;
+        };
+        if (outside(t0) <= 0.0f)
+            return t0;
+
+        const float ratio = 0.38196601125f;
+        const float eps = 1e-6f * std::max(1.0f, t1);
+        float a = t0, b = t1;
+        float m = a + ratio * (b - a), fm = outside(m);
+        while (fm > 0.0f)
+        {
+            if (b - a < eps)
+                return -1.0f;
+            // probe the larger side and keep the bracket around the lower value
+            bool right = b - m > m - a;
+            float c = right ? m + ratio * (b - m) : m - ratio * (m - a), fc = outside(c);
+            if (fc < fm)
+            {
+                (right ? a : b) = m;
+                m = c;
+                fm = fc;
+            }
+            else
+                (right ? b : a) = c;
+        }
+
+        // outside at t0, inside at m
+        float lo = t0, hi = m;
+        while (hi - lo > eps)
+        {
+            float mid = 0.5f * (lo + hi);
+            (outside(mid) > 0.0f ? lo : hi) = mid;
+        }
+        return hi;
+    }
+
+    // world-space boxes of the bodies as placed by setBody
+    const std::vector<glm::vec3>& lowerCorners() const { return boxMin; }
+    const std::vector<glm::vec3>& upperCorners() const { return boxMax; }
+
+    // finds all touching pairs; the result is sorted by (a, b)
+    const std::vector<Contact>& detect(ThreadPool& pool)
+    {
+        contactList.clear();
+        pairs.clear();
+        size_t n = bodies.size();
+        if (n < 2)
+            return contactList;
+
+        buildGrid(pool);
+
+        // all box pairs within each cell
+        std::mutex pairsMutex;
+        pool.parallelFor(cellStart.size() - 1, 4096, [&](size_t begin, size_t end) {
+            std::vector<std::pair<unsigned int, unsigned int>> local;
+            for (size_t key = begin; key < end; key++)
+                for (unsigned int e = cellStart[key]; e + 1 < cellStart[key + 1]; e++)
+                    for (unsigned int f = e + 1; f < cellStart[key + 1]; f++)
+                    {
+                        // the first shared cell along an axis is the first cell of one of the two
+                        // boxes, so the overlap corner lies here when every axis is covered
+                        if (((cellEntries[e] | cellEntries[f]) >> FIRST_CELL_SHIFT) != 7u)
+                            continue;
+                        unsigned int i = cellEntries[e] & BODY_MASK, j = cellEntries[f] & BODY_MASK;
+                        if (overlaps(i, j))
+                            local.push_back(i < j ? std::make_pair(i, j) : std::make_pair(j, i));
+                    }
+            std::lock_guard<std::mutex> lock(pairsMutex);
+            pairs.insert(pairs.end(), local.begin(), local.end());
+        });
+        std::sort(pairs.begin(), pairs.end());
+
+        // narrow phase; each pair writes its own slot, so no synchronisation is needed
+        pairContacts.resize(pairs.size());
+        pairHit.resize(pairs.size());
+        pool.parallelFor(pairs.size(), 64, [&](size_t begin, size_t end) {
+            for (size_t k = begin; k < end; k++)
+            {
+                pairHit[k] = collide(pairs[k].first, pairs[k].second, pairContacts[k]);
+                pairContacts[k].a = pairs[k].first;
+                pairContacts[k].b = pairs[k].second;
+            }
+        });
+        for (size_t k = 0; k < pairs.size(); k++)
+            if (pairHit[k])
+                contactList.push_back(pairContacts[k]);
+        return contactList;
+    }
+
+    const std::vector<Contact>& contacts() const { return contactList; }
+
+    // pairs whose boxes overlapped in the last detect()
+    size_t candidatePairCount() const { return pairs.size(); }
+
+private:
+    struct Body
+    {
+        glm::mat3 basis;
+        glm::vec3 center;
+        float n1, n2;
+        float ps, qs;
+    };
+
+    // point of the Minkowski difference a - b together with the two points it came from
+    struct SupportPoint
+    {
+        glm::vec3 v, onA, onB;
+    };
+
+    std::vector<Body> bodies;
+    std::vector<glm::vec3> boxMin, boxMax;
+
+    // spatial hash: cell k of the gridX * gridY * gridZ table lists the bodies whose boxes cover it
+    // in cellEntries[cellStart[k], cellStart[k + 1]); an entry is the body index with three flags
+    // on top telling along which axes this is the first cell the box covers
+    static constexpr unsigned int FIRST_CELL_SHIFT = 29;
+    static constexpr unsigned int BODY_MASK = (1u << FIRST_CELL_SHIFT) - 1;
+
+    // wrapped first cell of every box and whether it reaches into the next cell along x, y, z
+    struct CellSpan
+    {
+        int x, y, z;
+        bool nextX, nextY, nextZ;
+    };
+    std::vector<CellSpan> spans;
+    std::vector<unsigned int> cellStart, cellEntries, cellFill;
+    int gridX = 1, gridY = 1, gridZ = 1;
+
+    std::vector<std::pair<unsigned int, unsigned int>> pairs;
+    std::vector<Contact> pairContacts;
+    std::vector<unsigned char> pairHit;
+    std::vector<Contact> contactList;
+
+
+    bool overlaps(unsigned int i, unsigned int j) const
+    {
+        return boxMin[i].x <= boxMax[j].x && boxMin[j].x <= boxMax[i].x &&
+               boxMin[i].y <= boxMax[j].y && boxMin[j].y <= boxMax[i].y &&
+               boxMin[i].z <= boxMax[j].z && boxMin[j].z <= boxMax[i].z;
+    }
+
+    // calls fn(entry) with the entry's table cell for every cell the box of body i covers
+    template <typename Fn>
+    void forEachCell(size_t i, Fn fn) const
+    {
+        const CellSpan& span = spans[i];
+        for (int dz = 0; dz <= (int)span.nextZ; dz++)
+        {
+            int z = span.z + dz == gridZ ? 0 : span.z + dz;
+            for (int dy = 0; dy <= (int)span.nextY; dy++)
+            {
+                int y = span.y + dy == gridY ? 0 : span.y + dy;
+                for (int dx = 0; dx <= (int)span.nextX; dx++)
+                {
+                    int x = span.x + dx == gridX ? 0 : span.x + dx;
+                    unsigned int first = (dx == 0 ? 1u : 0u) | (dy == 0 ? 2u : 0u) | (dz == 0 ? 4u : 0u);
+                    fn((unsigned int)(x + gridX * (y + gridY * z)), (unsigned int)i | first << FIRST_CELL_SHIFT);
+                }
+            }
+        }
+    }
+
+    void buildGrid(ThreadPool& pool)
+    {
+        size_t n = bodies.size();
+        glm::vec3 largest(0.0f), lower = boxMin[0], upper = boxMin[0];
+        for (size_t i = 0; i < n; i++)
+        {
+            largest = glm::max(largest, boxMax[i] - boxMin[i]);
+            lower = glm::min(lower, boxMin[i]);
+            upper = glm::max(upper, boxMax[i]);
+        }
+        float cellSize = 2.0f * std::max(std::max(largest.x, largest.y), std::max(largest.z, 1e-6f));
+        float invCellSize = 1.0f / cellSize;
+
+        // cells spanned by the scene, halved along the longest axis until the table holds about
+        // four cells per body; at least three per axis so a box never wraps onto itself
+        double extent[3];
+        for (int k = 0; k < 3; k++)
+            extent[k] = std::min((double)(upper[k] - lower[k]) * invCellSize + 1.0, 1e6);
+        while (extent[0] * extent[1] * extent[2] > 4.0 * n + 27.0)
+        {
+            int k = extent[1] > extent[0] ? 1 : 0;
+            if (extent[2] > extent[k])
+                k = 2;
+            extent[k] = std::ceil(extent[k] * 0.5);
+        }
+        gridX = std::max(3, (int)extent[0]);
+        gridY = std::max(3, (int)extent[1]);
+        gridZ = std::max(3, (int)extent[2]);
+
+        spans.resize(n);
+        pool.parallelFor(n, 4096, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+            {
+                glm::vec3 first = glm::min((boxMin[i] - lower) * invCellSize, glm::vec3(1e9f));
+                glm::vec3 last = glm::min((boxMax[i] - lower) * invCellSize, glm::vec3(1e9f));
+                CellSpan& span = spans[i];
+                span.x = (int)first.x % gridX;
+                span.y = (int)first.y % gridY;
+                span.z = (int)first.z % gridZ;
+                span.nextX = (int)last.x != (int)first.x;
+                span.nextY = (int)last.y != (int)first.y;
+                span.nextZ = (int)last.z != (int)first.z;
+            }
+        });
+
+        // counting sort of the entries by cell
+        size_t cellCount = (size_t)gridX * gridY * gridZ;
+        cellStart.assign(cellCount + 1, 0);
+        for (size_t i = 0; i < n; i++)
+            forEachCell(i, [&](unsigned int key, unsigned int) { cellStart[key + 1]++; });
+        for (size_t k = 0; k < cellCount; k++)
+            cellStart[k + 1] += cellStart[k];
+        cellFill.assign(cellStart.begin(), cellStart.end() - 1);
+        cellEntries.resize(cellStart[cellCount]);
+        for (size_t i = 0; i < n; i++)
+            forEachCell(i, [&](unsigned int key, unsigned int entry) { cellEntries[cellFill[key]++] = entry; });
+    }
+
+    // support points of the unit shapes of two bodies at once (the two halves of a Minkowski
+    // support): gradients of the dual nested norms, with all powers taken in the log domain and
+    // the x, y, z lanes side by side. The two dependency chains overlap and share the scalar steps.
+    static void unitSupports(const Body* body[2], const glm::vec3 d[2], glm::vec3 s[2])
+    {
+        using simd::float4;
+        float4 magnitude[2], logs[2];
+        float powers[2][4];
+        for (int k = 0; k < 2; k++)
+        {
+            // the support point does not depend on |d|; a unit maximum keeps the powers in range
+            float largest = std::max(std::fabs(d[k].x), std::max(std::fabs(d[k].y), std::fabs(d[k].z)));
+            largest = std::max(largest, 1e-30f);
+            magnitude[k] = simd::abs(float4(d[k].x, d[k].y, d[k].z, largest)) * (1.0f / largest);
+            logs[k] = simd::log2(magnitude[k]);
+            // |x|^p*, |y|^p*, |z|^q*
+            simd::exp2(logs[k] * float4(body[k]->ps, body[k]->ps, body[k]->qs, 0.0f)).store(powers[k]);
+        }
+
+        // log2 of the inner norm r = |(x, y)|_p* and of the outer norm m = |(r, z)|_q*, lane k is body k
+        float logR[4], rq[4], logM[4];
+        float4 inner(powers[0][0] + powers[0][1], powers[1][0] + powers[1][1], 1.0f, 1.0f);
+        (simd::log2(inner) * float4(1.0f / body[0]->ps, 1.0f / body[1]->ps, 0.0f, 0.0f)).store(logR);
+        simd::exp2(float4(logR[0] * body[0]->qs, logR[1] * body[1]->qs, 0.0f, 0.0f)).store(rq);
+        (simd::log2(float4(rq[0] + powers[0][2], rq[1] + powers[1][2], 1.0f, 1.0f)) *
+            float4(1.0f / body[0]->qs, 1.0f / body[1]->qs, 0.0f, 0.0f)).store(logM);
+
+        // dm/dx = (r / m)^(q* - 1) (|x| / r)^(p* - 1), dm/dz = (|z| / m)^(q* - 1); lane 3 is dm/dr
+        const float4 zero(0.0f), lane3 = simd::cmpgt(float4(0.0f, 0.0f, 0.0f, 1.0f), zero);
+        for (int k = 0; k < 2; k++)
+        {
+            float ps1 = body[k]->ps - 1.0f, qs1 = body[k]->qs - 1.0f;
+            float4 l = simd::select(lane3, float4(logR[k]), logs[k]);
+            float4 ratios = simd::exp2(float4(ps1, ps1, qs1, qs1) * (l - float4(logR[k], logR[k], logM[k], logM[k])));
+            float r[4];
+            simd::select(simd::cmpgt(magnitude[k], zero), ratios, zero).store(r);
+            float dr = inner[k] > 0.0f ? r[3] : 0.0f;
+            s[k] = glm::vec3(std::copysign(r[0] * dr, d[k].x), std::copysign(r[1] * dr, d[k].y), std::copysign(r[2], d[k].z));
+        }
+    }
+
+    SupportPoint support(const Body& a, const Body& b, const glm::vec3& d) const
+    {
+        // support of a linear image: h_MK(d) = h_K(M^T d)
+        const Body* pair[2] = { &a, &b };
+        glm::vec3 local[2] = { glm::transpose(a.basis) * d, glm::transpose(b.basis) * -d };
+        glm::vec3 unit[2];
+        unitSupports(pair, local, unit);
+        SupportPoint p;
+        p.onA = a.center + a.basis * unit[0];
+        p.onB = b.center + b.basis * unit[1];
+        p.v = p.onA - p.onB;
+        return p;
+    }
+
+    // Minkowski portal refinement (XenoCollide). The origin lies in a - b exactly when the bodies
+    // touch; the ray from an interior point of a - b towards the origin finds the contact normal.
+    bool collide(unsigned int ia, unsigned int ib, Contact& contact) const
+    {
+        const Body& a = bodies[ia];
+        const Body& b = bodies[ib];
+
+        // interior point of a - b
+        SupportPoint v0;
+        v0.onA = a.center;
+        v0.onB = b.center;
+        v0.v = a.center - b.center;
+        if (glm::dot(v0.v, v0.v) < 1e-12f)
+            v0.v = glm::vec3(1e-5f, 0.0f, 0.0f);
+
+        // portal discovery: a triangle (v1, v2, v3) that the ray v0 -> origin passes through
+        glm::vec3 n = -v0.v;
+        SupportPoint v1 = support(a, b, n);
+        if (glm::dot(v1.v, n) <= 0.0f)
+            return false;
+
+        n = glm::cross(v1.v, v0.v);
+        if (glm::dot(n, n) < 1e-12f)
+        {
+            // origin on the segment v0 - v1
+            contact.normal = glm::normalize(v1.v - v0.v);
+            contact.depth = glm::length(v1.v);
+            contact.point = (v1.onA + v1.onB) * 0.5f;
+            return true;
+        }
+
+        SupportPoint v2 = support(a, b, n);
+        if (glm::dot(v2.v, n) <= 0.0f)
+            return false;
+
+        n = glm::cross(v1.v - v0.v, v2.v - v0.v);
+        if (glm::dot(n, v0.v) > 0.0f)
+        {
+            std::swap(v1, v2);
+            n = -n;
+        }
+
+        SupportPoint v3;
+        for (int iteration = 0;; iteration++)
+        {
+            if (iteration > 64)
+                return false;
+            v3 = support(a, b, n);
+            if (glm::dot(v3.v, n) <= 0.0f)
+                return false;
+            // origin outside (v1, v0, v3): replace v2
+            if (glm::dot(glm::cross(v1.v, v3.v), v0.v) < 0.0f)
+            {
+                v2 = v3;
+                n = glm::cross(v1.v - v0.v, v3.v - v0.v);
+                continue;
+            }
+            // origin outside (v3, v0, v2): replace v1
+            if (glm::dot(glm::cross(v3.v, v2.v), v0.v) < 0.0f)
+            {
+                v1 = v3;
+                n = glm::cross(v3.v - v0.v, v2.v - v0.v);
+                continue;
+            }
+            break;
+        }
+
+        // portal refinement: push the portal out to the boundary of a - b
+        bool hit = false;
+        for (int iteration = 0;; iteration++)
+        {
+            n = glm::cross(v2.v - v1.v, v3.v - v1.v);
+            float length = glm::length(n);
+            if (length < 1e-20f)
+                return hit;
+            n /= length;
+
+            // origin behind the portal: it is inside the tetrahedron (v0, v1, v2, v3)
+            float distance = glm::dot(n, v1.v);
+            if (distance >= 0.0f)
+                hit = true;
+
+            SupportPoint v4 = support(a, b, n);
+            float separation = glm::dot(v4.v, n);
+            if (separation < 0.0f)
+                return false;
+            if (glm::dot(v4.v - v3.v, n) <= tolerance || iteration > 64)
+            {
+                if (!hit)
+                    return false;
+                // the portal approximates the boundary near the origin; its normal is the
+                // contact normal and the origin's projection onto it gives the contact points
+                glm::vec3 projected = n * distance;
+                glm::vec3 w = barycentric(projected, v1.v, v2.v, v3.v);
+                glm::vec3 onA = v1.onA * w.x + v2.onA * w.y + v3.onA * w.z;
+                glm::vec3 onB = v1.onB * w.x + v2.onB * w.y + v3.onB * w.z;
+                contact.normal = n;
+                contact.depth = distance;
+                contact.point = (onA + onB) * 0.5f;
+                return true;
+            }
+
+            // keep the sub-triangle of (v1, v2, v3, v4) the ray still passes through
+            glm::vec3 c = glm::cross(v4.v, v0.v);
+            if (glm::dot(v1.v, c) > 0.0f)
+            {
+                if (glm::dot(v2.v, c) > 0.0f)
+                    v1 = v4;
+                else
+                    v3 = v4;
+            }
+            else
+            {
+                if (glm::dot(v3.v, c) > 0.0f)
+                    v2 = v4;
+                else
+                    v1 = v4;
+            }
+        }
+    }
+
+    static glm::vec3 barycentric(const glm::vec3& p, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+    {
+        glm::vec3 e0 = b - a, e1 = c - a, e2 = p - a;
+        float d00 = glm::dot(e0, e0), d01 = glm::dot(e0, e1), d11 = glm::dot(e1, e1);
+        float d20 = glm::dot(e2, e0), d21 = glm::dot(e2, e1);
+        float denominator = d00 * d11 - d01 * d01;
+        if (std::fabs(denominator) < 1e-20f)
+            return glm::vec3(1.0f, 0.0f, 0.0f);
+        float v = (d11 * d20 - d01 * d21) / denominator;
+        float w = (d00 * d21 - d01 * d20) / denominator;
+        return glm::vec3(1.0f - v - w, v, w);
+    }
+};
+
+#endif
@@ -0,0 +1,167 @@
+#ifndef SUPERELLIPSOID_COMPUTE_H
+#define SUPERELLIPSOID_COMPUTE_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// GL 4.3 names, for loaders generated for 3.3
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+#endif
+
+// Superellipsoid generation by compute shader (6.superellipsoid_generate.cs) where the context is
+// GL 4.3 or newer. One dispatch evaluates any number of shapes, each with its own radii and
+// exponents from a storage buffer, and writes position, analytic normal and texture coordinates
+// per vertex into a second storage buffer in the Vertex layout, so the output buffer can be the
+// vertex buffer superellipsoidVAO already reads (a MeshRing) with shape k following shape k - 1.
+//
+// Positions and texture coordinates are those of generateSuperellipsoid on the same grid; normals
+// are the surface's true ones where the CPU path approximates them by normalize(p / radii^2).
+// The entry points past 3.3 are looked up at runtime, as StereoTarget does for multiview.
+class SuperellipsoidCompute
+{
+public:
+    struct Shape
+    {
+        glm::vec3 radii;
+        float n1;
+        float n2;
+    };
+
+    // the grid of generateSuperellipsoid(..., stacks, slices); false without GL 4.3 or if the
+    // program did not build
+    bool create(int stacks, int slices, const char* shaderPath)
+    {
+        gridStacks = stacks;
+        gridSlices = slices;
+        GLint major = 0, minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        if (major < 4 || (major == 4 && minor < 3))
+            return false;
+        dispatchCompute = (DispatchComputeProc)glfwGetProcAddress("glDispatchCompute");
+        memoryBarrier = (MemoryBarrierProc)glfwGetProcAddress("glMemoryBarrier");
+        if (!dispatchCompute || !memoryBarrier)
+            return false;
+        program = buildProgram(shaderPath);
+        if (program)
+            glGenBuffers(1, &shapeBuffer);
+        return program != 0;
+    }
+
+    bool available() const { return program != 0; }
+    size_t vertexCount() const { return (size_t)(gridStacks + 1) * (gridSlices + 1); }
+
+    // writes count shapes of vertexCount() vertices each into buffer, starting at vertex
+    // firstVertex; draws issued afterwards see the new vertices
+    void generate(unsigned int buffer, size_t firstVertex, const Shape* shapes, size_t count)
+    {
+        if (!program || count == 0)
+            return;
+        // std430: two vec4 per shape
+        shapeData.resize(count * 8);
+        for (size_t k = 0; k < count; k++)
+        {
+            float* out = &shapeData[k * 8];
+            out[0] = shapes[k].radii.x;
+            out[1] = shapes[k].radii.y;
+            out[2] = shapes[k].radii.z;
+            out[3] = shapes[k].n1;
+            out[4] = shapes[k].n2;
+            out[5] = out[6] = out[7] = 0.0f;
+        }
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, shapeBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, shapeData.size() * sizeof(float), shapeData.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+        glUseProgram(program);
+        glUniform1i(glGetUniformLocation(program, "stacks"), gridStacks);
+        glUniform1i(glGetUniformLocation(program, "slices"), gridSlices);
+        glUniform1ui(glGetUniformLocation(program, "firstVertex"), (GLuint)firstVertex);
+        glUniform1i(glGetUniformLocation(program, "shapeCount"), (GLint)count);
+        // bound whole: a range would have to start at a multiple of the storage offset alignment
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, shapeBuffer);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, buffer);
+        dispatchCompute((GLuint)((vertexCount() + LOCAL_SIZE - 1) / LOCAL_SIZE), (GLuint)count, 1);
+        // storage writes are not ordered before vertex fetch without a barrier
+        memoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, 0);
+    }
+
+    void destroy()
+    {
+        glDeleteProgram(program);
+        glDeleteBuffers(1, &shapeBuffer);
+        program = shapeBuffer = 0;
+    }
+
+private:
+    typedef void (APIENTRY* DispatchComputeProc)(GLuint groupsX, GLuint groupsY, GLuint groupsZ);
+    typedef void (APIENTRY* MemoryBarrierProc)(GLbitfield barriers);
+
+    static constexpr size_t LOCAL_SIZE = 64; // local_size_x in the shader
+
+    unsigned int program = 0;
+    unsigned int shapeBuffer = 0;
+    int gridStacks = 0, gridSlices = 0;
+    std::vector<float> shapeData;
+    DispatchComputeProc dispatchCompute = nullptr;
+    MemoryBarrierProc memoryBarrier = nullptr;
+
+    static unsigned int buildProgram(const char* path)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR::SUPERELLIPSOID::COMPUTE_SHADER_NOT_FOUND: " << path << std::endl;
+            return 0;
+        }
+        std::stringstream source;
+        source << file.rdbuf();
+        std::string code = source.str();
+        const char* text = code.c_str();
+        unsigned int shader = glCreateShader(GL_COMPUTE_SHADER);
+        glShaderSource(shader, 1, &text, nullptr);
+        glCompileShader(shader);
+        char log[1024];
+        int success;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+            std::cout << "ERROR::SUPERELLIPSOID::COMPUTE_SHADER_COMPILATION_ERROR\n" << log << std::endl;
+            glDeleteShader(shader);
+            return 0;
+        }
+        unsigned int program = glCreateProgram();
+        glAttachShader(program, shader);
+        glLinkProgram(program);
+        glDeleteShader(shader);
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+            std::cout << "ERROR::SUPERELLIPSOID::COMPUTE_PROGRAM_LINKING_ERROR\n" << log << std::endl;
+            glDeleteProgram(program);
+            return 0;
+        }
+        return program;
+    }
+};
+
+#endif
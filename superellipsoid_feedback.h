@@ -0,0 +1,135 @@
+#ifndef SUPERELLIPSOID_FEEDBACK_H
+#define SUPERELLIPSOID_FEEDBACK_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Superellipsoid generation on the GPU with GL 3.3 transform feedback, no compute shaders needed.
+//
+// The (u, v) grid generateSuperellipsoid walks never changes, so it is uploaded once; generate()
+// draws it as points through 6.superellipsoid_generate.vs with rasterization off and captures the
+// evaluated vertices straight into a range of a vertex buffer (a MeshRing slot), in the same
+// position / normal / texture coordinate layout the CPU path uploads. Later passes draw from that
+// buffer, so the mesh never exists on the CPU. The grid's index buffer is unchanged by the shape
+// and is still built once by generateSuperellipsoid.
+class SuperellipsoidFeedback
+{
+public:
+    // the grid of generateSuperellipsoid(..., stacks, slices); false if the program did not build
+    bool create(int stacks, int slices, const char* shaderPath)
+    {
+        std::vector<float> grid;
+        grid.reserve((stacks + 1) * (slices + 1) * 2);
+        for (int i = 0; i <= stacks; i++)
+        {
+            for (int j = 0; j <= slices; j++)
+            {
+                grid.push_back((float)j / slices);
+                grid.push_back((float)i / stacks);
+            }
+        }
+        gridVertices = grid.size() / 2;
+        glGenVertexArrays(1, &gridVAO);
+        glGenBuffers(1, &gridVBO);
+        glBindVertexArray(gridVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, gridVBO);
+        glBufferData(GL_ARRAY_BUFFER, grid.size() * sizeof(float), grid.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glBindVertexArray(0);
+        program = buildProgram(shaderPath);
+        return program != 0;
+    }
+
+    bool available() const { return program != 0; }
+    size_t vertexCount() const { return gridVertices; }
+
+    // evaluates the shape into vertexCount() vertices of 8 floats at offset bytes into buffer;
+    // buffer must not be read by a draw until this returns (GL orders the capture before later draws)
+    void generate(unsigned int buffer, GLintptr offset, float n1, float n2, const glm::vec3& radii = glm::vec3(1.0f))
+    {
+        if (!program)
+            return;
+        glUseProgram(program);
+        glUniform3fv(glGetUniformLocation(program, "radii"), 1, glm::value_ptr(radii));
+        glUniform2f(glGetUniformLocation(program, "exponents"), n1, n2);
+        glEnable(GL_RASTERIZER_DISCARD);
+        glBindVertexArray(gridVAO);
+        glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, buffer, offset, gridVertices * VERTEX_BYTES);
+        glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, 0, (GLsizei)gridVertices);
+        glEndTransformFeedback();
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+        glBindVertexArray(0);
+        glDisable(GL_RASTERIZER_DISCARD);
+    }
+
+    void destroy()
+    {
+        glDeleteProgram(program);
+        glDeleteVertexArrays(1, &gridVAO);
+        glDeleteBuffers(1, &gridVBO);
+        program = gridVAO = gridVBO = 0;
+        gridVertices = 0;
+    }
+
+private:
+    static constexpr size_t VERTEX_BYTES = 8 * sizeof(float);
+
+    unsigned int program = 0;
+    unsigned int gridVAO = 0, gridVBO = 0;
+    size_t gridVertices = 0;
+
+    static unsigned int buildProgram(const char* path)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR::SUPERELLIPSOID::GENERATE_SHADER_NOT_FOUND: " << path << std::endl;
+            return 0;
+        }
+        std::stringstream source;
+        source << file.rdbuf();
+        std::string code = source.str();
+        const char* text = code.c_str();
+        unsigned int shader = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(shader, 1, &text, nullptr);
+        glCompileShader(shader);
+        char log[1024];
+        int success;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+            std::cout << "ERROR::SUPERELLIPSOID::GENERATE_SHADER_COMPILATION_ERROR\n" << log << std::endl;
+            glDeleteShader(shader);
+            return 0;
+        }
+        // no fragment stage: the pass only writes the captured varyings
+        unsigned int program = glCreateProgram();
+        glAttachShader(program, shader);
+        const char* varyings[] = { "position", "normal", "texCoords" };
+        glTransformFeedbackVaryings(program, 3, varyings, GL_INTERLEAVED_ATTRIBS);
+        glLinkProgram(program);
+        glDeleteShader(shader);
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+            std::cout << "ERROR::SUPERELLIPSOID::GENERATE_PROGRAM_LINKING_ERROR\n" << log << std::endl;
+            glDeleteProgram(program);
+            return 0;
+        }
+        return program;
+    }
+};
+
+#endif
@@ -0,0 +1,220 @@
+#ifndef SUPERELLIPSOID_RAYMARCH_H
+#define SUPERELLIPSOID_RAYMARCH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// Superellipsoids drawn as implicit surfaces: no mesh at all, only a box around each shape whose
+// fragments march their view ray to the surface (6.superellipsoid_raymarch.fs). The hit point is
+// exact whatever the distance or the exponents, and its normal is the analytic gradient of the
+// inside-outside function, so close-ups of nearly boxy or pinched shapes show no facets. Each
+// fragment writes its own depth, so ray-marched shapes intersect meshed geometry correctly.
+//
+// Lighting is 6.multiple_lights.fs itself, built with RAY_MARCHED defined so that the march
+// supplies FragPos, Normal and TexCoords; the program takes the lit pass's uniforms. Boxes are
+// instanced like the mesh path: the program reads the records of an InstanceBatches attached to
+// vao(). Only back faces of the box are drawn, so a camera inside a box still sees its shape.
+//
+// Steps are conservative: F^(n1/2), F the inside-outside function, grows by at most 1 / h per unit
+// of distance, h the smallest distance from the centre to a tangent plane of the surface, so a
+// step of (F^(n1/2) - 1) * h cannot pass through it. h is found on the CPU by sampling the surface
+// whenever the shape changes.
+class SuperellipsoidRaymarch
+{
+public:
+    int maxSteps = 96;
+
+    // false if the program did not build
+    bool create(const char* vertexPath, const char* marchPath, const char* lightingPath)
+    {
+        program = buildProgram(vertexPath, marchPath, lightingPath);
+        if (!program)
+            return false;
+
+        float corners[8 * 3];
+        for (int i = 0; i < 8; i++)
+        {
+            corners[i * 3 + 0] = (i & 1) ? 1.0f : -1.0f;
+            corners[i * 3 + 1] = (i & 2) ? 1.0f : -1.0f;
+            corners[i * 3 + 2] = (i & 4) ? 1.0f : -1.0f;
+        }
+        // counter-clockwise seen from outside
+        const unsigned int faces[36] = {
+            4, 6, 2, 4, 2, 0,  1, 3, 7, 1, 7, 5,  0, 1, 5, 0, 5, 4,
+            6, 7, 3, 6, 3, 2,  2, 3, 1, 2, 1, 0,  4, 5, 7, 4, 7, 6
+        };
+        glGenVertexArrays(1, &boxVAO);
+        glGenBuffers(1, &boxVBO);
+        glGenBuffers(1, &boxEBO);
+        glBindVertexArray(boxVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, boxVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, boxEBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(faces), faces, GL_STATIC_DRAW);
+        glBindVertexArray(0);
+        return true;
+    }
+
+    bool available() const { return program != 0; }
+    unsigned int vao() const { return boxVAO; }
+    unsigned int programId() const { return program; }
+
+    // draws instances copies of the shape; expects program in use with view, projection and
+    // viewPos set
+    void draw(float n1, float n2, GLsizei instances, const glm::vec3& radii = glm::vec3(1.0f))
+    {
+        if (!program || instances == 0)
+            return;
+        if (n1 != boundN1 || n2 != boundN2 || radii != boundRadii)
+        {
+            support = smallestSupport(n1, n2, radii);
+            boundN1 = n1;
+            boundN2 = n2;
+            boundRadii = radii;
+        }
+        glUniform3fv(glGetUniformLocation(program, "radii"), 1, glm::value_ptr(radii));
+        glUniform2f(glGetUniformLocation(program, "exponents"), n1, n2);
+        glUniform1f(glGetUniformLocation(program, "stepScale"), support);
+        glUniform1i(glGetUniformLocation(program, "maxSteps"), maxSteps);
+        glBindVertexArray(boxVAO);
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_FRONT);
+        glDrawElementsInstanced(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0, instances);
+        glCullFace(GL_BACK);
+        glDisable(GL_CULL_FACE);
+    }
+
+    void destroy()
+    {
+        glDeleteProgram(program);
+        glDeleteVertexArrays(1, &boxVAO);
+        glDeleteBuffers(1, &boxVBO);
+        glDeleteBuffers(1, &boxEBO);
+        program = boxVAO = boxVBO = boxEBO = 0;
+    }
+
+private:
+    unsigned int program = 0;
+    unsigned int boxVAO = 0, boxVBO = 0, boxEBO = 0;
+    float boundN1 = -1.0f, boundN2 = -1.0f;
+    glm::vec3 boundRadii = glm::vec3(0.0f);
+    float support = 0.0f;
+
+    static float signedPow(float base, float e)
+    {
+        return (base < 0.0f ? -1.0f : 1.0f) * std::pow(std::fabs(base), e);
+    }
+
+    // the smallest p . normal over a grid of surface points, with a margin for what lies between
+    // them; near the cusps of exponents above 2 it tends to 0 and the shader's minimum step takes over
+    static float smallestSupport(float n1, float n2, const glm::vec3& radii)
+    {
+        const int stacks = 32, slices = 64;
+        const float PI = 3.14159265358979323846f;
+        float smallest = std::min(radii.x, std::min(radii.y, radii.z));
+        for (int i = 0; i <= stacks; i++)
+        {
+            float u = -PI / 2.0f + PI * i / stacks;
+            float cu = std::cos(u), su = std::sin(u);
+            for (int j = 0; j < slices; j++)
+            {
+                float v = -PI + 2.0f * PI * j / slices;
+                float cv = std::cos(v), sv = std::sin(v);
+                glm::vec3 p = radii * glm::vec3(signedPow(cu, n1) * signedPow(cv, n2),
+                                                signedPow(cu, n1) * signedPow(sv, n2),
+                                                signedPow(su, n1));
+                glm::vec3 n = glm::vec3(signedPow(cu, 2.0f - n1) * signedPow(cv, 2.0f - n2),
+                                        signedPow(cu, 2.0f - n1) * signedPow(sv, 2.0f - n2),
+                                        signedPow(su, 2.0f - n1)) / radii;
+                float length2 = glm::dot(n, n);
+                if (!(length2 > 1e-20f) || std::isinf(length2))
+                    continue; // no tangent plane here
+                smallest = std::min(smallest, glm::dot(p, n) / std::sqrt(length2));
+            }
+        }
+        return std::max(smallest, 0.0f) * 0.9f;
+    }
+
+    static std::string readFile(const char* path)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR::RAYMARCH::SHADER_NOT_FOUND: " << path << std::endl;
+            return std::string();
+        }
+        std::stringstream source;
+        source << file.rdbuf();
+        return source.str();
+    }
+
+    static unsigned int compile(GLenum type, const std::string& code, const char* path)
+    {
+        if (code.empty())
+            return 0;
+        const char* text = code.c_str();
+        unsigned int shader = glCreateShader(type);
+        glShaderSource(shader, 1, &text, nullptr);
+        glCompileShader(shader);
+        int success;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            char log[1024];
+            glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+            std::cout << "ERROR::RAYMARCH::SHADER_COMPILATION_ERROR: " << path << "\n" << log << std::endl;
+            glDeleteShader(shader);
+            return 0;
+        }
+        return shader;
+    }
+
+    // the vertex shader, the march and the lighting as a second fragment shader object
+    static unsigned int buildProgram(const char* vertexPath, const char* marchPath, const char* lightingPath)
+    {
+        std::string lightingCode = readFile(lightingPath);
+        size_t versionEnd = lightingCode.find('\n', lightingCode.find("#version"));
+        if (versionEnd == std::string::npos)
+            return 0;
+        lightingCode.insert(versionEnd + 1, "#define RAY_MARCHED\n");
+
+        unsigned int shaders[3] = {
+            compile(GL_VERTEX_SHADER, readFile(vertexPath), vertexPath),
+            compile(GL_FRAGMENT_SHADER, readFile(marchPath), marchPath),
+            compile(GL_FRAGMENT_SHADER, lightingCode, lightingPath)
+        };
+        unsigned int program = 0;
+        if (shaders[0] && shaders[1] && shaders[2])
+        {
+            program = glCreateProgram();
+            for (unsigned int shader : shaders)
+                glAttachShader(program, shader);
+            glLinkProgram(program);
+            int success;
+            glGetProgramiv(program, GL_LINK_STATUS, &success);
+            if (!success)
+            {
+                char log[1024];
+                glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+                std::cout << "ERROR::RAYMARCH::PROGRAM_LINKING_ERROR\n" << log << std::endl;
+                glDeleteProgram(program);
+                program = 0;
+            }
+        }
+        for (unsigned int shader : shaders)
+            glDeleteShader(shader);
+        return program;
+    }
+};
+
+#endif
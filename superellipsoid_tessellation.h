@@ -0,0 +1,227 @@
+#ifndef SUPERELLIPSOID_TESSELLATION_H
+#define SUPERELLIPSOID_TESSELLATION_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// GL 4.0 names, for loaders generated for 3.3
+#ifndef GL_PATCHES
+#define GL_PATCHES 0x000E
+#endif
+#ifndef GL_PATCH_VERTICES
+#define GL_PATCH_VERTICES 0x8E72
+#endif
+#ifndef GL_TESS_CONTROL_SHADER
+#define GL_TESS_CONTROL_SHADER 0x8E88
+#endif
+#ifndef GL_TESS_EVALUATION_SHADER
+#define GL_TESS_EVALUATION_SHADER 0x8E87
+#endif
+
+// Superellipsoids subdivided on the GPU as far as the view needs, where the context is GL 4.0 or
+// newer: a coarse grid of quad patches over (u, v) is drawn as GL_PATCHES, the control shader
+// (6.superellipsoid_tess.tcs) picks each edge's level from its on-screen length and from how far
+// the surface bends away from it, and the evaluation shader (6.superellipsoid_tess.tes) puts every
+// generated vertex on the exact surface with its analytic normal. Detail follows the camera and
+// the morph with no CPU work and no mesh in memory beyond the patch corners.
+//
+// Patches are instanced like the mesh path: the program reads the records of an InstanceBatches
+// attached to vao(), and its outputs are those of 6.multiple_lights.vs, so it links with the lit
+// fragment shader and takes the same lighting uniforms. Levels are computed from each edge's sorted
+// endpoints, so neighbouring patches agree and the surface has no cracks.
+class SuperellipsoidTessellation
+{
+public:
+    float pixelsPerSegment = 8.0f; // on-screen length of one subdivided edge segment
+    float curvatureWeight = 8.0f;  // extra subdivision where the surface bends away from an edge
+    float maxLevel = 64.0f;
+
+    // patchStacks x patchSlices patches over the grid of generateSuperellipsoid; false without
+    // GL 4.0 or if the program did not build
+    bool create(int patchStacks, int patchSlices, const char* vertexPath, const char* controlPath,
+                const char* evaluationPath, const char* fragmentPath)
+    {
+        GLint major = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        if (major < 4)
+            return false;
+        patchParameteri = (PatchParameteriProc)glfwGetProcAddress("glPatchParameteri");
+        if (!patchParameteri)
+            return false;
+        program = buildProgram(vertexPath, controlPath, evaluationPath, fragmentPath);
+        if (!program)
+            return false;
+        glGenQueries(1, &primitivesQuery);
+
+        std::vector<float> corners;
+        for (int i = 0; i <= patchStacks; i++)
+        {
+            for (int j = 0; j <= patchSlices; j++)
+            {
+                corners.push_back((float)j / patchSlices);
+                corners.push_back((float)i / patchStacks);
+            }
+        }
+        std::vector<unsigned int> patches;
+        for (int i = 0; i < patchStacks; i++)
+        {
+            for (int j = 0; j < patchSlices; j++)
+            {
+                unsigned int first = i * (patchSlices + 1) + j;
+                unsigned int above = first + patchSlices + 1;
+                patches.push_back(first);
+                patches.push_back(first + 1);
+                patches.push_back(above + 1);
+                patches.push_back(above);
+            }
+        }
+        patchIndexCount = (GLsizei)patches.size();
+        glGenVertexArrays(1, &patchVAO);
+        glGenBuffers(1, &cornerVBO);
+        glGenBuffers(1, &patchEBO);
+        glBindVertexArray(patchVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, cornerVBO);
+        glBufferData(GL_ARRAY_BUFFER, corners.size() * sizeof(float), corners.data(), GL_STATIC_DRAW);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, patchEBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, patches.size() * sizeof(unsigned int), patches.data(), GL_STATIC_DRAW);
+        glBindVertexArray(0);
+        return true;
+    }
+
+    bool available() const { return program != 0; }
+    unsigned int vao() const { return patchVAO; }
+    unsigned int programId() const { return program; }
+
+    // triangles the tessellator generated in the most recent counted draw (one draw is counted
+    // at a time, so with several views this is one of them)
+    GLuint lastTriangleCount() const { return lastTriangles; }
+
+    // draws instances copies of the shape; expects program in use with view and projection set
+    void draw(float n1, float n2, const glm::vec2& viewportSize, GLsizei instances, const glm::vec3& radii = glm::vec3(1.0f))
+    {
+        if (!program || instances == 0)
+            return;
+        // the previous count has usually arrived by now; never wait for it
+        if (queryPending)
+        {
+            GLint available = 0;
+            glGetQueryObjectiv(primitivesQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available)
+            {
+                glGetQueryObjectuiv(primitivesQuery, GL_QUERY_RESULT, &lastTriangles);
+                queryPending = false;
+            }
+        }
+        glUniform3fv(glGetUniformLocation(program, "radii"), 1, glm::value_ptr(radii));
+        glUniform2f(glGetUniformLocation(program, "exponents"), n1, n2);
+        glUniform2f(glGetUniformLocation(program, "viewportSize"), viewportSize.x, viewportSize.y);
+        glUniform1f(glGetUniformLocation(program, "pixelsPerSegment"), pixelsPerSegment);
+        glUniform1f(glGetUniformLocation(program, "curvatureWeight"), curvatureWeight);
+        glUniform1f(glGetUniformLocation(program, "maxLevel"), maxLevel);
+        glBindVertexArray(patchVAO);
+        patchParameteri(GL_PATCH_VERTICES, 4);
+        bool counting = !queryPending;
+        if (counting)
+            glBeginQuery(GL_PRIMITIVES_GENERATED, primitivesQuery);
+        glDrawElementsInstanced(GL_PATCHES, patchIndexCount, GL_UNSIGNED_INT, 0, instances);
+        if (counting)
+        {
+            glEndQuery(GL_PRIMITIVES_GENERATED);
+            queryPending = true;
+        }
+    }
+
+    void destroy()
+    {
+        glDeleteProgram(program);
+        glDeleteVertexArrays(1, &patchVAO);
+        glDeleteBuffers(1, &cornerVBO);
+        glDeleteBuffers(1, &patchEBO);
+        glDeleteQueries(1, &primitivesQuery);
+        program = patchVAO = cornerVBO = patchEBO = primitivesQuery = 0;
+        queryPending = false;
+    }
+
+private:
+    typedef void (APIENTRY* PatchParameteriProc)(GLenum pname, GLint value);
+
+    unsigned int program = 0;
+    unsigned int patchVAO = 0, cornerVBO = 0, patchEBO = 0;
+    GLsizei patchIndexCount = 0;
+    PatchParameteriProc patchParameteri = nullptr;
+    unsigned int primitivesQuery = 0;
+    bool queryPending = false;
+    GLuint lastTriangles = 0;
+
+    static unsigned int compile(GLenum type, const char* path)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR::TESSELLATION::SHADER_NOT_FOUND: " << path << std::endl;
+            return 0;
+        }
+        std::stringstream source;
+        source << file.rdbuf();
+        std::string code = source.str();
+        const char* text = code.c_str();
+        unsigned int shader = glCreateShader(type);
+        glShaderSource(shader, 1, &text, nullptr);
+        glCompileShader(shader);
+        int success;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            char log[1024];
+            glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+            std::cout << "ERROR::TESSELLATION::SHADER_COMPILATION_ERROR: " << path << "\n" << log << std::endl;
+            glDeleteShader(shader);
+            return 0;
+        }
+        return shader;
+    }
+
+    static unsigned int buildProgram(const char* vertexPath, const char* controlPath, const char* evaluationPath, const char* fragmentPath)
+    {
+        unsigned int shaders[4] = {
+            compile(GL_VERTEX_SHADER, vertexPath),
+            compile(GL_TESS_CONTROL_SHADER, controlPath),
+            compile(GL_TESS_EVALUATION_SHADER, evaluationPath),
+            compile(GL_FRAGMENT_SHADER, fragmentPath)
+        };
+        unsigned int program = 0;
+        if (shaders[0] && shaders[1] && shaders[2] && shaders[3])
+        {
+            program = glCreateProgram();
+            for (unsigned int shader : shaders)
+                glAttachShader(program, shader);
+            glLinkProgram(program);
+            int success;
+            glGetProgramiv(program, GL_LINK_STATUS, &success);
+            if (!success)
+            {
+                char log[1024];
+                glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+                std::cout << "ERROR::TESSELLATION::PROGRAM_LINKING_ERROR\n" << log << std::endl;
+                glDeleteProgram(program);
+                program = 0;
+            }
+        }
+        for (unsigned int shader : shaders)
+            glDeleteShader(shader);
+        return program;
+    }
+};
+
+#endif
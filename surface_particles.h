@@ -0,0 +1,482 @@
+#ifndef SURFACE_PARTICLES_H
+#define SURFACE_PARTICLES_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "simd.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+// Particles shed by a (morphing) triangle mesh, drawn as point sprites with one glDrawArrays.
+//
+// setEmitter() takes the current mesh and builds an alias table over its triangle areas, so a
+// birth position costs O(1) and is uniform over the surface whatever the tessellation does. Each
+// particle lives `lifetime` seconds and is reborn on the surface, moving along the normal, the
+// moment it expires; initial ages are staggered so births run at count / lifetime per second.
+//
+// Two interchangeable backends simulate the same model:
+//   CPU  SoA state, simd::float4 kernel on the thread pool, written into a mapped vertex buffer
+//   GPU  ping-pong vertex buffers updated by transform feedback (6.particles_update.vs); the
+//        emitter mesh and alias table live in a texture buffer and never come back to the CPU
+// Both render from (position, age) at attribute locations 0 and 1 (6.particles.vs).
+class SurfaceParticles
+{
+public:
+    enum Backend { CPU, GPU };
+
+    float lifetime = 2.0f;
+    float speed = 0.6f;               // launch speed along the normal
+    float spread = 0.3f;              // random launch velocity, relative to speed
+    float drag = 0.5f;                // fraction of velocity lost per second
+    glm::vec3 gravity{ 0.0f, -0.4f, 0.0f };
+
+    // count particles (rounded up to a multiple of four); false if the transform feedback program
+    // did not build, in which case only the CPU backend is available
+    bool create(size_t count, const char* updateShaderPath)
+    {
+        particleCount = (count + 3) & ~(size_t)3;
+        glGenQueries(2, timerQueries);
+        glGenBuffers(1, &emitterBuffer);
+        glGenTextures(1, &emitterTexture);
+        glBindBuffer(GL_TEXTURE_BUFFER, emitterBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, emitterTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, emitterBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        updateProgram = buildUpdateProgram(updateShaderPath);
+        return updateProgram != 0;
+    }
+
+    bool gpuAvailable() const { return updateProgram != 0; }
+    Backend backend() const { return activeBackend; }
+    size_t count() const { return particleCount; }
+
+    // switches backends (freeing the other one's storage) and restarts emission
+    void setBackend(Backend backend)
+    {
+        release();
+        activeBackend = backend == GPU && gpuAvailable() ? GPU : CPU;
+        frameIndex = 0;
+        pendingQuery = -1;
+        if (activeBackend == CPU)
+            createCpuStorage();
+        else
+            createGpuStorage();
+    }
+
+    // the surface to emit from: vertex k has its position at positions + k * stride and its normal
+    // at normals + k * stride (floats), triangles are index triples
+    void setEmitter(const float* positions, const float* normals, size_t stride, const unsigned int* indices, size_t indexCount)
+    {
+        triangleCount = indexCount / 3;
+        emitter.assign(triangleCount * EMITTER_FLOATS, 0.0f);
+        std::vector<float> weight(triangleCount);
+        double total = 0.0;
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            float* e = &emitter[t * EMITTER_FLOATS];
+            for (int k = 0; k < 3; k++)
+            {
+                size_t v = indices[t * 3 + k];
+                std::copy(positions + v * stride, positions + v * stride + 3, e + k * 4);
+                std::copy(normals + v * stride, normals + v * stride + 3, e + 12 + k * 4);
+            }
+            glm::vec3 p0 = glm::make_vec3(e), p1 = glm::make_vec3(e + 4), p2 = glm::make_vec3(e + 8);
+            weight[t] = 0.5f * glm::length(glm::cross(p1 - p0, p2 - p0));
+            total += weight[t];
+        }
+        buildAliasTable(weight, total);
+        emitterDirty = true;
+    }
+
+    // advances every particle by dt; births land on the emitter transformed by model
+    void update(float dt, const glm::mat4& model, ThreadPool& pool)
+    {
+        if (particleCount == 0 || triangleCount == 0 || !storageReady)
+            return;
+        frameIndex++;
+        seed = hash((uint32_t)frameIndex * 0x9E3779B9u);
+        if (activeBackend == CPU)
+            updateCpu(dt, model, pool);
+        else
+            updateGpu(dt, model);
+    }
+
+    // point sprites; the caller binds 6.particles.vs/fs with its projection, view and blending
+    void draw() const
+    {
+        if (!storageReady)
+            return;
+        glBindVertexArray(activeBackend == CPU ? cpuVAO : stateVAO[source]);
+        glDrawArrays(GL_POINTS, 0, (GLsizei)particleCount);
+        glBindVertexArray(0);
+    }
+
+    // duration of the last measured update: wall clock of the kernel and upload (CPU) or GPU time
+    // of the transform feedback pass (a frame or two late, read without stalling)
+    double updateMilliseconds() const { return lastUpdateMs; }
+
+    // frees the particle state of the active backend; setBackend() starts over
+    void release()
+    {
+        if (cpuVAO)
+        {
+            glDeleteVertexArrays(1, &cpuVAO);
+            glDeleteBuffers(1, &cpuVBO);
+            cpuVAO = cpuVBO = 0;
+        }
+        if (stateVAO[0])
+        {
+            glDeleteVertexArrays(2, stateVAO);
+            glDeleteBuffers(2, stateVBO);
+            stateVAO[0] = stateVAO[1] = stateVBO[0] = stateVBO[1] = 0;
+        }
+        for (std::vector<float>* a : { &px, &py, &pz, &vx, &vy, &vz, &age })
+        {
+            a->clear();
+            a->shrink_to_fit();
+        }
+        storageReady = false;
+    }
+
+    void destroy()
+    {
+        release();
+        glDeleteQueries(2, timerQueries);
+        glDeleteBuffers(1, &emitterBuffer);
+        glDeleteTextures(1, &emitterTexture);
+        if (updateProgram)
+            glDeleteProgram(updateProgram);
+        emitterBuffer = emitterTexture = updateProgram = 0;
+        particleCount = triangleCount = 0;
+    }
+
+private:
+    // per triangle, as RGBA32F texels: 3 positions, 3 normals, (alias probability, alias index)
+    static constexpr size_t EMITTER_FLOATS = 28;
+    static constexpr size_t CHUNK = 4096;
+    // texture unit the update program reads the emitter from
+    static constexpr int EMITTER_UNIT = 3;
+
+    size_t particleCount = 0, triangleCount = 0;
+    std::vector<float> emitter;
+    bool emitterDirty = false;
+    Backend activeBackend = CPU;
+    bool storageReady = false;
+    uint64_t frameIndex = 0;
+    uint32_t seed = 0;
+    double lastUpdateMs = 0.0;
+
+    // CPU backend
+    std::vector<float> px, py, pz, vx, vy, vz, age;
+    unsigned int cpuVAO = 0, cpuVBO = 0; // interleaved (x, y, z, age)
+
+    // GPU backend: state[i] holds (x, y, z, age, vx, vy, vz, unused) per particle
+    unsigned int stateVBO[2] = { 0, 0 }, stateVAO[2] = { 0, 0 };
+    int source = 0;
+    unsigned int updateProgram = 0, emitterBuffer = 0, emitterTexture = 0;
+    unsigned int timerQueries[2] = { 0, 0 };
+    int pendingQuery = -1;
+
+    // lowbias32; the update shader uses the same function so both backends draw alike
+    static uint32_t hash(uint32_t x)
+    {
+        x ^= x >> 16;
+        x *= 0x7feb352du;
+        x ^= x >> 15;
+        x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return x;
+    }
+
+    static float random(uint32_t& h)
+    {
+        h = hash(h);
+        return (h >> 8) * (1.0f / 16777216.0f);
+    }
+
+    // Vose's alias method: triangle t keeps probability emitter[t].prob of being picked when its
+    // column is chosen, otherwise its alias is
+    void buildAliasTable(const std::vector<float>& weight, double total)
+    {
+        size_t n = weight.size();
+        std::vector<double> scaled(n);
+        std::vector<uint32_t> small, large;
+        for (size_t t = 0; t < n; t++)
+        {
+            scaled[t] = total > 0.0 ? weight[t] * n / total : 1.0;
+            (scaled[t] < 1.0 ? small : large).push_back((uint32_t)t);
+        }
+        while (!small.empty() && !large.empty())
+        {
+            uint32_t s = small.back(), l = large.back();
+            small.pop_back();
+            emitter[s * EMITTER_FLOATS + 24] = (float)scaled[s];
+            emitter[s * EMITTER_FLOATS + 25] = (float)l;
+            scaled[l] += scaled[s] - 1.0;
+            if (scaled[l] < 1.0)
+            {
+                large.pop_back();
+                small.push_back(l);
+            }
+        }
+        // what is left is 1 up to rounding
+        for (uint32_t t : small)
+            emitter[t * EMITTER_FLOATS + 24] = 1.0f, emitter[t * EMITTER_FLOATS + 25] = (float)t;
+        for (uint32_t t : large)
+            emitter[t * EMITTER_FLOATS + 24] = 1.0f, emitter[t * EMITTER_FLOATS + 25] = (float)t;
+    }
+
+    // not yet born: ages in (-lifetime, 0], so the first births are spread over one lifetime
+    float initialAge(size_t i) const { return -lifetime * (float)i / (float)particleCount; }
+
+    void createCpuStorage()
+    {
+        for (std::vector<float>* a : { &px, &py, &pz, &vx, &vy, &vz })
+            a->assign(particleCount, 0.0f);
+        age.resize(particleCount);
+        for (size_t i = 0; i < particleCount; i++)
+            age[i] = initialAge(i);
+        glGenVertexArrays(1, &cpuVAO);
+        glGenBuffers(1, &cpuVBO);
+        glBindVertexArray(cpuVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, cpuVBO);
+        glBufferData(GL_ARRAY_BUFFER, particleCount * 4 * sizeof(float), nullptr, GL_STREAM_DRAW);
+        setRenderAttributes(4 * sizeof(float));
+        glBindVertexArray(0);
+        storageReady = true;
+    }
+
+    void createGpuStorage()
+    {
+        std::vector<float> initial(particleCount * 8, 0.0f);
+        for (size_t i = 0; i < particleCount; i++)
+            initial[i * 8 + 3] = initialAge(i);
+        glGenVertexArrays(2, stateVAO);
+        glGenBuffers(2, stateVBO);
+        for (int b = 0; b < 2; b++)
+        {
+            glBindVertexArray(stateVAO[b]);
+            glBindBuffer(GL_ARRAY_BUFFER, stateVBO[b]);
+            glBufferData(GL_ARRAY_BUFFER, initial.size() * sizeof(float), initial.data(), GL_DYNAMIC_COPY);
+            setRenderAttributes(8 * sizeof(float));
+            // velocity, read by the update pass only
+            glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(4 * sizeof(float)));
+            glEnableVertexAttribArray(2);
+        }
+        glBindVertexArray(0);
+        source = 0;
+        emitterDirty = true;
+        storageReady = true;
+    }
+
+    static void setRenderAttributes(GLsizei stride)
+    {
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, stride, (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, stride, (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+    }
+
+    void updateCpu(float dt, const glm::mat4& model, ThreadPool& pool)
+    {
+        using simd::float4;
+        auto start = std::chrono::steady_clock::now();
+        glBindBuffer(GL_ARRAY_BUFFER, cpuVBO);
+        float* out = (float*)glMapBufferRange(GL_ARRAY_BUFFER, 0, particleCount * 4 * sizeof(float),
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (!out)
+            return;
+        glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+        const float4 step(dt), life(lifetime), inverseLife(1.0f / lifetime);
+        const float4 damping(std::max(0.0f, 1.0f - drag * dt));
+        const float4 gx(gravity.x * dt), gy(gravity.y * dt), gz(gravity.z * dt);
+
+        pool.parallelFor(particleCount / 4, CHUNK / 4, [&](size_t begin, size_t end) {
+            for (size_t group = begin; group < end; group++)
+            {
+                size_t i = group * 4;
+                float4 x = float4::load(&px[i]), y = float4::load(&py[i]), z = float4::load(&pz[i]);
+                float4 u = madd(float4::load(&vx[i]), damping, gx);
+                float4 v = madd(float4::load(&vy[i]), damping, gy);
+                float4 w = madd(float4::load(&vz[i]), damping, gz);
+                x = madd(u, step, x);
+                y = madd(v, step, y);
+                z = madd(w, step, z);
+                float4 a = float4::load(&age[i]);
+                float4 aged = a + step;
+                // reborn whenever the age crosses a multiple of the lifetime (including 0, the first birth)
+                float4 cycles = floor(aged * inverseLife);
+                float4 reborn = cmplt(floor(a * inverseLife), cycles);
+                aged = select(reborn, aged - cycles * life, aged);
+                x.store(&px[i]);
+                y.store(&py[i]);
+                z.store(&pz[i]);
+                u.store(&vx[i]);
+                v.store(&vy[i]);
+                w.store(&vz[i]);
+                aged.store(&age[i]);
+                if (any(reborn))
+                {
+                    for (int lane = 0; lane < 4; lane++)
+                        if (reborn[lane] != 0.0f)
+                            emit(i + lane, model, normalMatrix);
+                    x = float4::load(&px[i]);
+                    y = float4::load(&py[i]);
+                    z = float4::load(&pz[i]);
+                }
+                // to (x, y, z, age) per particle for the vertex buffer
+                transpose(x, y, z, aged);
+                x.store(out + i * 4);
+                y.store(out + i * 4 + 4);
+                z.store(out + i * 4 + 8);
+                aged.store(out + i * 4 + 12);
+            }
+        });
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        lastUpdateMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // places particle i at a random point of the emitter (area-weighted) with a launch velocity
+    void emit(size_t i, const glm::mat4& model, const glm::mat3& normalMatrix)
+    {
+        uint32_t h = (uint32_t)i * 0x9E3779B9u ^ seed;
+        float column = random(h) * triangleCount;
+        size_t t = std::min((size_t)column, triangleCount - 1);
+        const float* e = &emitter[t * EMITTER_FLOATS];
+        if (column - t >= e[24])
+            e = &emitter[(size_t)e[25] * EMITTER_FLOATS];
+        // uniform barycentric coordinates
+        float s = std::sqrt(random(h)), r = random(h);
+        float b0 = 1.0f - s, b1 = s * (1.0f - r), b2 = s * r;
+        glm::vec3 p = b0 * glm::make_vec3(e) + b1 * glm::make_vec3(e + 4) + b2 * glm::make_vec3(e + 8);
+        glm::vec3 n = b0 * glm::make_vec3(e + 12) + b1 * glm::make_vec3(e + 16) + b2 * glm::make_vec3(e + 20);
+        p = glm::vec3(model * glm::vec4(p, 1.0f));
+        n = normalMatrix * n;
+        float length = glm::length(n);
+        n = length > 0.0f ? n / length : glm::vec3(0.0f, 1.0f, 0.0f);
+        float launch = speed * (0.7f + 0.6f * random(h));
+        glm::vec3 jitter(random(h) * 2.0f - 1.0f, random(h) * 2.0f - 1.0f, random(h) * 2.0f - 1.0f);
+        glm::vec3 velocity = n * launch + jitter * (spread * speed);
+        px[i] = p.x;
+        py[i] = p.y;
+        pz[i] = p.z;
+        vx[i] = velocity.x;
+        vy[i] = velocity.y;
+        vz[i] = velocity.z;
+    }
+
+    void updateGpu(float dt, const glm::mat4& model)
+    {
+        // the previous query has usually finished by now; never wait for it
+        if (pendingQuery >= 0)
+        {
+            GLint available = 0;
+            glGetQueryObjectiv(timerQueries[pendingQuery], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available)
+            {
+                GLuint64 nanoseconds = 0;
+                glGetQueryObjectui64v(timerQueries[pendingQuery], GL_QUERY_RESULT, &nanoseconds);
+                lastUpdateMs = nanoseconds * 1e-6;
+                pendingQuery = -1;
+            }
+        }
+        if (emitterDirty)
+        {
+            glBindBuffer(GL_TEXTURE_BUFFER, emitterBuffer);
+            glBufferData(GL_TEXTURE_BUFFER, emitter.size() * sizeof(float), emitter.data(), GL_STREAM_DRAW);
+            emitterDirty = false;
+        }
+
+        glUseProgram(updateProgram);
+        glUniform1i(glGetUniformLocation(updateProgram, "emitter"), EMITTER_UNIT);
+        glUniform1i(glGetUniformLocation(updateProgram, "triangleCount"), (GLint)triangleCount);
+        glUniformMatrix4fv(glGetUniformLocation(updateProgram, "model"), 1, GL_FALSE, glm::value_ptr(model));
+        glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+        glUniformMatrix3fv(glGetUniformLocation(updateProgram, "normalMatrix"), 1, GL_FALSE, glm::value_ptr(normalMatrix));
+        glUniform1f(glGetUniformLocation(updateProgram, "dt"), dt);
+        glUniform1f(glGetUniformLocation(updateProgram, "lifetime"), lifetime);
+        glUniform1f(glGetUniformLocation(updateProgram, "speed"), speed);
+        glUniform1f(glGetUniformLocation(updateProgram, "spread"), spread);
+        glUniform1f(glGetUniformLocation(updateProgram, "damping"), std::max(0.0f, 1.0f - drag * dt));
+        glUniform3fv(glGetUniformLocation(updateProgram, "gravity"), 1, glm::value_ptr(gravity));
+        glUniform1ui(glGetUniformLocation(updateProgram, "seed"), seed);
+        glActiveTexture(GL_TEXTURE0 + EMITTER_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, emitterTexture);
+        glActiveTexture(GL_TEXTURE0);
+
+        int target = 1 - source;
+        bool timing = pendingQuery < 0;
+        int query = (int)(frameIndex & 1);
+        if (timing)
+            glBeginQuery(GL_TIME_ELAPSED, timerQueries[query]);
+        glEnable(GL_RASTERIZER_DISCARD);
+        glBindVertexArray(stateVAO[source]);
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, stateVBO[target]);
+        glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, 0, (GLsizei)particleCount);
+        glEndTransformFeedback();
+        glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+        glBindVertexArray(0);
+        glDisable(GL_RASTERIZER_DISCARD);
+        if (timing)
+        {
+            glEndQuery(GL_TIME_ELAPSED);
+            pendingQuery = query;
+        }
+        source = target;
+    }
+
+    static unsigned int buildUpdateProgram(const char* path)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR::PARTICLES::UPDATE_SHADER_NOT_FOUND: " << path << std::endl;
+            return 0;
+        }
+        std::stringstream source;
+        source << file.rdbuf();
+        std::string code = source.str();
+        const char* text = code.c_str();
+        unsigned int shader = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(shader, 1, &text, nullptr);
+        glCompileShader(shader);
+        char log[1024];
+        int success;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success)
+        {
+            glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+            std::cout << "ERROR::PARTICLES::UPDATE_SHADER_COMPILATION_ERROR\n" << log << std::endl;
+            glDeleteShader(shader);
+            return 0;
+        }
+        // no fragment stage: the pass only writes the captured varyings
+        unsigned int program = glCreateProgram();
+        glAttachShader(program, shader);
+        const char* varyings[] = { "position", "age", "velocity" };
+        glTransformFeedbackVaryings(program, 3, varyings, GL_INTERLEAVED_ATTRIBS);
+        glLinkProgram(program);
+        glDeleteShader(shader);
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (!success)
+        {
+            glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+            std::cout << "ERROR::PARTICLES::UPDATE_PROGRAM_LINKING_ERROR\n" << log << std::endl;
+            glDeleteProgram(program);
+            return 0;
+        }
+        return program;
+    }
+};
+
+#endif
@@ -0,0 +1,134 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent worker pool for the per-frame data-parallel loops (scene graph, arrays, physics).
+// The calling thread takes part in every parallelFor, so a pool of N threads spawns N - 1 workers.
+class ThreadPool
+{
+public:
+    explicit ThreadPool(unsigned int threadCount = 0)
+    {
+        if (threadCount == 0)
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned int i = 1; i < threadCount; i++)
+            workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers)
+            worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // number of threads that execute a parallelFor, including the caller
+    unsigned int size() const { return (unsigned int)workers.size() + 1; }
+
+    // runs fn(begin, end) over [0, count) in chunks of at least minChunk items and blocks until done.
+    // calls made from inside a job (or with a single chunk) run inline on the calling thread.
+    void parallelFor(size_t count, size_t minChunk, const std::function<void(size_t, size_t)>& fn)
+    {
+        if (count == 0)
+            return;
+        minChunk = std::max<size_t>(1, minChunk);
+        // a few chunks per thread keeps the load balanced when items have uneven cost
+        size_t chunk = std::max(minChunk, (count + size() * 4 - 1) / (size() * 4));
+        if (workers.empty() || insideJobFlag() || chunk >= count)
+        {
+            fn(0, count);
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(dispatchMutex);
+        {
+            std::lock_guard<std::mutex> guard(mutex);
+            job = &fn;
+            jobCount = count;
+            jobChunk = chunk;
+            nextChunk.store(0);
+            pending = (unsigned int)workers.size();
+            generation++;
+        }
+        wake.notify_all();
+
+        runChunks();
+
+        std::unique_lock<std::mutex> guard(mutex);
+        done.wait(guard, [this] { return pending == 0; });
+        job = nullptr;
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::mutex dispatchMutex; // serialises parallelFor calls coming from different threads
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    const std::function<void(size_t, size_t)>* job = nullptr;
+    size_t jobCount = 0;
+    size_t jobChunk = 0;
+    std::atomic<size_t> nextChunk{ 0 };
+    unsigned int pending = 0;
+    unsigned int generation = 0;
+    bool stopping = false;
+
+    static bool& insideJobFlag()
+    {
+        static thread_local bool flag = false;
+        return flag;
+    }
+
+    void runChunks()
+    {
+        bool& flag = insideJobFlag();
+        flag = true;
+        for (;;)
+        {
+            size_t begin = nextChunk.fetch_add(jobChunk);
+            if (begin >= jobCount)
+                break;
+            (*job)(begin, std::min(begin + jobChunk, jobCount));
+        }
+        flag = false;
+    }
+
+    void workerLoop()
+    {
+        unsigned int seen = 0;
+        for (;;)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping)
+                    return;
+                seen = generation;
+            }
+            runChunks();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--pending == 0)
+                    done.notify_one();
+            }
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,183 @@
+#ifndef UPLOAD_THREAD_H
+#define UPLOAD_THREAD_H
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
+// Buffer and texture uploads on a worker thread with its own GL context, shared with the render
+// context so buffer and texture names (not VAOs) are common to both.
+//
+// submit() queues a job that runs with the upload context current, after everything the render
+// thread issued before submit() (a fence from the render context is waited on first, so a job may
+// read buffers the render thread wrote). After the job the worker inserts a fence and flushes, so
+// the job's GL commands are on their way before the render thread looks. The render thread polls
+// ready(), which never blocks, or calls wait() when it cannot go on without the data: that blocks
+// only until the worker has issued the job and then makes the render context's later commands
+// wait for the fence on the GPU (glWaitSync), not the CPU.
+//
+// Objects a job writes must not be used by the render thread until its ticket is ready; data the
+// job reads from client memory must stay alive until then as well.
+class UploadThread
+{
+public:
+    typedef size_t Ticket; // 0 never names a job
+
+    ~UploadThread() { stop(); }
+
+    // creates a hidden 1x1 window sharing objects with share; call on the thread that owns GLFW
+    bool start(GLFWwindow* share)
+    {
+        stop();
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+        context = glfwCreateWindow(1, 1, "uploads", nullptr, share);
+        glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+        if (!context)
+            return false;
+        stopping = false;
+        worker = std::thread([this] { workerLoop(); });
+        return true;
+    }
+
+    // finishes queued jobs, then destroys the upload context
+    void stop()
+    {
+        if (!context)
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        worker.join();
+        for (auto& entry : jobs)
+            if (entry.second.fence)
+                glDeleteSync(entry.second.fence);
+        // the worker has run every queued job, so their `after` fences are gone already
+        jobs.clear();
+        glfwDestroyWindow(context);
+        context = nullptr;
+    }
+
+    bool running() const { return context != nullptr; }
+
+    // render thread
+    Ticket submit(std::function<void()> work)
+    {
+        GLsync after = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+        std::lock_guard<std::mutex> lock(mutex);
+        Ticket ticket = ++lastTicket;
+        jobs[ticket].work = std::move(work);
+        jobs[ticket].after = after;
+        queue.push_back(ticket);
+        wake.notify_all();
+        return ticket;
+    }
+
+    // render thread: true once the job's commands have completed on the GPU; never blocks
+    bool ready(Ticket ticket)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto job = jobs.find(ticket);
+        if (job == jobs.end())
+            return true; // retired
+        if (!job->second.fence)
+            return false;
+        GLenum state = glClientWaitSync(job->second.fence, 0, 0);
+        if (state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED)
+            return false;
+        retire(job);
+        return true;
+    }
+
+    // render thread: the job's results are visible to every command issued after this returns
+    void wait(Ticket ticket)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto job = jobs.find(ticket);
+        if (job == jobs.end())
+            return;
+        issued.wait(lock, [&] { return job->second.fence != nullptr; });
+        glWaitSync(job->second.fence, 0, GL_TIMEOUT_IGNORED);
+        retire(job);
+    }
+
+    // worker time of the most recently finished job (running it, fence and flush), in milliseconds
+    double lastJobMilliseconds() const
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return lastJobMs;
+    }
+
+private:
+    struct Job
+    {
+        std::function<void()> work;
+        GLsync after = nullptr; // render context fence the job waits for
+        GLsync fence = nullptr; // set by the worker once the job is issued
+    };
+
+    GLFWwindow* context = nullptr;
+    std::thread worker;
+    mutable std::mutex mutex;
+    std::condition_variable wake, issued;
+    std::deque<Ticket> queue;
+    std::map<Ticket, Job> jobs;
+    Ticket lastTicket = 0;
+    bool stopping = false;
+    double lastJobMs = 0.0;
+
+    void retire(std::map<Ticket, Job>::iterator job)
+    {
+        // deleting a fence the GPU still waits on is deferred by GL
+        glDeleteSync(job->second.fence);
+        jobs.erase(job);
+    }
+
+    void workerLoop()
+    {
+        glfwMakeContextCurrent(context);
+        for (;;)
+        {
+            std::function<void()> work;
+            GLsync after;
+            Ticket ticket;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (queue.empty())
+                    break;
+                ticket = queue.front();
+                queue.pop_front();
+                work = std::move(jobs[ticket].work);
+                after = jobs[ticket].after;
+            }
+            auto start = std::chrono::steady_clock::now();
+            glWaitSync(after, 0, GL_TIMEOUT_IGNORED);
+            glDeleteSync(after);
+            work();
+            GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            // without a flush the fence might never reach the GPU and waiters would hang
+            glFlush();
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                jobs[ticket].fence = fence;
+                lastJobMs = ms;
+            }
+            issued.notify_all();
+        }
+        glfwMakeContextCurrent(nullptr);
+    }
+};
+
+#endif
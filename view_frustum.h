@@ -0,0 +1,44 @@
+#ifndef VIEW_FRUSTUM_H
+#define VIEW_FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+// The six clip planes of a view, taken straight from its projection * view matrix, for culling
+// axis-aligned boxes on the CPU before anything is recorded for that view.
+class ViewFrustum
+{
+public:
+    explicit ViewFrustum(const glm::mat4& viewProjection)
+    {
+        // a point is inside when -w <= x, y, z <= w in clip space, i.e. (row 3 +- row i) . p >= 0
+        glm::vec4 rows[4];
+        for (int i = 0; i < 4; i++)
+            rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+        for (int i = 0; i < 3; i++)
+        {
+            planes[2 * i] = rows[3] + rows[i];
+            planes[2 * i + 1] = rows[3] - rows[i];
+        }
+    }
+
+    // false only if the box lies entirely behind one plane; boxes near a frustum corner may pass
+    // although they are outside, which just costs a draw
+    bool intersects(const glm::vec3& lower, const glm::vec3& upper) const
+    {
+        for (const glm::vec4& plane : planes)
+        {
+            // the corner furthest along the plane normal
+            glm::vec3 corner(plane.x >= 0.0f ? upper.x : lower.x,
+                             plane.y >= 0.0f ? upper.y : lower.y,
+                             plane.z >= 0.0f ? upper.z : lower.z);
+            if (plane.x * corner.x + plane.y * corner.y + plane.z * corner.z + plane.w < 0.0f)
+                return false;
+        }
+        return true;
+    }
+
+private:
+    glm::vec4 planes[6];
+};
+
+#endif
@@ -0,0 +1,902 @@
+#ifndef VULKAN_RENDERER_H
+#define VULKAN_RENDERER_H
+
+#define VK_NO_PROTOTYPES
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// The Vulkan SculptureBackend: the batch image of SculptureRenderer::render() (the shapes, lamps and
+// cables, the lighting model of 6.multiple_lights.fs) drawn by Vulkan into an offscreen image. Part
+// of sculpture.h, which includes it when the Vulkan headers are there; nothing is linked, the loader
+// library is opened at run time the way glad loads GL, so a machine without Vulkan just lacks the
+// backend.
+//
+// Recording is what scales: every instance batch of InstanceBatches::BATCH_SIZE shapes gets its own
+// command pool and secondary command buffer, and the pool's threads each write a batch's instance
+// records and record its draw; the lamps and cables are one more secondary. The render thread only
+// begins the render pass, executes the secondaries, copies the image out and waits for it.
+//
+// Runs on any Vulkan 1.0 device with a graphics queue, the first one the loader lists. For a machine
+// without a GPU, Mesa's lavapipe is picked with VK_ICD_FILENAMES=<path to lvp_icd.*.json>; the
+// shaders are the SPIR-V next to their GLSL sources (6.*_vulkan.vs/.fs, rebuilt with
+// glslangValidator -V -S vert|frag <source> -o <source>.spv).
+#define SCULPTURE_VULKAN_INSTANCE_FUNCTIONS(X) \
+    X(vkDestroyInstance) X(vkEnumeratePhysicalDevices) X(vkGetPhysicalDeviceProperties) \
+    X(vkGetPhysicalDeviceQueueFamilyProperties) X(vkGetPhysicalDeviceMemoryProperties) \
+    X(vkGetPhysicalDeviceFormatProperties) X(vkCreateDevice) X(vkGetDeviceProcAddr)
+#define SCULPTURE_VULKAN_DEVICE_FUNCTIONS(X) \
+    X(vkDestroyDevice) X(vkGetDeviceQueue) X(vkQueueSubmit) X(vkDeviceWaitIdle) \
+    X(vkAllocateMemory) X(vkFreeMemory) X(vkMapMemory) X(vkUnmapMemory) X(vkBindBufferMemory) \
+    X(vkBindImageMemory) X(vkGetBufferMemoryRequirements) X(vkGetImageMemoryRequirements) \
+    X(vkCreateFence) X(vkDestroyFence) X(vkResetFences) X(vkWaitForFences) \
+    X(vkCreateBuffer) X(vkDestroyBuffer) X(vkCreateImage) X(vkDestroyImage) X(vkCreateImageView) \
+    X(vkDestroyImageView) X(vkCreateShaderModule) X(vkDestroyShaderModule) X(vkCreateGraphicsPipelines) \
+    X(vkDestroyPipeline) X(vkCreatePipelineLayout) X(vkDestroyPipelineLayout) \
+    X(vkCreateDescriptorSetLayout) X(vkDestroyDescriptorSetLayout) X(vkCreateDescriptorPool) \
+    X(vkDestroyDescriptorPool) X(vkAllocateDescriptorSets) X(vkUpdateDescriptorSets) \
+    X(vkCreateFramebuffer) X(vkDestroyFramebuffer) X(vkCreateRenderPass) X(vkDestroyRenderPass) \
+    X(vkCreateCommandPool) X(vkDestroyCommandPool) X(vkResetCommandPool) X(vkAllocateCommandBuffers) \
+    X(vkBeginCommandBuffer) X(vkEndCommandBuffer) X(vkCmdBindPipeline) X(vkCmdBindDescriptorSets) \
+    X(vkCmdBindIndexBuffer) X(vkCmdBindVertexBuffers) X(vkCmdDraw) X(vkCmdDrawIndexed) \
+    X(vkCmdCopyImageToBuffer) X(vkCmdPipelineBarrier) X(vkCmdBeginRenderPass) X(vkCmdEndRenderPass) \
+    X(vkCmdExecuteCommands)
+
+class VulkanSculptureRenderer : public SculptureBackend
+{
+public:
+    const char* name() const override { return "vulkan"; }
+    bool needsGLContext() const override { return false; }
+    std::string deviceName() const override { return device ? properties.deviceName : ""; }
+    // a software implementation such as lavapipe or SwiftShader
+    bool cpuDevice() const { return device && properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_CPU; }
+
+    bool create(int width, int height, int stacks = 64, int slices = 64) override
+    {
+        targetWidth = width;
+        targetHeight = height;
+        meshStacks = stacks;
+        meshSlices = slices;
+        if (!createDevice() || !createTarget() || !createPipelines())
+            return false;
+
+        // the mesh is rewritten every frame, its indices never change; a unit cube per point light
+        generateSuperellipsoid(vertices, indices, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, stacks, slices);
+        const float cube[] = {
+            -0.5f, -0.5f, -0.5f,  0.5f, -0.5f, -0.5f,  0.5f,  0.5f, -0.5f,  0.5f,  0.5f, -0.5f, -0.5f,  0.5f, -0.5f, -0.5f, -0.5f, -0.5f,
+            -0.5f, -0.5f,  0.5f,  0.5f, -0.5f,  0.5f,  0.5f,  0.5f,  0.5f,  0.5f,  0.5f,  0.5f, -0.5f,  0.5f,  0.5f, -0.5f, -0.5f,  0.5f,
+            -0.5f,  0.5f,  0.5f, -0.5f,  0.5f, -0.5f, -0.5f, -0.5f, -0.5f, -0.5f, -0.5f, -0.5f, -0.5f, -0.5f,  0.5f, -0.5f,  0.5f,  0.5f,
+             0.5f,  0.5f,  0.5f,  0.5f,  0.5f, -0.5f,  0.5f, -0.5f, -0.5f,  0.5f, -0.5f, -0.5f,  0.5f, -0.5f,  0.5f,  0.5f,  0.5f,  0.5f,
+            -0.5f, -0.5f, -0.5f,  0.5f, -0.5f, -0.5f,  0.5f, -0.5f,  0.5f,  0.5f, -0.5f,  0.5f, -0.5f, -0.5f,  0.5f, -0.5f, -0.5f, -0.5f,
+            -0.5f,  0.5f, -0.5f,  0.5f,  0.5f, -0.5f,  0.5f,  0.5f,  0.5f,  0.5f,  0.5f,  0.5f, -0.5f,  0.5f,  0.5f, -0.5f,  0.5f, -0.5f
+        };
+        if (!createBuffer(meshBuffer, vertices.size() * sizeof(Vertex), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT)
+            || !createBuffer(indexBuffer, indices.size() * sizeof(unsigned int), VK_BUFFER_USAGE_INDEX_BUFFER_BIT)
+            || !createBuffer(lampBuffer, sizeof(cube), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT)
+            || !createBuffer(uniformBuffer, sizeof(LightingBlock), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT)
+            || !createBuffer(readbackBuffer, (VkDeviceSize)width * height * 4, VK_BUFFER_USAGE_TRANSFER_DST_BIT))
+            return false;
+        std::memcpy(indexBuffer.mapped, indices.data(), indices.size() * sizeof(unsigned int));
+        std::memcpy(lampBuffer.mapped, cube, sizeof(cube));
+
+        VkDescriptorBufferInfo uniforms = { uniformBuffer.buffer, 0, sizeof(LightingBlock) };
+        VkWriteDescriptorSet write = {};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = descriptorSet;
+        write.dstBinding = 0;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        write.pBufferInfo = &uniforms;
+        vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+
+        pixels.resize((size_t)width * height * 3);
+        return true;
+    }
+
+    // generates the mesh, records the batches on the pool, then submits them and waits for the image
+    void render(const SculptureScene& scene, ThreadPool& pool) override
+    {
+        generateSuperellipsoid(vertices, indices, 1.0f, 1.0f, 1.0f, scene.n1, scene.n2, meshStacks, meshSlices);
+        std::memcpy(meshBuffer.mapped, vertices.data(), vertices.size() * sizeof(Vertex));
+        cableLineVertices.clear();
+        scene.cables.appendSegmentLines(cableLineVertices);
+        size_t bodies = scene.spawnedCount() + 1;
+        size_t batches = (bodies + InstanceBatches::BATCH_SIZE - 1) / InstanceBatches::BATCH_SIZE;
+        // the previous frame has been waited for, so its buffers may be replaced
+        if (!reserveBuffer(cableBuffer, std::max<size_t>(cableLineVertices.size(), 1) * sizeof(float), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT)
+            || !reserveBuffer(instanceBuffer, (FIRST_BODY_RECORD + bodies) * InstanceBatches::RECORD_BYTES, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT)
+            || !reserveRecorders(batches + 1))
+            return;
+        if (!cableLineVertices.empty())
+            std::memcpy(cableBuffer.mapped, cableLineVertices.data(), cableLineVertices.size() * sizeof(float));
+        writeLighting(scene);
+
+        // one task per batch of shapes, the last one for the lamps and cables
+        std::atomic<bool> recorded(true);
+        pool.parallelFor(batches + 1, 1, [&](size_t begin, size_t end) {
+            for (size_t batch = begin; batch < end; batch++)
+            {
+                bool ok = batch < batches ? recordShapes(scene, batch, bodies) : recordLamps(scene, batch);
+                if (!ok)
+                    recorded = false;
+            }
+        });
+        if (!recorded)
+        {
+            std::cout << "ERROR::VULKAN::RECORDING_FAILED" << std::endl;
+            return;
+        }
+        submit(batches + 1);
+    }
+
+    const std::vector<unsigned char>& image() const override { return pixels; }
+    int width() const override { return targetWidth; }
+    int height() const override { return targetHeight; }
+
+    void destroy() override
+    {
+        if (device)
+        {
+            vkDeviceWaitIdle(device);
+            for (size_t i = 0; i < commandPools.size(); i++)
+                vkDestroyCommandPool(device, commandPools[i], nullptr);
+            commandPools.clear();
+            secondaries.clear();
+            Buffer* buffers[] = { &meshBuffer, &indexBuffer, &lampBuffer, &cableBuffer, &instanceBuffer, &uniformBuffer, &readbackBuffer };
+            for (Buffer* buffer : buffers)
+                destroyBuffer(*buffer);
+            VkPipeline pipelines[] = { shapePipeline, lampPipeline, cablePipeline };
+            for (VkPipeline pipeline : pipelines)
+                vkDestroyPipeline(device, pipeline, nullptr);
+            vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+            vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+            vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+            vkDestroyFramebuffer(device, framebuffer, nullptr);
+            vkDestroyRenderPass(device, renderPass, nullptr);
+            vkDestroyImageView(device, colorView, nullptr);
+            vkDestroyImageView(device, depthView, nullptr);
+            vkDestroyImage(device, colorImage, nullptr);
+            vkDestroyImage(device, depthImage, nullptr);
+            vkFreeMemory(device, colorMemory, nullptr);
+            vkFreeMemory(device, depthMemory, nullptr);
+            vkDestroyFence(device, fence, nullptr);
+            vkDestroyCommandPool(device, commandPool, nullptr);
+            vkDestroyDevice(device, nullptr);
+        }
+        if (instance)
+            vkDestroyInstance(instance, nullptr);
+        if (library)
+        {
+#ifdef _WIN32
+            FreeLibrary((HMODULE)library);
+#else
+            dlclose(library);
+#endif
+        }
+        shapePipeline = lampPipeline = cablePipeline = VK_NULL_HANDLE;
+        pipelineLayout = VK_NULL_HANDLE;
+        descriptorPool = VK_NULL_HANDLE;
+        descriptorSetLayout = VK_NULL_HANDLE;
+        framebuffer = VK_NULL_HANDLE;
+        renderPass = VK_NULL_HANDLE;
+        colorView = depthView = VK_NULL_HANDLE;
+        colorImage = depthImage = VK_NULL_HANDLE;
+        colorMemory = depthMemory = VK_NULL_HANDLE;
+        fence = VK_NULL_HANDLE;
+        commandPool = VK_NULL_HANDLE;
+        device = VK_NULL_HANDLE;
+        instance = VK_NULL_HANDLE;
+        library = nullptr;
+    }
+
+private:
+    // instance records 0 - 3 are the lamps, 4 the cables' identity, then body i at 5 + i
+    static constexpr size_t FIRST_BODY_RECORD = SculptureScene::LIGHTS + 1;
+
+    // the uniform block of 6.multiple_lights_vulkan.vs/.fs, std140
+    struct LightingBlock
+    {
+        glm::mat4 projectionView;
+        glm::vec3 viewPos; float pad0;
+        struct { glm::vec3 diffuse; float shininess; glm::vec3 specular; float pad; } material;
+        struct { glm::vec3 direction; float pad0; glm::vec3 ambient; float pad1; glm::vec3 diffuse; float pad2; glm::vec3 specular; float pad3; } dirLight;
+        struct
+        {
+            glm::vec3 position; float constant, linear, quadratic, pad0[2];
+            glm::vec3 ambient; float pad1; glm::vec3 diffuse; float pad2; glm::vec3 specular; float pad3;
+        } pointLights[SculptureScene::LIGHTS];
+        struct
+        {
+            glm::vec3 position; float cutOff; glm::vec3 direction; float outerCutOff;
+            float constant, linear, quadratic, pad0;
+            glm::vec3 ambient; float pad1; glm::vec3 diffuse; float pad2; glm::vec3 specular; float pad3;
+        } spotLight;
+    };
+    static_assert(sizeof(LightingBlock) == 592, "LightingBlock must match the std140 block of the shaders");
+
+    // a host-visible, coherent buffer, mapped for its lifetime
+    struct Buffer
+    {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        void* mapped = nullptr;
+        VkDeviceSize size = 0;
+    };
+
+#define SCULPTURE_VULKAN_DECLARE(function) PFN_##function function = nullptr;
+    SCULPTURE_VULKAN_INSTANCE_FUNCTIONS(SCULPTURE_VULKAN_DECLARE)
+    SCULPTURE_VULKAN_DEVICE_FUNCTIONS(SCULPTURE_VULKAN_DECLARE)
+#undef SCULPTURE_VULKAN_DECLARE
+
+    void* library = nullptr;
+    VkInstance instance = VK_NULL_HANDLE;
+    VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties properties = {};
+    VkPhysicalDeviceMemoryProperties memoryProperties = {};
+    VkDevice device = VK_NULL_HANDLE;
+    uint32_t queueFamily = 0;
+    VkQueue queue = VK_NULL_HANDLE;
+
+    VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+    VkImage colorImage = VK_NULL_HANDLE, depthImage = VK_NULL_HANDLE;
+    VkDeviceMemory colorMemory = VK_NULL_HANDLE, depthMemory = VK_NULL_HANDLE;
+    VkImageView colorView = VK_NULL_HANDLE, depthView = VK_NULL_HANDLE;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    VkFramebuffer framebuffer = VK_NULL_HANDLE;
+
+    VkDescriptorSetLayout descriptorSetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool descriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    VkPipelineLayout pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline shapePipeline = VK_NULL_HANDLE, lampPipeline = VK_NULL_HANDLE, cablePipeline = VK_NULL_HANDLE;
+
+    // the primary command buffer, and a pool and secondary per recording task
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    VkCommandBuffer primary = VK_NULL_HANDLE;
+    VkFence fence = VK_NULL_HANDLE;
+    std::vector<VkCommandPool> commandPools;
+    std::vector<VkCommandBuffer> secondaries;
+
+    Buffer meshBuffer, indexBuffer, lampBuffer, cableBuffer, instanceBuffer, uniformBuffer, readbackBuffer;
+    int meshStacks = 64, meshSlices = 64;
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<float> cableLineVertices;
+    int targetWidth = 0, targetHeight = 0;
+    std::vector<unsigned char> pixels;
+
+    static bool check(VkResult result, const char* what)
+    {
+        if (result != VK_SUCCESS)
+            std::cout << "ERROR::VULKAN::" << what << ": " << result << std::endl;
+        return result == VK_SUCCESS;
+    }
+
+    // the loader, an instance, the first device with a graphics queue and its entry points
+    bool createDevice()
+    {
+#ifdef _WIN32
+        library = (void*)LoadLibraryA("vulkan-1.dll");
+        PFN_vkGetInstanceProcAddr getInstanceProcAddr = library ? (PFN_vkGetInstanceProcAddr)GetProcAddress((HMODULE)library, "vkGetInstanceProcAddr") : nullptr;
+#else
+        library = dlopen("libvulkan.so.1", RTLD_NOW | RTLD_LOCAL);
+        PFN_vkGetInstanceProcAddr getInstanceProcAddr = library ? (PFN_vkGetInstanceProcAddr)dlsym(library, "vkGetInstanceProcAddr") : nullptr;
+#endif
+        if (!getInstanceProcAddr)
+        {
+            std::cout << "ERROR::VULKAN::LOADER_NOT_FOUND" << std::endl;
+            return false;
+        }
+        PFN_vkCreateInstance createInstance = (PFN_vkCreateInstance)getInstanceProcAddr(VK_NULL_HANDLE, "vkCreateInstance");
+        VkApplicationInfo application = {};
+        application.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+        application.pApplicationName = "sculpture";
+        application.apiVersion = VK_API_VERSION_1_0;
+        VkInstanceCreateInfo instanceInfo = {};
+        instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+        instanceInfo.pApplicationInfo = &application;
+        if (!createInstance || !check(createInstance(&instanceInfo, nullptr, &instance), "CREATE_INSTANCE"))
+            return false;
+#define SCULPTURE_VULKAN_LOAD(function) function = (PFN_##function)getInstanceProcAddr(instance, #function);
+        SCULPTURE_VULKAN_INSTANCE_FUNCTIONS(SCULPTURE_VULKAN_LOAD)
+#undef SCULPTURE_VULKAN_LOAD
+
+        uint32_t count = 0;
+        vkEnumeratePhysicalDevices(instance, &count, nullptr);
+        std::vector<VkPhysicalDevice> physicalDevices(count);
+        vkEnumeratePhysicalDevices(instance, &count, physicalDevices.data());
+        for (VkPhysicalDevice candidate : physicalDevices)
+        {
+            uint32_t families = 0;
+            vkGetPhysicalDeviceQueueFamilyProperties(candidate, &families, nullptr);
+            std::vector<VkQueueFamilyProperties> familyProperties(families);
+            vkGetPhysicalDeviceQueueFamilyProperties(candidate, &families, familyProperties.data());
+            for (uint32_t family = 0; family < families && !physicalDevice; family++)
+                if (familyProperties[family].queueFlags & VK_QUEUE_GRAPHICS_BIT)
+                {
+                    physicalDevice = candidate;
+                    queueFamily = family;
+                }
+            if (physicalDevice)
+                break;
+        }
+        if (!physicalDevice)
+        {
+            std::cout << "ERROR::VULKAN::NO_GRAPHICS_DEVICE" << std::endl;
+            return false;
+        }
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+        float priority = 1.0f;
+        VkDeviceQueueCreateInfo queueInfo = {};
+        queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+        queueInfo.queueFamilyIndex = queueFamily;
+        queueInfo.queueCount = 1;
+        queueInfo.pQueuePriorities = &priority;
+        VkDeviceCreateInfo deviceInfo = {};
+        deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        deviceInfo.queueCreateInfoCount = 1;
+        deviceInfo.pQueueCreateInfos = &queueInfo;
+        if (!check(vkCreateDevice(physicalDevice, &deviceInfo, nullptr, &device), "CREATE_DEVICE"))
+            return false;
+#define SCULPTURE_VULKAN_LOAD(function) function = (PFN_##function)vkGetDeviceProcAddr(device, #function);
+        SCULPTURE_VULKAN_DEVICE_FUNCTIONS(SCULPTURE_VULKAN_LOAD)
+#undef SCULPTURE_VULKAN_LOAD
+        vkGetDeviceQueue(device, queueFamily, 0, &queue);
+
+        VkCommandPoolCreateInfo poolInfo = {};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolInfo.queueFamilyIndex = queueFamily;
+        VkFenceCreateInfo fenceInfo = {};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        return check(vkCreateCommandPool(device, &poolInfo, nullptr, &commandPool), "CREATE_COMMAND_POOL")
+            && allocateCommandBuffer(commandPool, VK_COMMAND_BUFFER_LEVEL_PRIMARY, primary)
+            && check(vkCreateFence(device, &fenceInfo, nullptr, &fence), "CREATE_FENCE");
+    }
+
+    // the colour and depth images, cleared by a render pass that leaves the colour ready to copy out
+    bool createTarget()
+    {
+        const VkFormat depthFormats[] = { VK_FORMAT_X8_D24_UNORM_PACK32, VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D32_SFLOAT, VK_FORMAT_D16_UNORM };
+        for (VkFormat format : depthFormats)
+        {
+            VkFormatProperties formatProperties;
+            vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+            if (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+            {
+                depthFormat = format;
+                break;
+            }
+        }
+        bool stencil = depthFormat == VK_FORMAT_D24_UNORM_S8_UINT;
+        if (depthFormat == VK_FORMAT_UNDEFINED
+            || !createImage(VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+                VK_IMAGE_ASPECT_COLOR_BIT, colorImage, colorMemory, colorView)
+            || !createImage(depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+                VK_IMAGE_ASPECT_DEPTH_BIT | (stencil ? VK_IMAGE_ASPECT_STENCIL_BIT : 0), depthImage, depthMemory, depthView))
+            return false;
+
+        VkAttachmentDescription attachments[2] = {};
+        attachments[0].format = VK_FORMAT_R8G8B8A8_UNORM;
+        attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+        attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+        attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        attachments[0].finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        attachments[1] = attachments[0];
+        attachments[1].format = depthFormat;
+        attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        VkAttachmentReference colorReference = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+        VkAttachmentReference depthReference = { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+        VkSubpassDescription subpass = {};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = 1;
+        subpass.pColorAttachments = &colorReference;
+        subpass.pDepthStencilAttachment = &depthReference;
+        // the last frame's copy is read before the image is cleared, the drawing finished before it
+        // is copied
+        VkSubpassDependency dependencies[2] = {};
+        dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[0].dstSubpass = 0;
+        dependencies[0].srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependencies[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+        dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        dependencies[1].srcSubpass = 0;
+        dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+        dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        VkRenderPassCreateInfo renderPassInfo = {};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = 2;
+        renderPassInfo.pAttachments = attachments;
+        renderPassInfo.subpassCount = 1;
+        renderPassInfo.pSubpasses = &subpass;
+        renderPassInfo.dependencyCount = 2;
+        renderPassInfo.pDependencies = dependencies;
+        if (!check(vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass), "CREATE_RENDER_PASS"))
+            return false;
+
+        VkImageView views[2] = { colorView, depthView };
+        VkFramebufferCreateInfo framebufferInfo = {};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = renderPass;
+        framebufferInfo.attachmentCount = 2;
+        framebufferInfo.pAttachments = views;
+        framebufferInfo.width = (uint32_t)targetWidth;
+        framebufferInfo.height = (uint32_t)targetHeight;
+        framebufferInfo.layers = 1;
+        return check(vkCreateFramebuffer(device, &framebufferInfo, nullptr, &framebuffer), "CREATE_FRAMEBUFFER");
+    }
+
+    bool createImage(VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect, VkImage& image, VkDeviceMemory& memory, VkImageView& view)
+    {
+        VkImageCreateInfo imageInfo = {};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = format;
+        imageInfo.extent = { (uint32_t)targetWidth, (uint32_t)targetHeight, 1 };
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = usage;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        if (!check(vkCreateImage(device, &imageInfo, nullptr, &image), "CREATE_IMAGE"))
+            return false;
+        VkMemoryRequirements requirements;
+        vkGetImageMemoryRequirements(device, image, &requirements);
+        if (!allocate(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, memory)
+            || !check(vkBindImageMemory(device, image, memory, 0), "BIND_IMAGE_MEMORY"))
+            return false;
+        VkImageViewCreateInfo viewInfo = {};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = format;
+        viewInfo.subresourceRange = { aspect, 0, 1, 0, 1 };
+        return check(vkCreateImageView(device, &viewInfo, nullptr, &view), "CREATE_IMAGE_VIEW");
+    }
+
+    // memory of a type requirements allow, with the wanted properties if there is such a type
+    bool allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags wanted, VkDeviceMemory& memory)
+    {
+        uint32_t type = UINT32_MAX;
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount && type == UINT32_MAX; i++)
+            if ((requirements.memoryTypeBits & (1u << i)) && (memoryProperties.memoryTypes[i].propertyFlags & wanted) == wanted)
+                type = i;
+        for (uint32_t i = 0; i < memoryProperties.memoryTypeCount && type == UINT32_MAX && !(wanted & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT); i++)
+            if (requirements.memoryTypeBits & (1u << i))
+                type = i;
+        if (type == UINT32_MAX)
+        {
+            std::cout << "ERROR::VULKAN::NO_MEMORY_TYPE" << std::endl;
+            return false;
+        }
+        VkMemoryAllocateInfo allocateInfo = {};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocateInfo.allocationSize = requirements.size;
+        allocateInfo.memoryTypeIndex = type;
+        return check(vkAllocateMemory(device, &allocateInfo, nullptr, &memory), "ALLOCATE_MEMORY");
+    }
+
+    bool createBuffer(Buffer& buffer, VkDeviceSize size, VkBufferUsageFlags usage)
+    {
+        VkBufferCreateInfo bufferInfo = {};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = size;
+        bufferInfo.usage = usage;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        if (!check(vkCreateBuffer(device, &bufferInfo, nullptr, &buffer.buffer), "CREATE_BUFFER"))
+            return false;
+        VkMemoryRequirements requirements;
+        vkGetBufferMemoryRequirements(device, buffer.buffer, &requirements);
+        buffer.size = size;
+        return allocate(requirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, buffer.memory)
+            && check(vkBindBufferMemory(device, buffer.buffer, buffer.memory, 0), "BIND_BUFFER_MEMORY")
+            && check(vkMapMemory(device, buffer.memory, 0, VK_WHOLE_SIZE, 0, &buffer.mapped), "MAP_MEMORY");
+    }
+
+    void destroyBuffer(Buffer& buffer)
+    {
+        if (buffer.mapped)
+            vkUnmapMemory(device, buffer.memory);
+        vkDestroyBuffer(device, buffer.buffer, nullptr);
+        vkFreeMemory(device, buffer.memory, nullptr);
+        buffer = Buffer();
+    }
+
+    // a buffer of at least size bytes, doubled when it grows; the GPU must be done with the old one
+    bool reserveBuffer(Buffer& buffer, VkDeviceSize size, VkBufferUsageFlags usage)
+    {
+        if (size <= buffer.size)
+            return true;
+        size = std::max(size, buffer.size * 2);
+        destroyBuffer(buffer);
+        return createBuffer(buffer, size, usage);
+    }
+
+    bool allocateCommandBuffer(VkCommandPool pool, VkCommandBufferLevel level, VkCommandBuffer& commands)
+    {
+        VkCommandBufferAllocateInfo allocateInfo = {};
+        allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocateInfo.commandPool = pool;
+        allocateInfo.level = level;
+        allocateInfo.commandBufferCount = 1;
+        return check(vkAllocateCommandBuffers(device, &allocateInfo, &commands), "ALLOCATE_COMMAND_BUFFERS");
+    }
+
+    // a command pool and secondary for each of count tasks; pools are not shared between threads
+    bool reserveRecorders(size_t count)
+    {
+        VkCommandPoolCreateInfo poolInfo = {};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolInfo.queueFamilyIndex = queueFamily;
+        while (commandPools.size() < count)
+        {
+            VkCommandPool pool;
+            VkCommandBuffer commands;
+            if (!check(vkCreateCommandPool(device, &poolInfo, nullptr, &pool), "CREATE_COMMAND_POOL"))
+                return false;
+            commandPools.push_back(pool);
+            if (!allocateCommandBuffer(pool, VK_COMMAND_BUFFER_LEVEL_SECONDARY, commands))
+                return false;
+            secondaries.push_back(commands);
+        }
+        return true;
+    }
+
+    VkShaderModule loadShader(const char* path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            std::cout << "ERROR::VULKAN::SHADER_NOT_FOUND: " << path << std::endl;
+            return VK_NULL_HANDLE;
+        }
+        std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        std::vector<uint32_t> code((bytes.size() + 3) / 4);
+        std::memcpy(code.data(), bytes.data(), bytes.size());
+        VkShaderModuleCreateInfo moduleInfo = {};
+        moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        moduleInfo.codeSize = bytes.size();
+        moduleInfo.pCode = code.data();
+        VkShaderModule module = VK_NULL_HANDLE;
+        check(vkCreateShaderModule(device, &moduleInfo, nullptr, &module), "CREATE_SHADER_MODULE");
+        return module;
+    }
+
+    // the uniform block's layout, and the lit pipeline of the shapes and the white ones of the lamps
+    // and cables; no culling, depth tested like GL's default GL_LESS
+    bool createPipelines()
+    {
+        VkDescriptorSetLayoutBinding binding = {};
+        binding.binding = 0;
+        binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        binding.descriptorCount = 1;
+        binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+        VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.bindingCount = 1;
+        layoutInfo.pBindings = &binding;
+        if (!check(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout), "CREATE_DESCRIPTOR_SET_LAYOUT"))
+            return false;
+        VkDescriptorPoolSize poolSize = { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 };
+        VkDescriptorPoolCreateInfo poolInfo = {};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.maxSets = 1;
+        poolInfo.poolSizeCount = 1;
+        poolInfo.pPoolSizes = &poolSize;
+        if (!check(vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool), "CREATE_DESCRIPTOR_POOL"))
+            return false;
+        VkDescriptorSetAllocateInfo setInfo = {};
+        setInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        setInfo.descriptorPool = descriptorPool;
+        setInfo.descriptorSetCount = 1;
+        setInfo.pSetLayouts = &descriptorSetLayout;
+        if (!check(vkAllocateDescriptorSets(device, &setInfo, &descriptorSet), "ALLOCATE_DESCRIPTOR_SETS"))
+            return false;
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = 1;
+        pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+        if (!check(vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout), "CREATE_PIPELINE_LAYOUT"))
+            return false;
+
+        VkShaderModule lightingVertex = loadShader("6.multiple_lights_vulkan.vs.spv");
+        VkShaderModule lightingFragment = loadShader("6.multiple_lights_vulkan.fs.spv");
+        VkShaderModule lampVertex = loadShader("6.light_cubes_vulkan.vs.spv");
+        VkShaderModule lampFragment = loadShader("6.light_cube_vulkan.fs.spv");
+        bool created = lightingVertex && lightingFragment && lampVertex && lampFragment
+            && createPipeline(lightingVertex, lightingFragment, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, true, shapePipeline)
+            && createPipeline(lampVertex, lampFragment, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, false, lampPipeline)
+            && createPipeline(lampVertex, lampFragment, VK_PRIMITIVE_TOPOLOGY_LINE_LIST, false, cablePipeline);
+        VkShaderModule modules[] = { lightingVertex, lightingFragment, lampVertex, lampFragment };
+        for (VkShaderModule module : modules)
+            vkDestroyShaderModule(device, module, nullptr);
+        return created;
+    }
+
+    // binding 0 the mesh (Vertex when lit, else positions only), binding 1 the instance records
+    bool createPipeline(VkShaderModule vertexShader, VkShaderModule fragmentShader, VkPrimitiveTopology topology, bool lit, VkPipeline& pipeline)
+    {
+        VkPipelineShaderStageCreateInfo stages[2] = {};
+        stages[0].sType = stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+        stages[0].module = vertexShader;
+        stages[0].pName = "main";
+        stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        stages[1].module = fragmentShader;
+        stages[1].pName = "main";
+
+        VkVertexInputBindingDescription bindings[2] = {
+            { 0, lit ? (uint32_t)sizeof(Vertex) : 3 * (uint32_t)sizeof(float), VK_VERTEX_INPUT_RATE_VERTEX },
+            { 1, (uint32_t)InstanceBatches::RECORD_BYTES, VK_VERTEX_INPUT_RATE_INSTANCE }
+        };
+        std::vector<VkVertexInputAttributeDescription> attributes;
+        attributes.push_back({ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0 });
+        if (lit)
+            attributes.push_back({ 1, 0, VK_FORMAT_R32G32B32_SFLOAT, (uint32_t)offsetof(Vertex, Normal) });
+        const uint32_t first = InstanceBatches::FIRST_LOCATION;
+        for (uint32_t column = 0; column < 4; column++)
+            attributes.push_back({ first + column, 1, VK_FORMAT_R32G32B32A32_SFLOAT, column * 4 * (uint32_t)sizeof(float) });
+        for (uint32_t column = 0; lit && column < 3; column++)
+            attributes.push_back({ first + 4 + column, 1, VK_FORMAT_R32G32B32_SFLOAT, (16 + column * 3) * (uint32_t)sizeof(float) });
+        VkPipelineVertexInputStateCreateInfo vertexInput = {};
+        vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        vertexInput.vertexBindingDescriptionCount = 2;
+        vertexInput.pVertexBindingDescriptions = bindings;
+        vertexInput.vertexAttributeDescriptionCount = (uint32_t)attributes.size();
+        vertexInput.pVertexAttributeDescriptions = attributes.data();
+
+        VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+        inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        inputAssembly.topology = topology;
+        VkViewport viewport = { 0.0f, 0.0f, (float)targetWidth, (float)targetHeight, 0.0f, 1.0f };
+        VkRect2D scissor = { { 0, 0 }, { (uint32_t)targetWidth, (uint32_t)targetHeight } };
+        VkPipelineViewportStateCreateInfo viewportState = {};
+        viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+        viewportState.viewportCount = 1;
+        viewportState.pViewports = &viewport;
+        viewportState.scissorCount = 1;
+        viewportState.pScissors = &scissor;
+        VkPipelineRasterizationStateCreateInfo rasterization = {};
+        rasterization.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+        rasterization.polygonMode = VK_POLYGON_MODE_FILL;
+        rasterization.cullMode = VK_CULL_MODE_NONE;
+        rasterization.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+        rasterization.lineWidth = 1.0f;
+        VkPipelineMultisampleStateCreateInfo multisample = {};
+        multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+        multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+        VkPipelineDepthStencilStateCreateInfo depthStencil = {};
+        depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+        depthStencil.depthTestEnable = VK_TRUE;
+        depthStencil.depthWriteEnable = VK_TRUE;
+        depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+        VkPipelineColorBlendAttachmentState blendAttachment = {};
+        blendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        VkPipelineColorBlendStateCreateInfo blend = {};
+        blend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        blend.attachmentCount = 1;
+        blend.pAttachments = &blendAttachment;
+
+        VkGraphicsPipelineCreateInfo pipelineInfo = {};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        pipelineInfo.stageCount = 2;
+        pipelineInfo.pStages = stages;
+        pipelineInfo.pVertexInputState = &vertexInput;
+        pipelineInfo.pInputAssemblyState = &inputAssembly;
+        pipelineInfo.pViewportState = &viewportState;
+        pipelineInfo.pRasterizationState = &rasterization;
+        pipelineInfo.pMultisampleState = &multisample;
+        pipelineInfo.pDepthStencilState = &depthStencil;
+        pipelineInfo.pColorBlendState = &blend;
+        pipelineInfo.layout = pipelineLayout;
+        pipelineInfo.renderPass = renderPass;
+        pipelineInfo.subpass = 0;
+        return check(vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline), "CREATE_GRAPHICS_PIPELINES");
+    }
+
+    // the values SculptureRenderer::setLightingUniforms() gives the GL passes. The material is the
+    // batch's: the solid yellow diffuse map and no specular map
+    void writeLighting(const SculptureScene& scene)
+    {
+        const Camera& camera = scene.camera;
+        // GL's clip depth of -w..w becomes Vulkan's 0..w; window y needs no flip, as Vulkan's first
+        // row is GL's bottom one, which is what image() holds first
+        glm::mat4 depthRange(1.0f);
+        depthRange[2][2] = 0.5f;
+        depthRange[3][2] = 0.5f;
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)targetWidth / (float)targetHeight, 0.1f, 100.0f);
+        glm::mat4 view = glm::lookAt(camera.Position, camera.Position + camera.Front, camera.Up);
+
+        LightingBlock block = {};
+        block.projectionView = depthRange * projection * view;
+        block.viewPos = camera.Position;
+        block.material.diffuse = glm::vec3(1.0f, 1.0f, 0.0f);
+        block.material.shininess = 32.0f;
+        block.material.specular = glm::vec3(0.0f);
+        block.dirLight.direction = glm::vec3(-0.2f, -1.0f, -0.3f);
+        block.dirLight.ambient = glm::vec3(0.05f);
+        block.dirLight.diffuse = glm::vec3(0.4f);
+        block.dirLight.specular = glm::vec3(0.5f);
+        for (int i = 0; i < SculptureScene::LIGHTS; i++)
+        {
+            block.pointLights[i].position = scene.lightPositions[i];
+            block.pointLights[i].ambient = glm::vec3(0.05f);
+            block.pointLights[i].diffuse = glm::vec3(0.8f) * scene.lightIntensities[i];
+            block.pointLights[i].specular = glm::vec3(1.0f) * scene.lightIntensities[i];
+            block.pointLights[i].constant = 1.0f;
+            block.pointLights[i].linear = 0.09f;
+            block.pointLights[i].quadratic = 0.032f;
+        }
+        block.spotLight.position = camera.Position;
+        block.spotLight.direction = camera.Front;
+        block.spotLight.ambient = glm::vec3(0.0f);
+        block.spotLight.diffuse = glm::vec3(1.0f);
+        block.spotLight.specular = glm::vec3(1.0f);
+        block.spotLight.constant = 1.0f;
+        block.spotLight.linear = 0.09f;
+        block.spotLight.quadratic = 0.032f;
+        block.spotLight.cutOff = glm::cos(glm::radians(12.5f));
+        block.spotLight.outerCutOff = glm::cos(glm::radians(15.0f));
+        std::memcpy(uniformBuffer.mapped, &block, sizeof(block));
+    }
+
+    // resets task's pool and begins its secondary inside the render pass
+    bool beginSecondary(size_t task)
+    {
+        VkCommandBufferInheritanceInfo inheritance = {};
+        inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritance.renderPass = renderPass;
+        inheritance.subpass = 0;
+        inheritance.framebuffer = framebuffer;
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        beginInfo.pInheritanceInfo = &inheritance;
+        return vkResetCommandPool(device, commandPools[task], 0) == VK_SUCCESS
+            && vkBeginCommandBuffer(secondaries[task], &beginInfo) == VK_SUCCESS;
+    }
+
+    // (on a pool thread) the records of bodies batch * BATCH_SIZE onwards and their instanced draw
+    bool recordShapes(const SculptureScene& scene, size_t batch, size_t bodies)
+    {
+        size_t first = batch * InstanceBatches::BATCH_SIZE;
+        size_t count = std::min(InstanceBatches::BATCH_SIZE, bodies - first);
+        float* records = (float*)instanceBuffer.mapped + (FIRST_BODY_RECORD + first) * InstanceBatches::RECORD_FLOATS;
+        for (size_t i = 0; i < count; i++)
+            InstanceBatches::writeRecord(records + i * InstanceBatches::RECORD_FLOATS, scene.bodyMatrix(first + i));
+
+        if (!beginSecondary(batch))
+            return false;
+        VkCommandBuffer commands = secondaries[batch];
+        VkBuffer buffers[2] = { meshBuffer.buffer, instanceBuffer.buffer };
+        VkDeviceSize offsets[2] = { 0, 0 };
+        vkCmdBindPipeline(commands, VK_PIPELINE_BIND_POINT_GRAPHICS, shapePipeline);
+        vkCmdBindDescriptorSets(commands, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+        vkCmdBindVertexBuffers(commands, 0, 2, buffers, offsets);
+        vkCmdBindIndexBuffer(commands, indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+        vkCmdDrawIndexed(commands, (uint32_t)indices.size(), (uint32_t)count, 0, 0, (uint32_t)(FIRST_BODY_RECORD + first));
+        return vkEndCommandBuffer(commands) == VK_SUCCESS;
+    }
+
+    // (on a pool thread) the lamps' records and draw, then the cables with the identity record
+    bool recordLamps(const SculptureScene& scene, size_t task)
+    {
+        float* records = (float*)instanceBuffer.mapped;
+        for (int i = 0; i < SculptureScene::LIGHTS; i++)
+        {
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), scene.lightPositions[i]);
+            InstanceBatches::writeRecord(records + i * InstanceBatches::RECORD_FLOATS, glm::scale(model, glm::vec3(0.2f)));
+        }
+        InstanceBatches::writeRecord(records + SculptureScene::LIGHTS * InstanceBatches::RECORD_FLOATS, glm::mat4(1.0f));
+
+        if (!beginSecondary(task))
+            return false;
+        VkCommandBuffer commands = secondaries[task];
+        VkBuffer buffers[2] = { lampBuffer.buffer, instanceBuffer.buffer };
+        VkDeviceSize offsets[2] = { 0, 0 };
+        vkCmdBindPipeline(commands, VK_PIPELINE_BIND_POINT_GRAPHICS, lampPipeline);
+        vkCmdBindDescriptorSets(commands, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+        vkCmdBindVertexBuffers(commands, 0, 2, buffers, offsets);
+        vkCmdDraw(commands, 36, SculptureScene::LIGHTS, 0, 0);
+        if (!cableLineVertices.empty())
+        {
+            buffers[0] = cableBuffer.buffer;
+            vkCmdBindPipeline(commands, VK_PIPELINE_BIND_POINT_GRAPHICS, cablePipeline);
+            vkCmdBindVertexBuffers(commands, 0, 2, buffers, offsets);
+            vkCmdDraw(commands, (uint32_t)(cableLineVertices.size() / 3), 1, 0, SculptureScene::LIGHTS);
+        }
+        return vkEndCommandBuffer(commands) == VK_SUCCESS;
+    }
+
+    // the render pass executing the tasks' secondaries, the copy out, and the wait for both
+    void submit(size_t tasks)
+    {
+        VkCommandBufferBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        if (!check(vkResetCommandPool(device, commandPool, 0), "RESET_COMMAND_POOL")
+            || !check(vkBeginCommandBuffer(primary, &beginInfo), "BEGIN_COMMAND_BUFFER"))
+            return;
+        VkClearValue clears[2];
+        clears[0].color = { { 0.1f, 0.1f, 0.1f, 1.0f } };
+        clears[1].depthStencil = { 1.0f, 0 };
+        VkRenderPassBeginInfo renderPassBegin = {};
+        renderPassBegin.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassBegin.renderPass = renderPass;
+        renderPassBegin.framebuffer = framebuffer;
+        renderPassBegin.renderArea = { { 0, 0 }, { (uint32_t)targetWidth, (uint32_t)targetHeight } };
+        renderPassBegin.clearValueCount = 2;
+        renderPassBegin.pClearValues = clears;
+        vkCmdBeginRenderPass(primary, &renderPassBegin, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        vkCmdExecuteCommands(primary, (uint32_t)tasks, secondaries.data());
+        vkCmdEndRenderPass(primary);
+
+        VkBufferImageCopy region = {};
+        region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        region.imageExtent = { (uint32_t)targetWidth, (uint32_t)targetHeight, 1 };
+        vkCmdCopyImageToBuffer(primary, colorImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer.buffer, 1, &region);
+        VkBufferMemoryBarrier readable = {};
+        readable.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        readable.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        readable.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        readable.srcQueueFamilyIndex = readable.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        readable.buffer = readbackBuffer.buffer;
+        readable.size = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier(primary, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &readable, 0, nullptr);
+        if (!check(vkEndCommandBuffer(primary), "END_COMMAND_BUFFER"))
+            return;
+
+        VkSubmitInfo submitInfo = {};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &primary;
+        if (!check(vkQueueSubmit(queue, 1, &submitInfo, fence), "QUEUE_SUBMIT")
+            || !check(vkWaitForFences(device, 1, &fence, VK_TRUE, UINT64_MAX), "WAIT_FOR_FENCES"))
+            return;
+        vkResetFences(device, 1, &fence);
+
+        // RGBA to the RGB rows of image()
+        const unsigned char* rgba = (const unsigned char*)readbackBuffer.mapped;
+        for (size_t i = 0, count = (size_t)targetWidth * targetHeight; i < count; i++)
+        {
+            pixels[i * 3] = rgba[i * 4];
+            pixels[i * 3 + 1] = rgba[i * 4 + 1];
+            pixels[i * 3 + 2] = rgba[i * 4 + 2];
+        }
+    }
+};
+
+#endif